@@ -5,6 +5,7 @@
 #pragma once
 
 #include <climits>
+#include <cstdint>
 #include <cstring>
 #include <limits>
 #include <type_traits>
@@ -68,23 +69,88 @@ private:
   extra_ref_cnt_value value_;
 };
 
-inline int64_t string_hash(const char *p, size_t l) __attribute__ ((always_inline)) ubsan_supp("alignment");
+namespace string_hash_impl {
 
-int64_t string_hash(const char *p, size_t l) {
-  constexpr uint64_t HASH_MUL = 1915239017;
-  uint64_t hash = 2147483648U;
+// the wyhash constants
+constexpr uint64_t SECRET[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
 
-  size_t prev = (l & 3);
-  for (size_t i = 0; i < prev; i++) {
-    hash = hash * HASH_MUL + p[i];
-  }
+constexpr void mum(uint64_t &a, uint64_t &b) noexcept {
+  const __uint128_t r = static_cast<__uint128_t>(a) * b;
+  a = static_cast<uint64_t>(r);
+  b = static_cast<uint64_t>(r >> 64);
+}
+
+constexpr uint64_t mix(uint64_t a, uint64_t b) noexcept {
+  mum(a, b);
+  return a ^ b;
+}
 
-  const auto *p_uint = reinterpret_cast<const uint32_t *>(p + prev);
-  l >>= 2;
-  while (l-- > 0) {
-    hash = hash * HASH_MUL + *p_uint++;
+inline uint64_t read8(const char *p) noexcept {
+  uint64_t v = 0;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t read4(const char *p) noexcept {
+  uint32_t v = 0;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t read3(const char *p, size_t l) noexcept {
+  return (static_cast<uint64_t>(static_cast<uint8_t>(p[0])) << 16) |
+         (static_cast<uint64_t>(static_cast<uint8_t>(p[l >> 1])) << 8) |
+         static_cast<uint8_t>(p[l - 1]);
+}
+
+constexpr uint64_t SEED = mix(SECRET[0], SECRET[1]);
+
+} // namespace string_hash_impl
+
+// The wyhash: the input is consumed by 8 byte words, the long inputs by 3 independent 16 byte lanes.
+// The hash is computed by the compiler for the constant keys as well, so it must be the same on all the platforms.
+inline int64_t string_hash(const char *p, size_t l) __attribute__ ((always_inline));
+
+int64_t string_hash(const char *p, size_t l) {
+  using namespace string_hash_impl;
+  uint64_t seed = SEED;
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if (l <= 16) {
+    if (l >= 4) {
+      const size_t shift = (l >> 3) << 2;
+      a = (read4(p) << 32) | read4(p + shift);
+      b = (read4(p + l - 4) << 32) | read4(p + l - 4 - shift);
+    } else if (l > 0) {
+      a = read3(p, l);
+    }
+  } else {
+    const char *cur = p;
+    size_t left = l;
+    if (left > 48) {
+      uint64_t seed1 = seed;
+      uint64_t seed2 = seed;
+      do {
+        seed = mix(read8(cur) ^ SECRET[1], read8(cur + 8) ^ seed);
+        seed1 = mix(read8(cur + 16) ^ SECRET[2], read8(cur + 24) ^ seed1);
+        seed2 = mix(read8(cur + 32) ^ SECRET[3], read8(cur + 40) ^ seed2);
+        cur += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (left > 16) {
+      seed = mix(read8(cur) ^ SECRET[1], read8(cur + 8) ^ seed);
+      cur += 16;
+      left -= 16;
+    }
+    a = read8(cur + left - 16);
+    b = read8(cur + left - 8);
   }
-  const auto result = static_cast<int64_t>(hash);
+  a ^= SECRET[1];
+  b ^= seed;
+  mum(a, b);
+  const auto result = static_cast<int64_t>(mix(a ^ SECRET[0] ^ l, b ^ SECRET[1]));
   // to ensure that there is no way to get the -9223372036854775808L during code generation
   return (result != std::numeric_limits<int64_t>::min()) * result;
 }
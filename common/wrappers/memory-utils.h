@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <sys/mman.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -19,6 +20,16 @@
   #define MADV_DONTDUMP 16
 #endif
 
+#ifndef MADV_HUGEPAGE
+  #define MADV_HUGEPAGE 14
+#endif
+
+#ifndef MADV_POPULATE_WRITE
+  #define MADV_POPULATE_WRITE 23
+#endif
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
 inline int our_madvise(void *addr, size_t len, int advice) noexcept {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -33,6 +44,38 @@ inline void *mmap_shared(size_t size, int fd = -1) noexcept {
   return mem;
 }
 
+// maps the memory aligned to the huge page size and asks the kernel to back it with the transparent huge pages,
+// returns MAP_FAILED on failure; the memory can be unmapped with the usual munmap(mem, size)
+inline void *mmap_huge_pages(size_t size, int flags) noexcept {
+  const size_t page_size = getpagesize();
+  size = (size + page_size - 1) / page_size * page_size;
+  void *mem = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (mem == MAP_FAILED) {
+    return mem;
+  }
+  char *begin = static_cast<char *>(mem);
+  char *aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(begin) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+  if (aligned != begin) {
+    munmap(begin, aligned - begin);
+  }
+  if (char *tail = aligned + size; tail != begin + size + HUGE_PAGE_SIZE) {
+    munmap(tail, begin + size + HUGE_PAGE_SIZE - tail);
+  }
+  our_madvise(aligned, size, MADV_HUGEPAGE);
+  return aligned;
+}
+
+// faults in the memory in advance, so the first touches don't pay the page faults
+inline void prefault_memory(void *mem, size_t size) noexcept {
+  // MADV_POPULATE_WRITE is supported since Linux 5.14, touch the pages manually on the older kernels
+  if (our_madvise(mem, size, MADV_POPULATE_WRITE) != 0) {
+    const size_t page_size = getpagesize();
+    for (size_t offset = 0; offset < size; offset += page_size) {
+      static_cast<volatile char *>(mem)[offset] = static_cast<volatile char *>(mem)[offset];
+    }
+  }
+}
+
 inline auto get_malloc_stats() noexcept {
 #ifdef __GLIBC_PREREQ
   #if __GLIBC_PREREQ(2, 33)
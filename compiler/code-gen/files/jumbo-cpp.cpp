@@ -0,0 +1,52 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "compiler/code-gen/files/jumbo-cpp.h"
+
+#include "common/algorithms/hashes.h"
+#include "common/wrappers/fmt_format.h"
+
+#include "compiler/code-gen/common.h"
+#include "compiler/code-gen/includes.h"
+#include "compiler/compiler-core.h"
+#include "compiler/data/function-data.h"
+
+JumboCpp::JumboCpp(std::string subdir, std::vector<FunctionPtr> &&functions) :
+  subdir_(std::move(subdir)),
+  functions_(std::move(functions)) {
+  kphp_assert(!functions_.empty());
+}
+
+void JumboCpp::compile(CodeGenerator &W) const {
+  // the name depends on the first function only, so the object file of the group keeps its name when the group changes
+  W << OpenFile(fmt_format("_jumbo_{:x}.cpp", vk::std_hash(functions_.front()->src_name)), subdir_);
+  // the runtime headers go first, so that the precompiled header is used
+  W << ExternInclude(G->settings().runtime_headers.get());
+  for (FunctionPtr function : functions_) {
+    W << Include(function->subdir + "/" + function->src_name);
+  }
+  W << CloseFile();
+}
+
+std::vector<size_t> split_into_jumbo_groups(const std::vector<std::pair<std::string, size_t>> &items, size_t jumbo_size) {
+  // the group is closed on the item with the "lucky" name hash, when it's large enough, or when it reaches jumbo_size
+  constexpr size_t boundary_hash_divisor = 4;
+  const size_t min_group_size = jumbo_size / boundary_hash_divisor;
+
+  std::vector<size_t> groups;
+  size_t group_size = 0;
+  size_t group_len = 0;
+  for (const auto &name_and_size : items) {
+    group_size += name_and_size.second;
+    group_len++;
+    if (group_size >= jumbo_size || (group_size >= min_group_size && vk::std_hash(name_and_size.first) % boundary_hash_divisor == 0)) {
+      groups.push_back(group_len);
+      group_size = group_len = 0;
+    }
+  }
+  if (group_len) {
+    groups.push_back(group_len);
+  }
+  return groups;
+}
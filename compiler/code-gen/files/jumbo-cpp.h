@@ -0,0 +1,28 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "compiler/code-gen/code-gen-root-cmd.h"
+#include "compiler/code-gen/code-generator.h"
+#include "compiler/data/data_ptr.h"
+
+// the jumbo (unity) .cpp includes the .cpp files of several functions, so that they are compiled by one C++ compiler process;
+// the included .cpp files are not compiled on their own, see create_obj_files()
+struct JumboCpp : CodeGenRootCmd {
+  JumboCpp(std::string subdir, std::vector<FunctionPtr> &&functions);
+  void compile(CodeGenerator &W) const final;
+
+private:
+  std::string subdir_;
+  std::vector<FunctionPtr> functions_;
+};
+
+// splits the items (name and size), sorted by name, into the consecutive groups of about jumbo_size, returns the lengths of the groups;
+// the group boundaries are mostly chosen by the hashes of the names, so adding or removing an item changes only the neighbouring groups
+std::vector<size_t> split_into_jumbo_groups(const std::vector<std::pair<std::string, size_t>> &items, size_t jumbo_size);
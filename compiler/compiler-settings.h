@@ -131,6 +131,7 @@ public:
   KphpOption<uint64_t> jobs_count;
   KphpOption<uint64_t> threads_count;
   KphpOption<uint64_t> globals_split_count;
+  KphpOption<uint64_t> jumbo_size;
 
   KphpOption<bool> require_functions_typing;
   KphpOption<bool> require_class_typing;
@@ -163,6 +164,8 @@ public:
 
   KphpOption<bool> no_pch;
   KphpOption<bool> no_index_file;
+  KphpOption<std::string> objs_cache_dir;
+  KphpOption<uint64_t> objs_cache_size_limit;
   KphpOption<bool> show_progress;
 
   CxxFlags cxx_flags_default;
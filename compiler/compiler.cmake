@@ -29,6 +29,7 @@ prepend(KPHP_COMPILER_MAKE_SOURCES make/
         hardlink-or-copy.cpp
         make-runner.cpp
         make.cpp
+        objs-cache.cpp
         target.cpp)
 
 prepend(KPHP_COMPILER_DATA_SOURCES data/
@@ -76,6 +77,7 @@ prepend(KPHP_COMPILER_CODEGEN_SOURCES code-gen/
         files/function-source.cpp
         files/global_vars_memory_stats.cpp
         files/init-scripts.cpp
+        files/jumbo-cpp.cpp
         files/lib-header.cpp
         files/tl2cpp/tl-combinator.cpp
         files/tl2cpp/tl-constructor.cpp
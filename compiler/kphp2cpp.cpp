@@ -237,6 +237,8 @@ int main(int argc, char *argv[]) {
              't', "threads-count", "KPHP_THREADS_COUNT", std::to_string(get_default_threads_count()));
   parser.add("Count of global variables per dedicated .cpp file. Lowering it could decrease compilation time", settings->globals_split_count,
              "globals-split-count", "KPHP_GLOBALS_SPLIT_COUNT", "1024");
+  parser.add("Approximate size (in AST vertices) of the jumbo .cpp files the functions are grouped into. 0 means no grouping", settings->jumbo_size,
+             "jumbo-size", "KPHP_JUMBO_SIZE", "0");
   parser.add("Builtin tl schema. Incompatible with lib mode", settings->tl_schema_file,
              'T', "tl-schema", "KPHP_TL_SCHEMA");
   parser.add("Generate storers and fetchers for internal tl functions", settings->gen_tl_internals,
@@ -283,6 +285,10 @@ int main(int argc, char *argv[]) {
              "no-pch", "KPHP_NO_PCH");
   parser.add("Forbid to use the index file", settings->no_index_file,
              "no-index-file", "KPHP_NO_INDEX_FILE");
+  parser.add("Directory of the object files cache shared between the destination directories", settings->objs_cache_dir,
+             "objs-cache-dir", "KPHP_OBJS_CACHE_DIR");
+  parser.add("Size limit of the object files cache in bytes", settings->objs_cache_size_limit,
+             "objs-cache-size-limit", "KPHP_OBJS_CACHE_SIZE_LIMIT", std::to_string(10ULL << 30));
   parser.add("Show transpilation progress", settings->show_progress,
              "show-progress", "KPHP_SHOW_PROGRESS");
   parser.add("A folder that contains composer.json file", settings->composer_root,
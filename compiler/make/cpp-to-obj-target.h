@@ -8,6 +8,7 @@
 
 #include "common/algorithms/contains.h"
 
+#include "compiler/make/objs-cache.h"
 #include "compiler/make/target.h"
 
 class Cpp2ObjTarget : public Target {
@@ -16,6 +17,11 @@ public:
     make_pch_(make_pch) {
   }
 
+  Cpp2ObjTarget(ObjsCache *objs_cache, std::string objs_cache_key) noexcept :
+    objs_cache_(objs_cache),
+    objs_cache_key_(std::move(objs_cache_key)) {
+  }
+
   string get_cmd() final {
     std::stringstream ss;
     const auto cpp_list = dep_list();
@@ -36,6 +42,16 @@ public:
     return ss.str();
   }
 
+  bool restore_from_cache() final {
+    return objs_cache_ && !objs_cache_key_.empty() && objs_cache_->restore(objs_cache_key_, target());
+  }
+
+  void save_to_cache() final {
+    if (objs_cache_ && !objs_cache_key_.empty()) {
+      objs_cache_->store(objs_cache_key_, target());
+    }
+  }
+
   void compute_priority() final {
     priority = 0;
     for (auto dep : deps) {
@@ -47,4 +63,6 @@ public:
 
 private:
   bool make_pch_{false};
+  ObjsCache *objs_cache_{nullptr};
+  std::string objs_cache_key_;
 };
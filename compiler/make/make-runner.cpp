@@ -121,6 +121,13 @@ static int run_cmd(const string &cmd) {
 
 bool MakeRunner::start_job(Target *target) {
   target->start_time = dl_time();
+  if (target->restore_from_cache()) {
+    if (!target->after_run_success()) {
+      return false;
+    }
+    ready_target(target);
+    return true;
+  }
   string cmd = target->get_cmd();
 
   int pid = run_cmd(cmd);
@@ -158,6 +165,7 @@ bool MakeRunner::finish_job(int pid, int return_code, int by_signal) {
   if (!target->after_run_success()) {
     return false;
   }
+  target->save_to_cache();
   ready_target(target);
   return true;
 }
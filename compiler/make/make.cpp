@@ -7,6 +7,7 @@
 #include <forward_list>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "common/wrappers/mkdir_recursive.h"
 #include "common/wrappers/pathname.h"
@@ -18,6 +19,7 @@
 #include "compiler/make/file-target.h"
 #include "compiler/make/hardlink-or-copy.h"
 #include "compiler/make/make-runner.h"
+#include "compiler/make/objs-cache.h"
 #include "compiler/make/objs-to-bin-target.h"
 #include "compiler/make/objs-to-obj-target.h"
 #include "compiler/make/objs-to-static-lib-target.h"
@@ -28,6 +30,7 @@ class MakeSetup {
 private:
   MakeRunner make;
   const CompilerSettings &settings;
+  ObjsCache *objs_cache{nullptr};
 
   void target_set_file(Target *target, File *file) {
     assert (file->target == nullptr);
@@ -66,17 +69,22 @@ private:
   }
 
 public:
-  MakeSetup(FILE *stats_file, const CompilerSettings &compiler_settings) noexcept:
+  MakeSetup(FILE *stats_file, const CompilerSettings &compiler_settings, ObjsCache *compiler_objs_cache = nullptr) noexcept:
     make(stats_file),
-    settings(compiler_settings) {
+    settings(compiler_settings),
+    objs_cache(compiler_objs_cache) {
+  }
+
+  ObjsCache *get_objs_cache() const {
+    return objs_cache;
   }
 
   Target *create_cpp_target(File *cpp) {
     return create_target(new FileTarget(), vector<Target *>(), cpp);
   }
 
-  Target *create_cpp2obj_target(File *cpp, File *obj) {
-    return create_target(new Cpp2ObjTarget(), to_targets(cpp), obj);
+  Target *create_cpp2obj_target(File *cpp, File *obj, std::string objs_cache_key) {
+    return create_target(new Cpp2ObjTarget(objs_cache, std::move(objs_cache_key)), to_targets(cpp), obj);
   }
 
   Target *create_pch_target(File *header_h, File *pch) {
@@ -290,12 +298,30 @@ static std::unordered_map<File *, long long> create_dep_mtime(const Index &cpp_d
 static std::vector<File *> create_obj_files(MakeSetup *make, Index &obj_dir, const Index &cpp_dir,
                                             const std::forward_list<Index> &imported_headers) {
   std::unordered_map<File *, long long> dep_mtime = create_dep_mtime(cpp_dir, imported_headers);
+  std::unordered_map<File *, std::string> objs_cache_keys;
+  if (make->get_objs_cache()) {
+    AutoProfiler profiler{get_profiler("Calc Objs Cache Keys")};
+    objs_cache_keys = calc_objs_cache_keys(cpp_dir, G->settings(), make->get_objs_cache()->cxx_identity());
+  }
+  // the .cpp files included by the jumbo ones are compiled as their part, see JumboCpp
+  std::unordered_set<File *> jumbo_parts;
+  if (G->settings().jumbo_size.get()) {
+    for (const auto &file : cpp_dir.get_files()) {
+      for (const auto &include : file->includes) {
+        File *included_file = cpp_dir.get_file(include);
+        if (included_file && included_file->ext == ".cpp") {
+          jumbo_parts.emplace(included_file);
+        }
+      }
+    }
+  }
   std::vector<File *> objs;
   for (const auto &cpp_file : cpp_dir.get_files()) {
-    if (cpp_file->ext == ".cpp") {
+    if (cpp_file->ext == ".cpp" && !jumbo_parts.count(cpp_file)) {
       File *obj_file = obj_dir.insert_file(static_cast<std::string>(cpp_file->name_without_ext) + ".o");
       obj_file->compile_with_debug_info_flag = cpp_file->compile_with_debug_info_flag;
-      make->create_cpp2obj_target(cpp_file, obj_file);
+      auto key_it = objs_cache_keys.find(cpp_file);
+      make->create_cpp2obj_target(cpp_file, obj_file, key_it != objs_cache_keys.end() ? std::move(key_it->second) : std::string{});
       Target *cpp_target = cpp_file->target;
       cpp_target->force_changed(dep_mtime[cpp_file]);
       objs.push_back(obj_file);
@@ -400,7 +426,19 @@ void run_make() {
   File bin_file(settings.binary_path.get());
   kphp_assert(bin_file.read_stat() >= 0);
 
-  MakeSetup make{make_stats_file, settings};
+  std::unique_ptr<ObjsCache> objs_cache;
+  if (!settings.objs_cache_dir.get().empty()) {
+    std::string cxx_identity = calc_cxx_identity(settings.cxx.get());
+    if (cxx_identity.empty()) {
+      fmt_fprintf(stderr, "Can't get the version of '{}', the objs cache is not used\n", settings.cxx.get());
+    } else {
+      // the cached objects are not used on the force make, but they are updated
+      objs_cache = std::make_unique<ObjsCache>(settings.objs_cache_dir.get(), settings.objs_cache_size_limit.get(), !settings.force_make.get(),
+                                               std::move(cxx_identity));
+    }
+  }
+
+  MakeSetup make{make_stats_file, settings, objs_cache.get()};
   auto objs = run_pre_make(settings, make_stats_file, make, obj_index, bin_file);
   stage::die_if_global_errors();
 
@@ -422,6 +460,15 @@ void run_make() {
   bool ok = make.make_target(&bin_file, build_stage, settings.jobs_count.get());
   kphp_error(ok, build_stage + " stage failure");
 
+  if (objs_cache) {
+    objs_cache->trim();
+    if (make_stats_file) {
+      objs_cache->write_stats(make_stats_file);
+    }
+    if (G->settings().verbosity.get() >= 1) {
+      fmt_fprintf(stderr, "objs cache: {} hits, {} misses\n", objs_cache->hits(), objs_cache->misses());
+    }
+  }
   if (make_stats_file) {
     fclose(make_stats_file);
   }
@@ -0,0 +1,319 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "compiler/make/objs-cache.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <openssl/sha.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#include "common/wrappers/fmt_format.h"
+#include "common/wrappers/mkdir_recursive.h"
+
+#include "compiler/compiler-settings.h"
+#include "compiler/index.h"
+#include "compiler/stage.h"
+
+namespace {
+
+bool copy_file_atomically(const std::string &from, const std::string &to, std::error_code &ec) noexcept {
+  // the other kphp processes may read the cache at the same time, so the file appears at once
+  const std::string tmp_file = fmt_format("{}.tmp{}", to, getpid());
+  std::filesystem::copy_file(from, tmp_file, std::filesystem::copy_options::overwrite_existing, ec);
+  if (!ec) {
+    std::filesystem::rename(tmp_file, to, ec);
+  }
+  if (ec) {
+    std::error_code ignored;
+    std::filesystem::remove(tmp_file, ignored);
+    return false;
+  }
+  return true;
+}
+
+using digest_t = std::array<unsigned char, SHA256_DIGEST_LENGTH>;
+
+// the digests of the generated files together with all the generated files they include;
+// the includes may be cyclic, so the digest is calculated for the strongly connected components (Tarjan's algorithm)
+class IncludesDigests {
+public:
+  explicit IncludesDigests(const Index &cpp_dir) noexcept :
+    cpp_dir_(cpp_dir) {
+  }
+
+  // returns nullptr, if the file can't be cached
+  const digest_t *get(File *file) noexcept {
+    auto it = nodes_.find(file);
+    if (it == nodes_.end()) {
+      visit(file);
+      it = nodes_.find(file);
+    }
+    return it->second.cacheable ? &it->second.digest : nullptr;
+  }
+
+private:
+  struct Node {
+    int index{0};
+    int lowlink{0};
+    bool on_stack{false};
+    bool cacheable{true};
+    digest_t digest{};
+  };
+
+  void visit(File *file) noexcept {
+    // the references to the elements of unordered_map stay valid on the insertions
+    Node &node = nodes_[file];
+    node.index = node.lowlink = next_index_++;
+    node.on_stack = true;
+    stack_.push_back(file);
+
+    for (const auto &include : file->includes) {
+      File *header = cpp_dir_.get_file(include);
+      if (header == nullptr) {
+        node.cacheable = false;
+        continue;
+      }
+      auto it = nodes_.find(header);
+      if (it == nodes_.end()) {
+        visit(header);
+        node.lowlink = std::min(node.lowlink, nodes_[header].lowlink);
+      } else if (it->second.on_stack) {
+        node.lowlink = std::min(node.lowlink, it->second.index);
+      }
+    }
+
+    if (node.lowlink == node.index) {
+      finish_component(file);
+    }
+  }
+
+  void finish_component(File *root) noexcept {
+    std::vector<File *> component;
+    File *member = nullptr;
+    do {
+      member = stack_.back();
+      stack_.pop_back();
+      nodes_[member].on_stack = false;
+      component.push_back(member);
+    } while (member != root);
+
+    bool cacheable = true;
+    std::vector<std::tuple<std::string, unsigned long long, unsigned long long>> contents;
+    std::vector<digest_t> included_digests;
+    for (File *file : component) {
+      const Node &node = nodes_[file];
+      cacheable = cacheable && node.cacheable && file->lib_includes.empty() && file->crc64 != static_cast<unsigned long long>(-1);
+      contents.emplace_back(static_cast<std::string>(file->name), file->crc64, file->crc64_with_comments);
+      for (const auto &include : file->includes) {
+        File *header = cpp_dir_.get_file(include);
+        if (header == nullptr || std::find(component.begin(), component.end(), header) != component.end()) {
+          continue;
+        }
+        const Node &header_node = nodes_[header];
+        cacheable = cacheable && header_node.cacheable;
+        included_digests.push_back(header_node.digest);
+      }
+    }
+    std::sort(contents.begin(), contents.end());
+    std::sort(included_digests.begin(), included_digests.end());
+    included_digests.erase(std::unique(included_digests.begin(), included_digests.end()), included_digests.end());
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    for (const auto &content : contents) {
+      const std::string &name = std::get<0>(content);
+      SHA256_Update(&sha256, name.c_str(), name.size() + 1);
+      SHA256_Update(&sha256, &std::get<1>(content), sizeof(unsigned long long));
+      SHA256_Update(&sha256, &std::get<2>(content), sizeof(unsigned long long));
+    }
+    for (const auto &digest : included_digests) {
+      SHA256_Update(&sha256, digest.data(), digest.size());
+    }
+    digest_t digest;
+    SHA256_Final(digest.data(), &sha256);
+
+    for (File *file : component) {
+      Node &node = nodes_[file];
+      node.cacheable = cacheable;
+      node.digest = digest;
+    }
+  }
+
+  const Index &cpp_dir_;
+  std::unordered_map<File *, Node> nodes_;
+  std::vector<File *> stack_;
+  int next_index_{0};
+};
+
+} // namespace
+
+ObjsCache::ObjsCache(std::string dir, uint64_t size_limit, bool use_cached_objs, std::string cxx_identity) noexcept :
+  dir_(std::move(dir)),
+  size_limit_(size_limit),
+  use_cached_objs_(use_cached_objs),
+  cxx_identity_(std::move(cxx_identity)) {
+}
+
+std::string ObjsCache::get_obj_path(const std::string &key) const noexcept {
+  return dir_ + key.substr(0, 2) + "/" + key + ".o";
+}
+
+bool ObjsCache::restore(const std::string &key, const std::string &obj_path) noexcept {
+  const std::string cached_obj_path = get_obj_path(key);
+  std::error_code ec;
+  if (!use_cached_objs_ || !copy_file_atomically(cached_obj_path, obj_path, ec)) {
+    misses_++;
+    return false;
+  }
+  // the modification time is the time of the last use
+  utimensat(AT_FDCWD, cached_obj_path.c_str(), nullptr, 0);
+  hits_++;
+  return true;
+}
+
+void ObjsCache::store(const std::string &key, const std::string &obj_path) noexcept {
+  const std::string cached_obj_path = get_obj_path(key);
+  const std::string subdir = cached_obj_path.substr(0, cached_obj_path.rfind('/') + 1);
+  const mode_t old_mask = umask(0);
+  const bool dir_created = mkdir_recursive(subdir.c_str(), 0777);
+  umask(old_mask);
+
+  std::error_code ec;
+  if (!dir_created || !copy_file_atomically(obj_path, cached_obj_path, ec)) {
+    // the cache is the optimization only, so the failure is reported once and the build continues
+    if (!error_reported_) {
+      fmt_fprintf(stderr, "Can't save '{}' to the objs cache '{}': {}\n", obj_path, dir_, dir_created ? ec.message() : strerror(errno));
+      error_reported_ = true;
+    }
+    return;
+  }
+  stored_++;
+}
+
+void ObjsCache::trim() noexcept {
+  struct CachedObj {
+    std::filesystem::file_time_type last_use;
+    uint64_t size;
+    std::filesystem::path path;
+  };
+  std::vector<CachedObj> objs;
+  uint64_t total_size = 0;
+
+  std::error_code ec;
+  const auto stale_tmp_time = std::filesystem::file_time_type::clock::now() - std::chrono::hours{1};
+  for (std::filesystem::recursive_directory_iterator it{dir_, ec}, end; !ec && it != end; it.increment(ec)) {
+    std::error_code file_ec;
+    if (!it->is_regular_file(file_ec)) {
+      continue;
+    }
+    const auto last_use = it->last_write_time(file_ec);
+    const uint64_t size = it->file_size(file_ec);
+    if (file_ec) {
+      continue;
+    }
+    if (it->path().extension() != ".o") {
+      // the leftovers of the killed kphp processes
+      if (last_use < stale_tmp_time) {
+        std::filesystem::remove(it->path(), file_ec);
+      }
+      continue;
+    }
+    objs.push_back({last_use, size, it->path()});
+    total_size += size;
+  }
+
+  if (total_size <= size_limit_) {
+    return;
+  }
+  std::sort(objs.begin(), objs.end(), [](const CachedObj &lhs, const CachedObj &rhs) { return lhs.last_use < rhs.last_use; });
+  for (const auto &obj : objs) {
+    if (total_size <= size_limit_) {
+      break;
+    }
+    std::error_code file_ec;
+    if (std::filesystem::remove(obj.path, file_ec)) {
+      total_size -= obj.size;
+      evicted_++;
+    }
+  }
+}
+
+void ObjsCache::write_stats(FILE *stats_file) const noexcept {
+  fmt_fprintf(stats_file, "objs cache: {} hits, {} misses, {} stored, {} evicted\n", hits_, misses_, stored_, evicted_);
+}
+
+std::string calc_cxx_identity(const std::string &cxx) noexcept {
+  FILE *version_pipe = popen(fmt_format("{} --version 2>/dev/null", cxx).c_str(), "r");
+  if (!version_pipe) {
+    return {};
+  }
+  SHA256_CTX sha256;
+  SHA256_Init(&sha256);
+  SHA256_Update(&sha256, cxx.c_str(), cxx.size() + 1);
+  std::array<char, 4096> buf;
+  size_t total_read = 0;
+  while (size_t read = fread(buf.data(), 1, buf.size(), version_pipe)) {
+    SHA256_Update(&sha256, buf.data(), read);
+    total_read += read;
+  }
+  const int status = pclose(version_pipe);
+  digest_t digest;
+  SHA256_Final(digest.data(), &sha256);
+  if (status != 0 || total_read == 0) {
+    return {};
+  }
+  return std::string(digest.begin(), digest.end());
+}
+
+std::unordered_map<File *, std::string> calc_objs_cache_keys(const Index &cpp_dir, const CompilerSettings &settings, const std::string &cxx_identity) {
+  std::unordered_map<File *, std::string> keys;
+
+  const auto &files = cpp_dir.get_files();
+  auto lib_version_it = std::find_if(files.begin(), files.end(), [](File *file) { return file->name == "_lib_version.h"; });
+  kphp_assert(lib_version_it != files.end());
+
+  IncludesDigests digests{cpp_dir};
+  // every .cpp depends on _lib_version.h implicitly, see create_dep_mtime()
+  const digest_t *lib_version_digest = digests.get(*lib_version_it);
+  if (lib_version_digest == nullptr) {
+    return keys;
+  }
+
+  for (File *file : files) {
+    if (file->ext != ".cpp") {
+      continue;
+    }
+    const digest_t *digest = digests.get(file);
+    if (digest == nullptr) {
+      continue;
+    }
+    const auto &cxx_flags = file->compile_with_debug_info_flag ? settings.cxx_flags_with_debug : settings.cxx_flags_default;
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, settings.runtime_sha256.get().c_str(), settings.runtime_sha256.get().size() + 1);
+    SHA256_Update(&sha256, cxx_flags.flags_sha256.get().c_str(), cxx_flags.flags_sha256.get().size() + 1);
+    SHA256_Update(&sha256, cxx_identity.data(), cxx_identity.size());
+    SHA256_Update(&sha256, lib_version_digest->data(), lib_version_digest->size());
+    SHA256_Update(&sha256, digest->data(), digest->size());
+    digest_t key;
+    SHA256_Final(key.data(), &sha256);
+
+    std::string key_str;
+    key_str.reserve(key.size() * 2);
+    for (auto key_symb : key) {
+      fmt_format_to(std::back_inserter(key_str), "{:02x}", key_symb);
+    }
+    keys.emplace(file, std::move(key_str));
+  }
+  return keys;
+}
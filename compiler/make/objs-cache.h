@@ -0,0 +1,59 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+#include "common/mixin/not_copyable.h"
+
+class CompilerSettings;
+class File;
+class Index;
+
+// the content-addressed cache of object files, which is shared between the destination directories (checkouts, branches, CI agents)
+// the key of .o is the hash of its .cpp with all the generated headers it includes, the C++ compiler version and flags and the runtime sha256,
+// so the object compiled once is reused wherever the same code is compiled in the same way;
+// when the cache exceeds the size limit, the least recently used objects are removed
+// note, that the debug info of the reused object refers to the directory, where it was compiled first
+class ObjsCache : vk::not_copyable {
+public:
+  // if !use_cached_objs, the cache is only updated by the compiled objects; cxx_identity is calc_cxx_identity() of the compiler
+  ObjsCache(std::string dir, uint64_t size_limit, bool use_cached_objs, std::string cxx_identity) noexcept;
+
+  // copies the cached object to obj_path; returns false on the cache miss
+  bool restore(const std::string &key, const std::string &obj_path) noexcept;
+  void store(const std::string &key, const std::string &obj_path) noexcept;
+  // removes the least recently used objects beyond the size limit
+  void trim() noexcept;
+
+  void write_stats(FILE *stats_file) const noexcept;
+
+  uint64_t hits() const noexcept { return hits_; }
+  uint64_t misses() const noexcept { return misses_; }
+  const std::string &cxx_identity() const noexcept { return cxx_identity_; }
+
+private:
+  std::string get_obj_path(const std::string &key) const noexcept;
+
+  std::string dir_;
+  uint64_t size_limit_{0};
+  bool use_cached_objs_{true};
+  std::string cxx_identity_;
+  uint64_t hits_{0};
+  uint64_t misses_{0};
+  uint64_t stored_{0};
+  uint64_t evicted_{0};
+  bool error_reported_{false};
+};
+
+// the compiler name and flags don't tell its version, while the objects of the different compilers are incompatible;
+// the output of '<cxx> --version' is hashed, the empty result means the compiler can't be identified
+std::string calc_cxx_identity(const std::string &cxx) noexcept;
+
+// the cache keys of the .cpp files of the index; the files, which can't be cached (e.g. including lib headers), are skipped
+std::unordered_map<File *, std::string> calc_objs_cache_keys(const Index &cpp_dir, const CompilerSettings &settings, const std::string &cxx_identity);
@@ -40,6 +40,9 @@ public:
 
   virtual void compute_priority();
   virtual std::string get_cmd() = 0;
+  // the target is taken from the objs cache instead of running the command, see ObjsCache
+  virtual bool restore_from_cache() { return false; }
+  virtual void save_to_cache() {}
   std::string get_name();
 
   void on_require();
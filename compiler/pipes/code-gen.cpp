@@ -13,6 +13,7 @@
 #include "compiler/code-gen/files/function-source.h"
 #include "compiler/code-gen/files/global_vars_memory_stats.h"
 #include "compiler/code-gen/files/init-scripts.h"
+#include "compiler/code-gen/files/jumbo-cpp.h"
 #include "compiler/code-gen/files/lib-header.h"
 #include "compiler/code-gen/files/tl2cpp/tl2cpp.h"
 #include "compiler/code-gen/files/type-tagger.h"
@@ -32,6 +33,42 @@ size_t CodeGenF::calc_count_of_parts(size_t cnt_global_vars) {
   return 1u + cnt_global_vars / G->settings().globals_split_count.get();
 }
 
+static size_t calc_vertices_count(VertexPtr root) {
+  size_t count = 1;
+  for (VertexPtr son : *root) {
+    count += calc_vertices_count(son);
+  }
+  return count;
+}
+
+// the functions of one subdir (that is, mostly of the same php files) are grouped by name, so the class methods stay together
+void CodeGenF::start_jumbo_cpps(const std::forward_list<FunctionPtr> &all_functions, DataStream<std::unique_ptr<CodeGenRootCmd>> &os) {
+  std::map<std::string, std::vector<FunctionPtr>> subdirs;
+  for (FunctionPtr f : all_functions) {
+    if (!f->is_inline && !f->is_imported_from_static_lib()) {
+      subdirs[f->subdir].emplace_back(f);
+    }
+  }
+
+  for (auto &subdir_and_functions : subdirs) {
+    auto &functions = subdir_and_functions.second;
+    std::sort(functions.begin(), functions.end(), [](FunctionPtr a, FunctionPtr b) { return a->src_name < b->src_name; });
+    std::vector<std::pair<std::string, size_t>> sizes;
+    sizes.reserve(functions.size());
+    for (FunctionPtr f : functions) {
+      sizes.emplace_back(f->src_name, calc_vertices_count(f->root));
+    }
+
+    auto group_begin = functions.begin();
+    for (size_t group_len : split_into_jumbo_groups(sizes, G->settings().jumbo_size.get())) {
+      if (group_len > 1) {
+        code_gen_start_root_task(os, std::make_unique<JumboCpp>(subdir_and_functions.first, std::vector<FunctionPtr>(group_begin, group_begin + group_len)));
+      }
+      group_begin += group_len;
+    }
+  }
+}
+
 
 void CodeGenF::execute(FunctionPtr function, DataStream<std::unique_ptr<CodeGenRootCmd>> &unused_os __attribute__ ((unused))) {
   if (FunctionData::does_need_codegen(function) || function->is_imported_from_static_lib()) {
@@ -57,6 +94,9 @@ void CodeGenF::on_finish(DataStream<std::unique_ptr<CodeGenRootCmd>> &os) {
     code_gen_start_root_task(os, std::make_unique<FunctionH>(f));
     code_gen_start_root_task(os, std::make_unique<FunctionCpp>(f));
   }
+  if (G->settings().jumbo_size.get()) {
+    start_jumbo_cpps(all_functions, os);
+  }
 
   for (ClassPtr c : all_classes) {
     if (!ClassData::does_need_codegen(c)) {
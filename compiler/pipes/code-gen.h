@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <forward_list>
+
 #include "compiler/code-gen/code-gen-root-cmd.h"
 #include "compiler/code-gen/writer-data.h"
 #include "compiler/pipes/sync.h"
@@ -19,6 +21,7 @@ class CodeGenF final : public SyncPipeF<FunctionPtr, std::unique_ptr<CodeGenRoot
   void prepare_generate_function(FunctionPtr func);
   std::string get_subdir(const std::string &base);
   size_t calc_count_of_parts(size_t cnt_global_vars);
+  void start_jumbo_cpps(const std::forward_list<FunctionPtr> &all_functions, DataStream<std::unique_ptr<CodeGenRootCmd>> &os);
 
 public:
   void execute(FunctionPtr function, DataStream<std::unique_ptr<CodeGenRootCmd>> &unused_os) final;
@@ -26,6 +26,16 @@ bool Node::is_parallel() {
   return parallel;
 }
 
+void Node::get_tasks(std::vector<Task *> &tasks, size_t max_count) {
+  for (size_t i = 0; i < max_count; ++i) {
+    Task *task = get_task();
+    if (task == nullptr) {
+      return;
+    }
+    tasks.push_back(task);
+  }
+}
+
 Node::Node(bool parallel) :
   in_scheduler(nullptr),
   parallel(parallel) {}
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 class SchedulerBase;
 class Task;
 
@@ -27,5 +30,7 @@ public:
   virtual bool is_parallel();
 
   virtual Task *get_task() = 0;
+  // appends up to max_count tasks, it takes the lock of the input once
+  virtual void get_tasks(std::vector<Task *> &tasks, size_t max_count);
   virtual void on_finish() = 0;
 };
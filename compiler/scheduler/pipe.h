@@ -108,6 +108,12 @@ public:
     return new TaskType(std::move(x), this);
   }
 
+  void get_tasks(std::vector<Task *> &tasks, size_t max_count) override {
+    for (auto &x : input_stream->get_many(max_count)) {
+      tasks.push_back(new TaskType(std::move(x), this));
+    }
+  }
+
   virtual void process_input(InputType &&input) {
     function.execute(std::move(input), *output_stream);
   }
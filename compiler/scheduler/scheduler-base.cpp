@@ -7,6 +7,7 @@
 #include <cassert>
 
 volatile int tasks_before_sync_node;
+EventCount new_data_events;
 
 static SchedulerBase *scheduler;
 
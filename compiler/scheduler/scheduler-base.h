@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "compiler/threading/event-count.h"
+
 class Node;
 
 class Task;
@@ -23,6 +25,8 @@ void set_scheduler(SchedulerBase *new_scheduler);
 void unset_scheduler(SchedulerBase *old_scheduler);
 
 extern volatile int tasks_before_sync_node;
+// the idle scheduler threads sleep on it until the new data is pushed to the streams
+extern EventCount new_data_events;
 
 inline void register_async_task(Task *task) {
   get_scheduler()->add_task(task);
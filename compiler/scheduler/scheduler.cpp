@@ -4,21 +4,31 @@
 
 #include "compiler/scheduler/scheduler.h"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 #include "compiler/scheduler/task.h"
 #include "compiler/threading/thread-id.h"
 #include "compiler/threading/tls.h"
 
+// the tasks are taken from the nodes by batches to lock the node streams less often
+static constexpr size_t TASKS_BATCH_SIZE = 16;
+
 class ThreadContext {
 public:
-  pthread_t pthread_id;
-  int thread_id;
+  pthread_t pthread_id{};
+  int thread_id{0};
+
+  class Scheduler *scheduler{nullptr};
 
-  class Scheduler *scheduler;
+  std::atomic<bool> run_flag{false};
 
-  Node *node;
-  bool run_flag;
+  // the owner takes the tasks from the back, the others steal them from the front
+  std::mutex tasks_mutex;
+  std::deque<Task *> tasks;
+  std::atomic<size_t> tasks_count{0};
 };
 
 
@@ -53,24 +63,24 @@ void Scheduler::add_task(Task *task) {
 void Scheduler::execute() {
   task_pull->add_to_scheduler(this);
   set_thread_id(0);
-  std::vector<ThreadContext> threads(threads_count + 1);
+  std::vector<ThreadContext> thread_contexts(threads_count + 1);
+  threads = thread_contexts.data();
+  one_thread_node_locks = std::vector<std::mutex>(one_thread_nodes.size());
 
-  assert ((int)one_thread_nodes.size() < threads_count);
   for (int i = 1; i <= threads_count; i++) {
     threads[i].thread_id = i;
     threads[i].scheduler = this;
     threads[i].run_flag = true;
-    if (i <= (int)one_thread_nodes.size()) {
-      threads[i].node = one_thread_nodes[i - 1];
-    }
     pthread_create(&threads[i].pthread_id, nullptr, ::scheduler_thread_execute, &threads[i]);
   }
 
   while (true) {
+    const auto key = all_tasks_done.prepare_wait();
     if (tasks_before_sync_node > 0) {
-      usleep(250);
+      all_tasks_done.wait(key);
       continue;
     }
+    all_tasks_done.cancel_wait();
     if (sync_nodes.empty()) {
       break;
     }
@@ -80,9 +90,12 @@ void Scheduler::execute() {
 
   for (int i = 1; i <= threads_count; i++) {
     threads[i].run_flag = false;
-    __sync_synchronize();
+  }
+  new_data_events.notify_all();
+  for (int i = 1; i <= threads_count; i++) {
     pthread_join(threads[i].pthread_id, nullptr);
   }
+  threads = nullptr;
 
   for (auto node : nodes) {
     delete node;
@@ -94,36 +107,128 @@ void Scheduler::set_threads_count(int new_threads_count) {
   threads_count = new_threads_count;
 }
 
-bool Scheduler::thread_process_node(Node *node) {
-  Task *task = node->get_task();
-  if (task == nullptr) {
-    return false;
-  }
+void Scheduler::execute_task(Task *task) {
   task->execute();
   delete task;
-  __sync_fetch_and_sub(&tasks_before_sync_node, 1);
-  return true;
+  if (__sync_sub_and_fetch(&tasks_before_sync_node, 1) == 0) {
+    all_tasks_done.notify_one();
+  }
+}
+
+Task *Scheduler::take_tasks_from_nodes(ThreadContext *tls) {
+  std::vector<Task *> batch;
+  for (Node *node : nodes) {
+    node->get_tasks(batch, TASKS_BATCH_SIZE);
+    if (!batch.empty()) {
+      break;
+    }
+  }
+  if (batch.empty()) {
+    return nullptr;
+  }
+
+  Task *task = batch.back();
+  batch.pop_back();
+  if (!batch.empty()) {
+    {
+      std::lock_guard<std::mutex> lock{tls->tasks_mutex};
+      tls->tasks.insert(tls->tasks.end(), batch.begin(), batch.end());
+      tls->tasks_count = tls->tasks.size();
+    }
+    // a sleeping thread can steal the rest of the batch
+    new_data_events.notify_one();
+  }
+  return task;
+}
+
+Task *Scheduler::steal_task(ThreadContext *tls) {
+  for (int i = 1; i < threads_count; i++) {
+    ThreadContext &victim = threads[(tls->thread_id + i - 1) % threads_count + 1];
+    if (victim.tasks_count == 0) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock{victim.tasks_mutex};
+    if (!victim.tasks.empty()) {
+      Task *task = victim.tasks.front();
+      victim.tasks.pop_front();
+      victim.tasks_count = victim.tasks.size();
+      if (!victim.tasks.empty()) {
+        // wake up the threads one by one while there is something to steal
+        new_data_events.notify_one();
+      }
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+Task *Scheduler::pop_own_task(ThreadContext *tls) {
+  if (tls->tasks_count != 0) {
+    std::lock_guard<std::mutex> lock{tls->tasks_mutex};
+    if (!tls->tasks.empty()) {
+      Task *task = tls->tasks.back();
+      tls->tasks.pop_back();
+      tls->tasks_count = tls->tasks.size();
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+Task *Scheduler::find_task(ThreadContext *tls) {
+  if (Task *task = pop_own_task(tls)) {
+    return task;
+  }
+  if (Task *task = take_tasks_from_nodes(tls)) {
+    return task;
+  }
+  return steal_task(tls);
+}
+
+bool Scheduler::execute_one_thread_node_task() {
+  for (size_t i = 0; i < one_thread_nodes.size(); i++) {
+    std::unique_lock<std::mutex> lock{one_thread_node_locks[i], std::try_to_lock};
+    // the thread holding the lock takes the next task of the node itself before sleeping
+    if (!lock.owns_lock()) {
+      continue;
+    }
+    if (Task *task = one_thread_nodes[i]->get_task()) {
+      execute_task(task);
+      return true;
+    }
+  }
+  return false;
 }
 
 void Scheduler::thread_execute(ThreadContext *tls) {
   set_thread_id(tls->thread_id);
 
-  auto process_node = [this](Node *node) {
-    bool at_least_one_task_executed = false;
-    while (thread_process_node(node)) {
-      at_least_one_task_executed = true;
-    }
-    return at_least_one_task_executed;
-  };
   while (tls->run_flag) {
-    bool at_least_one_task_executed = false;
-    if (tls->node != nullptr) {
-      at_least_one_task_executed = process_node(tls->node);
-    } else {
-      at_least_one_task_executed = std::count_if(nodes.begin(), nodes.end(), process_node) > 0;
+    // the not parallel nodes are preferred to the tasks of the parallel ones,
+    // so their input (e.g. the generated files to be written) doesn't pile up in memory;
+    // it's one try_lock per free node, the thread executing the node task is skipped
+    if (execute_one_thread_node_task()) {
+      continue;
+    }
+    if (Task *task = find_task(tls)) {
+      execute_task(task);
+      continue;
     }
-    if (!at_least_one_task_executed) {
-      usleep(250);
+    // the data could be pushed after the search above, so it's repeated after prepare_wait()
+    const auto key = new_data_events.prepare_wait();
+    if (execute_one_thread_node_task()) {
+      new_data_events.cancel_wait();
+      continue;
+    }
+    if (Task *task = find_task(tls)) {
+      new_data_events.cancel_wait();
+      execute_task(task);
+      continue;
+    }
+    if (!tls->run_flag) {
+      new_data_events.cancel_wait();
+      break;
     }
+    new_data_events.wait(key);
   }
 }
@@ -4,14 +4,21 @@
 
 #pragma once
 
+#include <mutex>
 #include <queue>
 #include <vector>
 
 #include "compiler/scheduler/scheduler-base.h"
 #include "compiler/scheduler/task-pull.h"
+#include "compiler/threading/event-count.h"
 
 class ThreadContext;
 
+// the worker threads take the tasks from the nodes by batches into their own deques,
+// and the idle ones steal the tasks from the deques of the others;
+// the threads with nothing to do sleep until the new data is pushed to the streams;
+// the tasks of the not parallel nodes are executed by any thread, but one at a time,
+// and they take priority over the new tasks of the parallel nodes
 class Scheduler : public SchedulerBase {
 private:
   std::vector<Node *> nodes;
@@ -19,8 +26,16 @@ private:
   std::queue<Node *> sync_nodes;
   int threads_count;
   TaskPull *task_pull;
-
-  bool thread_process_node(Node *node);
+  std::vector<std::mutex> one_thread_node_locks;
+  ThreadContext *threads{nullptr};
+  EventCount all_tasks_done;
+
+  Task *pop_own_task(ThreadContext *tls);
+  Task *find_task(ThreadContext *tls);
+  Task *take_tasks_from_nodes(ThreadContext *tls);
+  Task *steal_task(ThreadContext *tls);
+  void execute_task(Task *task);
+  bool execute_one_thread_node_task();
   void thread_execute(ThreadContext *tls);
   friend void *scheduler_thread_execute(void *arg);
 
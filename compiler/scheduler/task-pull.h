@@ -25,5 +25,11 @@ public:
     return x;
   }
 
+  void get_tasks(std::vector<Task *> &tasks, size_t max_count) override {
+    for (Task *task : stream.get_many(max_count)) {
+      tasks.push_back(task);
+    }
+  }
+
   void on_finish() override {}
 };
@@ -36,12 +36,27 @@ public:
     return false;
   }
 
+  std::vector<DataType> get_many(size_t max_count) {
+    std::vector<DataType> result;
+    std::lock_guard<std::mutex> lock{mutex_};
+    while (result.size() < max_count && !queue_.empty()) {
+      result.emplace_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    return result;
+  }
+
   void operator<<(DataType input) {
     if (!is_sink_mode_) {
       __sync_fetch_and_add(&tasks_before_sync_node, 1);
     }
-    std::lock_guard<std::mutex> lock{mutex_};
-    queue_.push_front(std::move(input));
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      queue_.push_front(std::move(input));
+    }
+    if (!is_sink_mode_) {
+      new_data_events.notify_one();
+    }
   }
 
   std::forward_list<DataType> flush() {
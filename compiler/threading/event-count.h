@@ -0,0 +1,60 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "common/mixin/not_copyable.h"
+
+// lets the threads sleep until some condition becomes true, without polling and without the lost wakeups:
+//   auto key = events.prepare_wait();
+//   if (condition()) { events.cancel_wait(); } else { events.wait(key); }
+// the thread, which makes the condition true, calls notify_one() or notify_all() after that;
+// notify is cheap when nobody waits, so it may be called on every change
+class EventCount : vk::not_copyable {
+public:
+  using Key = uint64_t;
+
+  Key prepare_wait() noexcept {
+    waiters_.fetch_add(1);
+    return epoch_.load();
+  }
+
+  void cancel_wait() noexcept {
+    waiters_.fetch_sub(1);
+  }
+
+  void wait(Key key) noexcept {
+    std::unique_lock<std::mutex> lock{mutex_};
+    cv_.wait(lock, [this, key] { return epoch_.load() != key; });
+    waiters_.fetch_sub(1);
+  }
+
+  void notify_one() noexcept {
+    notify(false);
+  }
+
+  void notify_all() noexcept {
+    notify(true);
+  }
+
+private:
+  void notify(bool all) noexcept {
+    epoch_.fetch_add(1);
+    if (waiters_.load() > 0) {
+      // the waiter either sees the new epoch, or already sleeps on cv_
+      std::lock_guard<std::mutex> lock{mutex_};
+      all ? cv_.notify_all() : cv_.notify_one();
+    }
+  }
+
+  std::atomic<Key> epoch_{0};
+  std::atomic<int> waiters_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
@@ -4,83 +4,157 @@
 
 #pragma once
 
-#include <cassert>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 
+#include "common/mixin/not_copyable.h"
+
 #include "compiler/threading/locks.h"
+#include "compiler/threading/tls.h"
 
+// the concurrent hash table growing with the number of elements;
+// the nodes are never moved, so the pointers returned by at() stay valid after the table is grown;
+// find() and at() for an existing hash don't take any locks, the inserts take the lock shared,
+// and only the growth takes it exclusively, the previous index tables are kept for the concurrent readers
 template<class T>
-class TSHashTable {
-  static const int N = 1000000;
+class TSHashTable : vk::not_copyable {
 public:
   struct HTNode : Lockable {
     unsigned long long hash;
     T data;
 
-    HTNode() :
-      hash(0),
+    explicit HTNode(unsigned long long hash = 0) :
+      hash(hash),
       data() {
     }
   };
 
 private:
-  HTNode *nodes;
-  int used_size;
-  int nodes_size;
+  static constexpr size_t INITIAL_CAPACITY = 256;
+
+  struct Index {
+    const size_t capacity;
+    std::unique_ptr<std::atomic<HTNode *>[]> slots;
+
+    explicit Index(size_t capacity) :
+      capacity(capacity),
+      slots(new std::atomic<HTNode *>[capacity]) {
+      for (size_t i = 0; i < capacity; i++) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    HTNode *find(unsigned long long hash) const {
+      for (size_t i = hash % capacity;; i = (i + 1) % capacity) {
+        HTNode *node = slots[i].load(std::memory_order_acquire);
+        if (node == nullptr || node->hash == hash) {
+          return node;
+        }
+      }
+    }
+  };
+
+  std::atomic<Index *> index_;
+  std::vector<std::unique_ptr<Index>> indexes_;
+  std::atomic<size_t> used_size_{0};
+  std::shared_mutex grow_mutex_;
+
+  // the load factor is kept below 1/2, the margin is for the threads inserting at the same time
+  static bool is_overfilled(size_t used_size, size_t capacity) {
+    return (used_size + MAX_THREADS_COUNT) * 2 > capacity;
+  }
+
+  void grow(const Index *full_index) {
+    std::unique_lock<std::shared_mutex> lock{grow_mutex_};
+    if (index_.load(std::memory_order_relaxed) != full_index) {
+      return;
+    }
+    auto grown = std::make_unique<Index>(full_index->capacity * 2);
+    for (size_t i = 0; i < full_index->capacity; i++) {
+      if (HTNode *node = full_index->slots[i].load(std::memory_order_relaxed)) {
+        size_t j = node->hash % grown->capacity;
+        while (grown->slots[j].load(std::memory_order_relaxed) != nullptr) {
+          j = (j + 1) % grown->capacity;
+        }
+        grown->slots[j].store(node, std::memory_order_relaxed);
+      }
+    }
+    index_.store(grown.get(), std::memory_order_release);
+    indexes_.emplace_back(std::move(grown));
+  }
+
+  HTNode *insert(unsigned long long hash) {
+    std::shared_lock<std::shared_mutex> lock{grow_mutex_};
+    Index *index = index_.load(std::memory_order_acquire);
+    auto new_node = std::make_unique<HTNode>(hash);
+    for (size_t i = hash % index->capacity;; i = (i + 1) % index->capacity) {
+      HTNode *node = index->slots[i].load(std::memory_order_acquire);
+      if (node == nullptr) {
+        if (!index->slots[i].compare_exchange_strong(node, new_node.get(), std::memory_order_acq_rel)) {
+          // the other thread has occupied the slot, it may be the same hash
+          i = (i + index->capacity - 1) % index->capacity;
+          continue;
+        }
+        used_size_.fetch_add(1, std::memory_order_relaxed);
+        return new_node.release();
+      }
+      if (node->hash == hash) {
+        return node;
+      }
+    }
+  }
+
 public:
   TSHashTable() :
-    nodes(new HTNode[N]),
-    used_size(0),
-    nodes_size(N) {
+    index_(new Index(INITIAL_CAPACITY)) {
+    indexes_.emplace_back(index_.load());
+  }
+
+  ~TSHashTable() {
+    const Index *index = index_.load();
+    for (size_t i = 0; i < index->capacity; i++) {
+      delete index->slots[i].load();
+    }
   }
 
   HTNode *at(unsigned long long hash) {
-    int i = (unsigned)hash % (unsigned)nodes_size;
     while (true) {
-      while (nodes[i].hash != 0 && nodes[i].hash != hash) {
-        i++;
-        if (i == nodes_size) {
-          i = 0;
-        }
+      Index *index = index_.load(std::memory_order_acquire);
+      if (HTNode *node = index->find(hash)) {
+        return node;
       }
-      if (nodes[i].hash == 0 && !__sync_bool_compare_and_swap(&nodes[i].hash, 0, hash)) {
-        int id = __sync_fetch_and_add(&used_size, 1);
-        assert(id * 2 < N);
-        continue;
+      if (!is_overfilled(used_size_.load(std::memory_order_relaxed), index->capacity)) {
+        return insert(hash);
       }
-      break;
+      grow(index);
     }
-    return &nodes[i];
   }
 
   const T *find(unsigned long long hash) {
-    int i = (unsigned)hash % (unsigned)nodes_size;
-    while (nodes[i].hash != 0 && nodes[i].hash != hash) {
-      i++;
-      if (i == nodes_size) {
-        i = 0;
-      }
-    }
+    const HTNode *node = index_.load(std::memory_order_acquire)->find(hash);
+    return node != nullptr ? &node->data : nullptr;
+  }
 
-    return nodes[i].hash == hash ? &nodes[i].data : nullptr;
+  size_t size() const {
+    return used_size_.load(std::memory_order_relaxed);
   }
 
   std::vector<T> get_all() {
-    std::vector<T> res;
-    for (int i = 0; i < N; i++) {
-      if (nodes[i].hash != 0) {
-        res.push_back(nodes[i].data);
-      }
-    }
-    return res;
+    return get_all_if([](const T &) { return true; });
   }
 
+  // the load factor is about 1/4 or more after the growth, so the iteration is linear in the number of elements
   template<class CondF>
   std::vector<T> get_all_if(const CondF &callbackF) {
     std::vector<T> res;
-    for (int i = 0; i < N; i++) {
-      if (nodes[i].hash != 0 && callbackF(nodes[i].data)) {
-        res.push_back(nodes[i].data);
+    const Index *index = index_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < index->capacity; i++) {
+      const HTNode *node = index->slots[i].load(std::memory_order_acquire);
+      if (node != nullptr && callbackF(node->data)) {
+        res.push_back(node->data);
       }
     }
     return res;
@@ -0,0 +1,134 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net/net-hpack.h"
+
+namespace {
+
+using headers_t = std::vector<std::pair<std::string, std::string>>;
+
+int collect_header(void *extra, const char *name, int name_len, const char *value, int value_len) {
+  static_cast<headers_t *>(extra)->emplace_back(std::string(name, name_len), std::string(value, value_len));
+  return 0;
+}
+
+std::string from_hex(const char *hex) {
+  std::string res;
+  for (; hex[0] && hex[1]; hex += 2) {
+    if (*hex == ' ') {
+      hex--;
+      continue;
+    }
+    res.push_back(static_cast<char>(std::stoi(std::string(hex, 2), nullptr, 16)));
+  }
+  return res;
+}
+
+headers_t decode(hpack_table *table, const std::string &block) {
+  headers_t headers;
+  EXPECT_EQ(hpack_decode(table, reinterpret_cast<const unsigned char *>(block.data()), block.size(), collect_header, &headers), 0);
+  return headers;
+}
+
+} // namespace
+
+// RFC 7541 C.3: requests without Huffman coding
+TEST(hpack, test_decode_requests) {
+  hpack_table table;
+  hpack_table_init(&table, HPACK_DEFAULT_TABLE_SIZE);
+
+  ASSERT_EQ(decode(&table, from_hex("828684410f7777772e6578616d706c652e636f6d")),
+            (headers_t{{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}}));
+  ASSERT_EQ(table.size, 57);
+
+  ASSERT_EQ(decode(&table, from_hex("828684be58086e6f2d6361636865")),
+            (headers_t{{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+  ASSERT_EQ(table.size, 110);
+
+  ASSERT_EQ(decode(&table, from_hex("828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565")),
+            (headers_t{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+  ASSERT_EQ(table.size, 164);
+  ASSERT_EQ(table.count, 3);
+
+  hpack_table_free(&table);
+}
+
+// RFC 7541 C.4: the same requests with Huffman coding
+TEST(hpack, test_decode_huffman_requests) {
+  hpack_table table;
+  hpack_table_init(&table, HPACK_DEFAULT_TABLE_SIZE);
+
+  ASSERT_EQ(decode(&table, from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff")),
+            (headers_t{{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}}));
+  ASSERT_EQ(decode(&table, from_hex("828684be5886a8eb10649cbf")),
+            (headers_t{{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+  ASSERT_EQ(decode(&table, from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf")),
+            (headers_t{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+  ASSERT_EQ(table.size, 164);
+
+  hpack_table_free(&table);
+}
+
+TEST(hpack, test_eviction) {
+  hpack_table table;
+  hpack_table_init(&table, 256);
+
+  // the literal with incremental indexing refers to the name of the entry, which is evicted by it
+  const std::string value(150, 'v');
+  ASSERT_EQ(decode(&table, from_hex("400a637573746f6d2d6b65797f17") + value), (headers_t{{"custom-key", value}}));
+  ASSERT_EQ(decode(&table, from_hex("7e7f17") + value), (headers_t{{"custom-key", value}}));
+  ASSERT_EQ(table.count, 1);
+  ASSERT_EQ(table.size, 32 + 10 + 150);
+
+  // the table size update to 0 evicts everything
+  ASSERT_EQ(decode(&table, from_hex("20")), headers_t{});
+  ASSERT_EQ(table.count, 0);
+  // and the table size can't exceed the limit
+  headers_t headers;
+  const std::string too_large = from_hex("3fe201");
+  ASSERT_EQ(hpack_decode(&table, reinterpret_cast<const unsigned char *>(too_large.data()), too_large.size(), collect_header, &headers), -1);
+
+  hpack_table_free(&table);
+}
+
+TEST(hpack, test_decode_errors) {
+  const char *blocks[] = {
+    "80",            // zero index
+    "be",            // the dynamic table is empty
+    "4088",          // truncated string
+    "ff808080808080", // integer overflow
+    "418cf1e3c2e5f23a6ba0ab90f4fe", // the padding is not EOS
+    "817f",          // truncated integer
+  };
+  for (const char *hex : blocks) {
+    hpack_table table;
+    hpack_table_init(&table, HPACK_DEFAULT_TABLE_SIZE);
+    const std::string block = from_hex(hex);
+    headers_t headers;
+    ASSERT_EQ(hpack_decode(&table, reinterpret_cast<const unsigned char *>(block.data()), block.size(), collect_header, &headers), -1) << hex;
+    hpack_table_free(&table);
+  }
+}
+
+TEST(hpack, test_encode) {
+  char buf[256];
+  int len = hpack_encode_status(buf, 0, sizeof(buf), 200);
+  len = hpack_encode_status(buf, len, sizeof(buf), 418);
+  len = hpack_encode_header(buf, len, sizeof(buf), "content-type", 12, "text/html", 9);
+  len = hpack_encode_header(buf, len, sizeof(buf), "x-custom", 8, std::string(200, 'x').c_str(), 200);
+  ASSERT_GT(len, 0);
+  ASSERT_EQ(hpack_encode_header(buf, len, sizeof(buf), "x-custom", 8, std::string(20, 'y').c_str(), 20), -1);
+
+  hpack_table table;
+  hpack_table_init(&table, HPACK_DEFAULT_TABLE_SIZE);
+  ASSERT_EQ(decode(&table, std::string(buf, len)),
+            (headers_t{{":status", "200"}, {":status", "418"}, {"content-type", "text/html"}, {"x-custom", std::string(200, 'x')}}));
+  ASSERT_EQ(table.count, 0);
+  hpack_table_free(&table);
+}
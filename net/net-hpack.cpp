@@ -0,0 +1,386 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-hpack.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HPACK_ENTRY_OVERHEAD 32
+#define HPACK_STATIC_TABLE_SIZE 61
+
+static const struct {
+  const char *name;
+  const char *value;
+} static_table[HPACK_STATIC_TABLE_SIZE] = {
+  {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+  {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+  {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+  {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+  {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+  {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""}, {"content-location", ""}, {"content-range", ""},
+  {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""}, {"expect", ""},
+  {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+  {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+  {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+  {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+  {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+  {"www-authenticate", ""},
+};
+
+/* RFC 7541 Appendix B, the codes of the symbols 0..255 and EOS */
+static const struct {
+  uint32_t code;
+  int bits;
+} huffman_codes[257] = {
+  {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28},
+  {0xfffffe6, 28}, {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+  {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28},
+  {0xfffffef, 28}, {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+  {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28},
+  {0xffffffa, 28}, {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+  {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11}, {0x3fa, 10}, {0x3fb, 10},
+  {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+  {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6},
+  {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+  {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6},
+  {0x5d, 7}, {0x5e, 7}, {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+  {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7},
+  {0x69, 7}, {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+  {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8}, {0x73, 7},
+  {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+  {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5},
+  {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+  {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7},
+  {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+  {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14},
+  {0x1ffd, 13}, {0xffffffc, 28}, {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+  {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23},
+  {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+  {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23}, {0xffffee, 24}, {0x7fffe1, 23},
+  {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+  {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21},
+  {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+  {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22},
+  {0x7fffeb, 23}, {0x7fffec, 23}, {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+  {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22},
+  {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+  {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22}, {0x7ffff2, 23},
+  {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+  {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21},
+  {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+  {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27},
+  {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+  {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22},
+  {0x1ffffee, 25}, {0x1ffffef, 25}, {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+  {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27},
+  {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+  {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26}, {0x3fffffff, 30},
+};
+
+#define HUFFMAN_EOS 256
+
+/* the children of the internal nodes: a positive number is the next node, a negative one is -(symbol + 1), 0 is none */
+static short huffman_tree[HUFFMAN_EOS][2];
+
+static void huffman_tree_init() {
+  static bool inited = false;
+  if (inited) {
+    return;
+  }
+  int nodes = 1;
+  for (int sym = 0; sym <= HUFFMAN_EOS; sym++) {
+    int node = 0;
+    for (int i = huffman_codes[sym].bits - 1; i > 0; i--) {
+      int bit = (huffman_codes[sym].code >> i) & 1;
+      if (!huffman_tree[node][bit]) {
+        assert (nodes < HUFFMAN_EOS);
+        huffman_tree[node][bit] = (short)nodes++;
+      }
+      node = huffman_tree[node][bit];
+      assert (node > 0);
+    }
+    assert (!huffman_tree[node][huffman_codes[sym].code & 1]);
+    huffman_tree[node][huffman_codes[sym].code & 1] = (short)(-sym - 1);
+  }
+  inited = true;
+}
+
+static int huffman_decode(const unsigned char *data, int len, char *out, int out_size) {
+  huffman_tree_init();
+
+  int out_len = 0;
+  int node = 0;
+  int pending_bits = 0;
+  bool pending_ones = true;
+  for (int i = 0; i < len; i++) {
+    for (int shift = 7; shift >= 0; shift--) {
+      int bit = (data[i] >> shift) & 1;
+      int next = huffman_tree[node][bit];
+      pending_bits++;
+      pending_ones = pending_ones && bit;
+      if (next >= 0) {
+        node = next;
+        continue;
+      }
+      if (next == -HUFFMAN_EOS - 1 || out_len == out_size) {
+        return -1;
+      }
+      out[out_len++] = (char)(-next - 1);
+      node = 0;
+      pending_bits = 0;
+      pending_ones = true;
+    }
+  }
+  /* the padding is the most significant bits of EOS, shorter than a byte */
+  if (pending_bits > 7 || !pending_ones) {
+    return -1;
+  }
+  return out_len;
+}
+
+static int decode_int(const unsigned char **p, const unsigned char *end, int prefix_bits, int *value) {
+  const int mask = (1 << prefix_bits) - 1;
+  int res = *(*p)++ & mask;
+  if (res < mask) {
+    *value = res;
+    return 0;
+  }
+  for (int shift = 0; *p < end && shift <= 21; shift += 7) {
+    unsigned char byte = *(*p)++;
+    res += (byte & 127) << shift;
+    if (!(byte & 128)) {
+      *value = res;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static int decode_string(const unsigned char **p, const unsigned char *end, char *scratch, const char **str, int *str_len) {
+  if (*p == end) {
+    return -1;
+  }
+  const bool huffman = (**p & 0x80) != 0;
+  int len;
+  if (decode_int(p, end, 7, &len) < 0 || len > end - *p) {
+    return -1;
+  }
+  if (huffman) {
+    *str_len = huffman_decode(*p, len, scratch, HPACK_MAX_STRING_SIZE);
+    if (*str_len < 0) {
+      return -1;
+    }
+    *str = scratch;
+  } else {
+    if (len > HPACK_MAX_STRING_SIZE) {
+      return -1;
+    }
+    *str = (const char *)*p;
+    *str_len = len;
+  }
+  *p += len;
+  return 0;
+}
+
+void hpack_table_init(struct hpack_table *t, int max_size_limit) {
+  memset(t, 0, sizeof(*t));
+  t->max_size = t->max_size_limit = max_size_limit;
+}
+
+void hpack_table_free(struct hpack_table *t) {
+  for (int i = 0; i < t->count; i++) {
+    free(t->entries[(t->first + i) % t->capacity].data);
+  }
+  free(t->entries);
+  memset(t, 0, sizeof(*t));
+}
+
+static void table_evict(struct hpack_table *t, int max_size) {
+  while (t->count && t->size > max_size) {
+    struct hpack_entry *oldest = &t->entries[(t->first + t->count - 1) % t->capacity];
+    t->size -= oldest->name_len + oldest->value_len + HPACK_ENTRY_OVERHEAD;
+    free(oldest->data);
+    t->count--;
+  }
+}
+
+static void table_add(struct hpack_table *t, const char *name, int name_len, const char *value, int value_len) {
+  const int entry_size = name_len + value_len + HPACK_ENTRY_OVERHEAD;
+  /* the name is copied before the eviction */
+  char *data = NULL;
+  if (entry_size <= t->max_size) {
+    data = static_cast<char *>(malloc(name_len + value_len));
+    assert (data || !(name_len + value_len));
+    memcpy(data, name, name_len);
+    memcpy(data + name_len, value, value_len);
+  }
+
+  table_evict(t, t->max_size - entry_size);
+  if (!data) {
+    return;
+  }
+
+  if (t->count == t->capacity) {
+    int capacity = t->capacity ? 2 * t->capacity : 16;
+    struct hpack_entry *entries = static_cast<struct hpack_entry *>(malloc(capacity * sizeof(struct hpack_entry)));
+    assert (entries);
+    for (int i = 0; i < t->count; i++) {
+      entries[i] = t->entries[(t->first + i) % t->capacity];
+    }
+    free(t->entries);
+    t->entries = entries;
+    t->capacity = capacity;
+    t->first = 0;
+  }
+  t->first = (t->first + t->capacity - 1) % t->capacity;
+  t->entries[t->first] = {data, name_len, value_len};
+  t->count++;
+  t->size += entry_size;
+}
+
+static int table_get(struct hpack_table *t, int index, const char **name, int *name_len, const char **value, int *value_len) {
+  if (index <= 0) {
+    return -1;
+  }
+  if (index <= HPACK_STATIC_TABLE_SIZE) {
+    *name = static_table[index - 1].name;
+    *name_len = (int)strlen(*name);
+    *value = static_table[index - 1].value;
+    *value_len = (int)strlen(*value);
+    return 0;
+  }
+  index -= HPACK_STATIC_TABLE_SIZE + 1;
+  if (index >= t->count) {
+    return -1;
+  }
+  const struct hpack_entry *entry = &t->entries[(t->first + index) % t->capacity];
+  *name = entry->data;
+  *name_len = entry->name_len;
+  *value = entry->data + entry->name_len;
+  *value_len = entry->value_len;
+  return 0;
+}
+
+int hpack_decode(struct hpack_table *t, const unsigned char *data, int len, hpack_header_handler_t handler, void *extra) {
+  static char name_scratch[HPACK_MAX_STRING_SIZE], value_scratch[HPACK_MAX_STRING_SIZE];
+  const unsigned char *p = data, *end = data + len;
+
+  while (p < end) {
+    const char *name, *value;
+    int name_len, value_len, index;
+
+    if (*p & 0x80) {
+      /* indexed header field */
+      if (decode_int(&p, end, 7, &index) < 0 || table_get(t, index, &name, &name_len, &value, &value_len) < 0) {
+        return -1;
+      }
+    } else if ((*p & 0xe0) == 0x20) {
+      /* dynamic table size update */
+      int max_size;
+      if (decode_int(&p, end, 5, &max_size) < 0 || max_size > t->max_size_limit) {
+        return -1;
+      }
+      t->max_size = max_size;
+      table_evict(t, max_size);
+      continue;
+    } else {
+      /* literal header field: with incremental indexing, without indexing or never indexed */
+      const bool add_to_table = (*p & 0x40) != 0;
+      if (decode_int(&p, end, add_to_table ? 6 : 4, &index) < 0) {
+        return -1;
+      }
+      if (index) {
+        const char *unused_value;
+        int unused_value_len;
+        if (table_get(t, index, &name, &name_len, &unused_value, &unused_value_len) < 0) {
+          return -1;
+        }
+      } else if (decode_string(&p, end, name_scratch, &name, &name_len) < 0) {
+        return -1;
+      }
+      if (decode_string(&p, end, value_scratch, &value, &value_len) < 0) {
+        return -1;
+      }
+      if (add_to_table) {
+        /* the name may refer to an entry, which is evicted by the new one */
+        if (handler(extra, name, name_len, value, value_len) < 0) {
+          return -1;
+        }
+        table_add(t, name, name_len, value, value_len);
+        continue;
+      }
+    }
+
+    if (handler(extra, name, name_len, value, value_len) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int encode_int(char *buf, int len, int buf_size, unsigned char first_byte, int prefix_bits, int value) {
+  const int mask = (1 << prefix_bits) - 1;
+  if (len == buf_size) {
+    return -1;
+  }
+  if (value < mask) {
+    buf[len++] = (char)(first_byte | value);
+    return len;
+  }
+  buf[len++] = (char)(first_byte | mask);
+  for (value -= mask; value >= 128; value >>= 7) {
+    if (len == buf_size) {
+      return -1;
+    }
+    buf[len++] = (char)(128 | (value & 127));
+  }
+  if (len == buf_size) {
+    return -1;
+  }
+  buf[len++] = (char)value;
+  return len;
+}
+
+static int encode_string(char *buf, int len, int buf_size, const char *str, int str_len) {
+  len = encode_int(buf, len, buf_size, 0, 7, str_len);
+  if (len < 0 || str_len > buf_size - len) {
+    return -1;
+  }
+  memcpy(buf + len, str, str_len);
+  return len + str_len;
+}
+
+int hpack_encode_header(char *buf, int len, int buf_size, const char *name, int name_len, const char *value, int value_len) {
+  int name_index = 0;
+  for (int i = 0; i < HPACK_STATIC_TABLE_SIZE && !name_index; i++) {
+    if ((int)strlen(static_table[i].name) == name_len && !memcmp(static_table[i].name, name, name_len)) {
+      name_index = i + 1;
+    }
+  }
+
+  /* literal header field without indexing */
+  len = encode_int(buf, len, buf_size, 0, 4, name_index);
+  if (len >= 0 && !name_index) {
+    len = encode_string(buf, len, buf_size, name, name_len);
+  }
+  if (len >= 0) {
+    len = encode_string(buf, len, buf_size, value, value_len);
+  }
+  return len;
+}
+
+int hpack_encode_status(char *buf, int len, int buf_size, int status) {
+  char value[16];
+  int value_len = snprintf(value, sizeof(value), "%d", status);
+  for (int i = 0; i < HPACK_STATIC_TABLE_SIZE; i++) {
+    if (!strcmp(static_table[i].name, ":status") && !strcmp(static_table[i].value, value)) {
+      return encode_int(buf, len, buf_size, 0x80, 7, i + 1);
+    }
+  }
+  return hpack_encode_header(buf, len, buf_size, ":status", 7, value, value_len);
+}
@@ -0,0 +1,45 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+/*
+ * HPACK (RFC 7541), the header compression of HTTP/2.
+ * The decoder supports the static and the dynamic tables and the Huffman coded strings.
+ * The encoder doesn't use the dynamic table and the Huffman coding: it emits the literals without indexing,
+ * which refer to the static table names, so the peer's decoder state never depends on it.
+ */
+
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+#define HPACK_MAX_STRING_SIZE (64 * 1024)
+
+struct hpack_entry {
+  char *data;  /* the name followed by the value */
+  int name_len;
+  int value_len;
+};
+
+struct hpack_table {
+  struct hpack_entry *entries;  /* the ring buffer, the newest entry is at first */
+  int capacity;
+  int first;
+  int count;
+  int size;            /* the sum of the entry sizes, see RFC 7541 4.1 */
+  int max_size;        /* changed by the dynamic table size updates of the peer */
+  int max_size_limit;  /* announced in SETTINGS_HEADER_TABLE_SIZE */
+};
+
+void hpack_table_init(struct hpack_table *t, int max_size_limit);
+void hpack_table_free(struct hpack_table *t);
+
+/* returns 0 to continue, or -1 to stop the decoding with an error */
+typedef int (*hpack_header_handler_t)(void *extra, const char *name, int name_len, const char *value, int value_len);
+
+/* decodes the complete header block; returns 0, or -1 on the compression error, after which the table can't be used anymore */
+int hpack_decode(struct hpack_table *t, const unsigned char *data, int len, hpack_header_handler_t handler, void *extra);
+
+/* appends the header to buf; returns the new length, or -1 if there is no space */
+int hpack_encode_header(char *buf, int len, int buf_size, const char *name, int name_len, const char *value, int value_len);
+/* appends the :status pseudo header */
+int hpack_encode_status(char *buf, int len, int buf_size, int status);
@@ -0,0 +1,158 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "common/precise-time.h"
+
+#include "net/net-http-parser.h"
+#include "net/net-http-server.h"
+
+namespace {
+
+constexpr int MAX_HEADERS = 16;
+
+struct parsed_request {
+  int size{0};
+  http_request_head head{};
+  http_header_slice headers[MAX_HEADERS]{};
+};
+
+parsed_request parse(const std::string &request) {
+  parsed_request res;
+  res.size = http_parse_request_head(request.data(), request.size(), &res.head, res.headers, MAX_HEADERS);
+  return res;
+}
+
+std::string slice(const std::string &request, int offset, int size) {
+  return request.substr(offset, size);
+}
+
+const std::string browser_request =
+  "GET /index.php?id=12345&section=feed HTTP/1.1\r\n"
+  "Host: example.com\r\n"
+  "Connection: keep-alive\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/90.0.4430.93 Safari/537.36\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Accept-Language: en-US,en;q=0.9\r\n"
+  "Cookie: remixlang=0; remixstid=1234567890_abcdefghijklmnopqrstuvwxyz; remixsid=0123456789abcdef0123456789abcdef\r\n"
+  "\r\n";
+
+} // namespace
+
+TEST(net_http_parser, test_get) {
+  const auto res = parse(browser_request);
+  ASSERT_EQ(res.size, browser_request.size());
+  ASSERT_EQ(res.head.header_size, browser_request.size());
+  ASSERT_EQ(res.head.query_type, htqt_get);
+  ASSERT_EQ(res.head.http_ver, HTTP_V11);
+  ASSERT_EQ(res.head.first_line_size, browser_request.find("Host"));
+  ASSERT_EQ(slice(browser_request, res.head.uri_offset, res.head.uri_size), "/index.php?id=12345&section=feed");
+  ASSERT_EQ(slice(browser_request, res.head.host_offset, res.head.host_size), "example.com");
+  ASSERT_TRUE(res.head.keep_alive);
+  ASSERT_EQ(res.head.data_size, -1);
+
+  ASSERT_EQ(res.head.headers_num, 7);
+  const auto &user_agent = res.headers[2];
+  ASSERT_EQ(slice(browser_request, user_agent.name_offset, user_agent.name_size), "User-Agent");
+  ASSERT_EQ(slice(browser_request, user_agent.value_offset, user_agent.value_size).substr(0, 12), "Mozilla/5.0 ");
+  const auto &cookie = res.headers[6];
+  ASSERT_EQ(slice(browser_request, cookie.name_offset, cookie.name_size), "Cookie");
+  ASSERT_EQ(cookie.value_offset + cookie.value_size + 4, browser_request.size());
+}
+
+TEST(net_http_parser, test_post) {
+  const std::string request = "POST  /upload   HTTP/1.0 \r\ncontent-length:\t42 \r\nX-Empty:\r\nX-Spaces: \t value \t\r\n\r\n";
+  const auto res = parse(request);
+  ASSERT_EQ(res.size, request.size());
+  ASSERT_EQ(res.head.query_type, htqt_post);
+  ASSERT_EQ(res.head.http_ver, HTTP_V10);
+  ASSERT_EQ(slice(request, res.head.uri_offset, res.head.uri_size), "/upload");
+  ASSERT_EQ(res.head.data_size, 42);
+  ASSERT_EQ(res.head.host_size, 0);
+  ASSERT_FALSE(res.head.keep_alive);
+  ASSERT_EQ(res.head.headers_num, 3);
+  ASSERT_EQ(res.headers[1].value_size, 0);
+  ASSERT_EQ(slice(request, res.headers[2].value_offset, res.headers[2].value_size), "value");
+}
+
+TEST(net_http_parser, test_bare_lf) {
+  const std::string request = "HEAD / HTTP/1.1\nHost: a.b\n\n";
+  const auto res = parse(request);
+  ASSERT_EQ(res.size, request.size());
+  ASSERT_EQ(res.head.query_type, htqt_head);
+  ASSERT_EQ(res.head.first_line_size, 16);
+  ASSERT_EQ(slice(request, res.head.host_offset, res.head.host_size), "a.b");
+}
+
+TEST(net_http_parser, test_pipelined) {
+  const std::string first = "GET /first HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+  const std::string second = "GET /second HTTP/1.1\r\n\r\n";
+  const std::string requests = first + second;
+  const auto res = parse(requests);
+  ASSERT_EQ(res.size, first.size());
+
+  http_request_head head{};
+  ASSERT_EQ(http_parse_request_head(requests.data() + res.size, requests.size() - res.size, &head, nullptr, 0), second.size());
+  ASSERT_EQ(slice(second, head.uri_offset, head.uri_size), "/second");
+}
+
+TEST(net_http_parser, test_incomplete) {
+  for (size_t len = 0; len < browser_request.size(); ++len) {
+    ASSERT_EQ(parse(browser_request.substr(0, len)).size, 0);
+  }
+}
+
+TEST(net_http_parser, test_left_to_state_machine) {
+  const char *requests[] = {
+    "GET /\r\n\r\n",
+    "GET / HTTP/2.0\r\n\r\n",
+    "PUT / HTTP/1.1\r\n\r\n",
+    "get / HTTP/1.1\r\n\r\n",
+    "GET\t/ HTTP/1.1\r\n\r\n",
+    " GET / HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 1\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 2147483648\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1a\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length:\r\n\r\n",
+    "GET / HTTP/1.1\r\nConnection: keep-alive, Upgrade\r\n\r\n",
+    "GET / HTTP/1.1\r\nX-Folded: a\r\n b\r\n\r\n",
+    "GET / HTTP/1.1\r\nX-Bad-CR: a\rb\r\n\r\n",
+    "GET / HTTP/1.1\r\nNo-Colon\r\n\r\n",
+    "GET / HTTP/1.1\r\nName : value\r\n\r\n",
+    "GET / HTTP/1.1\r\n\r\r\n",
+  };
+  for (const char *request : requests) {
+    ASSERT_EQ(parse(request).size, 0) << request;
+  }
+
+  std::string many_headers = "GET / HTTP/1.1\r\n";
+  for (int i = 0; i <= MAX_HEADERS; ++i) {
+    many_headers += "X-Header: value\r\n";
+  }
+  many_headers += "\r\n";
+  ASSERT_EQ(parse(many_headers).size, 0);
+  http_request_head head{};
+  ASSERT_EQ(http_parse_request_head(many_headers.data(), many_headers.size(), &head, nullptr, 0), many_headers.size());
+  ASSERT_EQ(head.headers_num, MAX_HEADERS + 1);
+
+  std::string huge_header = "GET / HTTP/1.1\r\nX-Huge: " + std::string(MAX_HTTP_HEADER_SIZE, 'x') + "\r\n\r\n";
+  ASSERT_EQ(parse(huge_header).size, 0);
+}
+
+TEST(net_http_parser, DISABLED_benchmark_browser_request) {
+  constexpr int ITERATIONS = 1000000;
+  http_request_head head{};
+  http_header_slice headers[MAX_HEADERS];
+  long long total = 0;
+  const double start = get_utime_monotonic();
+  for (int i = 0; i != ITERATIONS; ++i) {
+    total += http_parse_request_head(browser_request.data(), browser_request.size(), &head, headers, MAX_HEADERS);
+  }
+  const double elapsed = get_utime_monotonic() - start;
+  ASSERT_EQ(total, static_cast<long long>(browser_request.size()) * ITERATIONS);
+  fprintf(stderr, "%zu bytes request: %.0f ns/request, %.0f MB/sec\n", browser_request.size(), elapsed * 1e9 / ITERATIONS, total / elapsed / 1e6);
+}
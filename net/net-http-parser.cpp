@@ -0,0 +1,239 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-http-parser.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "net/net-http-server.h"
+
+#if defined(__aarch64__)
+/* neon has no movemask, each byte is represented by a nibble */
+static inline int neon_first_byte(uint8x16_t eq) {
+  const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+  return mask ? __builtin_ctzll(mask) >> 2 : -1;
+}
+#endif
+
+/* the first '\r' or '\n' */
+static inline const char *find_eol(const char *p, const char *end) {
+#if defined(__x86_64__)
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  for (; end - p >= 16; p += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+    const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf)));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#elif defined(__aarch64__)
+  for (; end - p >= 16; p += 16) {
+    const uint8x16_t bytes = vld1q_u8((const uint8_t *)p);
+    const int first = neon_first_byte(vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\r')), vceqq_u8(bytes, vdupq_n_u8('\n'))));
+    if (first >= 0) {
+      return p + first;
+    }
+  }
+#endif
+  while (p < end && *p != '\r' && *p != '\n') {
+    p++;
+  }
+  return p;
+}
+
+/* the first byte, which is not greater than ' ' (as unsigned) */
+static inline const char *find_token_end(const char *p, const char *end) {
+#if defined(__x86_64__)
+  const __m128i space = _mm_set1_epi8(' ');
+  for (; end - p >= 16; p += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(bytes, space), bytes));
+    if (mask) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#elif defined(__aarch64__)
+  for (; end - p >= 16; p += 16) {
+    const uint8x16_t bytes = vld1q_u8((const uint8_t *)p);
+    const int first = neon_first_byte(vcleq_u8(bytes, vdupq_n_u8(' ')));
+    if (first >= 0) {
+      return p + first;
+    }
+  }
+#endif
+  while (p < end && (unsigned char)*p > ' ') {
+    p++;
+  }
+  return p;
+}
+
+static inline const char *skip_spaces(const char *p, const char *end, bool skip_tabs) {
+  while (p < end && (*p == ' ' || (*p == '\t' && skip_tabs))) {
+    p++;
+  }
+  return p;
+}
+
+/* the header names are short, and their bytes are checked one by one anyway */
+static inline const char *find_header_name_end(const char *p, const char *end) {
+  while (p < end && *p > ' ' && *p != ':') {
+    p++;
+  }
+  return p;
+}
+
+/* skips the line end, returns NULL if there is no valid one */
+static inline const char *skip_eol(const char *p, const char *end) {
+  if (p < end && *p == '\r') {
+    p++;
+  }
+  if (p == end || *p != '\n') {
+    return NULL;
+  }
+  return p + 1;
+}
+
+static int parse_query_type(const char *word, int len) {
+  if (len == 3 && !memcmp(word, "GET", 3)) {
+    return htqt_get;
+  }
+  if (len == 4 && !memcmp(word, "HEAD", 4)) {
+    return htqt_head;
+  }
+  if (len == 4 && !memcmp(word, "POST", 4)) {
+    return htqt_post;
+  }
+  if (len == 7 && !memcmp(word, "OPTIONS", 7)) {
+    return htqt_options;
+  }
+  return htqt_error;
+}
+
+int http_parse_request_head(const char *buf, int len, struct http_request_head *head, struct http_header_slice *headers, int max_headers) {
+  /* the state machine doesn't accept the heads of MAX_HTTP_HEADER_SIZE bytes and more */
+  const char *end = buf + (len < MAX_HTTP_HEADER_SIZE ? len : MAX_HTTP_HEADER_SIZE - 1);
+  const char *p = buf;
+
+  memset(head, 0, sizeof(*head));
+  head->data_size = -1;
+
+  /* METHOD SP+ URI SP+ HTTP/1.x SP* CRLF */
+  const char *word_end = find_token_end(p, end);
+  if (word_end == end || *word_end != ' ') {
+    return 0;
+  }
+  head->query_type = parse_query_type(p, word_end - p);
+  if (head->query_type == htqt_error) {
+    return 0;
+  }
+
+  p = skip_spaces(word_end, end, false);
+  word_end = find_token_end(p, end);
+  if (word_end == end || *word_end != ' ' || word_end == p || word_end - p > MAX_HTTP_HEADER_QUERY_WORD_SIZE) {
+    return 0;
+  }
+  head->uri_offset = p - buf;
+  head->uri_size = word_end - p;
+
+  p = skip_spaces(word_end, end, false);
+  word_end = find_token_end(p, end);
+  if (word_end - p != 8 || memcmp(p, "HTTP/1.", 7) || (p[7] != '0' && p[7] != '1')) {
+    return 0;
+  }
+  head->http_ver = p[7] == '1' ? HTTP_V11 : HTTP_V10;
+
+  p = skip_eol(skip_spaces(word_end, end, false), end);
+  if (!p) {
+    return 0;
+  }
+  head->first_line_size = p - buf;
+
+  while (true) {
+    if (p == end) {
+      return 0;
+    }
+    if (*p == '\r' || *p == '\n') {
+      p = skip_eol(p, end);
+      break;
+    }
+
+    /* NAME ':' (SP|HT)* VALUE (SP|HT)* CRLF */
+    const char *name = p;
+    p = find_header_name_end(p, end);
+    if (p == end || *p != ':' || p - name > MAX_HTTP_HEADER_KEY_SIZE) {
+      return 0;
+    }
+    const int name_size = p - name;
+    const char *value = skip_spaces(p + 1, end, true);
+    const char *value_end;
+
+    if (name_size == 14 && !strncasecmp(name, "content-length", 14)) {
+      if (head->data_size != -1) {
+        return 0;
+      }
+      long long size = 0;
+      for (value_end = value; value_end < end && *value_end >= '0' && *value_end <= '9'; value_end++) {
+        if (size >= 0x7fffffffL / 10) {
+          return 0;
+        }
+        size = size * 10 + (*value_end - '0');
+      }
+      if (value_end == value) {
+        return 0;
+      }
+      head->data_size = (int)size;
+      p = skip_spaces(value_end, end, true);
+    } else if ((name_size == 4 && !strncasecmp(name, "host", 4)) || (name_size == 10 && !strncasecmp(name, "connection", 10))) {
+      /* a single token is expected */
+      value_end = find_token_end(value, end);
+      if (value_end != value) {
+        if (name_size == 4) {
+          head->host_offset = value - buf;
+          head->host_size = value_end - value;
+        } else if (value_end - value == 10 && !strncasecmp(value, "keep-alive", 10)) {
+          head->keep_alive = 1;
+        }
+      }
+      p = skip_spaces(value_end, end, true);
+    } else {
+      p = find_eol(value, end);
+      value_end = p;
+      while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+        value_end--;
+      }
+    }
+
+    p = skip_eol(p, end);
+    if (!p) {
+      return 0;
+    }
+
+    if (headers) {
+      if (head->headers_num == max_headers) {
+        return 0;
+      }
+      struct http_header_slice *header = &headers[head->headers_num];
+      header->name_offset = name - buf;
+      header->name_size = name_size;
+      header->value_offset = value - buf;
+      header->value_size = value_end - value;
+    }
+    head->headers_num++;
+  }
+
+  if (!p) {
+    return 0;
+  }
+  head->header_size = p - buf;
+  return head->header_size;
+}
@@ -0,0 +1,40 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+/*
+ * The fast path of the HTTP request head parsing.
+ * The head must be fully in the contiguous buffer, it is scanned with SIMD
+ * for the line ends and the token ends, nothing is copied: the uri, the host
+ * and the headers are recorded as the slices (offsets) of the buffer.
+ * Only the well formed requests are accepted, the incomplete or unusual ones
+ * (HTTP/0.9, errors, too large heads) are left to the byte-at-a-time state machine
+ * of hts_parse_execute(), which is the reference of the accepted syntax.
+ */
+
+struct http_header_slice {
+  int name_offset;
+  int name_size;
+  int value_offset;
+  int value_size;
+};
+
+struct http_request_head {
+  int query_type;       /* enum hts_query_type */
+  int http_ver;
+  int keep_alive;
+  int header_size;
+  int first_line_size;
+  int uri_offset;
+  int uri_size;
+  int host_offset;
+  int host_size;
+  int data_size;        /* -1 if there is no Content-Length */
+  int headers_num;
+};
+
+/* returns the size of the head, or 0 if the request must be parsed by the state machine;
+ * the headers are recorded if the array is given, the heads with more than max_headers headers are not accepted then */
+int http_parse_request_head(const char *buf, int len, struct http_request_head *head, struct http_header_slice *headers, int max_headers);
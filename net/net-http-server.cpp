@@ -17,6 +17,8 @@
 #include "net/net-buffers.h"
 #include "net/net-connections.h"
 #include "net/net-events.h"
+#include "net/net-http-parser.h"
+#include "net/net-http2-server.h"
 
 /*
  *
@@ -27,7 +29,7 @@
 #define	SERVER_VERSION	"nginx/0.3.33"
 
 int http_connections;
-long long http_queries, http_bad_headers, http_queries_size;
+long long http_queries, http_bad_headers, http_queries_size, http_fast_parsed_queries;
 
 static const char *extra_http_response_headers = "";
 
@@ -92,7 +94,8 @@ struct http_server_functions default_http_server = {
   .execute = hts_default_execute,
   .ht_wakeup = hts_do_wakeup,
   .ht_alarm = hts_do_wakeup,
-  .ht_close = NULL
+  .ht_close = NULL,
+  .execute_http2 = NULL
 };
 
 int hts_default_execute (struct connection *c, int op) {
@@ -127,8 +130,9 @@ int hts_default_execute (struct connection *c, int op) {
 
 }
 
-int hts_init_accepted (struct connection *c __attribute__((unused))) {//TODO: this unused generated by script, recheck it.
+int hts_init_accepted (struct connection *c) {
   http_connections++;
+  HTS_DATA(c)->http2 = NULL;
   return 0;
 }
 
@@ -138,6 +142,9 @@ int hts_close_connection (struct connection *c, int who) {
   if (HTS_FUNC(c)->ht_close != NULL) {
     HTS_FUNC(c)->ht_close (c, who);
   } 
+  if (HTS_DATA(c)->http2) {
+    http2_free_connection (c);
+  }
 
   return server_close_connection (c, who);
 }
@@ -206,12 +213,40 @@ int write_http_error (struct connection *c, int code) {
   }
 }
 
+void hts_set_request_head (struct hts_data *D, const struct http_request_head *head) {
+  D->query_type = head->query_type;
+  D->query_flags = head->keep_alive ? QF_KEEPALIVE : 0;
+  D->header_size = head->header_size;
+  D->first_line_size = head->first_line_size;
+  D->data_size = head->data_size;
+  D->host_offset = head->host_offset;
+  D->host_size = head->host_size;
+  D->uri_offset = head->uri_offset;
+  D->uri_size = head->uri_size;
+  D->http_ver = head->http_ver;
+}
+
+/* the whole head in the contiguous chunk is parsed at once, the rest is done by the state machine */
+static int hts_fast_parse_head (struct hts_data *D, const char *ptr, int len) {
+  struct http_request_head head;
+  if (!http_parse_request_head (ptr, len, &head, NULL, 0)) {
+    return 0;
+  }
+  hts_set_request_head (D, &head);
+  http_fast_parsed_queries++;
+  return 1;
+}
+
 int hts_parse_execute (struct connection *c) {
   struct hts_data *D = HTS_DATA(c);
   char *ptr, *ptr_s, *ptr_e;
   int len;
   long long tt;
 
+  if (D->http2) {
+    return http2_parse_execute (c);
+  }
+
   while (c->status == conn_expect_query || c->status == conn_reading_query) {
     len = nbit_ready_bytes (&c->Q);
     ptr = ptr_s = static_cast<char*>(nbit_get_ptr (&c->Q));
@@ -228,6 +263,21 @@ int hts_parse_execute (struct connection *c) {
           memset (D, 0, sizeof (*D));
           D->query_type = htqt_none;
           D->data_size = -1;
+          if (*ptr == HTTP2_PREFACE[0] && HTS_FUNC(c)->execute_http2) {
+            int res = http2_check_preface (c);
+            if (res < 0) {
+              return NEED_MORE_BYTES;
+            }
+            if (res > 0) {
+              http2_init_connection (c);
+              return http2_parse_execute (c);
+            }
+          }
+          if (hts_fast_parse_head (D, ptr, ptr_e - ptr)) {
+            ptr += D->header_size;
+            c->parse_state = htqp_done;
+            break;
+          }
           c->parse_state = htqp_readtospace;
           /* fallthrough */
 
@@ -634,6 +684,9 @@ int hts_std_wakeup (struct connection *c) {
   if (c->status == conn_wait_net || c->status == conn_wait_aio) {
     c->status = conn_expect_query;
     HTS_FUNC(c)->ht_wakeup (c);
+    if (HTS_DATA(c)->http2) {
+      http2_execute_streams (c);
+    }
   }
   if (c->Out.total_bytes > 0) {
     c->flags |= C_WANTWR;
@@ -647,6 +700,9 @@ int hts_std_wakeup (struct connection *c) {
 
 int hts_std_alarm (struct connection *c) {
   HTS_FUNC(c)->ht_alarm (c);
+  if (HTS_DATA(c)->http2) {
+    http2_execute_streams (c);
+  }
   if (c->Out.total_bytes > 0) {
     c->flags |= C_WANTWR;
   }
@@ -19,13 +19,18 @@ struct http_server_functions {
   int (*ht_wakeup)(struct connection *c);
   int (*ht_alarm)(struct connection *c);
   int (*ht_close)(struct connection *c, int who);
+  /* executes the request of HTTP/2 stream, converted to HTTP/1.1 head and the body; HTTP/2 is refused if it's not set */
+  int (*execute_http2)(struct connection *c, int op, char *head, char *body);
 };
 
 #define	HTTP_V09	9
 #define	HTTP_V10	0x100
 #define	HTTP_V11	0x101
 
-/* in conn->custom_data, 104 bytes */
+struct http2_connection;
+struct http_request_head;
+
+/* in conn->custom_data, 112 bytes */
 struct hts_data {
   int query_type;
   int query_flags;
@@ -46,7 +51,9 @@ struct hts_data {
   int extra_int3;
   int extra_int4;
   double extra_double, extra_double2;
+  struct http2_connection *http2;  /* is set after the HTTP/2 connection preface */
 };
+static_assert(sizeof(struct hts_data) <= CONN_CUSTOM_DATA_BYTES, "hts_data doesn't fit into custom_data");
 
 /* for hts_data.query_type */
 enum hts_query_type {
@@ -78,9 +85,10 @@ int hts_std_wakeup (struct connection *c);
 int hts_std_alarm (struct connection *c);
 int hts_init_accepted (struct connection *c);
 int hts_close_connection (struct connection *c, int who);
+void hts_set_request_head (struct hts_data *D, const struct http_request_head *head);
 
 extern int http_connections;
-extern long long http_queries, http_bad_headers, http_queries_size;
+extern long long http_queries, http_bad_headers, http_queries_size, http_fast_parsed_queries;
 
 /* useful functions */
 int get_http_header (const char *qHeaders, const int qHeadersLen, char *buffer, int b_len, const char *arg_name, const int arg_len);
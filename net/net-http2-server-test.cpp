@@ -0,0 +1,359 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net/net-buffers.h"
+#include "net/net-connections.h"
+#include "net/net-hpack.h"
+#include "net/net-http-server.h"
+#include "net/net-http2-server.h"
+
+namespace {
+
+using headers_t = std::vector<std::pair<std::string, std::string>>;
+
+struct executed_request {
+  std::string head;
+  std::string body;
+};
+
+struct frame {
+  int type;
+  int flags;
+  int stream_id;
+  std::string payload;
+};
+
+std::vector<executed_request> executed;
+std::string response_head;
+std::string response_body;
+
+int execute_http2(connection *c, int op __attribute__((unused)), char *head, char *body) {
+  const hts_data *D = HTS_DATA(c);
+  executed.push_back({std::string(head, D->header_size), body ? std::string(body, D->data_size) : std::string()});
+  http2_write_response(c, response_head.data(), response_head.size(), response_body.data(), response_body.size());
+  return 0;
+}
+
+std::string make_frame(int type, int flags, int stream_id, const std::string &payload) {
+  std::string res;
+  res.push_back(static_cast<char>(payload.size() >> 16));
+  res.push_back(static_cast<char>(payload.size() >> 8));
+  res.push_back(static_cast<char>(payload.size()));
+  res.push_back(static_cast<char>(type));
+  res.push_back(static_cast<char>(flags));
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    res.push_back(static_cast<char>(stream_id >> shift));
+  }
+  return res + payload;
+}
+
+std::string make_int(unsigned int value, int bytes = 4) {
+  std::string res;
+  for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+    res.push_back(static_cast<char>(value >> shift));
+  }
+  return res;
+}
+
+std::string make_headers_block(const headers_t &headers) {
+  char buf[4096];
+  int len = 0;
+  for (const auto &header : headers) {
+    len = hpack_encode_header(buf, len, sizeof(buf), header.first.data(), header.first.size(), header.second.data(), header.second.size());
+  }
+  return std::string(buf, len);
+}
+
+int collect_header(void *extra, const char *name, int name_len, const char *value, int value_len) {
+  static_cast<headers_t *>(extra)->emplace_back(std::string(name, name_len), std::string(value, value_len));
+  return 0;
+}
+
+const std::string get_request = make_frame(1, 0x5, 1, make_headers_block({{":method", "GET"}, {":scheme", "http"}, {":path", "/a?x=1"}, {":authority", "example.com"},
+                                                                           {"cookie", "a=1"}, {"user-agent", "test"}, {"cookie", "b=2"}}));
+
+class http2_server : public ::testing::Test {
+protected:
+  void SetUp() override {
+    static bool netbuffers_initialized = false;
+    if (!netbuffers_initialized) {
+      init_netbuffers();
+      netbuffers_initialized = true;
+    }
+    memset(&c, 0, sizeof(c));
+    init_connection_buffers(&c);
+    functions = http_server_functions();
+    functions.execute_http2 = execute_http2;
+    c.extra = &functions;
+    c.status = conn_expect_query;
+    executed.clear();
+    response_head = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: keep-alive\r\nX-Custom:  value \r\n\r\n";
+    response_body = "Hello world!";
+    hpack_table_init(&decoder, HPACK_DEFAULT_TABLE_SIZE);
+  }
+
+  void TearDown() override {
+    if (HTS_DATA(&c)->http2) {
+      http2_free_connection(&c);
+    }
+    free_all_buffers(&c.In);
+    free_all_buffers(&c.Out);
+    hpack_table_free(&decoder);
+  }
+
+  /* the same calls as in server_reader() */
+  void receive(const std::string &bytes) {
+    write_out(&c.In, bytes.data(), bytes.size());
+    if (c.status == conn_expect_query) {
+      nbit_set(&c.Q, &c.In);
+      c.parse_state = 0;
+      c.status = conn_reading_query;
+    }
+    if (!hts_parse_execute(&c) && c.status == conn_reading_query) {
+      c.status = conn_expect_query;
+    }
+  }
+
+  std::vector<frame> sent_frames() {
+    std::string out(get_total_ready_bytes(&c.Out), '\0');
+    EXPECT_EQ(read_in(&c.Out, &out[0], out.size()), out.size());
+    std::vector<frame> frames;
+    for (size_t offset = 0; offset + 9 <= out.size();) {
+      const auto *p = reinterpret_cast<const unsigned char *>(out.data() + offset);
+      const int len = (p[0] << 16) | (p[1] << 8) | p[2];
+      frames.push_back({p[3], p[4], static_cast<int>(((p[5] & 0x7f) << 24) | (p[6] << 16) | (p[7] << 8) | p[8]), out.substr(offset + 9, len)});
+      offset += 9 + len;
+    }
+    return frames;
+  }
+
+  void open_post_streams(int last_stream_id) {
+    std::string input = HTTP2_PREFACE + make_frame(4, 0, 0, "");
+    for (int stream_id = 1; stream_id <= last_stream_id; stream_id += 2) {
+      input += make_frame(1, 0x4, stream_id, make_headers_block({{":method", "POST"}, {":scheme", "http"}, {":path", "/"}}));
+      windows[stream_id] = 65535;
+    }
+    receive(input);
+    sent_frames();
+  }
+
+  // sends the body frames, while the stream window allows; returns the number of the sent frames
+  int send_body(int stream_id, int frames_count) {
+    int sent = 0;
+    for (update_windows(); sent < frames_count && windows[stream_id] >= 16384; update_windows()) {
+      receive(make_frame(0, 0, stream_id, std::string(16384, 'x')));
+      windows[stream_id] -= 16384;
+      sent++;
+    }
+    return sent;
+  }
+
+  void update_windows() {
+    for (const frame &f : sent_frames()) {
+      if (f.type == 8 && f.stream_id) {
+        const auto *p = reinterpret_cast<const unsigned char *>(f.payload.data());
+        windows[f.stream_id] += (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+      }
+    }
+  }
+
+  headers_t decode(const std::string &block) {
+    headers_t headers;
+    EXPECT_EQ(hpack_decode(&decoder, reinterpret_cast<const unsigned char *>(block.data()), block.size(), collect_header, &headers), 0);
+    return headers;
+  }
+
+  // the bodies, which are a frame shorter than the limit
+  static constexpr int frames_per_body = HTTP2_MAX_BODY_SIZE / 16384 - 1;
+
+  connection c;
+  http_server_functions functions;
+  hpack_table decoder;
+  std::map<int, int> windows;
+};
+
+} // namespace
+
+TEST_F(http2_server, test_requests) {
+  const std::string post_request = make_frame(1, 0x4, 3, make_headers_block({{":method", "POST"}, {":scheme", "http"}, {":path", "/b"}}));
+  receive(HTTP2_PREFACE + make_frame(4, 0, 0, "") + get_request + post_request + make_frame(0, 0, 3, "hello") + make_frame(0, 0x1, 3, "world"));
+
+  ASSERT_EQ(executed.size(), 2);
+  ASSERT_EQ(executed[0].head, "GET /a?x=1 HTTP/1.1\r\nHost: example.com\r\nuser-agent: test\r\nCookie: a=1; b=2\r\n\r\n");
+  ASSERT_EQ(executed[0].body, "");
+  ASSERT_EQ(executed[1].head, "POST /b HTTP/1.1\r\nContent-Length: 10\r\n\r\n");
+  ASSERT_EQ(executed[1].body, "helloworld");
+  ASSERT_EQ(c.status, conn_expect_query);
+
+  const auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 6);
+  // the own settings and the acknowledgement of the client ones
+  ASSERT_EQ(frames[0].type, 4);
+  ASSERT_EQ(frames[0].flags, 0);
+  ASSERT_EQ(frames[1].type, 4);
+  ASSERT_EQ(frames[1].flags, 0x1);
+  for (int i = 0; i < 2; i++) {
+    const frame &headers = frames[2 + 2 * i];
+    const frame &data = frames[3 + 2 * i];
+    ASSERT_EQ(headers.type, 1);
+    ASSERT_EQ(headers.flags, 0x4);
+    ASSERT_EQ(headers.stream_id, 1 + 2 * i);
+    ASSERT_EQ(decode(headers.payload), (headers_t{{":status", "200"}, {"content-type", "text/plain"}, {"x-custom", "value"}}));
+    ASSERT_EQ(data.type, 0);
+    ASSERT_EQ(data.flags, 0x1);
+    ASSERT_EQ(data.stream_id, 1 + 2 * i);
+    ASSERT_EQ(data.payload, "Hello world!");
+  }
+}
+
+TEST_F(http2_server, test_partial_input) {
+  const std::string input = HTTP2_PREFACE + make_frame(4, 0, 0, make_int(4, 2) + make_int(100)) + get_request;
+  for (char byte : input) {
+    ASSERT_TRUE(executed.empty());
+    receive(std::string(1, byte));
+  }
+  ASSERT_EQ(executed.size(), 1);
+  ASSERT_EQ(executed[0].head, "GET /a?x=1 HTTP/1.1\r\nHost: example.com\r\nuser-agent: test\r\nCookie: a=1; b=2\r\n\r\n");
+  ASSERT_EQ(get_total_ready_bytes(&c.In), 0);
+}
+
+TEST_F(http2_server, test_flow_control) {
+  response_body = std::string(25, 'x');
+  receive(HTTP2_PREFACE + make_frame(4, 0, 0, make_int(4, 2) + make_int(10)) + get_request);
+  ASSERT_EQ(executed.size(), 1);
+
+  auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 4);
+  ASSERT_EQ(frames[3].type, 0);
+  ASSERT_EQ(frames[3].flags, 0);
+  ASSERT_EQ(frames[3].payload, std::string(10, 'x'));
+
+  // the rest is sent, when the stream window is enlarged
+  receive(make_frame(8, 0, 1, make_int(5)));
+  frames = sent_frames();
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_EQ(frames[0].flags, 0);
+  ASSERT_EQ(frames[0].payload, std::string(5, 'x'));
+
+  receive(make_frame(8, 0, 1, make_int(100)));
+  frames = sent_frames();
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_EQ(frames[0].flags, 0x1);
+  ASSERT_EQ(frames[0].payload, std::string(10, 'x'));
+}
+
+TEST_F(http2_server, test_too_long_body) {
+  receive(HTTP2_PREFACE + make_frame(4, 0, 0, "") + make_frame(1, 0x4, 1, make_headers_block({{":method", "POST"}, {":scheme", "http"}, {":path", "/"}})));
+  sent_frames();
+
+  // the body isn't buffered up to its end, the stream is answered as soon as the limit is reached
+  const std::string data = make_frame(0, 0, 1, std::string(16384, 'x'));
+  for (int i = 0; i < HTTP2_MAX_BODY_SIZE / 16384; i++) {
+    receive(data);
+  }
+  auto frames = sent_frames();
+  ASSERT_GE(frames.size(), 3);
+  const frame &headers = frames[frames.size() - 3];
+  ASSERT_EQ(headers.type, 1);
+  ASSERT_EQ(decode(headers.payload)[0], (std::pair<std::string, std::string>{":status", "413"}));
+  ASSERT_EQ(frames[frames.size() - 2].type, 0);
+  ASSERT_EQ(frames[frames.size() - 2].flags, 0x1);
+  ASSERT_EQ(frames.back().type, 3);
+  ASSERT_EQ(frames.back().payload, make_int(0));
+  ASSERT_TRUE(executed.empty());
+  ASSERT_EQ(c.status, conn_expect_query);
+}
+
+TEST_F(http2_server, test_buffered_body_budget) {
+  open_post_streams(7);
+  // the bodies are buffered up to the budget
+  ASSERT_EQ(send_body(1, frames_per_body), frames_per_body);
+  ASSERT_EQ(send_body(3, frames_per_body), frames_per_body);
+  // the connection buffers more than the budget, so the window of the third stream isn't enlarged
+  ASSERT_EQ(send_body(5, frames_per_body), 3);
+  ASSERT_EQ(windows[5], 16383);
+
+  // the oldest stream is still served, its body stays shorter than the limit
+  receive(make_frame(0, 0, 1, std::string(16383, 'x')));
+  const auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 2);
+  ASSERT_EQ(frames[1].type, 8);
+  ASSERT_EQ(frames[1].stream_id, 1);
+
+  // the window is returned, as soon as the executed request releases its body
+  receive(make_frame(0, 0x1, 1, ""));
+  ASSERT_EQ(executed.size(), 1);
+  ASSERT_EQ(send_body(5, frames_per_body - 3), frames_per_body - 3);
+}
+
+TEST_F(http2_server, test_receive_window) {
+  open_post_streams(5);
+  ASSERT_EQ(send_body(1, frames_per_body), frames_per_body);
+  ASSERT_EQ(send_body(3, frames_per_body), frames_per_body);
+  ASSERT_EQ(send_body(5, frames_per_body), 3);
+
+  // the data beyond the advertised window resets the stream
+  receive(make_frame(0, 0, 5, std::string(16384, 'x')));
+  const auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 2);
+  // the frame is counted by the connection window anyway
+  ASSERT_EQ(frames[0].type, 8);
+  ASSERT_EQ(frames[0].stream_id, 0);
+  ASSERT_EQ(frames[1].type, 3);
+  ASSERT_EQ(frames[1].stream_id, 5);
+  ASSERT_EQ(frames[1].payload, make_int(3));
+  ASSERT_EQ(c.status, conn_expect_query);
+}
+
+TEST_F(http2_server, test_stream_errors) {
+  receive(HTTP2_PREFACE + make_frame(4, 0, 0, ""));
+  sent_frames();
+
+  // the malformed request is reset
+  receive(make_frame(1, 0x5, 1, make_headers_block({{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {"User-Agent", "test"}})));
+  auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_EQ(frames[0].type, 3);
+  ASSERT_EQ(frames[0].stream_id, 1);
+  ASSERT_EQ(frames[0].payload, make_int(1));
+
+  // the header value can't inject the header of HTTP/1.1 head
+  receive(make_frame(1, 0x5, 3, make_headers_block({{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {"x-header", "a\r\nhost: b"}})));
+  frames = sent_frames();
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_EQ(frames[0].type, 3);
+
+  // the unsupported method is answered by the server
+  receive(make_frame(1, 0x5, 5, make_headers_block({{":method", "PUT"}, {":scheme", "http"}, {":path", "/"}})));
+  frames = sent_frames();
+  ASSERT_EQ(frames.size(), 2);
+  ASSERT_EQ(frames[0].type, 1);
+  ASSERT_EQ(decode(frames[0].payload)[0], (std::pair<std::string, std::string>{":status", "501"}));
+
+  ASSERT_TRUE(executed.empty());
+  ASSERT_EQ(c.status, conn_expect_query);
+}
+
+TEST_F(http2_server, test_connection_frames) {
+  receive(HTTP2_PREFACE + make_frame(4, 0, 0, "") + make_frame(6, 0, 0, "12345678"));
+  auto frames = sent_frames();
+  ASSERT_EQ(frames.size(), 3);
+  ASSERT_EQ(frames[2].type, 6);
+  ASSERT_EQ(frames[2].flags, 0x1);
+  ASSERT_EQ(frames[2].payload, "12345678");
+
+  // DATA frame must belong to the stream
+  receive(make_frame(0, 0, 0, "data"));
+  frames = sent_frames();
+  ASSERT_EQ(frames.size(), 1);
+  ASSERT_EQ(frames[0].type, 7);
+  ASSERT_EQ(frames[0].payload, make_int(0) + make_int(1));
+  ASSERT_EQ(c.status, conn_write_close);
+}
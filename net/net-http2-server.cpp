@@ -0,0 +1,1087 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-http2-server.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/kprintf.h"
+#include "common/options.h"
+#include "common/stats/provider.h"
+
+#include "net/net-buffers.h"
+#include "net/net-hpack.h"
+#include "net/net-http-parser.h"
+#include "net/net-http-server.h"
+
+#define HTTP2_FRAME_HEADER_SIZE 9
+#define HTTP2_DEFAULT_FRAME_SIZE 16384
+#define HTTP2_MAX_FRAME_SIZE ((1 << 24) - 1)
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535
+#define HTTP2_MAX_WINDOW_SIZE 0x7fffffff
+/* the header block is split into the frames, its size is limited separately from the size of the decoded headers */
+#define HTTP2_MAX_HEADER_BLOCK_SIZE (2 * MAX_HTTP_HEADER_SIZE)
+/* the stream windows aren't enlarged, while the connection buffers more request bodies, except the oldest receiving stream */
+#define HTTP2_MAX_BUFFERED_BODY_SIZE (2 * HTTP2_MAX_BODY_SIZE)
+
+enum http2_frame_type {
+  h2f_data = 0x0,
+  h2f_headers = 0x1,
+  h2f_priority = 0x2,
+  h2f_rst_stream = 0x3,
+  h2f_settings = 0x4,
+  h2f_push_promise = 0x5,
+  h2f_ping = 0x6,
+  h2f_goaway = 0x7,
+  h2f_window_update = 0x8,
+  h2f_continuation = 0x9
+};
+
+#define H2F_END_STREAM 0x1
+#define H2F_ACK 0x1
+#define H2F_END_HEADERS 0x4
+#define H2F_PADDED 0x8
+#define H2F_PRIORITY 0x20
+
+enum http2_error_code {
+  h2e_no_error = 0x0,
+  h2e_protocol_error = 0x1,
+  h2e_internal_error = 0x2,
+  h2e_flow_control_error = 0x3,
+  h2e_stream_closed = 0x5,
+  h2e_frame_size_error = 0x6,
+  h2e_refused_stream = 0x7,
+  h2e_compression_error = 0x9
+};
+
+enum http2_settings_id {
+  h2set_header_table_size = 0x1,
+  h2set_enable_push = 0x2,
+  h2set_max_concurrent_streams = 0x3,
+  h2set_initial_window_size = 0x4,
+  h2set_max_frame_size = 0x5,
+  h2set_max_header_list_size = 0x6
+};
+
+enum http2_stream_state {
+  h2ss_body,       /* the request body is being received */
+  h2ss_ready,      /* the request is complete and waits for the execution */
+  h2ss_executing,
+  h2ss_sending     /* the rest of the response body waits for the flow control window */
+};
+
+static int http2_max_concurrent_streams = 100;
+
+static struct {
+  long long connections;
+  long long streams;
+  long long refused_streams;
+  long long reset_streams;
+  long long connection_errors;
+  long long flow_control_waits;
+} http2_stats;
+
+STATS_PROVIDER(http2, 1000) {
+  add_histogram_stat_long(stats, "http2_connections", http2_stats.connections);
+  add_histogram_stat_long(stats, "http2_streams", http2_stats.streams);
+  add_histogram_stat_long(stats, "http2_refused_streams", http2_stats.refused_streams);
+  add_histogram_stat_long(stats, "http2_reset_streams", http2_stats.reset_streams);
+  add_histogram_stat_long(stats, "http2_connection_errors", http2_stats.connection_errors);
+  add_histogram_stat_long(stats, "http2_flow_control_waits", http2_stats.flow_control_waits);
+}
+
+OPTION_PARSER(OPT_NETWORK, "http2-max-concurrent-streams", required_argument,
+              "the maximal number of the streams on HTTP/2 connection, which are received but not answered yet (default %d)", http2_max_concurrent_streams) {
+  http2_max_concurrent_streams = atoi(optarg);
+  if (http2_max_concurrent_streams <= 0) {
+    kprintf("--http2-max-concurrent-streams option, the value must be positive\n");
+    return -1;
+  }
+  return 0;
+}
+
+struct http2_buffer {
+  char *data;
+  int len;
+  int size;
+};
+
+struct http2_stream {
+  int id;
+  int state;
+  int send_window;
+  int recv_unacked;    /* the received body bytes, which aren't returned to the peer by WINDOW_UPDATE yet */
+  int error;           /* the HTTP status of the request, which isn't executed */
+  bool is_head;
+  bool reset;          /* the executing stream is reset, its response is dropped */
+  /* the request in parts, it's converted to HTTP/1.1 head before the execution */
+  struct http2_buffer method;
+  struct http2_buffer path;
+  struct http2_buffer authority;
+  struct http2_buffer headers;
+  struct http2_buffer cookie;
+  struct http2_buffer body;
+  /* the rest of the response body */
+  struct http2_buffer out;
+  int out_offset;
+  struct http2_stream *next;
+};
+
+struct http2_connection {
+  struct hpack_table decoder;
+  struct http2_stream *streams;    /* sorted by id, so the complete requests are executed in the order of their arrival */
+  int streams_num;
+  struct http2_stream *executing;
+  int last_stream_id;
+  int send_window;
+  int recv_unacked;
+  int buffered_body_size;    /* the bodies of the streams, which aren't executed yet */
+  int peer_initial_window;
+  int peer_max_frame_size;
+  bool preface_received;
+  bool goaway_received;
+  /* the header block, which is continued by CONTINUATION frames */
+  int block_stream_id;
+  int block_flags;
+  struct http2_buffer block;
+};
+
+#define HTTP2_DATA(c) (HTS_DATA(c)->http2)
+
+static void http2_buffer_append(struct http2_buffer *b, const char *data, int len) {
+  if (b->len + len > b->size) {
+    b->size = b->len + len > 2 * b->size ? b->len + len : 2 * b->size;
+    if (b->size < 64) {
+      b->size = 64;
+    }
+    b->data = static_cast<char *>(realloc(b->data, b->size));
+    assert (b->data);
+  }
+  if (len > 0) {
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+  }
+}
+
+static void http2_buffer_free(struct http2_buffer *b) {
+  free(b->data);
+  memset(b, 0, sizeof(*b));
+}
+
+static inline bool http2_buffer_equals(const struct http2_buffer *b, const char *str) {
+  const int len = strlen(str);
+  return b->len == len && !memcmp(b->data, str, len);
+}
+
+static inline void put_int(unsigned char *p, unsigned int value) {
+  p[0] = (unsigned char)(value >> 24);
+  p[1] = (unsigned char)(value >> 16);
+  p[2] = (unsigned char)(value >> 8);
+  p[3] = (unsigned char)value;
+}
+
+static inline unsigned int get_int(const unsigned char *p) {
+  return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+/*
+ *
+ *		FRAMES
+ *
+ */
+
+static void http2_write_frame(struct connection *c, int type, int flags, int stream_id, const void *payload, int len) {
+  unsigned char header[HTTP2_FRAME_HEADER_SIZE];
+  header[0] = (unsigned char)(len >> 16);
+  header[1] = (unsigned char)(len >> 8);
+  header[2] = (unsigned char)len;
+  header[3] = (unsigned char)type;
+  header[4] = (unsigned char)flags;
+  put_int(header + 5, stream_id);
+  assert (write_out(&c->Out, header, HTTP2_FRAME_HEADER_SIZE) == HTTP2_FRAME_HEADER_SIZE);
+  if (len > 0) {
+    assert (write_out(&c->Out, payload, len) == len);
+  }
+}
+
+static void http2_write_int_frame(struct connection *c, int type, int stream_id, unsigned int value) {
+  unsigned char payload[4];
+  put_int(payload, value);
+  http2_write_frame(c, type, 0, stream_id, payload, 4);
+}
+
+static void http2_write_settings(struct connection *c) {
+  unsigned char payload[12];
+  payload[0] = 0;
+  payload[1] = h2set_max_concurrent_streams;
+  put_int(payload + 2, http2_max_concurrent_streams);
+  payload[6] = 0;
+  payload[7] = h2set_max_header_list_size;
+  put_int(payload + 8, MAX_HTTP_HEADER_SIZE);
+  http2_write_frame(c, h2f_settings, 0, 0, payload, sizeof(payload));
+}
+
+static void http2_goaway(struct connection *c, struct http2_connection *H, int error) {
+  vkprintf(1, "http2: connection #%d error %d, last stream %d\n", c->fd, error, H->last_stream_id);
+  unsigned char payload[8];
+  put_int(payload, H->last_stream_id);
+  put_int(payload + 4, error);
+  http2_write_frame(c, h2f_goaway, 0, 0, payload, sizeof(payload));
+  http2_stats.connection_errors++;
+  c->status = conn_write_close;
+  c->parse_state = -1;
+}
+
+/*
+ *
+ *		STREAMS
+ *
+ */
+
+static struct http2_stream *http2_stream_create(struct http2_connection *H, int stream_id) {
+  auto *S = static_cast<struct http2_stream *>(calloc(1, sizeof(struct http2_stream)));
+  assert (S);
+  S->id = stream_id;
+  S->state = h2ss_body;
+  S->send_window = H->peer_initial_window;
+
+  struct http2_stream **last = &H->streams;
+  while (*last) {
+    last = &(*last)->next;
+  }
+  *last = S;
+  H->streams_num++;
+  http2_stats.streams++;
+  return S;
+}
+
+static void http2_stream_free_request(struct http2_connection *H, struct http2_stream *S) {
+  H->buffered_body_size -= S->body.len;
+  http2_buffer_free(&S->method);
+  http2_buffer_free(&S->path);
+  http2_buffer_free(&S->authority);
+  http2_buffer_free(&S->headers);
+  http2_buffer_free(&S->cookie);
+  http2_buffer_free(&S->body);
+}
+
+static void http2_stream_free(struct http2_connection *H, struct http2_stream *S) {
+  struct http2_stream **prev = &H->streams;
+  while (*prev != S) {
+    prev = &(*prev)->next;
+  }
+  *prev = S->next;
+  H->streams_num--;
+
+  http2_stream_free_request(H, S);
+  http2_buffer_free(&S->out);
+  free(S);
+}
+
+static struct http2_stream *http2_stream_find(struct http2_connection *H, int stream_id) {
+  struct http2_stream *S = H->streams;
+  while (S && S->id != stream_id) {
+    S = S->next;
+  }
+  return S;
+}
+
+static void http2_reset_stream(struct connection *c, struct http2_connection *H, struct http2_stream *S, int error) {
+  http2_write_int_frame(c, h2f_rst_stream, S->id, error);
+  http2_stats.reset_streams++;
+  if (S == H->executing) {
+    S->reset = true;
+  } else {
+    http2_stream_free(H, S);
+  }
+}
+
+/* writes as much as the flow control allows, the last frame ends the stream */
+static int http2_write_data(struct connection *c, struct http2_connection *H, struct http2_stream *S, const char *data, int len) {
+  int sent = 0;
+  while (sent < len) {
+    int n = len - sent;
+    n = n < H->send_window ? n : H->send_window;
+    n = n < S->send_window ? n : S->send_window;
+    n = n < H->peer_max_frame_size ? n : H->peer_max_frame_size;
+    if (n <= 0) {
+      break;
+    }
+    http2_write_frame(c, h2f_data, sent + n == len ? H2F_END_STREAM : 0, S->id, data + sent, n);
+    sent += n;
+    H->send_window -= n;
+    S->send_window -= n;
+  }
+  return sent;
+}
+
+static void http2_flush_streams(struct connection *c, struct http2_connection *H) {
+  struct http2_stream *S = H->streams;
+  while (S && H->send_window > 0) {
+    struct http2_stream *next = S->next;
+    if (S->state == h2ss_sending) {
+      S->out_offset += http2_write_data(c, H, S, S->out.data + S->out_offset, S->out.len - S->out_offset);
+      if (S->out_offset == S->out.len) {
+        http2_stream_free(H, S);
+      }
+    }
+    S = next;
+  }
+}
+
+static void http2_respond(struct connection *c, struct http2_connection *H, struct http2_stream *S, const char *block, int block_len,
+                          const char *body, int body_len) {
+  if (S->is_head) {
+    body_len = 0;
+  }
+
+  int offset = 0;
+  int type = h2f_headers;
+  do {
+    int n = block_len - offset < H->peer_max_frame_size ? block_len - offset : H->peer_max_frame_size;
+    int flags = (type == h2f_headers && body_len == 0 ? H2F_END_STREAM : 0) | (offset + n == block_len ? H2F_END_HEADERS : 0);
+    http2_write_frame(c, type, flags, S->id, block + offset, n);
+    offset += n;
+    type = h2f_continuation;
+  } while (offset < block_len);
+
+  const int sent = body_len ? http2_write_data(c, H, S, body, body_len) : 0;
+  if (sent == body_len) {
+    http2_stream_free(H, S);
+  } else {
+    http2_buffer_append(&S->out, body + sent, body_len - sent);
+    S->out_offset = 0;
+    S->state = h2ss_sending;
+    http2_stats.flow_control_waits++;
+  }
+}
+
+static void http2_respond_error(struct connection *c, struct http2_connection *H, struct http2_stream *S, int code) {
+  static char body[1024];
+  char block[64];
+  char content_length[16];
+
+  const int body_len = format_http_error_page(code, body);
+  int block_len = hpack_encode_status(block, 0, sizeof(block), code);
+  block_len = hpack_encode_header(block, block_len, sizeof(block), "content-type", 12, "text/html", 9);
+  block_len = hpack_encode_header(block, block_len, sizeof(block), "content-length", 14, content_length, sprintf(content_length, "%d", body_len));
+  assert (block_len > 0);
+  http2_respond(c, H, S, block, block_len, body, body_len);
+}
+
+static bool http2_is_connection_header(const char *name, int name_len) {
+  static const char *names[] = {"connection", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade", "http2-settings"};
+  for (const char *connection_name : names) {
+    if (name_len == (int)strlen(connection_name) && !memcmp(name, connection_name, name_len)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int http2_write_response(struct connection *c, const char *head, int head_len, const char *body, int body_len) {
+  static char name[MAX_HTTP_HEADER_KEY_SIZE];
+  struct http2_connection *H = HTTP2_DATA(c);
+  struct http2_stream *S = H->executing;
+  if (!S) {
+    return -1;
+  }
+  H->executing = NULL;
+  if (S->reset) {
+    http2_stream_free(H, S);
+    return 0;
+  }
+
+  /* HTTP/1.x NNN Reason */
+  const char *end = head + head_len;
+  const char *line_end = static_cast<const char *>(memchr(head, '\n', head_len));
+  const char *status = static_cast<const char *>(memchr(head, ' ', line_end ? line_end - head : 0));
+  if (!status || line_end - status < 4 || status[1] < '1' || status[1] > '5' || status[2] < '0' || status[2] > '9' || status[3] < '0' || status[3] > '9') {
+    http2_respond_error(c, H, S, 500);
+    return -1;
+  }
+
+  const int block_size = 2 * head_len + 16;
+  char *block = static_cast<char *>(malloc(block_size));
+  assert (block);
+  int block_len = hpack_encode_status(block, 0, block_size, (status[1] - '0') * 100 + (status[2] - '0') * 10 + (status[3] - '0'));
+
+  for (const char *p = line_end + 1; p < end && block_len >= 0; p = line_end + 1) {
+    line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!line_end) {
+      line_end = end;
+    }
+    const char *value_end = line_end > p && line_end[-1] == '\r' ? line_end - 1 : line_end;
+    if (value_end == p) {
+      break;
+    }
+    const char *colon = static_cast<const char *>(memchr(p, ':', value_end - p));
+    if (!colon || colon == p || colon - p > MAX_HTTP_HEADER_KEY_SIZE) {
+      continue;
+    }
+    const int name_len = colon - p;
+    for (int i = 0; i < name_len; i++) {
+      name[i] = p[i] >= 'A' && p[i] <= 'Z' ? p[i] + 'a' - 'A' : p[i];
+    }
+    if (http2_is_connection_header(name, name_len)) {
+      continue;
+    }
+    const char *value = colon + 1;
+    while (value < value_end && (*value == ' ' || *value == '\t')) {
+      value++;
+    }
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+      value_end--;
+    }
+    block_len = hpack_encode_header(block, block_len, block_size, name, name_len, value, value_end - value);
+  }
+
+  if (block_len < 0) {
+    http2_respond_error(c, H, S, 500);
+  } else {
+    http2_respond(c, H, S, block, block_len, body, body_len);
+  }
+  free(block);
+  return 0;
+}
+
+/*
+ *
+ *		REQUESTS
+ *
+ */
+
+struct http2_request {
+  struct http2_stream *stream;  /* NULL, if the headers are decoded only to keep the decoder state */
+  int pseudo_headers;
+  bool regular_seen;
+  bool malformed;
+};
+
+#define H2_PSEUDO_METHOD 1
+#define H2_PSEUDO_PATH 2
+#define H2_PSEUDO_SCHEME 4
+#define H2_PSEUDO_AUTHORITY 8
+
+static int http2_on_request_header(void *extra, const char *name, int name_len, const char *value, int value_len) {
+  auto *request = static_cast<struct http2_request *>(extra);
+  struct http2_stream *S = request->stream;
+  if (!S || request->malformed) {
+    return 0;
+  }
+
+  /* the values are copied to HTTP/1.1 head, so they can't contain the line ends */
+  for (int i = 0; i < value_len; i++) {
+    if (value[i] == '\r' || value[i] == '\n' || value[i] == 0) {
+      request->malformed = true;
+      return 0;
+    }
+  }
+  if (name_len == 0) {
+    request->malformed = true;
+    return 0;
+  }
+
+  if (name[0] == ':') {
+    struct http2_buffer *pseudo = NULL;
+    int bit = 0;
+    if (name_len == 7 && !memcmp(name, ":method", 7)) {
+      pseudo = &S->method;
+      bit = H2_PSEUDO_METHOD;
+    } else if (name_len == 5 && !memcmp(name, ":path", 5)) {
+      pseudo = &S->path;
+      bit = H2_PSEUDO_PATH;
+    } else if (name_len == 7 && !memcmp(name, ":scheme", 7)) {
+      bit = H2_PSEUDO_SCHEME;
+    } else if (name_len == 10 && !memcmp(name, ":authority", 10)) {
+      pseudo = &S->authority;
+      bit = H2_PSEUDO_AUTHORITY;
+    }
+    if (!bit || (request->pseudo_headers & bit) || request->regular_seen) {
+      request->malformed = true;
+      return 0;
+    }
+    request->pseudo_headers |= bit;
+    if (pseudo) {
+      http2_buffer_append(pseudo, value, value_len);
+    }
+    return 0;
+  }
+
+  request->regular_seen = true;
+  for (int i = 0; i < name_len; i++) {
+    if ((unsigned char)name[i] <= ' ' || (unsigned char)name[i] >= 0x7f || name[i] == ':' || (name[i] >= 'A' && name[i] <= 'Z')) {
+      request->malformed = true;
+      return 0;
+    }
+  }
+  if (http2_is_connection_header(name, name_len) || (name_len == 2 && !memcmp(name, "te", 2) && !(value_len == 8 && !memcmp(value, "trailers", 8)))) {
+    request->malformed = true;
+    return 0;
+  }
+  if (S->error) {
+    return 0;
+  }
+  /* the actual body size is passed */
+  if (name_len == 14 && !memcmp(name, "content-length", 14)) {
+    return 0;
+  }
+  if (S->headers.len + S->cookie.len + name_len + value_len + 4 >= MAX_HTTP_HEADER_SIZE) {
+    S->error = 431;
+    return 0;
+  }
+  /* the cookie can be split into the separate fields, see RFC 7540 8.1.2.5 */
+  if (name_len == 6 && !memcmp(name, "cookie", 6)) {
+    if (S->cookie.len) {
+      http2_buffer_append(&S->cookie, "; ", 2);
+    }
+    http2_buffer_append(&S->cookie, value, value_len);
+    return 0;
+  }
+  http2_buffer_append(&S->headers, name, name_len);
+  http2_buffer_append(&S->headers, ": ", 2);
+  http2_buffer_append(&S->headers, value, value_len);
+  http2_buffer_append(&S->headers, "\r\n", 2);
+  return 0;
+}
+
+static int http2_process_header_block(struct connection *c, struct http2_connection *H) {
+  const int stream_id = H->block_stream_id;
+  const bool end_stream = H->block_flags & H2F_END_STREAM;
+  H->block_stream_id = 0;
+
+  struct http2_request request = {};
+  struct http2_stream *S = NULL;
+  int error = 0;
+  if (stream_id > H->last_stream_id) {
+    H->last_stream_id = stream_id;
+    if (H->goaway_received || H->streams_num >= http2_max_concurrent_streams) {
+      error = h2e_refused_stream;
+      http2_stats.refused_streams++;
+    } else {
+      S = request.stream = http2_stream_create(H, stream_id);
+    }
+  } else {
+    /* the trailers are ignored */
+    S = http2_stream_find(H, stream_id);
+    if (!S || S->state != h2ss_body) {
+      error = h2e_stream_closed;
+    } else if (!end_stream) {
+      error = h2e_protocol_error;
+    }
+  }
+
+  const int decoded = hpack_decode(&H->decoder, reinterpret_cast<unsigned char *>(H->block.data), H->block.len, http2_on_request_header, &request);
+  H->block.len = 0;
+  if (decoded < 0) {
+    return h2e_compression_error;
+  }
+
+  if (request.stream && (request.pseudo_headers & (H2_PSEUDO_METHOD | H2_PSEUDO_PATH | H2_PSEUDO_SCHEME)) != (H2_PSEUDO_METHOD | H2_PSEUDO_PATH | H2_PSEUDO_SCHEME)) {
+    request.malformed = true;
+  }
+  if (request.malformed) {
+    error = h2e_protocol_error;
+  }
+  if (error) {
+    if (S) {
+      http2_reset_stream(c, H, S, error);
+    } else {
+      http2_write_int_frame(c, h2f_rst_stream, stream_id, error);
+    }
+    return 0;
+  }
+
+  S->is_head = http2_buffer_equals(&S->method, "HEAD");
+  if (end_stream) {
+    S->state = h2ss_ready;
+  }
+  return 0;
+}
+
+/* returns the received body bytes to the peer, while the buffered bodies fit into the budget;
+ * the oldest receiving stream is never held, so the connection doesn't stall on the incomplete requests */
+static void http2_update_recv_windows(struct connection *c, struct http2_connection *H) {
+  bool oldest = true;
+  for (struct http2_stream *S = H->streams; S; S = S->next) {
+    if (S->state != h2ss_body) {
+      continue;
+    }
+    if (S->recv_unacked >= HTTP2_DEFAULT_WINDOW_SIZE / 2 && (oldest || H->buffered_body_size < HTTP2_MAX_BUFFERED_BODY_SIZE)) {
+      http2_write_int_frame(c, h2f_window_update, S->id, S->recv_unacked);
+      S->recv_unacked = 0;
+    }
+    oldest = false;
+  }
+}
+
+static int http2_process_data(struct connection *c, struct http2_connection *H, int flags, int stream_id, const char *data, int len) {
+  const int frame_len = len;
+  if (flags & H2F_PADDED) {
+    if (len < 1 || (unsigned char)data[0] >= len) {
+      return h2e_protocol_error;
+    }
+    len -= 1 + (unsigned char)data[0];
+    data++;
+  }
+
+  /* the padding is counted by the flow control too;
+   * the connection window is always returned, the buffered bytes are limited by the stream windows */
+  if (H->recv_unacked + frame_len > HTTP2_DEFAULT_WINDOW_SIZE) {
+    return h2e_flow_control_error;
+  }
+  H->recv_unacked += frame_len;
+  if (H->recv_unacked >= HTTP2_DEFAULT_WINDOW_SIZE / 2) {
+    http2_write_int_frame(c, h2f_window_update, 0, H->recv_unacked);
+    H->recv_unacked = 0;
+  }
+
+  struct http2_stream *S = http2_stream_find(H, stream_id);
+  if (S && S->state == h2ss_sending && S->error == 413) {
+    /* the rest of the rejected body, the response waits for the flow control window */
+    return 0;
+  }
+  if (!S || S->state != h2ss_body) {
+    if (stream_id > H->last_stream_id) {
+      return h2e_protocol_error;
+    }
+    if (S) {
+      http2_reset_stream(c, H, S, h2e_stream_closed);
+    } else {
+      http2_write_int_frame(c, h2f_rst_stream, stream_id, h2e_stream_closed);
+    }
+    return 0;
+  }
+  /* the receive window of the stream isn't enlarged by SETTINGS, so it's the default one without the unacknowledged bytes */
+  if (S->recv_unacked + frame_len > HTTP2_DEFAULT_WINDOW_SIZE) {
+    http2_reset_stream(c, H, S, h2e_flow_control_error);
+    return 0;
+  }
+
+  if (!S->error && S->body.len + len >= HTTP2_MAX_BODY_SIZE) {
+    /* the request is rejected before its end, and the complete response asks the client to stop sending (RFC 7540, 8.1) */
+    vkprintf(2, "http2: connection #%d rejects stream %d with too long body\n", c->fd, S->id);
+    S->error = 413;
+    http2_stream_free_request(H, S);
+    http2_respond_error(c, H, S, 413);
+    if (!(flags & H2F_END_STREAM) && !http2_stream_find(H, stream_id)) {
+      http2_write_int_frame(c, h2f_rst_stream, stream_id, h2e_no_error);
+    }
+    return 0;
+  }
+  if (!S->error) {
+    http2_buffer_append(&S->body, data, len);
+    H->buffered_body_size += len;
+  }
+
+  if (flags & H2F_END_STREAM) {
+    S->state = h2ss_ready;
+  } else {
+    S->recv_unacked += frame_len;
+    http2_update_recv_windows(c, H);
+  }
+  return 0;
+}
+
+static int http2_process_settings(struct connection *c, struct http2_connection *H, const unsigned char *payload, int len) {
+  for (int i = 0; i < len; i += 6) {
+    const int id = (payload[i] << 8) | payload[i + 1];
+    const unsigned int value = get_int(payload + i + 2);
+    switch (id) {
+      case h2set_enable_push:
+        if (value > 1) {
+          return h2e_protocol_error;
+        }
+        break;
+      case h2set_initial_window_size: {
+        if (value > HTTP2_MAX_WINDOW_SIZE) {
+          return h2e_flow_control_error;
+        }
+        const long long delta = (long long)value - H->peer_initial_window;
+        for (struct http2_stream *S = H->streams; S; S = S->next) {
+          if (S->send_window + delta > HTTP2_MAX_WINDOW_SIZE) {
+            return h2e_flow_control_error;
+          }
+          S->send_window += delta;
+        }
+        H->peer_initial_window = value;
+        break;
+      }
+      case h2set_max_frame_size:
+        if (value < HTTP2_DEFAULT_FRAME_SIZE || value > HTTP2_MAX_FRAME_SIZE) {
+          return h2e_protocol_error;
+        }
+        H->peer_max_frame_size = value;
+        break;
+      default:
+        /* the encoder doesn't use the dynamic table, and the rest are advisory or unknown */
+        break;
+    }
+  }
+  http2_write_frame(c, h2f_settings, H2F_ACK, 0, NULL, 0);
+  http2_flush_streams(c, H);
+  return 0;
+}
+
+static int http2_process_window_update(struct connection *c, struct http2_connection *H, int stream_id, unsigned int increment) {
+  increment &= HTTP2_MAX_WINDOW_SIZE;
+  if (!stream_id) {
+    if (!increment) {
+      return h2e_protocol_error;
+    }
+    if ((long long)H->send_window + increment > HTTP2_MAX_WINDOW_SIZE) {
+      return h2e_flow_control_error;
+    }
+    H->send_window += increment;
+  } else {
+    struct http2_stream *S = http2_stream_find(H, stream_id);
+    if (!S) {
+      return stream_id > H->last_stream_id ? h2e_protocol_error : 0;
+    }
+    if (!increment) {
+      http2_reset_stream(c, H, S, h2e_protocol_error);
+      return 0;
+    }
+    if ((long long)S->send_window + increment > HTTP2_MAX_WINDOW_SIZE) {
+      http2_reset_stream(c, H, S, h2e_flow_control_error);
+      return 0;
+    }
+    S->send_window += increment;
+  }
+  http2_flush_streams(c, H);
+  return 0;
+}
+
+/* returns the connection error code or 0, the stream errors are handled here */
+static int http2_process_frame(struct connection *c, struct http2_connection *H, int type, int flags, int stream_id, const unsigned char *payload, int len) {
+  vkprintf(3, "http2: connection #%d frame type %d, flags 0x%x, stream %d, length %d\n", c->fd, type, flags, stream_id, len);
+
+  if (H->block_stream_id && (type != h2f_continuation || stream_id != H->block_stream_id)) {
+    return h2e_protocol_error;
+  }
+  const bool connection_frame = type == h2f_settings || type == h2f_ping || type == h2f_goaway;
+  if (type <= h2f_continuation && type != h2f_window_update && connection_frame != !stream_id) {
+    return h2e_protocol_error;
+  }
+
+  switch (type) {
+    case h2f_data:
+      return http2_process_data(c, H, flags, stream_id, reinterpret_cast<const char *>(payload), len);
+
+    case h2f_headers:
+      if (!(stream_id & 1)) {
+        return h2e_protocol_error;
+      }
+      if (flags & H2F_PADDED) {
+        if (len < 1 || payload[0] >= len) {
+          return h2e_protocol_error;
+        }
+        len -= 1 + payload[0];
+        payload++;
+      }
+      if (flags & H2F_PRIORITY) {
+        if (len < 5) {
+          return h2e_frame_size_error;
+        }
+        len -= 5;
+        payload += 5;
+      }
+      H->block_stream_id = stream_id;
+      H->block_flags = flags;
+      /* fallthrough */
+    case h2f_continuation:
+      if (!H->block_stream_id) {
+        return h2e_protocol_error;
+      }
+      if (H->block.len + len > HTTP2_MAX_HEADER_BLOCK_SIZE) {
+        return h2e_protocol_error;
+      }
+      http2_buffer_append(&H->block, reinterpret_cast<const char *>(payload), len);
+      if (flags & H2F_END_HEADERS) {
+        return http2_process_header_block(c, H);
+      }
+      return 0;
+
+    case h2f_priority:
+      if (len != 5) {
+        struct http2_stream *S = http2_stream_find(H, stream_id);
+        if (S) {
+          http2_reset_stream(c, H, S, h2e_frame_size_error);
+        } else {
+          http2_write_int_frame(c, h2f_rst_stream, stream_id, h2e_frame_size_error);
+        }
+      }
+      return 0;
+
+    case h2f_rst_stream: {
+      if (len != 4) {
+        return h2e_frame_size_error;
+      }
+      if (stream_id > H->last_stream_id) {
+        return h2e_protocol_error;
+      }
+      struct http2_stream *S = http2_stream_find(H, stream_id);
+      if (S) {
+        vkprintf(2, "http2: connection #%d stream %d is reset by the client, error %u\n", c->fd, stream_id, get_int(payload));
+        if (S == H->executing) {
+          S->reset = true;
+        } else {
+          http2_stream_free(H, S);
+        }
+      }
+      return 0;
+    }
+
+    case h2f_settings:
+      if (flags & H2F_ACK) {
+        return len ? h2e_frame_size_error : 0;
+      }
+      if (len % 6) {
+        return h2e_frame_size_error;
+      }
+      return http2_process_settings(c, H, payload, len);
+
+    case h2f_push_promise:
+      return h2e_protocol_error;
+
+    case h2f_ping:
+      if (len != 8) {
+        return h2e_frame_size_error;
+      }
+      if (!(flags & H2F_ACK)) {
+        http2_write_frame(c, h2f_ping, H2F_ACK, 0, payload, len);
+      }
+      return 0;
+
+    case h2f_goaway:
+      if (len < 8) {
+        return h2e_frame_size_error;
+      }
+      H->goaway_received = true;
+      return 0;
+
+    case h2f_window_update:
+      if (len != 4) {
+        return h2e_frame_size_error;
+      }
+      return http2_process_window_update(c, H, stream_id, get_int(payload));
+
+    default:
+      /* the unknown frames are ignored */
+      return 0;
+  }
+}
+
+/*
+ *
+ *		EXECUTION
+ *
+ */
+
+static bool http2_is_known_method(const struct http2_buffer *method) {
+  return http2_buffer_equals(method, "GET") || http2_buffer_equals(method, "HEAD") || http2_buffer_equals(method, "POST") || http2_buffer_equals(method, "OPTIONS");
+}
+
+/* the request is executed by the same code as HTTP/1.1 one */
+static int http2_build_request_head(struct http2_stream *S, char *head, struct http_request_head *parsed) {
+  if (S->method.len + S->path.len + S->authority.len + S->headers.len + S->cookie.len + 64 >= MAX_HTTP_HEADER_SIZE) {
+    return 431;
+  }
+  char *p = head;
+  p += sprintf(p, "%.*s %.*s HTTP/1.1\r\n", S->method.len, S->method.data, S->path.len, S->path.data);
+  if (S->authority.len) {
+    p += sprintf(p, "Host: %.*s\r\n", S->authority.len, S->authority.data);
+  }
+  if (S->headers.len) {
+    memcpy(p, S->headers.data, S->headers.len);
+    p += S->headers.len;
+  }
+  if (S->cookie.len) {
+    p += sprintf(p, "Cookie: %.*s\r\n", S->cookie.len, S->cookie.data);
+  }
+  if (S->body.len || http2_buffer_equals(&S->method, "POST")) {
+    p += sprintf(p, "Content-Length: %d\r\n", S->body.len);
+  }
+  p += sprintf(p, "\r\n");
+
+  if (!http2_is_known_method(&S->method)) {
+    return 501;
+  }
+  if (!http_parse_request_head(head, p - head, parsed, NULL, 0)) {
+    return 400;
+  }
+  return 0;
+}
+
+static void http2_execute_stream(struct connection *c, struct http2_connection *H, struct http2_stream *S) {
+  static char head[MAX_HTTP_HEADER_SIZE];
+  struct hts_data *D = HTS_DATA(c);
+  struct http_request_head parsed;
+
+  const int error = S->error ? S->error : http2_build_request_head(S, head, &parsed);
+  vkprintf(2, "http2: connection #%d executes stream %d, error %d\n", c->fd, S->id, error);
+
+  /* the stream may be freed during the execution, as soon as the response is written */
+  struct http2_buffer body = S->body;
+  memset(&S->body, 0, sizeof(S->body));
+  H->buffered_body_size -= body.len;
+  http2_stream_free_request(H, S);
+  http2_update_recv_windows(c, H);
+
+  if (error) {
+    http2_buffer_free(&body);
+    http2_respond_error(c, H, S, error);
+    return;
+  }
+
+  if (body.len) {
+    /* the body is passed as the string */
+    http2_buffer_append(&body, "", 1);
+    body.len--;
+  }
+  hts_set_request_head(D, &parsed);
+  D->query_flags |= QF_KEEPALIVE;
+  http_queries++;
+  http_queries_size += D->header_size + body.len;
+
+  S->state = h2ss_executing;
+  H->executing = S;
+  const int status = c->status;
+  c->status = conn_running;
+  const int res = HTS_FUNC(c)->execute_http2(c, D->query_type, head, body.data);
+  if (c->status == conn_running) {
+    c->status = status;
+  }
+  http2_buffer_free(&body);
+
+  if (res < 0 && H->executing == S) {
+    H->executing = NULL;
+    http2_respond_error(c, H, S, -res);
+  }
+}
+
+void http2_execute_streams(struct connection *c) {
+  struct http2_connection *H = HTTP2_DATA(c);
+
+  while (c->status == conn_expect_query || c->status == conn_reading_query) {
+    if (H->executing) {
+      /* the execution is finished without the response */
+      struct http2_stream *S = H->executing;
+      H->executing = NULL;
+      http2_reset_stream(c, H, S, h2e_internal_error);
+      continue;
+    }
+    struct http2_stream *S = H->streams;
+    while (S && S->state != h2ss_ready) {
+      S = S->next;
+    }
+    if (!S) {
+      break;
+    }
+    http2_execute_stream(c, H, S);
+  }
+
+  if (H->goaway_received && !H->streams && (c->status == conn_expect_query || c->status == conn_reading_query)) {
+    c->status = conn_write_close;
+    c->parse_state = -1;
+  }
+}
+
+/*
+ *
+ *		CONNECTION
+ *
+ */
+
+int http2_check_preface(struct connection *c) {
+  char preface[HTTP2_PREFACE_SIZE];
+  nb_iterator_t it;
+  nbit_set(&it, &c->In);
+  const int len = nbit_read_in(&it, preface, HTTP2_PREFACE_SIZE);
+  if (memcmp(preface, HTTP2_PREFACE, len)) {
+    return 0;
+  }
+  return len == HTTP2_PREFACE_SIZE ? 1 : -1;
+}
+
+void http2_init_connection(struct connection *c) {
+  vkprintf(1, "http2: connection #%d switches to HTTP/2\n", c->fd);
+  auto *H = static_cast<struct http2_connection *>(calloc(1, sizeof(struct http2_connection)));
+  assert (H);
+  hpack_table_init(&H->decoder, HPACK_DEFAULT_TABLE_SIZE);
+  H->send_window = HTTP2_DEFAULT_WINDOW_SIZE;
+  H->peer_initial_window = HTTP2_DEFAULT_WINDOW_SIZE;
+  H->peer_max_frame_size = HTTP2_DEFAULT_FRAME_SIZE;
+  HTTP2_DATA(c) = H;
+  http2_stats.connections++;
+}
+
+void http2_free_connection(struct connection *c) {
+  struct http2_connection *H = HTTP2_DATA(c);
+  H->executing = NULL;
+  while (H->streams) {
+    http2_stream_free(H, H->streams);
+  }
+  hpack_table_free(&H->decoder);
+  http2_buffer_free(&H->block);
+  free(H);
+  HTTP2_DATA(c) = NULL;
+}
+
+int http2_parse_execute(struct connection *c) {
+  static unsigned char frame[HTTP2_FRAME_HEADER_SIZE + HTTP2_DEFAULT_FRAME_SIZE];
+  struct http2_connection *H = HTTP2_DATA(c);
+  int need = 0;
+
+  while (c->status == conn_expect_query || c->status == conn_reading_query) {
+    const int ready = get_total_ready_bytes(&c->In);
+    if (!H->preface_received) {
+      if (ready < HTTP2_PREFACE_SIZE) {
+        need = HTTP2_PREFACE_SIZE - ready;
+        break;
+      }
+      assert (advance_skip_read_ptr(&c->In, HTTP2_PREFACE_SIZE) == HTTP2_PREFACE_SIZE);
+      H->preface_received = true;
+      http2_write_settings(c);
+      continue;
+    }
+
+    if (ready < HTTP2_FRAME_HEADER_SIZE) {
+      need = HTTP2_FRAME_HEADER_SIZE - ready;
+      break;
+    }
+    nb_iterator_t it;
+    nbit_set(&it, &c->In);
+    assert (nbit_read_in(&it, frame, HTTP2_FRAME_HEADER_SIZE) == HTTP2_FRAME_HEADER_SIZE);
+    /* SETTINGS_MAX_FRAME_SIZE isn't announced, so the default one is used by the client */
+    const int len = (frame[0] << 16) | (frame[1] << 8) | frame[2];
+    if (len > HTTP2_DEFAULT_FRAME_SIZE) {
+      http2_goaway(c, H, h2e_frame_size_error);
+      return 0;
+    }
+    if (ready < HTTP2_FRAME_HEADER_SIZE + len) {
+      need = HTTP2_FRAME_HEADER_SIZE + len - ready;
+      break;
+    }
+    assert (read_in(&c->In, frame, HTTP2_FRAME_HEADER_SIZE + len) == HTTP2_FRAME_HEADER_SIZE + len);
+
+    const int error = http2_process_frame(c, H, frame[3], frame[4], get_int(frame + 5) & HTTP2_MAX_WINDOW_SIZE, frame + HTTP2_FRAME_HEADER_SIZE, len);
+    if (error) {
+      http2_goaway(c, H, error);
+      return 0;
+    }
+    http2_execute_streams(c);
+  }
+
+  if (need > 0 && get_total_ready_bytes(&c->In) > 0 && (c->status == conn_expect_query || c->status == conn_reading_query)) {
+    /* parse_execute() is invoked again, when the rest of the frame is received */
+    c->status = conn_reading_query;
+    nbit_set(&c->Q, &c->In);
+    return need;
+  }
+  return 0;
+}
@@ -0,0 +1,35 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include "net/net-connections.h"
+
+/*
+ * HTTP/2 over the cleartext TCP (h2c) with the prior knowledge, RFC 7540.
+ * The HTTP server connection switches to HTTP/2, when it starts with the client connection preface.
+ * The streams are multiplexed on the connection: their frames are received at any time,
+ * but the complete requests are executed one by one in the order of their arrival by the worker owning the connection,
+ * so a slow request delays the next ones of the same connection, like HTTP/1.1 pipelining does.
+ * The request is converted to HTTP/1.1 head for http_server_functions.execute_http2,
+ * and the response is converted back from HTTP/1.x head, so the rest of the server isn't aware of HTTP/2.
+ */
+
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define HTTP2_PREFACE_SIZE 24
+/* the same as the limit of POST body of the server: the body must be shorter, the longer one is rejected with 413 as soon as it's received */
+#define HTTP2_MAX_BODY_SIZE (2 * 1024 * 1024)
+
+/* checks the beginning of the input: 1 - the preface, 0 - not HTTP/2, -1 - not enough bytes to decide */
+int http2_check_preface(struct connection *c);
+void http2_init_connection(struct connection *c);
+void http2_free_connection(struct connection *c);
+
+/* parse_execute() of the connection after the preface */
+int http2_parse_execute(struct connection *c);
+/* executes the complete requests, while the connection isn't waiting for the previous one */
+void http2_execute_streams(struct connection *c);
+
+/* writes the response of the executed stream, the head is in HTTP/1.x format */
+int http2_write_response(struct connection *c, const char *head, int head_len, const char *body, int body_len);
@@ -25,6 +25,7 @@
 #include "net/net-sockaddr-storage.h"
 #include "net/net-tcp-connections.h"
 #include "net/net-tcp-rpc-common.h"
+#include "net/net-tcp-rpc-compression.h"
 
 /*
  *
@@ -158,6 +159,7 @@ static int tcp_rpcc_send_handshake_packet (struct connection *c) {
     D->remote_pid.ip = (remote_ip == LOCALHOST ? 0 : remote_ip);
     D->remote_pid.port = inet_sockaddr_port(&c->remote_endpoint);
   }
+  P.flags |= tcp_rpcc_compression_offer_flags (c);
   memcpy (&P.sender_pid, &PID, sizeof (struct process_id));
   memcpy (&P.peer_pid, &D->remote_pid, sizeof (struct process_id));
   
@@ -219,6 +221,12 @@ static int tcp_rpcc_process_handshake_packet (struct connection *c, raw_message_
     D->crypto_flags |= RPC_CRYPTO_USE_CRC32C;
     D->custom_crc_partial = crc32c_partial;
   }
+  if (P.flags & RPC_CRYPTO_ZSTD) {
+    if (tcp_rpc_compression_enable (c, P.flags, true) < 0) {
+      tcp_rpcc_send_handshake_error_packet (c, -9);
+      return -9;
+    }
+  }
   return 0;
 }
 
@@ -325,6 +333,13 @@ int tcp_rpcc_parse_execute (struct connection *c) {
     } else {
       /* main case */
       c->status = conn_running;
+      if (D->packet_type == RPC_COMPRESSED_PACKET && tcp_rpc_decompress_packet (c, &msg, TCP_RPCC_FUNC(c)->max_packet_len) < 0) {
+        vkprintf (1, "error while parsing packet: can't decompress packet %d\n", D->packet_num);
+        c->status = conn_error;
+        c->error = -1;
+        rwm_free (&msg);
+        return 0;
+      }
       if (D->packet_type == TL_RPC_PING) {
         res = tcp_rpcc_default_execute (c, D->packet_type, &msg);
       } else {
@@ -410,6 +425,7 @@ int tcp_rpcc_close_connection (struct connection *c, int who) {
   if (TCP_RPCC_FUNC(c)->rpc_close != NULL) {
     TCP_RPCC_FUNC(c)->rpc_close (c, who);
   }
+  tcp_rpc_compression_free (c);
 
   return client_close_connection (c, who);
 }
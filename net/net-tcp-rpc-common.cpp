@@ -14,6 +14,7 @@
 
 #include "net/net-msg.h"
 #include "net/net-tcp-connections.h"
+#include "net/net-tcp-rpc-compression.h"
 
 int default_rpc_flags = RPC_CRYPTO_USE_CRC32C;
 
@@ -37,6 +38,11 @@ void tcp_rpc_conn_send (struct connection *c, raw_message_t *raw, int flags) {
   } else {
     r = *raw;
   }
+  if (Q[1] >= 0) {
+    /* the nonce and handshake packets are never compressed */
+    tcp_rpc_compress_packet (c, &r);
+    Q[0] = r.total_bytes + 12;
+  }
   rwm_push_data_front (&r, Q, 8);
   unsigned crc32 = rwm_custom_crc32 (&r, r.total_bytes, TCP_RPC_DATA(c)->custom_crc_partial);
   rwm_push_data (&r, &crc32, 4);
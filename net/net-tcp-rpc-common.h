@@ -40,6 +40,8 @@ struct tcp_rpc_handshake_error_packet {
 void tcp_rpc_conn_send (struct connection *c, struct raw_message *raw, int flags);
 void tcp_rpc_conn_send_data (struct connection *c, int len, void *Q);
 
+struct tcp_rpc_compression;
+
 /* in conn->custom_data */
 struct tcp_rpc_data {
   int packet_len;
@@ -63,9 +65,11 @@ struct tcp_rpc_data {
   int extra_int4;
   double extra_double, extra_double2;
   crc32_partial_func_t custom_crc_partial;
+  struct tcp_rpc_compression *compression;
 };
 
 #define	TCP_RPC_DATA(c)	((struct tcp_rpc_data *) ((c)->custom_data))
+static_assert(sizeof(struct tcp_rpc_data) <= CONN_CUSTOM_DATA_BYTES, "tcp_rpc_data doesn't fit into custom_data");
 
 #define RPC_CRYPTO_ALLOW_UNENCRYPTED  0x00000001
 #define RPC_CRYPTO_ALLOW_ENCRYPTED    0x00000002
@@ -75,6 +79,7 @@ struct tcp_rpc_data {
 #define RPC_CRYPTO_ENCRYPTED_MASK     (RPC_CRYPTO_ALLOW_ENCRYPTED | RPC_CRYPTO_NONCE_SENT | RPC_CRYPTO_ENCRYPTION_ON)
 #define RPC_CRYPTO_ALLOW_QACK         0x00000200
 #define RPC_CRYPTO_USE_CRC32C         0x00000800
+/* RPC_CRYPTO_ZSTD 0x00001000 is in net-tcp-rpc-compression.h */
 
 #define RPC_NONCE           0x7acb87aa
 #define RPC_HANDSHAKE       0x7682eef5
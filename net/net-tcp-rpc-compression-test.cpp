@@ -0,0 +1,96 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "net/net-tcp-rpc-common.h"
+#include "net/net-tcp-rpc-compression.h"
+
+namespace {
+
+std::string make_packet(int type, int len) {
+  std::string packet(len, '\0');
+  memcpy(&packet[0], &type, sizeof(type));
+  for (int i = 4; i < len; ++i) {
+    packet[i] = static_cast<char>('a' + i % 7);
+  }
+  return packet;
+}
+
+std::string rwm_to_string(raw_message_t *raw) {
+  std::string res(raw->total_bytes, '\0');
+  assert(rwm_fetch_data(raw, &res[0], raw->total_bytes) == static_cast<int>(res.size()));
+  return res;
+}
+
+} // namespace
+
+TEST(tcp_rpc_compression, test_compress_decompress) {
+  struct connection sender{};
+  struct connection receiver{};
+  // the server doesn't accept the compression until it's configured
+  ASSERT_EQ(tcp_rpc_compression_enable(&sender, RPC_CRYPTO_ZSTD, false), 0);
+  ASSERT_EQ(tcp_rpcs_compression_accept_flags(&sender), 0);
+  ASSERT_EQ(tcp_rpc_compression_add_target("*=1024"), 0);
+
+  ASSERT_EQ(tcp_rpc_compression_enable(&sender, RPC_CRYPTO_ZSTD, false), 0);
+  ASSERT_EQ(tcp_rpc_compression_enable(&receiver, RPC_CRYPTO_ZSTD, false), 0);
+  ASSERT_EQ(tcp_rpcs_compression_accept_flags(&sender), RPC_CRYPTO_ZSTD);
+
+  // the small packet is sent as is
+  const std::string small = make_packet(0x12345678, 64);
+  raw_message_t raw;
+  rwm_create(&raw, small.data(), small.size());
+  tcp_rpc_compress_packet(&sender, &raw);
+  ASSERT_EQ(rwm_to_string(&raw), small);
+  rwm_free(&raw);
+
+  // the stream keeps the history, so the repeated packets are compressed better
+  int prev_compressed_len = 0;
+  for (int i = 0; i != 3; ++i) {
+    const std::string packet = make_packet(0x12345678 + i, 4096);
+    rwm_create(&raw, packet.data(), packet.size());
+    tcp_rpc_compress_packet(&sender, &raw);
+    ASSERT_EQ(raw.total_bytes % 4, 0);
+    ASSERT_LT(raw.total_bytes, packet.size());
+    if (i > 0) {
+      ASSERT_LE(raw.total_bytes, prev_compressed_len);
+    }
+    prev_compressed_len = raw.total_bytes;
+
+    int type = 0;
+    ASSERT_EQ(rwm_fetch_lookup(&raw, &type, 4), 4);
+    ASSERT_EQ(type, RPC_COMPRESSED_PACKET);
+    TCP_RPC_DATA(&receiver)->packet_len = raw.total_bytes;
+    ASSERT_EQ(tcp_rpc_decompress_packet(&receiver, &raw, 0), 0);
+    ASSERT_EQ(TCP_RPC_DATA(&receiver)->packet_type, 0x12345678 + i);
+    ASSERT_EQ(TCP_RPC_DATA(&receiver)->packet_len, packet.size());
+    ASSERT_EQ(rwm_to_string(&raw), packet);
+    rwm_free(&raw);
+  }
+
+  // the corrupted packet is rejected
+  const std::string packet = make_packet(0x12345678, 4096);
+  rwm_create(&raw, packet.data(), packet.size());
+  tcp_rpc_compress_packet(&sender, &raw);
+  std::string corrupted = rwm_to_string(&raw);
+  corrupted[4] ^= 1;
+  rwm_free(&raw);
+  rwm_create(&raw, corrupted.data(), corrupted.size());
+  TCP_RPC_DATA(&receiver)->packet_len = raw.total_bytes;
+  ASSERT_EQ(tcp_rpc_decompress_packet(&receiver, &raw, 0), -1);
+  rwm_free(&raw);
+
+  // the packet longer than the limit is rejected before the decompression
+  rwm_create(&raw, packet.data(), packet.size());
+  tcp_rpc_compress_packet(&sender, &raw);
+  TCP_RPC_DATA(&receiver)->packet_len = raw.total_bytes;
+  ASSERT_EQ(tcp_rpc_decompress_packet(&receiver, &raw, 1024), -1);
+  rwm_free(&raw);
+
+  tcp_rpc_compression_free(&sender);
+  tcp_rpc_compression_free(&receiver);
+  ASSERT_EQ(tcp_rpcs_compression_accept_flags(&sender), 0);
+}
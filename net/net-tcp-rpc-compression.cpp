@@ -0,0 +1,356 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "net/net-tcp-rpc-compression.h"
+
+#include <assert.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <time.h>
+#include <vector>
+#include <zstd.h>
+
+#include "common/algorithms/arithmetic.h"
+#include "common/crc32.h"
+#include "common/kprintf.h"
+#include "common/options.h"
+#include "common/resolver.h"
+#include "common/stats/provider.h"
+
+#include "net/net-sockaddr-storage.h"
+#include "net/net-tcp-rpc-common.h"
+
+/* the window is limited, as the streams live as long as the connections */
+static const int compression_window_log = 17;
+static const int decompression_window_log_max = 20;
+/* the limit of the decompressed packet, if the connection type doesn't limit the packets itself */
+static const int default_max_decompressed_len = 1 << 28;
+
+static int compression_level = 1;
+static int compression_threshold = 1024;
+
+struct compression_target {
+  uint32_t ip; // 0 matches any target
+  uint16_t port;
+  int threshold;
+};
+static std::vector<compression_target> compression_targets;
+
+static std::vector<char> dictionary;
+static ZSTD_CDict *compression_dictionary;
+static ZSTD_DDict *decompression_dictionary;
+static int dictionary_tag;
+
+struct tcp_rpc_compression {
+  ZSTD_CCtx *cctx;
+  ZSTD_DCtx *dctx;
+  int threshold;
+  bool use_dictionary;
+};
+
+static struct {
+  long long connections;
+  long long packets_compressed;
+  long long packets_decompressed;
+  long long bytes_before_compression;
+  long long bytes_after_compression;
+  long long compression_time_us;
+  long long decompression_time_us;
+} compression_stats;
+
+STATS_PROVIDER(rpc_compression, 1000) {
+  add_histogram_stat_long(stats, "rpc_compression_connections", compression_stats.connections);
+  add_histogram_stat_long(stats, "rpc_compression_packets_compressed", compression_stats.packets_compressed);
+  add_histogram_stat_long(stats, "rpc_compression_packets_decompressed", compression_stats.packets_decompressed);
+  add_histogram_stat_long(stats, "rpc_compression_bytes_before", compression_stats.bytes_before_compression);
+  add_histogram_stat_long(stats, "rpc_compression_bytes_after", compression_stats.bytes_after_compression);
+  add_histogram_stat_long(stats, "rpc_compression_bytes_saved", compression_stats.bytes_before_compression - compression_stats.bytes_after_compression);
+  add_histogram_stat_long(stats, "rpc_compression_time_us", compression_stats.compression_time_us);
+  add_histogram_stat_long(stats, "rpc_decompression_time_us", compression_stats.decompression_time_us);
+}
+
+int tcp_rpc_compression_add_target(const char *target_str) {
+  char *target = strdup(target_str);
+  compression_target res = {0, 0, compression_threshold};
+  if (char *eq = strchr(target, '=')) {
+    *eq = 0;
+    res.threshold = atoi(eq + 1);
+    if (res.threshold <= 0) {
+      kprintf("--rpc-compression-target option, threshold must be positive\n");
+      free(target);
+      return -1;
+    }
+  }
+  if (strcmp(target, "*") != 0) {
+    char *colon = strrchr(target, ':');
+    struct hostent *h = NULL;
+    if (colon != NULL) {
+      *colon = 0;
+      res.port = static_cast<uint16_t>(atoi(colon + 1));
+      h = kdb_gethostbyname(target);
+    }
+    if (!res.port || !h || h->h_addrtype != AF_INET || h->h_length != 4 || !h->h_addr) {
+      kprintf("--rpc-compression-target option, can't parse target '%s'\n", target_str);
+      free(target);
+      return -1;
+    }
+    res.ip = ntohl(*reinterpret_cast<uint32_t *>(h->h_addr));
+  }
+  free(target);
+  compression_targets.push_back(res);
+  return 0;
+}
+
+OPTION_PARSER(OPT_RPC, "rpc-compression-target", required_argument,
+              "offers zstd compression to the RPC target in form host:port[=threshold] or *[=threshold] for all the targets, "
+              "the packets not smaller than the threshold are compressed; can be used several times. "
+              "The server accepts the compression only if this option or --rpc-compression-dictionary is given") {
+  return tcp_rpc_compression_add_target(optarg);
+}
+
+OPTION_PARSER(OPT_RPC, "rpc-compression-threshold", required_argument, "the default size of RPC packet to be compressed on the connections with negotiated compression (default %d)",
+              compression_threshold) {
+  compression_threshold = atoi(optarg);
+  return compression_threshold > 0 ? 0 : -1;
+}
+
+OPTION_PARSER(OPT_RPC, "rpc-compression-level", required_argument, "zstd level of RPC compression (default %d)", compression_level) {
+  compression_level = atoi(optarg);
+  return ZSTD_minCLevel() <= compression_level && compression_level <= ZSTD_maxCLevel() ? 0 : -1;
+}
+
+OPTION_PARSER(OPT_RPC, "rpc-compression-dictionary", required_argument, "zstd dictionary for RPC compression, it's used if the peer has the same one") {
+  FILE *f = fopen(optarg, "rb");
+  if (!f) {
+    kprintf("--rpc-compression-dictionary option, can't open '%s': %m\n", optarg);
+    return -1;
+  }
+  char buf[1 << 12];
+  size_t read = 0;
+  while ((read = fread(buf, 1, sizeof(buf), f)) > 0) {
+    dictionary.insert(dictionary.end(), buf, buf + read);
+  }
+  fclose(f);
+  if (dictionary.empty()) {
+    kprintf("--rpc-compression-dictionary option, '%s' is empty\n", optarg);
+    return -1;
+  }
+  // the peers compare the tags in the handshake, the dictionary is used if the tags are equal
+  dictionary_tag = static_cast<int>(compute_crc32(dictionary.data(), dictionary.size()) % 255) + 1;
+  return 0;
+}
+
+static long long monotonic_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static tcp_rpc_compression *get_compression(struct connection *c) {
+  return TCP_RPC_DATA(c)->compression;
+}
+
+/* the server accepts the compression only if it's configured: the peers may be not trusted enough to decompress their packets */
+static bool is_compression_configured() {
+  return !compression_targets.empty() || !dictionary.empty();
+}
+
+static int get_target_threshold(struct connection *c) {
+  const uint32_t ip = inet_sockaddr_address(&c->remote_endpoint);
+  const uint16_t port = inet_sockaddr_port(&c->remote_endpoint);
+  for (const auto &target : compression_targets) {
+    if (!target.ip || (target.ip == ip && target.port == port)) {
+      return target.threshold;
+    }
+  }
+  return 0;
+}
+
+int tcp_rpcc_compression_offer_flags(struct connection *c) {
+  if (!get_target_threshold(c)) {
+    return 0;
+  }
+  return RPC_CRYPTO_ZSTD | (dictionary_tag << RPC_COMPRESSION_DICT_SHIFT);
+}
+
+int tcp_rpcs_compression_accept_flags(struct connection *c) {
+  const tcp_rpc_compression *compression = get_compression(c);
+  if (!compression) {
+    return 0;
+  }
+  return RPC_CRYPTO_ZSTD | (compression->use_dictionary ? dictionary_tag << RPC_COMPRESSION_DICT_SHIFT : 0);
+}
+
+int tcp_rpc_compression_enable(struct connection *c, int handshake_flags, bool client_side) {
+  assert(handshake_flags & RPC_CRYPTO_ZSTD);
+  const int threshold = client_side ? get_target_threshold(c) : (is_compression_configured() ? compression_threshold : 0);
+  if (!threshold) {
+    // the client hasn't offered the compression, or the server doesn't accept it
+    return client_side ? -1 : 0;
+  }
+  const int peer_dictionary_tag = (handshake_flags & RPC_COMPRESSION_DICT_MASK) >> RPC_COMPRESSION_DICT_SHIFT;
+
+  auto *compression = static_cast<tcp_rpc_compression *>(calloc(1, sizeof(tcp_rpc_compression)));
+  compression->threshold = threshold;
+  compression->use_dictionary = dictionary_tag && peer_dictionary_tag == dictionary_tag;
+  compression->cctx = ZSTD_createCCtx();
+  compression->dctx = ZSTD_createDCtx();
+  if (compression->use_dictionary) {
+    // the dictionaries are created lazily, as they depend on the compression level
+    if (!compression_dictionary) {
+      compression_dictionary = ZSTD_createCDict(dictionary.data(), dictionary.size(), compression_level);
+      decompression_dictionary = ZSTD_createDDict(dictionary.data(), dictionary.size());
+      assert(compression_dictionary && decompression_dictionary);
+    }
+    ZSTD_CCtx_refCDict(compression->cctx, compression_dictionary);
+    ZSTD_DCtx_refDDict(compression->dctx, decompression_dictionary);
+  } else {
+    ZSTD_CCtx_setParameter(compression->cctx, ZSTD_c_compressionLevel, compression_level);
+  }
+  ZSTD_CCtx_setParameter(compression->cctx, ZSTD_c_windowLog, compression_window_log);
+  ZSTD_DCtx_setParameter(compression->dctx, ZSTD_d_windowLogMax, decompression_window_log_max);
+
+  TCP_RPC_DATA(c)->compression = compression;
+  TCP_RPC_DATA(c)->crypto_flags |= RPC_CRYPTO_ZSTD;
+  compression_stats.connections++;
+  vkprintf(2, "RPC connection #%d: zstd compression is enabled, threshold = %d, dictionary = %d\n", c->fd, threshold, compression->use_dictionary);
+  return 0;
+}
+
+void tcp_rpc_compression_free(struct connection *c) {
+  tcp_rpc_compression *compression = get_compression(c);
+  if (!compression) {
+    return;
+  }
+  ZSTD_freeCCtx(compression->cctx);
+  ZSTD_freeDCtx(compression->dctx);
+  free(compression);
+  TCP_RPC_DATA(c)->compression = NULL;
+  TCP_RPC_DATA(c)->crypto_flags &= ~RPC_CRYPTO_ZSTD;
+  compression_stats.connections--;
+}
+
+struct zstd_stream_extra {
+  tcp_rpc_compression *compression;
+  raw_message_t *out;
+  char *buffer;
+  size_t buffer_size;
+  int max_out_len;
+  bool failed;
+};
+
+static int zstd_stream_compress(void *extra_, const void *data, int len) {
+  auto *extra = static_cast<zstd_stream_extra *>(extra_);
+  ZSTD_inBuffer input = {data, static_cast<size_t>(len), 0};
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output = {extra->buffer, extra->buffer_size, 0};
+    const size_t res = ZSTD_compressStream2(extra->compression->cctx, &output, &input, ZSTD_e_continue);
+    assert(!ZSTD_isError(res));
+    rwm_push_data(extra->out, output.dst, static_cast<int>(output.pos));
+  }
+  return 0;
+}
+
+void tcp_rpc_compress_packet(struct connection *c, raw_message_t *raw) {
+  tcp_rpc_compression *compression = get_compression(c);
+  if (!compression || raw->total_bytes < compression->threshold) {
+    return;
+  }
+  const long long start = monotonic_us();
+  static char buffer[1 << 16];
+  const int original_len = raw->total_bytes;
+  raw_message_t out;
+  rwm_init(&out, 0);
+  zstd_stream_extra extra = {compression, &out, buffer, sizeof(buffer), 0, false};
+  rwm_process(raw, original_len, zstd_stream_compress, &extra);
+
+  // the flushed data is decodable by the peer, the stream keeps the history for the next packets
+  size_t remaining = 0;
+  do {
+    ZSTD_inBuffer input = {NULL, 0, 0};
+    ZSTD_outBuffer output = {buffer, sizeof(buffer), 0};
+    remaining = ZSTD_compressStream2(compression->cctx, &output, &input, ZSTD_e_flush);
+    assert(!ZSTD_isError(remaining));
+    rwm_push_data(&out, output.dst, static_cast<int>(output.pos));
+  } while (remaining != 0);
+
+  const int compressed_len = out.total_bytes;
+  const int header[3] = {static_cast<int>(RPC_COMPRESSED_PACKET), original_len, compressed_len};
+  rwm_push_data_front(&out, header, sizeof(header));
+  const int zero = 0;
+  rwm_push_data(&out, &zero, align4(compressed_len) - compressed_len);
+
+  rwm_free(raw);
+  *raw = out;
+
+  compression_stats.packets_compressed++;
+  compression_stats.bytes_before_compression += original_len;
+  compression_stats.bytes_after_compression += out.total_bytes;
+  compression_stats.compression_time_us += monotonic_us() - start;
+}
+
+static int zstd_stream_decompress(void *extra_, const void *data, int len) {
+  auto *extra = static_cast<zstd_stream_extra *>(extra_);
+  ZSTD_inBuffer input = {data, static_cast<size_t>(len), 0};
+  bool output_full = true;
+  while (!extra->failed && (input.pos < input.size || output_full)) {
+    // a byte more than the declared length is enough to find out that the packet is bad
+    const size_t left_len = static_cast<size_t>(extra->max_out_len - extra->out->total_bytes) + 1;
+    ZSTD_outBuffer output = {extra->buffer, std::min(extra->buffer_size, left_len), 0};
+    const size_t res = ZSTD_decompressStream(extra->compression->dctx, &output, &input);
+    if (ZSTD_isError(res)) {
+      vkprintf(1, "error while decompressing RPC packet: %s\n", ZSTD_getErrorName(res));
+      extra->failed = true;
+      break;
+    }
+    rwm_push_data(extra->out, output.dst, static_cast<int>(output.pos));
+    output_full = output.pos == output.size;
+    if (extra->out->total_bytes > extra->max_out_len) {
+      extra->failed = true;
+    }
+  }
+  return 0;
+}
+
+int tcp_rpc_decompress_packet(struct connection *c, raw_message_t *msg, int max_packet_len) {
+  tcp_rpc_compression *compression = get_compression(c);
+  struct tcp_rpc_data *D = TCP_RPC_DATA(c);
+  int header[3];
+  if (!compression || D->packet_len < static_cast<int>(sizeof(header)) || rwm_fetch_data(msg, header, sizeof(header)) != sizeof(header)) {
+    return -1;
+  }
+  const int original_len = header[1];
+  const int compressed_len = header[2];
+  if (original_len < 4 || (original_len & 3) || compressed_len <= 0 || align4(compressed_len) != msg->total_bytes) {
+    vkprintf(1, "error while parsing compressed packet: bad length %d -> %d\n", compressed_len, original_len);
+    return -1;
+  }
+  if (original_len > (max_packet_len > 0 ? max_packet_len : default_max_decompressed_len)) {
+    vkprintf(1, "error while parsing compressed packet: too long original packet %d\n", original_len);
+    return -1;
+  }
+
+  const long long start = monotonic_us();
+  static char buffer[1 << 16];
+  raw_message_t out;
+  rwm_init(&out, 0);
+  zstd_stream_extra extra = {compression, &out, buffer, sizeof(buffer), original_len, false};
+  rwm_process(msg, compressed_len, zstd_stream_decompress, &extra);
+  if (extra.failed || out.total_bytes != original_len) {
+    rwm_free(&out);
+    return -1;
+  }
+
+  rwm_free(msg);
+  *msg = out;
+  assert(rwm_fetch_lookup(msg, &D->packet_type, 4) == 4);
+  D->packet_len = original_len;
+
+  compression_stats.packets_decompressed++;
+  compression_stats.decompression_time_us += monotonic_us() - start;
+  return 0;
+}
@@ -0,0 +1,46 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <sys/cdefs.h>
+
+#include "net/net-connections.h"
+#include "net/net-msg.h"
+
+/*
+ * Connection-level zstd compression of TCP RPC packets.
+ * The client offers the compression in its handshake (to the targets listed by --rpc-compression-target),
+ * the server accepts it by echoing the flag in its handshake if the compression is configured for it
+ * (any --rpc-compression-target or --rpc-compression-dictionary), the peers without the support ignore the flag.
+ * After the handshake each side keeps a persistent zstd stream per direction: every packet not smaller
+ * than the threshold is flushed into the stream and sent as RPC_COMPRESSED_PACKET,
+ * so the packets are compressed with the history of the connection.
+ * The optional shared dictionary is used if both peers have the same one.
+ */
+
+#define RPC_CRYPTO_ZSTD             0x00001000
+#define RPC_COMPRESSION_DICT_MASK   0x00ff0000
+#define RPC_COMPRESSION_DICT_SHIFT  16
+
+/* RPC_COMPRESSED_PACKET original_len:int compressed_len:int data:bytes[compressed_len] padding */
+#define RPC_COMPRESSED_PACKET       0x6a9bbb6f
+
+struct tcp_rpc_compression;
+
+/* adds the target in form host:port[=threshold] or *[=threshold], as --rpc-compression-target does; returns -1 on error */
+int tcp_rpc_compression_add_target(const char *target);
+/* the handshake flags offered by the client, 0 if the compression isn't configured for the target */
+int tcp_rpcc_compression_offer_flags(struct connection *c);
+/* enables the compression on both sides, the flags are received in the handshake of the peer; returns -1 on error */
+int tcp_rpc_compression_enable(struct connection *c, int handshake_flags, bool client_side);
+/* the handshake flags of the server, which confirm the enabled compression */
+int tcp_rpcs_compression_accept_flags(struct connection *c);
+void tcp_rpc_compression_free(struct connection *c);
+
+/* replaces the packet with the compressed one, if the compression is enabled and the packet is large enough */
+void tcp_rpc_compress_packet(struct connection *c, raw_message_t *raw);
+/* replaces the RPC_COMPRESSED_PACKET with the original one and updates the packet type and length;
+ * returns -1 on error or if the original packet is longer than max_packet_len (0 means the default limit) */
+int tcp_rpc_decompress_packet(struct connection *c, raw_message_t *msg, int max_packet_len);
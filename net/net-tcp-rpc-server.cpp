@@ -25,6 +25,7 @@
 #include "net/net-ifnet.h"
 #include "net/net-sockaddr-storage.h"
 #include "net/net-tcp-connections.h"
+#include "net/net-tcp-rpc-compression.h"
 
 /*
  *
@@ -194,7 +195,7 @@ static int tcp_rpcs_send_handshake_packet (struct connection *c) {
   assert (PID.pid);
   memset (&P, 0, sizeof (P));
   P.type = RPC_HANDSHAKE;
-  P.flags = D->crypto_flags & RPC_CRYPTO_USE_CRC32C;
+  P.flags = (D->crypto_flags & RPC_CRYPTO_USE_CRC32C) | tcp_rpcs_compression_accept_flags (c);
   memcpy (&P.sender_pid, &PID, sizeof (struct process_id));
   memcpy (&P.peer_pid, &D->remote_pid, sizeof (struct process_id));
 
@@ -250,6 +251,9 @@ static int tcp_rpcs_process_handshake_packet (struct connection *c, raw_message_
   if (P.flags & default_rpc_flags & RPC_CRYPTO_USE_CRC32C) {
     D->crypto_flags |= RPC_CRYPTO_USE_CRC32C;
   }
+  if (P.flags & RPC_CRYPTO_ZSTD) {
+    tcp_rpc_compression_enable (c, P.flags, false);
+  }
   return 0;
 }
 
@@ -429,6 +433,13 @@ int tcp_rpcs_parse_execute (struct connection *c) {
       /* main case */
       c->status = conn_running;
       c->last_response_time = precise_now;
+      if (D->packet_type == RPC_COMPRESSED_PACKET && tcp_rpc_decompress_packet (c, &msg, TCP_RPCS_FUNC(c)->max_packet_len) < 0) {
+        vkprintf (1, "error while parsing packet: can't decompress packet %d\n", D->packet_num);
+        c->status = conn_error;
+        c->error = -1;
+        rwm_free (&msg);
+        return 0;
+      }
       if (D->packet_type == TL_RPC_PING) {
         res = tcp_rpcs_default_execute (c, D->packet_type, &msg);
       } else {
@@ -490,6 +501,7 @@ int tcp_rpcs_close_connection (struct connection *c, int who) {
   if (TCP_RPCS_FUNC(c)->rpc_close != NULL) {
     TCP_RPCS_FUNC(c)->rpc_close (c, who);
   } 
+  tcp_rpc_compression_free (c);
 
   return server_close_connection (c, who);
 }
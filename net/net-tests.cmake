@@ -1,6 +1,10 @@
 prepend(NET_TESTS_SOURCES ${BASE_DIR}/net/
         net-aes-keys-test.cpp
+        net-hpack-test.cpp
+        net-http-parser-test.cpp
+        net-http2-server-test.cpp
         net-msg-test.cpp
+        net-tcp-rpc-compression-test.cpp
         net-test.cpp
         time-slice-test.cpp)
 
@@ -8,6 +8,7 @@ prepend(NET_SOURCES ${BASE_DIR}/net/
         net-tcp-connections.cpp
         net-tcp-rpc-client.cpp
         net-tcp-rpc-common.cpp
+        net-tcp-rpc-compression.cpp
         net-tcp-rpc-server.cpp
         net-ifnet.cpp
         net-socket-options.cpp
@@ -18,7 +19,10 @@ prepend(NET_SOURCES ${BASE_DIR}/net/
         net-msg-part.cpp
         net-mysql-client.cpp
         net-memcache-client.cpp
+        net-hpack.cpp
+        net-http-parser.cpp
         net-http-server.cpp
+        net-http2-server.cpp
         net-msg-buffers.cpp
         net-msg.cpp
         net-msg-part.cpp)
@@ -86,6 +86,15 @@ void init_script_allocator(void *buffer, size_t buffer_size) noexcept {
   query_num++;
 }
 
+void set_script_allocator_slab_mode(bool enabled) noexcept {
+  auto &dealer = get_memory_dealer();
+  php_assert(dealer.is_default_allocator_used());
+  php_assert(!script_allocator_enabled);
+
+  // the mode is kept between the script runs
+  dealer.current_script_resource().set_slab_mode(enabled);
+}
+
 void free_script_allocator() noexcept {
   auto &dealer = get_memory_dealer();
   php_assert(!dealer.heap_script_resource_replacer());
@@ -29,6 +29,7 @@ size_t get_heap_memory_used() noexcept;
 
 void global_init_script_allocator() noexcept;
 void init_script_allocator(void *buffer, size_t buffer_size) noexcept; // init script allocator with arena of n bytes at buf
+void set_script_allocator_slab_mode(bool enabled) noexcept; // allocate small pieces of script memory from size class slabs
 void free_script_allocator() noexcept;
 
 void *allocate(size_t n) noexcept; // allocate script memory
@@ -145,6 +145,29 @@ uint32_t array<T>::array_inner::choose_bucket(int64_t key, uint32_t buf_size, ui
   return fastmod::fastmod_u32(static_cast<uint32_t>(key << 2), modulo_helper, buf_size);
 }
 
+template<class T>
+uint32_t array<T>::array_inner::probe_int(int64_t key) const {
+  uint32_t bucket = choose_bucket_int(key);
+  while (int_entries[bucket].next != EMPTY_POINTER && int_entries[bucket].int_key != key) {
+    if (unlikely (++bucket == int_buf_size)) {
+      bucket = 0;
+    }
+  }
+  return bucket;
+}
+
+template<class T>
+uint32_t array<T>::array_inner::probe_string(int64_t key, const string &string_key) const {
+  const string_hash_entry *string_entries = get_string_entries();
+  uint32_t bucket = choose_bucket_string(key);
+  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != key || string_entries[bucket].string_key != string_key)) {
+    if (unlikely (++bucket == string_buf_size)) {
+      bucket = 0;
+    }
+  }
+  return bucket;
+}
+
 template<class T>
 bool array<T>::array_inner::is_vector() const {
   return string_buf_size == std::numeric_limits<uint32_t>::max();
@@ -382,12 +405,7 @@ template<class T>
 template<class ...Args>
 T &array<T>::array_inner::emplace_int_key_map_value(overwrite_element policy, int64_t int_key, Args &&... args) noexcept {
   static_assert(std::is_constructible<T, Args...>{}, "should be constructible");
-  uint32_t bucket = choose_bucket_int(int_key);
-  while (int_entries[bucket].next != EMPTY_POINTER && int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == int_buf_size)) {
-      bucket = 0;
-    }
-  }
+  const uint32_t bucket = probe_int(int_key);
 
   if (int_entries[bucket].next == EMPTY_POINTER) {
     int_entries[bucket].int_key = int_key;
@@ -426,12 +444,7 @@ void array<T>::array_inner::unset_vector_value() {
 
 template<class T>
 void array<T>::array_inner::unset_map_value(int64_t int_key) {
-  uint32_t bucket = choose_bucket_int(int_key);
-  while (int_entries[bucket].next != EMPTY_POINTER && int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == int_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint32_t bucket = probe_int(int_key);
 
   if (int_entries[bucket].next != EMPTY_POINTER) {
     int_entries[bucket].int_key = 0;
@@ -478,29 +491,13 @@ void array<T>::array_inner::unset_map_value(int64_t int_key) {
 template<class T>
 template<class S>
 auto &array<T>::array_inner::find_map_entry(S &self, int64_t int_key) noexcept {
-  uint32_t bucket = self.choose_bucket_int(int_key);
-  while (self.int_entries[bucket].next != EMPTY_POINTER && self.int_entries[bucket].int_key != int_key) {
-    if (unlikely (++bucket == self.int_buf_size)) {
-      bucket = 0;
-    }
-  }
-
-  return self.int_entries[bucket];
+  return self.int_entries[self.probe_int(int_key)];
 }
 
 template<class T>
 template<class S>
 auto &array<T>::array_inner::find_map_entry(S &self, const string &string_key, int64_t precomuted_hash) noexcept {
-  auto *string_entries = self.get_string_entries();
-  uint32_t bucket = self.choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER &&
-         (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == self.string_buf_size)) {
-      bucket = 0;
-    }
-  }
-
-  return string_entries[bucket];
+  return self.get_string_entries()[self.probe_string(precomuted_hash, string_key)];
 }
 
 template<class T>
@@ -526,12 +523,7 @@ T &array<T>::array_inner::emplace_string_key_map_value(overwrite_element policy,
   static_assert(std::is_same<std::decay_t<STRING>, string>::value, "string_key should be string");
 
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(int_key);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != int_key || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  const uint32_t bucket = probe_string(int_key, string_key);
 
   if (string_entries[bucket].next == EMPTY_POINTER) {
     string_entries[bucket].int_key = int_key;
@@ -561,12 +553,7 @@ T &array<T>::array_inner::set_map_value(overwrite_element policy, int64_t int_ke
 template<class T>
 void array<T>::array_inner::unset_map_value(const string &string_key, int64_t precomuted_hash) {
   string_hash_entry *string_entries = get_string_entries();
-  uint32_t bucket = choose_bucket_string(precomuted_hash);
-  while (string_entries[bucket].next != EMPTY_POINTER && (string_entries[bucket].int_key != precomuted_hash || string_entries[bucket].string_key != string_key)) {
-    if (unlikely (++bucket == string_buf_size)) {
-      bucket = 0;
-    }
-  }
+  uint32_t bucket = probe_string(precomuted_hash, string_key);
 
   if (string_entries[bucket].next != EMPTY_POINTER) {
     string_entries[bucket].int_key = 0;
@@ -1903,24 +1890,11 @@ void array<T>::ksort(const T1 &compare) {
     list_hash_entry *cur;
     if (is_int_key(keysp[j])) {
       int64_t int_key = keysp[j].to_int();
-      uint32_t bucket = p->choose_bucket_int(int_key);
-      while (p->int_entries[bucket].int_key != int_key) {
-        if (unlikely (++bucket == p->int_buf_size)) {
-          bucket = 0;
-        }
-      }
-      cur = (list_hash_entry * ) & p->int_entries[bucket];
+      cur = &array_inner::find_map_entry(*p, int_key);
     } else {
       string string_key = keysp[j].to_string();
       int64_t int_key = string_key.hash();
-      string_hash_entry *string_entries = p->get_string_entries();
-      uint32_t bucket = p->choose_bucket_string(int_key);
-      while ((string_entries[bucket].int_key != int_key || string_entries[bucket].string_key != string_key)) {
-        if (unlikely (++bucket == p->string_buf_size)) {
-          bucket = 0;
-        }
-      }
-      cur = (list_hash_entry * ) & string_entries[bucket];
+      cur = &array_inner::find_map_entry(*p, string_key, int_key);
     }
 
     cur->prev = p->get_pointer(prev);
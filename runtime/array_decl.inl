@@ -141,6 +141,8 @@ private:
     inline uint32_t choose_bucket_int(int64_t key) const __attribute__ ((always_inline));
     inline uint32_t choose_bucket_string(int64_t key) const __attribute__ ((always_inline));
     inline static uint32_t choose_bucket(int64_t key, uint32_t buf_size, uint64_t modulo_helper) __attribute__ ((always_inline));
+    inline uint32_t probe_int(int64_t key) const __attribute__ ((always_inline));
+    inline uint32_t probe_string(int64_t key, const string &string_key) const __attribute__ ((always_inline));
 
     inline static size_t sizeof_vector(uint32_t int_size) __attribute__((always_inline));
     inline static size_t sizeof_map(uint32_t int_size, uint32_t string_size) __attribute__((always_inline));
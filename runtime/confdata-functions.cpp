@@ -34,6 +34,11 @@ public:
     return acquired_sample_->get_confdata();
   }
 
+  const confdata_sample_storage::value_type *find_confdata_element(const string &key) const noexcept {
+    php_assert(acquired_sample_);
+    return acquired_sample_->find(key);
+  }
+
   bool is_initialized() const noexcept {
     return global_manager_.is_initialized();
   }
@@ -96,16 +101,14 @@ mixed f$confdata_get_value(const string &key) noexcept {
   const auto &local_manager = ConfdataLocalManager::get();
   ConfdataKeyMaker key_maker;
   key_maker.update(key.c_str(), static_cast<int16_t>(key.size()), local_manager.get_predefined_wildcards());
-  const auto &confdata_storage = local_manager.get_confdata_storage();
-  auto it = confdata_storage.find(key_maker.get_first_key());
-  if (it != confdata_storage.end()) {
+  if (const auto *element = local_manager.find_confdata_element(key_maker.get_first_key())) {
     // if key doesn't contain prefixes
     if (key_maker.get_first_key_type() == ConfdataFirstKeyType::simple_key) {
-      return it->second;
+      return element->second;
     }
     // it must be an array (we loaded it this way)
-    php_assert(it->second.is_array());
-    if (auto *value = it->second.as_array().find_value(key_maker.get_second_key())) {
+    php_assert(element->second.is_array());
+    if (auto *value = element->second.as_array().find_value(key_maker.get_second_key())) {
       return *value;
     }
   }
@@ -124,18 +127,17 @@ array<mixed> f$confdata_get_values_by_any_wildcard(const string &wildcard) noexc
   const auto &local_manager = ConfdataLocalManager::get();
   const auto &predefined_wildcards = local_manager.get_predefined_wildcards();
   ConfdataKeyMaker key_maker;
-  const auto &confdata_storage = local_manager.get_confdata_storage();
   // wildcard has a form of '\w+\..*' or '\w+\.\w+\..*' and contains a predefined prefix
   if (key_maker.update(wildcard.c_str(), static_cast<int16_t>(wildcard.size()), predefined_wildcards) != ConfdataFirstKeyType::simple_key) {
     // the first key is '\w+\.' or '\w+\.\w+\.'
-    auto it = confdata_storage.find(key_maker.get_first_key());
-    if (it == confdata_storage.end()) {
+    const auto *element = local_manager.find_confdata_element(key_maker.get_first_key());
+    if (!element) {
       return {};
     }
 
     // it must be an array (we loaded it this way)
-    php_assert(it->second.is_array());
-    const auto &second_key_array = it->second.as_array();
+    php_assert(element->second.is_array());
+    const auto &second_key_array = element->second.as_array();
 
     // if the second key is an empty string; i.e. the first key is an entire prefix ('\w+\.' or '\w+\.\w+\.' or predefined)
     if (key_maker.get_second_key().is_string() && key_maker.get_second_key().as_string().empty()) {
@@ -154,7 +156,8 @@ array<mixed> f$confdata_get_values_by_any_wildcard(const string &wildcard) noexc
     return result;
   }
 
-  // wildcard has a form of '\w+' and does not contain a predefined prefix
+  // wildcard has a form of '\w+' and does not contain a predefined prefix, the ordered storage is used as a prefix index
+  const auto &confdata_storage = local_manager.get_confdata_storage();
   array<mixed> result;
   auto merge_into_result = [&result, &wildcard](confdata_sample_storage::const_iterator iter) {
     const auto section_suffix = f$substr(iter->first, wildcard.size()).val();
@@ -203,17 +206,15 @@ array<mixed> f$confdata_get_values_by_predefined_wildcard(const string &wildcard
   }
 
   const auto &local_manager = ConfdataLocalManager::get();
-  const auto &confdata_storage = local_manager.get_confdata_storage();
   const vk::string_view wildcard_view{wildcard.c_str(), wildcard.size()};
   if (local_manager.get_predefined_wildcards().detect_first_key_type(wildcard_view) == ConfdataFirstKeyType::simple_key) {
     php_warning("Trying to get elements by non predefined wildcard '%s'", wildcard.c_str());
     return {};
   }
 
-  const auto elements_it = confdata_storage.find(wildcard);
-  if (elements_it != confdata_storage.end()) {
-    php_assert(elements_it->second.is_array());
-    return elements_it->second.as_array();
+  if (const auto *element = local_manager.find_confdata_element(wildcard)) {
+    php_assert(element->second.is_array());
+    return element->second.as_array();
   }
   return {};
 }
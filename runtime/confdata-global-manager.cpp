@@ -32,22 +32,50 @@ void recursively_destroy_confdata_element(mixed &element) noexcept {
 
 } // namespace
 
-void ConfdataSample::init(memory_resource::unsynchronized_pool_resource &resource) noexcept {
+void ConfdataSample::init(memory_resource::unsynchronized_pool_resource &resource, bool use_hash_index) noexcept {
   php_assert(!resource_);
   php_assert(!confdata_storage_);
   resource_ = &resource;
   auto *mem = resource_->allocate(sizeof(*confdata_storage_));
   php_assert(mem);
-  confdata_storage_ = new(mem) confdata_sample_storage{confdata_sample_storage::allocator_type{*resource_}};
+  confdata_storage_ = new(mem) confdata_sample_storage{*resource_};
+  if (use_hash_index) {
+    mem = resource_->allocate(sizeof(*hash_index_));
+    php_assert(mem);
+    hash_index_ = new(mem) ConfdataHashIndex{};
+  }
 }
 
 void ConfdataSample::reset(confdata_sample_storage &&new_confdata) noexcept {
   clear();
   *confdata_storage_ = std::move(new_confdata);
+  if (hash_index_) {
+    warn_on_hash_index_failure(hash_index_->build(*confdata_storage_, *resource_));
+  }
+}
+
+void ConfdataSample::reset(confdata_sample_storage &&new_confdata, const ConfdataSample &previous,
+                           const ConfdataHashIndex::Changes &changes) noexcept {
+  php_assert(&previous != this);
+  clear();
+  *confdata_storage_ = std::move(new_confdata);
+  if (hash_index_) {
+    warn_on_hash_index_failure(hash_index_->update(*previous.hash_index_, *confdata_storage_, changes, *resource_));
+  }
+}
+
+void ConfdataSample::warn_on_hash_index_failure(bool index_ready) const noexcept {
+  if (!index_ready) {
+    php_warning("Can't allocate the confdata hash index for %zu elements, the ordered storage is used for lookups",
+                confdata_storage_->size());
+  }
 }
 
 void ConfdataSample::clear() noexcept {
   php_assert(confdata_storage_);
+  if (hash_index_) {
+    hash_index_->clear(*resource_);
+  }
   confdata_storage_->clear();
 
   if (garbage_) {
@@ -72,8 +100,13 @@ void ConfdataSample::destroy() noexcept {
   php_assert(!resource_ == !confdata_storage_);
   if (resource_) {
     clear();
-    confdata_storage_->~map();
+    confdata_storage_->~confdata_sample_storage();
     resource_->deallocate(confdata_storage_, sizeof(*confdata_storage_));
+    if (hash_index_) {
+      hash_index_->~ConfdataHashIndex();
+      resource_->deallocate(hash_index_, sizeof(*hash_index_));
+      hash_index_ = nullptr;
+    }
 
     confdata_storage_ = nullptr;
     resource_ = nullptr;
@@ -95,9 +128,10 @@ ConfdataGlobalManager &ConfdataGlobalManager::get() noexcept {
 
 void ConfdataGlobalManager::init(size_t confdata_memory_limit,
                                  std::unordered_set<vk::string_view> &&predefined_wilrdcards,
-                                 std::unique_ptr<re2::RE2> &&blacklist_pattern) noexcept {
+                                 std::unique_ptr<re2::RE2> &&blacklist_pattern,
+                                 bool use_hash_index) noexcept {
   resource_.init(mmap_shared(confdata_memory_limit), confdata_memory_limit);
-  confdata_samples_.init(resource_);
+  confdata_samples_.init(resource_, use_hash_index);
   predefined_wildcards_.set_wildcards(std::move(predefined_wilrdcards));
   key_blacklist_.set_blacklist(std::move(blacklist_pattern));
 }
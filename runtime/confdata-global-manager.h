@@ -9,14 +9,13 @@
 #include "common/mixin/not_copyable.h"
 #include "common/wrappers/string_view.h"
 
+#include "runtime/confdata-hash-index.h"
 #include "runtime/confdata-keys.h"
+#include "runtime/confdata-persistent-storage.h"
 #include "runtime/inter-process-resource.h"
 #include "runtime/kphp_core.h"
-#include "runtime/memory_resource/resource_allocator.h"
 #include "runtime/memory_resource/unsynchronized_pool_resource.h"
 
-using confdata_sample_storage = memory_resource::stl::map<string, mixed, memory_resource::unsynchronized_pool_resource, stl_string_less>;
-
 enum class ConfdataGarbageDestroyWay {
   shallow_first,
   deep_last
@@ -29,8 +28,11 @@ struct ConfdataGarbageNode {
 
 class ConfdataSample : vk::not_copyable {
 public:
-  void init(memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  void init(memory_resource::unsynchronized_pool_resource &resource, bool use_hash_index) noexcept;
   void reset(confdata_sample_storage &&new_confdata) noexcept;
+  // the hash index is built from the index of the previous sample, which must be alive
+  void reset(confdata_sample_storage &&new_confdata, const ConfdataSample &previous,
+             const ConfdataHashIndex::Changes &changes) noexcept;
   void clear() noexcept;
   void destroy() noexcept;
 
@@ -40,9 +42,24 @@ public:
     return *confdata_storage_;
   }
 
+  const confdata_sample_storage::value_type *find(const string &key) const noexcept {
+    if (hash_index_ && !hash_index_->empty()) {
+      return hash_index_->find(key);
+    }
+    return confdata_storage_->find(key);
+  }
+
+  size_t get_hash_index_memory_used() const noexcept {
+    return hash_index_ ? hash_index_->get_memory_used() : 0;
+  }
+
 private:
+  void warn_on_hash_index_failure(bool index_ready) const noexcept;
+
   memory_resource::unsynchronized_pool_resource *resource_{nullptr};
   confdata_sample_storage *confdata_storage_{nullptr};
+  // lives in the shared memory as the storage does, so workers see the index of the new sample
+  ConfdataHashIndex *hash_index_{nullptr};
   std::forward_list<ConfdataGarbageNode> *garbage_{nullptr};
 };
 
@@ -52,7 +69,8 @@ public:
 
   void init(size_t confdata_memory_limit,
     std::unordered_set<vk::string_view> &&predefined_wilrdcards,
-            std::unique_ptr<re2::RE2> &&blacklist_pattern) noexcept;
+            std::unique_ptr<re2::RE2> &&blacklist_pattern,
+            bool use_hash_index) noexcept;
 
   void force_release_all_resources_acquired_by_this_proc_if_init() noexcept {
     if (is_initialized()) {
@@ -76,8 +94,8 @@ public:
     return confdata_samples_.is_next_resource_unused();
   }
 
-  bool try_switch_to_next_sample(confdata_sample_storage &&confdata_storage) noexcept {
-    return confdata_samples_.try_switch_to_next_unused_resource(std::move(confdata_storage));
+  bool try_switch_to_next_sample(confdata_sample_storage &&confdata_storage, const ConfdataHashIndex::Changes &changes) noexcept {
+    return confdata_samples_.try_switch_to_next_unused_resource(std::move(confdata_storage), get_current(), changes);
   }
 
   void clear_unused_samples() noexcept {
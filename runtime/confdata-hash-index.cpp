@@ -0,0 +1,183 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "runtime/confdata-hash-index.h"
+
+#include <cstring>
+
+#include "runtime/php_assert.h"
+
+namespace {
+
+// the resource raises the out of memory signal on a huge piece allocation failure, check the limit in advance
+bool has_free_memory(const memory_resource::unsynchronized_pool_resource &resource, size_t size) noexcept {
+  const auto memory_stats = resource.get_memory_stats();
+  return memory_stats.memory_limit - memory_stats.memory_used >= size;
+}
+
+} // namespace
+
+bool ConfdataHashIndex::build(const confdata_sample_storage &storage, memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  php_assert(!pages_);
+  if (storage.empty()) {
+    return true;
+  }
+
+  // the load factor is kept under 0.5, the probe sequences are short enough for the linear probing
+  size_t slots_count = PAGE_SLOTS;
+  while (slots_count < storage.size() * 2) {
+    slots_count *= 2;
+  }
+  const size_t pages_count = slots_count / PAGE_SLOTS;
+  if (!has_free_memory(resource, pages_count * (sizeof(Page) + sizeof(Page *)))) {
+    return false;
+  }
+  pages_ = static_cast<Page **>(resource.allocate(pages_count * sizeof(Page *)));
+  php_assert(pages_);
+  for (size_t i = 0; i < pages_count; ++i) {
+    pages_[i] = static_cast<Page *>(resource.allocate(sizeof(Page)));
+    php_assert(pages_[i]);
+    std::memset(pages_[i], 0, sizeof(Page));
+    pages_[i]->ref_cnt = 1;
+  }
+  mask_ = slots_count - 1;
+  size_ = storage.size();
+
+  for (const auto &element : storage) {
+    const auto hash = static_cast<uint64_t>(element.first.hash());
+    size_t i = hash & mask_;
+    while (get_slot(i).element) {
+      i = (i + 1) & mask_;
+    }
+    pages_[i / PAGE_SLOTS]->slots[i % PAGE_SLOTS] = Slot{hash, &element};
+  }
+  return true;
+}
+
+bool ConfdataHashIndex::update(const ConfdataHashIndex &previous, const confdata_sample_storage &storage, const Changes &changes,
+                               memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  php_assert(!pages_);
+  // the storage size bounds the index size in between, as the erased keys are processed first
+  if (previous.empty() || storage.size() * 2 > previous.capacity() ||
+      (previous.capacity() > PAGE_SLOTS && storage.size() * 8 < previous.capacity())) {
+    return build(storage, resource);
+  }
+
+  // the pages directory is PAGE_SLOTS times smaller than the index, it isn't shared for simplicity
+  const size_t pages_count = previous.pages_count();
+  if (!has_free_memory(resource, pages_count * sizeof(Page *))) {
+    return false;
+  }
+  pages_ = static_cast<Page **>(resource.allocate(pages_count * sizeof(Page *)));
+  php_assert(pages_);
+  for (size_t i = 0; i < pages_count; ++i) {
+    pages_[i] = previous.pages_[i];
+    ++pages_[i]->ref_cnt;
+  }
+  mask_ = previous.mask_;
+  size_ = previous.size_;
+
+  for (const auto &key : changes.erased_keys) {
+    if (!erase(vk::string_view{key}, resource)) {
+      clear(resource);
+      return false;
+    }
+  }
+  for (const auto *element : changes.updated_elements) {
+    if (!upsert(element, resource)) {
+      clear(resource);
+      return false;
+    }
+  }
+  php_assert(size_ == storage.size());
+  return true;
+}
+
+void ConfdataHashIndex::clear(memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  if (pages_) {
+    for (size_t i = 0; i < pages_count(); ++i) {
+      if (--pages_[i]->ref_cnt == 0) {
+        resource.deallocate(pages_[i], sizeof(Page));
+      }
+    }
+    resource.deallocate(pages_, pages_count() * sizeof(Page *));
+    pages_ = nullptr;
+    mask_ = 0;
+    size_ = 0;
+  }
+}
+
+ConfdataHashIndex::Slot *ConfdataHashIndex::own_slot(size_t i, memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  Page *&page = pages_[i / PAGE_SLOTS];
+  if (page->ref_cnt > 1) {
+    if (!has_free_memory(resource, sizeof(Page))) {
+      return nullptr;
+    }
+    auto *page_copy = static_cast<Page *>(resource.allocate(sizeof(Page)));
+    php_assert(page_copy);
+    std::memcpy(page_copy, page, sizeof(Page));
+    page_copy->ref_cnt = 1;
+    --page->ref_cnt;
+    page = page_copy;
+  }
+  return &page->slots[i % PAGE_SLOTS];
+}
+
+bool ConfdataHashIndex::upsert(const element_type *element, memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  const auto hash = static_cast<uint64_t>(element->first.hash());
+  for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+    const Slot &slot = get_slot(i);
+    const bool is_free = !slot.element;
+    if (is_free || (slot.hash == hash && slot.element->first == element->first)) {
+      if (slot.element == element) {
+        return true;
+      }
+      Slot *owned_slot = own_slot(i, resource);
+      if (!owned_slot) {
+        return false;
+      }
+      *owned_slot = Slot{hash, element};
+      size_ += is_free;
+      return true;
+    }
+  }
+}
+
+bool ConfdataHashIndex::erase(vk::string_view key, memory_resource::unsynchronized_pool_resource &resource) noexcept {
+  const auto hash = static_cast<uint64_t>(string_hash(key.data(), key.size()));
+  size_t i = hash & mask_;
+  for (;; i = (i + 1) & mask_) {
+    const Slot &slot = get_slot(i);
+    if (!slot.element) {
+      return true;
+    }
+    if (slot.hash == hash && vk::string_view{slot.element->first.c_str(), slot.element->first.size()} == key) {
+      break;
+    }
+  }
+
+  // the backward shift deletion: the next elements of the cluster are moved to the hole if their probe sequence passes it
+  for (size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+    const Slot next = get_slot(j);
+    if (!next.element) {
+      break;
+    }
+    const size_t home = next.hash & mask_;
+    if (((j - home) & mask_) >= ((j - i) & mask_)) {
+      Slot *hole = own_slot(i, resource);
+      if (!hole) {
+        return false;
+      }
+      *hole = next;
+      i = j;
+    }
+  }
+  Slot *hole = own_slot(i, resource);
+  if (!hole) {
+    return false;
+  }
+  *hole = Slot{};
+  --size_;
+  return true;
+}
@@ -0,0 +1,100 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/mixin/not_copyable.h"
+#include "common/wrappers/string_view.h"
+
+#include "runtime/confdata-persistent-storage.h"
+#include "runtime/kphp_core.h"
+#include "runtime/memory_resource/unsynchronized_pool_resource.h"
+
+// An open addressing (linear probing) index over the confdata sample storage.
+// It is built by the master and is read-only for the workers,
+// so the lookup is a single hash computation and a few cache lines instead of the tree walk.
+// The storage itself remains the ordered (prefix) index for the wildcard lookups.
+// The slots are split into the pages shared by the indexes of the neighbouring samples:
+// the index of the next sample copies only the pages with the changed slots, as the storage copies only the changed paths.
+class ConfdataHashIndex : vk::not_copyable {
+public:
+  using element_type = confdata_sample_storage::value_type;
+
+  // the storage changes since the sample of the previous index
+  struct Changes {
+    // the elements with the new addresses, i.e. visited by confdata_sample_storage::commit_updates()
+    std::vector<const element_type *> updated_elements;
+    std::vector<std::string> erased_keys;
+  };
+
+  // returns false if there is no memory for the index, the index stays empty in this case
+  bool build(const confdata_sample_storage &storage, memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  // builds the index for the storage from the previous one, which must be alive and isn't changed;
+  // falls back to build() if the previous index is empty or its capacity doesn't fit the storage size
+  bool update(const ConfdataHashIndex &previous, const confdata_sample_storage &storage, const Changes &changes,
+              memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  void clear(memory_resource::unsynchronized_pool_resource &resource) noexcept;
+
+  bool empty() const noexcept {
+    return !pages_;
+  }
+
+  const element_type *find(const string &key) const noexcept {
+    const auto hash = static_cast<uint64_t>(key.hash());
+    for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+      const Slot &slot = get_slot(i);
+      if (!slot.element) {
+        return nullptr;
+      }
+      if (slot.hash == hash && slot.element->first == key) {
+        return slot.element;
+      }
+    }
+  }
+
+  // the shared pages are counted too
+  size_t get_memory_used() const noexcept {
+    return pages_ ? pages_count() * (sizeof(Page) + sizeof(Page *)) : 0;
+  }
+
+private:
+  struct Slot {
+    uint64_t hash;
+    const element_type *element;
+  };
+
+  static constexpr size_t PAGE_SLOTS = 256;
+
+  struct Page {
+    // only the master changes it, the workers read the slots only
+    size_t ref_cnt;
+    std::array<Slot, PAGE_SLOTS> slots;
+  };
+
+  size_t capacity() const noexcept {
+    return mask_ + 1;
+  }
+
+  size_t pages_count() const noexcept {
+    return capacity() / PAGE_SLOTS;
+  }
+
+  const Slot &get_slot(size_t i) const noexcept {
+    return pages_[i / PAGE_SLOTS]->slots[i % PAGE_SLOTS];
+  }
+
+  // copies the page of the slot if it is shared, returns nullptr if there is no memory for the copy
+  Slot *own_slot(size_t i, memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  bool upsert(const element_type *element, memory_resource::unsynchronized_pool_resource &resource) noexcept;
+  bool erase(vk::string_view key, memory_resource::unsynchronized_pool_resource &resource) noexcept;
+
+  Page **pages_{nullptr};
+  size_t mask_{0};
+  size_t size_{0};
+};
@@ -0,0 +1,278 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "runtime/confdata-persistent-storage.h"
+
+#include <algorithm>
+
+#include "runtime/php_assert.h"
+
+ConfdataPersistentStorage::const_iterator &ConfdataPersistentStorage::const_iterator::operator++() noexcept {
+  const Node *node = stack_[--depth_];
+  push_left_path(node->right);
+  return *this;
+}
+
+void ConfdataPersistentStorage::const_iterator::push_left_path(const Node *node) noexcept {
+  for (; node; node = node->left) {
+    php_assert(depth_ < stack_.size());
+    stack_[depth_++] = node;
+  }
+}
+
+ConfdataPersistentStorage::ConfdataPersistentStorage(const ConfdataPersistentStorage &other) noexcept:
+  resource_(other.resource_),
+  root_(other.root_),
+  size_(other.size_) {
+  if (root_) {
+    ++root_->ref_cnt;
+  }
+}
+
+ConfdataPersistentStorage::ConfdataPersistentStorage(ConfdataPersistentStorage &&other) noexcept:
+  resource_(other.resource_),
+  root_(std::exchange(other.root_, nullptr)),
+  size_(std::exchange(other.size_, 0)),
+  updated_nodes_memory_(std::exchange(other.updated_nodes_memory_, 0)) {
+}
+
+ConfdataPersistentStorage &ConfdataPersistentStorage::operator=(const ConfdataPersistentStorage &other) noexcept {
+  if (this != &other) {
+    if (other.root_) {
+      ++other.root_->ref_cnt;
+    }
+    release(root_);
+    resource_ = other.resource_;
+    root_ = other.root_;
+    size_ = other.size_;
+  }
+  return *this;
+}
+
+ConfdataPersistentStorage &ConfdataPersistentStorage::operator=(ConfdataPersistentStorage &&other) noexcept {
+  if (this != &other) {
+    release(root_);
+    resource_ = other.resource_;
+    root_ = std::exchange(other.root_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    updated_nodes_memory_ = std::exchange(other.updated_nodes_memory_, 0);
+  }
+  return *this;
+}
+
+ConfdataPersistentStorage::~ConfdataPersistentStorage() noexcept {
+  clear();
+}
+
+ConfdataPersistentStorage::const_iterator ConfdataPersistentStorage::begin() const noexcept {
+  const_iterator it;
+  it.push_left_path(root_);
+  return it;
+}
+
+ConfdataPersistentStorage::const_iterator ConfdataPersistentStorage::lower_bound(const string &key) const noexcept {
+  // the stack keeps the nodes, which are greater than the key, on the path from the root
+  const_iterator it;
+  for (const Node *node = root_; node;) {
+    const int64_t cmp = key.compare(node->value.first);
+    if (cmp > 0) {
+      node = node->right;
+      continue;
+    }
+    php_assert(it.depth_ < it.stack_.size());
+    it.stack_[it.depth_++] = node;
+    if (cmp == 0) {
+      break;
+    }
+    node = node->left;
+  }
+  return it;
+}
+
+const ConfdataPersistentStorage::value_type *ConfdataPersistentStorage::find(const string &key) const noexcept {
+  for (const Node *node = root_; node;) {
+    const int64_t cmp = key.compare(node->value.first);
+    if (cmp == 0) {
+      return &node->value;
+    }
+    node = cmp < 0 ? node->left : node->right;
+  }
+  return nullptr;
+}
+
+ConfdataPersistentStorage::value_type &ConfdataPersistentStorage::find_for_update(const string &key) noexcept {
+  const size_t size_before = size_;
+  Node *found = nullptr;
+  root_ = insert(root_, key, found);
+  php_assert(size_before == size_);
+  return found->value;
+}
+
+ConfdataPersistentStorage::value_type &ConfdataPersistentStorage::insert(const string &key) noexcept {
+  Node *found = nullptr;
+  root_ = insert(root_, key, found);
+  return found->value;
+}
+
+void ConfdataPersistentStorage::erase(const string &key) noexcept {
+  // do not copy the path if there is nothing to erase
+  if (find(key)) {
+    root_ = erase(root_, key);
+    --size_;
+  }
+}
+
+void ConfdataPersistentStorage::clear() noexcept {
+  release(root_);
+  root_ = nullptr;
+  size_ = 0;
+}
+
+void ConfdataPersistentStorage::update_height(Node *node) noexcept {
+  node->height = static_cast<uint8_t>(std::max(height(node->left), height(node->right)) + 1);
+}
+
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::make_node(const string &key) noexcept {
+  auto *mem = resource_->allocate(sizeof(Node));
+  php_assert(mem);
+  updated_nodes_memory_ += sizeof(Node);
+  return new(mem) Node{value_type{key, mixed{}}};
+}
+
+// returns the node, which can be modified in place: the node itself if it is referenced only by the caller, or its copy
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::own(Node *node) noexcept {
+  if (node->ref_cnt == 1) {
+    node->updated = true;
+    return node;
+  }
+  auto *mem = resource_->allocate(sizeof(Node));
+  php_assert(mem);
+  updated_nodes_memory_ += sizeof(Node);
+  auto *copy = new(mem) Node{node->value, node->left, node->right};
+  copy->height = node->height;
+  if (copy->left) {
+    ++copy->left->ref_cnt;
+  }
+  if (copy->right) {
+    ++copy->right->ref_cnt;
+  }
+  --node->ref_cnt;
+  return copy;
+}
+
+void ConfdataPersistentStorage::release(Node *node) noexcept {
+  if (node && --node->ref_cnt == 0) {
+    release(node->left);
+    release(node->right);
+    node->~Node();
+    resource_->deallocate(node, sizeof(Node));
+  }
+}
+
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::rotate_left(Node *node) noexcept {
+  Node *right = own(node->right);
+  node->right = right->left;
+  right->left = node;
+  update_height(node);
+  update_height(right);
+  return right;
+}
+
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::rotate_right(Node *node) noexcept {
+  Node *left = own(node->left);
+  node->left = left->right;
+  left->right = node;
+  update_height(node);
+  update_height(left);
+  return left;
+}
+
+// the node must be owned
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::balance(Node *node) noexcept {
+  update_height(node);
+  const int balance_factor = height(node->left) - height(node->right);
+  if (balance_factor > 1) {
+    if (height(node->left->left) < height(node->left->right)) {
+      node->left = rotate_left(own(node->left));
+    }
+    return rotate_right(node);
+  }
+  if (balance_factor < -1) {
+    if (height(node->right->right) < height(node->right->left)) {
+      node->right = rotate_right(own(node->right));
+    }
+    return rotate_left(node);
+  }
+  return node;
+}
+
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::insert(Node *node, const string &key, Node *&found) noexcept {
+  if (!node) {
+    ++size_;
+    found = make_node(key);
+    return found;
+  }
+  const int64_t cmp = key.compare(node->value.first);
+  node = own(node);
+  if (cmp == 0) {
+    found = node;
+    return node;
+  }
+  if (cmp < 0) {
+    node->left = insert(node->left, key, found);
+  } else {
+    node->right = insert(node->right, key, found);
+  }
+  return balance(node);
+}
+
+// the key must exist
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::erase(Node *node, const string &key) noexcept {
+  php_assert(node);
+  const int64_t cmp = key.compare(node->value.first);
+  if (cmp != 0) {
+    node = own(node);
+    if (cmp < 0) {
+      node->left = erase(node->left, key);
+    } else {
+      node->right = erase(node->right, key);
+    }
+    return balance(node);
+  }
+
+  Node *left = node->left;
+  Node *right = node->right;
+  if (node->ref_cnt == 1) {
+    node->left = nullptr;
+    node->right = nullptr;
+  } else {
+    // the node is still used by another storage, take the references to its children
+    if (left) {
+      ++left->ref_cnt;
+    }
+    if (right) {
+      ++right->ref_cnt;
+    }
+  }
+  release(node);
+
+  if (!left || !right) {
+    return left ? left : right;
+  }
+  Node *min_node = nullptr;
+  right = extract_min(right, min_node);
+  min_node->left = left;
+  min_node->right = right;
+  return balance(min_node);
+}
+
+ConfdataPersistentStorage::Node *ConfdataPersistentStorage::extract_min(Node *node, Node *&min_node) noexcept {
+  node = own(node);
+  if (!node->left) {
+    min_node = node;
+    return std::exchange(node->right, nullptr);
+  }
+  node->left = extract_min(node->left, min_node);
+  return balance(node);
+}
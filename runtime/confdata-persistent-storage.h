@@ -0,0 +1,132 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "runtime/kphp_core.h"
+#include "runtime/memory_resource/unsynchronized_pool_resource.h"
+
+// An ordered string -> mixed storage, which is a persistent (path copying) AVL tree.
+// A copy of the storage shares all the nodes with the original,
+// the first update of a shared node copies the path from the root to it.
+// Therefore, the next confdata sample is prepared with O(updated keys * log(size)) allocations,
+// and untouched subtrees are shared by the neighbouring samples.
+// All modifications are expected to be done by the single process (the master),
+// other processes only read the storage.
+class ConfdataPersistentStorage {
+  struct Node;
+
+public:
+  using value_type = std::pair<const string, mixed>;
+
+  class const_iterator {
+  public:
+    // keep the stack uninitialized, end() is called on every iteration
+    const_iterator() noexcept {}
+
+    const value_type &operator*() const noexcept { return stack_[depth_ - 1]->value; }
+    const value_type *operator->() const noexcept { return &stack_[depth_ - 1]->value; }
+
+    const_iterator &operator++() noexcept;
+
+    bool operator==(const const_iterator &other) const noexcept {
+      return depth_ == other.depth_ && (!depth_ || stack_[depth_ - 1] == other.stack_[depth_ - 1]);
+    }
+    bool operator!=(const const_iterator &other) const noexcept { return !(*this == other); }
+
+  private:
+    friend class ConfdataPersistentStorage;
+
+    void push_left_path(const Node *node) noexcept;
+
+    // the AVL tree height is less than 1.45 * log2(size + 2)
+    std::array<const Node *, 64> stack_;
+    uint32_t depth_{0};
+  };
+
+  explicit ConfdataPersistentStorage(memory_resource::unsynchronized_pool_resource &resource) noexcept:
+    resource_(&resource) {
+  }
+
+  ConfdataPersistentStorage(const ConfdataPersistentStorage &other) noexcept;
+  ConfdataPersistentStorage(ConfdataPersistentStorage &&other) noexcept;
+  ConfdataPersistentStorage &operator=(const ConfdataPersistentStorage &other) noexcept;
+  ConfdataPersistentStorage &operator=(ConfdataPersistentStorage &&other) noexcept;
+  ~ConfdataPersistentStorage() noexcept;
+
+  const_iterator begin() const noexcept;
+  const_iterator end() const noexcept { return {}; }
+  const_iterator lower_bound(const string &key) const noexcept;
+
+  const value_type *find(const string &key) const noexcept;
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return !size_; }
+
+  // the element must exist; its node (and the path to it) is copied if it is shared with another storage
+  value_type &find_for_update(const string &key) noexcept;
+  // inserts an element with null value if the key doesn't exist
+  value_type &insert(const string &key) noexcept;
+  void erase(const string &key) noexcept;
+  void clear() noexcept;
+
+  mixed &operator[](const string &key) noexcept {
+    return insert(key).second;
+  }
+
+  // visits the elements inserted or updated since the previous commit and returns the memory allocated for their nodes,
+  // the visited nodes are expected to be shared with the other storages after that
+  template<class F>
+  size_t commit_updates(const F &visitor) noexcept {
+    commit_updates_impl(root_, visitor);
+    return std::exchange(updated_nodes_memory_, 0);
+  }
+
+private:
+  struct Node {
+    value_type value;
+    Node *left{nullptr};
+    Node *right{nullptr};
+    uint32_t ref_cnt{1};
+    uint8_t height{1};
+    bool updated{true};
+  };
+
+  template<class F>
+  static void commit_updates_impl(Node *node, const F &visitor) noexcept {
+    // the updated nodes are copied with all their ancestors, so the not updated subtrees can be skipped
+    if (node && node->updated) {
+      node->updated = false;
+      visitor(node->value);
+      commit_updates_impl(node->left, visitor);
+      commit_updates_impl(node->right, visitor);
+    }
+  }
+
+  static uint8_t height(const Node *node) noexcept { return node ? node->height : 0; }
+  static void update_height(Node *node) noexcept;
+
+  Node *make_node(const string &key) noexcept;
+  Node *own(Node *node) noexcept;
+  void release(Node *node) noexcept;
+
+  Node *rotate_left(Node *node) noexcept;
+  Node *rotate_right(Node *node) noexcept;
+  Node *balance(Node *node) noexcept;
+
+  Node *insert(Node *node, const string &key, Node *&found) noexcept;
+  Node *erase(Node *node, const string &key) noexcept;
+  Node *extract_min(Node *node, Node *&min_node) noexcept;
+
+  memory_resource::unsynchronized_pool_resource *resource_{nullptr};
+  Node *root_{nullptr};
+  size_t size_{0};
+  size_t updated_nodes_memory_{0};
+};
+
+using confdata_sample_storage = ConfdataPersistentStorage;
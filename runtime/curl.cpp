@@ -9,15 +9,20 @@
 #include <curl/curl.h>
 #include <curl/easy.h>
 #include <curl/multi.h>
+#include <poll.h>
 
 #include "runtime/critical_section.h"
 #include "runtime/interface.h"
+#include "runtime/net_events.h"
+#include "runtime/resumable.h"
 #include "runtime/string-list.h"
 
 #include "common/macos-ports.h"
 #include "common/smart_ptrs/singleton.h"
 #include "common/wrappers/to_array.h"
 
+#include "server/curl-sockets.h"
+
 static_assert(LIBCURL_VERSION_NUM >= 0x071c00, "Outdated libcurl");
 static_assert(CURL_MAX_WRITE_SIZE <= (1 << 30), "CURL_MAX_WRITE_SIZE expected to be less than (1 << 30)");
 
@@ -33,11 +38,22 @@ static_assert(CURLM_BAD_SOCKET == 5, "check value");
 static_assert(CURLM_UNKNOWN_OPTION == 6, "check value");
 static_assert(CURLM_ADDED_ALREADY == 7, "check value");
 
+static_assert(CURL_CSELECT_IN == curl_socket_readable, "check value");
+static_assert(CURL_CSELECT_OUT == curl_socket_writable, "check value");
+static_assert(CURL_CSELECT_ERR == curl_socket_failed, "check value");
+
 namespace {
 
 constexpr int64_t BAD_CURL_OPTION = static_cast<int>(CURL_LAST) + static_cast<int>(CURL_FORMADD_LAST);
+// curl_exec waits for the transfer no longer than that, if CURLOPT_TIMEOUT is not set
+constexpr double CURL_EXEC_DEFAULT_TIMEOUT = 300.0;
 
 size_t curl_write(char *data, size_t size, size_t nmemb, void *userdata);
+int curl_socket_callback(CURL *, curl_socket_t fd, int what, void *userp, void *);
+int curl_multi_socket_callback(CURL *, curl_socket_t fd, int what, void *userp, void *);
+int curl_timer_callback(CURLM *, long timeout_ms, void *userp);
+
+int curl_timeout_wakeup_id{-1};
 
 class BaseContext : vk::not_copyable {
 public:
@@ -159,8 +175,20 @@ public:
     dl::deallocate(this, sizeof(EasyContext));
   }
 
+  bool is_executing() const noexcept {
+    return exec_ready_resumable_id != 0;
+  }
+
+  double get_exec_timeout() const noexcept {
+    return exec_timeout > 0 ? exec_timeout : CURL_EXEC_DEFAULT_TIMEOUT;
+  }
+
   CURL *easy_handle{nullptr};
   const int64_t self_id{-1};
+  // forked resumable, which is run when the transfer started by curl_exec is done
+  int64_t exec_ready_resumable_id{0};
+  // CURLOPT_TIMEOUT or CURLOPT_TIMEOUT_MS in seconds, 0 means no timeout
+  double exec_timeout{0};
 
   string_list received_header;
   string_list received_data;
@@ -174,6 +202,17 @@ public:
 
 class MultiContext : public BaseContext {
 public:
+  // self_id == 0 is reserved for the internal multi handle, which performs curl_exec transfers
+  explicit MultiContext(int64_t self_handler_id) noexcept:
+    self_id(self_handler_id) {
+  }
+
+  template<class T>
+  void set_option(CURLMoption option, const T &value) noexcept {
+    const CURLMcode res = dl::critical_section_call([&] { return curl_multi_setopt(multi_handle, option, value); });
+    php_assert (res == CURLM_OK);
+  }
+
   template<typename T>
   int64_t set_option_safe(CURLMoption option, const T &value) noexcept {
     dl::CriticalSectionGuard critical_section;
@@ -181,19 +220,93 @@ public:
     return error_num;
   }
 
+  void set_socket_callbacks() noexcept {
+    set_option(CURLMOPT_SOCKETFUNCTION, curl_socket_callback);
+    set_option(CURLMOPT_SOCKETDATA, static_cast<void *>(this));
+    set_option(CURLMOPT_TIMERFUNCTION, curl_timer_callback);
+    set_option(CURLMOPT_TIMERDATA, static_cast<void *>(this));
+  }
+
+  void set_multi_socket_callback() noexcept {
+    set_option(CURLMOPT_SOCKETFUNCTION, curl_multi_socket_callback);
+    set_option(CURLMOPT_SOCKETDATA, static_cast<void *>(this));
+  }
+
+  void watch_socket(int fd, int64_t what) noexcept;
+  void unwatch_socket(int fd) noexcept;
+  void unwatch_all_sockets() noexcept;
+
+  void set_timer(double timeout) noexcept {
+    remove_timer();
+    update_precise_now();
+    timer = allocate_event_timer(get_precise_now() + timeout, curl_timeout_wakeup_id, static_cast<int>(self_id));
+  }
+
+  void remove_timer() noexcept {
+    if (timer) {
+      remove_event_timer(timer);
+      timer = nullptr;
+    }
+  }
+
+  // the reactor reports the first ready socket, the others are checked without waiting, as curl_multi_wait() counts them
+  int64_t count_ready_sockets() const noexcept {
+    int64_t ready_sockets = 0;
+    for (const auto &socket : sockets) {
+      const int64_t what = socket.get_value();
+      pollfd poll_fd{static_cast<int>(socket.get_key().to_int()),
+                     static_cast<short>(((what & CURL_POLL_IN) ? POLLIN : 0) | ((what & CURL_POLL_OUT) ? POLLOUT : 0)), 0};
+      if (poll(&poll_fd, 1, 0) > 0) {
+        ++ready_sockets;
+      }
+    }
+    return ready_sockets;
+  }
+
+  void finish_select(int64_t ready_sockets) noexcept {
+    remove_timer();
+    unwatch_all_sockets();
+    select_ready_sockets = ready_sockets;
+    if (const int64_t ready_resumable_id = std::exchange(select_ready_resumable_id, 0)) {
+      resumable_run_ready(ready_resumable_id);
+    }
+  }
+
   void release() noexcept {
+    remove_timer();
+    unwatch_all_sockets();
+    dl::CriticalSectionGuard critical_section;
+    curl_multi_setopt(multi_handle, CURLMOPT_SOCKETFUNCTION, nullptr);
+    curl_multi_setopt(multi_handle, CURLMOPT_TIMERFUNCTION, nullptr);
     curl_multi_cleanup(multi_handle);
     this->~MultiContext();
     dl::deallocate(this, sizeof(MultiContext));
   }
 
   CURLM *multi_handle{nullptr};
+  const int64_t self_id{0};
+
+  // the sockets watched by the net reactor: fd => CURL_POLL_* flags
+  array<int64_t> sockets;
+  // the sockets of the transfers of curl_multi_exec: fd => CURL_POLL_* flags,
+  // they are watched by the net reactor only during curl_multi_select
+  array<int64_t> curl_sockets;
+  kphp_event_timer *timer{nullptr};
+
+  // forked resumable, which is run when curl_multi_select is done
+  int64_t select_ready_resumable_id{0};
+  int64_t select_ready_sockets{0};
 };
 
 struct CurlContexts : vk::not_copyable {
   array<EasyContext *> easy_contexts;
   array<MultiContext *> multi_contexts;
 
+  // lazily created multi handle, which performs all curl_exec transfers through the net reactor
+  MultiContext *exec_multi_context{nullptr};
+  // fd => the multi context which watches it
+  array<MultiContext *> socket_owners;
+
   template<class T>
   T *get_value(int64_t id) const noexcept;
 
@@ -221,6 +334,240 @@ T *get_context(int64_t id) noexcept {
   return context;
 }
 
+EasyContext *get_easy_context_by_handle(CURL *easy_handle, int64_t *easy_id = nullptr) noexcept {
+  void *id_as_ptr = nullptr;
+  dl::critical_section_call([&] { curl_easy_getinfo (easy_handle, CURLINFO_PRIVATE, &id_as_ptr); });
+  const auto curl_handler_id = static_cast<int64_t>(reinterpret_cast<size_t>(id_as_ptr));
+  const auto *easy_context = vk::singleton<CurlContexts>::get().easy_contexts.find_value(curl_handler_id - 1);
+  if (easy_context && *easy_context && (*easy_context)->easy_handle == easy_handle) {
+    if (easy_id) {
+      *easy_id = curl_handler_id;
+    }
+    return *easy_context;
+  }
+  return nullptr;
+}
+
+void MultiContext::watch_socket(int fd, int64_t what) noexcept {
+  sockets.set_value(fd, what);
+  vk::singleton<CurlContexts>::get().socket_owners.set_value(fd, this);
+  curl_socket_watch(fd, what & CURL_POLL_IN, what & CURL_POLL_OUT);
+}
+
+void MultiContext::unwatch_socket(int fd) noexcept {
+  sockets.unset(fd);
+  auto &socket_owners = vk::singleton<CurlContexts>::get().socket_owners;
+  if (socket_owners.get_value(fd) == this) {
+    socket_owners.unset(fd);
+  }
+  curl_socket_unwatch(fd);
+}
+
+void MultiContext::unwatch_all_sockets() noexcept {
+  while (!sockets.empty()) {
+    unwatch_socket(static_cast<int>(sockets.begin().get_key().to_int()));
+  }
+}
+
+MultiContext *get_exec_multi_context() noexcept {
+  auto &exec_multi_context = vk::singleton<CurlContexts>::get().exec_multi_context;
+  if (!exec_multi_context) {
+    auto *multi_context = new(dl::allocate(sizeof(MultiContext))) MultiContext{0};
+    dl::critical_section_call([&multi_context] { multi_context->multi_handle = curl_multi_init(); });
+    if (unlikely(multi_context->multi_handle == nullptr)) {
+      dl::critical_section_call([&multi_context] { multi_context->release(); });
+      return nullptr;
+    }
+    multi_context->set_socket_callbacks();
+    exec_multi_context = multi_context;
+  }
+  return exec_multi_context;
+}
+
+// this is a callback called from curl_multi_socket_action, curl_multi_add_handle and curl_multi_remove_handle
+int curl_socket_callback(CURL *, curl_socket_t fd, int what, void *userp, void *) {
+  auto *multi_context = static_cast<MultiContext *>(userp);
+  if (what == CURL_POLL_REMOVE) {
+    multi_context->unwatch_socket(fd);
+  } else {
+    multi_context->watch_socket(fd, what);
+  }
+  return 0;
+}
+
+// this is a callback called from curl_multi_socket_action and curl_multi_remove_handle of the curl_multi_init handles
+int curl_multi_socket_callback(CURL *, curl_socket_t fd, int what, void *userp, void *) {
+  auto *multi_context = static_cast<MultiContext *>(userp);
+  if (what == CURL_POLL_REMOVE) {
+    multi_context->curl_sockets.unset(fd);
+    if (multi_context->sockets.has_key(fd)) {
+      multi_context->unwatch_socket(fd);
+    }
+  } else {
+    multi_context->curl_sockets.set_value(fd, what);
+    // curl_multi_exec may be called by another fork during the select
+    if (multi_context->select_ready_resumable_id) {
+      multi_context->watch_socket(fd, what);
+    }
+  }
+  return 0;
+}
+
+// this is a callback called from curl_multi_socket_action, curl_multi_add_handle and curl_multi_remove_handle
+int curl_timer_callback(CURLM *, long timeout_ms, void *userp) {
+  auto *multi_context = static_cast<MultiContext *>(userp);
+  if (timeout_ms < 0) {
+    multi_context->remove_timer();
+  } else {
+    // zero timeout means 'as soon as possible', but event timers can't be set to the current time
+    multi_context->set_timer(std::max(timeout_ms, 1L) * 0.001);
+  }
+  return 0;
+}
+
+void finish_exec_transfers(MultiContext *exec_multi_context) noexcept {
+  int msgs_in_queue = 0;
+  while (CURLMsg *msg = dl::critical_section_call(curl_multi_info_read, exec_multi_context->multi_handle, &msgs_in_queue)) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    CURL *easy_handle = msg->easy_handle;
+    const CURLcode result = msg->data.result;
+    dl::critical_section_call(curl_multi_remove_handle, exec_multi_context->multi_handle, easy_handle);
+    if (auto *easy_context = get_easy_context_by_handle(easy_handle)) {
+      easy_context->error_num = result;
+      if (const int64_t ready_resumable_id = std::exchange(easy_context->exec_ready_resumable_id, 0)) {
+        resumable_run_ready(ready_resumable_id);
+      }
+    }
+  }
+}
+
+void exec_socket_action(MultiContext *exec_multi_context, curl_socket_t fd, int ready_flags) noexcept {
+  int running_handles = 0;
+  dl::critical_section_call(curl_multi_socket_action, exec_multi_context->multi_handle, fd, ready_flags, &running_handles);
+  if (fd != CURL_SOCKET_TIMEOUT && exec_multi_context->sockets.has_key(fd)) {
+    // the reactor watches sockets in one-shot mode
+    exec_multi_context->watch_socket(fd, exec_multi_context->sockets.get_value(fd));
+  }
+  finish_exec_transfers(exec_multi_context);
+}
+
+void process_curl_timeout(kphp_event_timer *timer) {
+  auto &contexts = vk::singleton<CurlContexts>::get();
+  MultiContext *multi_context = timer->wakeup_extra == 0
+                                ? contexts.exec_multi_context
+                                : contexts.get_value<MultiContext>(timer->wakeup_extra);
+  php_assert(multi_context && multi_context->timer == timer);
+  multi_context->remove_timer();
+  if (multi_context == contexts.exec_multi_context) {
+    exec_socket_action(multi_context, CURL_SOCKET_TIMEOUT, 0);
+  } else {
+    multi_context->finish_select(0);
+  }
+}
+
+// a forked resumable, which is run by the net events processing, when the awaited transfer or socket is ready
+class curl_ready_resumable final : public Resumable {
+  using ReturnT = bool;
+
+protected:
+  bool run() final {
+    RETURN(true);
+  }
+};
+
+mixed get_curl_exec_result(EasyContext *easy_context) noexcept {
+  if (easy_context->error_num != CURLE_OK && easy_context->error_num != CURLE_PARTIAL_FILE) {
+    return false;
+  }
+
+  if (easy_context->return_transfer) {
+    return easy_context->received_data.concat_and_get_string();
+  }
+
+  return true;
+}
+
+// libcurl checks CURLOPT_TIMEOUT on its timer too, this one doesn't let the script wait forever, if it doesn't fire
+void abort_exec_transfer(EasyContext *easy_context) noexcept {
+  const int64_t ready_resumable_id = std::exchange(easy_context->exec_ready_resumable_id, 0);
+  if (!ready_resumable_id) {
+    return;
+  }
+  dl::critical_section_call(curl_multi_remove_handle, vk::singleton<CurlContexts>::get().exec_multi_context->multi_handle, easy_context->easy_handle);
+  easy_context->error_num = CURLE_OPERATION_TIMEDOUT;
+  resumable_run_ready(ready_resumable_id);
+}
+
+class curl_exec_resumable final : public Resumable {
+public:
+  curl_exec_resumable(curl_easy easy_id, int64_t ready_resumable_id, double timeout) noexcept:
+    easy_id_(easy_id),
+    ready_resumable_id_(ready_resumable_id),
+    timeout_(timeout) {
+  }
+
+private:
+  using ReturnT = mixed;
+
+  bool run() final {
+    RESUMABLE_BEGIN
+      ready_ = wait_without_result(ready_resumable_id_, timeout_);
+      TRY_WAIT(curl_exec_resumable_label_0, ready_, bool);
+      if (ready_) {
+        get_forked_storage(ready_resumable_id_)->load<bool>();
+      }
+      // the handle may be closed while waiting
+      auto *easy_context = vk::singleton<CurlContexts>::get().get_value<EasyContext>(easy_id_);
+      if (!easy_context) {
+        RETURN(false);
+      }
+      if (!ready_) {
+        abort_exec_transfer(easy_context);
+        RETURN(false);
+      }
+      RETURN(get_curl_exec_result(easy_context));
+    RESUMABLE_END
+  }
+
+  curl_easy easy_id_{0};
+  int64_t ready_resumable_id_{0};
+  double timeout_{0};
+  bool ready_{false};
+};
+
+class curl_multi_select_resumable final : public Resumable {
+public:
+  curl_multi_select_resumable(curl_multi multi_id, int64_t ready_resumable_id) noexcept:
+    multi_id_(multi_id),
+    ready_resumable_id_(ready_resumable_id) {
+  }
+
+private:
+  using ReturnT = Optional<int64_t>;
+
+  bool run() final {
+    RESUMABLE_BEGIN
+      ready_ = wait_without_result(ready_resumable_id_);
+      TRY_WAIT(curl_multi_select_resumable_label_0, ready_, bool);
+      if (ready_) {
+        get_forked_storage(ready_resumable_id_)->load<bool>();
+      }
+      // the handle may be closed while waiting
+      auto *multi_context = vk::singleton<CurlContexts>::get().get_value<MultiContext>(multi_id_);
+      if (!ready_ || !multi_context) {
+        RETURN(false);
+      }
+      RETURN(multi_context->select_ready_sockets);
+    RESUMABLE_END
+  }
+
+  curl_multi multi_id_{0};
+  int64_t ready_resumable_id_{0};
+  bool ready_{false};
+};
+
 // this is a callback called from curl_easy_perform
 size_t curl_write(char *data, size_t size, size_t nmemb, void *userdata) {
   auto *easy_context = static_cast<EasyContext *>(userdata);
@@ -246,6 +593,13 @@ void long_option_setter(EasyContext *easy_context, CURLoption option, const mixe
   easy_context->set_option_safe(option, static_cast<long>(value.to_int()));
 }
 
+void timeout_option_setter(EasyContext *easy_context, CURLoption option, const mixed &value) {
+  long_option_setter(easy_context, option, value);
+  if (easy_context->error_num == CURLE_OK) {
+    easy_context->exec_timeout = static_cast<double>(std::max(value.to_int(), int64_t{0})) * (option == CURLOPT_TIMEOUT_MS ? 0.001 : 1.0);
+  }
+}
+
 void string_option_setter(EasyContext *easy_context, CURLoption option, const mixed &value) {
   easy_context->set_option_safe(option, value.to_string().c_str());
 }
@@ -479,8 +833,8 @@ bool curl_setopt(EasyContext *easy_context, int64_t option, const mixed &value)
       {CURLOPT_SSL_VERIFYPEER,          long_option_setter},
       {CURLOPT_TCP_NODELAY,             long_option_setter},
       {CURLOPT_TFTP_BLKSIZE,            long_option_setter},
-      {CURLOPT_TIMEOUT,                 long_option_setter},
-      {CURLOPT_TIMEOUT_MS,              long_option_setter},
+      {CURLOPT_TIMEOUT,                 timeout_option_setter},
+      {CURLOPT_TIMEOUT_MS,              timeout_option_setter},
       {CURLOPT_TRANSFERTEXT,            long_option_setter},
       {CURLOPT_UNRESTRICTED_AUTH,       long_option_setter},
       {CURLOPT_UPLOAD,                  long_option_setter},
@@ -614,9 +968,14 @@ curl_easy f$curl_init(const string &url) noexcept {
 
 void f$curl_reset(curl_easy easy_id) noexcept {
   if (auto *easy_context = get_context<EasyContext>(easy_id)) {
+    if (unlikely(easy_context->is_executing())) {
+      php_warning("Can't reset curl handle while curl_exec is running");
+      return;
+    }
     dl::CriticalSectionGuard critical_section;
     curl_easy_reset(easy_context->easy_handle);
     easy_context->return_transfer = false;
+    easy_context->exec_timeout = 0;
     easy_context->private_data = false;
     easy_context->cleanup_slists_and_posts();
     easy_context->cleanup_for_next_request();
@@ -653,18 +1012,26 @@ mixed f$curl_exec(curl_easy easy_id) noexcept {
     return false;
   }
 
-  easy_context->cleanup_for_next_request();
-  easy_context->error_num = dl::critical_section_call(curl_easy_perform, easy_context->easy_handle);
-
-  if (easy_context->error_num != CURLE_OK && easy_context->error_num != CURLE_PARTIAL_FILE) {
+  if (unlikely(easy_context->is_executing())) {
+    php_warning("curl_exec is already running for this handle");
     return false;
   }
 
-  if (easy_context->return_transfer) {
-    return easy_context->received_data.concat_and_get_string();
+  easy_context->cleanup_for_next_request();
+  MultiContext *exec_multi_context = get_exec_multi_context();
+  if (unlikely(!exec_multi_context)) {
+    php_warning("Could not initialize a curl multi handle for curl_exec");
+    return false;
   }
 
-  return true;
+  // the transfer is driven by the net reactor, so other forks keep running while it's in progress
+  const CURLMcode add_result = dl::critical_section_call(curl_multi_add_handle, exec_multi_context->multi_handle, easy_context->easy_handle);
+  if (unlikely(add_result != CURLM_OK)) {
+    php_warning("Can't start curl_exec: %s", dl::critical_section_call(curl_multi_strerror, add_result));
+    return false;
+  }
+  easy_context->exec_ready_resumable_id = register_forked_resumable(new curl_ready_resumable{});
+  return start_resumable<mixed>(new curl_exec_resumable{easy_id, easy_context->exec_ready_resumable_id, easy_context->get_exec_timeout()});
 }
 
 mixed f$curl_getinfo(curl_easy easy_id, int64_t option) noexcept {
@@ -768,16 +1135,25 @@ int64_t f$curl_errno(curl_easy easy_id) noexcept {
 
 void f$curl_close(curl_easy easy_id) noexcept {
   if (auto *easy_context = get_context<EasyContext>(easy_id)) {
-    dl::CriticalSectionGuard critical_section;
-    vk::singleton<CurlContexts>::get().easy_contexts.set_value(easy_id - 1, nullptr);
-    easy_context->release();
+    const int64_t exec_ready_resumable_id = easy_context->exec_ready_resumable_id;
+    {
+      dl::CriticalSectionGuard critical_section;
+      if (exec_ready_resumable_id) {
+        curl_multi_remove_handle(vk::singleton<CurlContexts>::get().exec_multi_context->multi_handle, easy_context->easy_handle);
+      }
+      vk::singleton<CurlContexts>::get().easy_contexts.set_value(easy_id - 1, nullptr);
+      easy_context->release();
+    }
+    if (exec_ready_resumable_id) {
+      resumable_run_ready(exec_ready_resumable_id);
+    }
   }
 }
 
 curl_multi f$curl_multi_init() noexcept {
   auto &multi_contexts = vk::singleton<CurlContexts>::get().multi_contexts;
   MultiContext *&multi = multi_contexts.emplace_back();
-  multi = new(dl::allocate(sizeof(MultiContext))) MultiContext;
+  multi = new(dl::allocate(sizeof(MultiContext))) MultiContext{multi_contexts.count()};
 
   dl::critical_section_call([&multi] { multi->multi_handle = curl_multi_init(); });
   if (unlikely(multi->multi_handle == nullptr)) {
@@ -785,6 +1161,7 @@ curl_multi f$curl_multi_init() noexcept {
     php_warning("Could not initialize a new curl multi handle");
     return 0;
   }
+  multi->set_multi_socket_callback();
   return multi_contexts.count();
 }
 
@@ -841,7 +1218,18 @@ bool f$curl_multi_setopt(curl_multi multi_id, int64_t option, int64_t value) noe
 Optional<int64_t> f$curl_multi_exec(curl_multi multi_id, int64_t &still_running) noexcept {
   if (auto *multi_context = get_context<MultiContext>(multi_id)) {
     int still_running_int = 0;
-    multi_context->error_num = dl::critical_section_call(curl_multi_perform, multi_context->multi_handle, &still_running_int);
+    // curl_multi_perform() doesn't report the sockets to the socket callback, and curl_multi_fdset() can't report the ones above FD_SETSIZE,
+    // so the transfers are run by the socket API: on each known socket, as its readiness is checked by curl itself, and on the timeout
+    dl::CriticalSectionGuard critical_section;
+    const array<int64_t> curl_sockets = multi_context->curl_sockets;
+    multi_context->error_num = CURLM_OK;
+    for (auto it = curl_sockets.begin(); it != curl_sockets.end() && multi_context->error_num == CURLM_OK; ++it) {
+      const auto fd = static_cast<curl_socket_t>(it.get_key().to_int());
+      multi_context->error_num = curl_multi_socket_action(multi_context->multi_handle, fd, 0, &still_running_int);
+    }
+    if (multi_context->error_num == CURLM_OK) {
+      multi_context->error_num = curl_multi_socket_action(multi_context->multi_handle, CURL_SOCKET_TIMEOUT, 0, &still_running_int);
+    }
     still_running = still_running_int;
     return multi_context->error_num;
   }
@@ -849,16 +1237,37 @@ Optional<int64_t> f$curl_multi_exec(curl_multi multi_id, int64_t &still_running)
 }
 
 Optional<int64_t> f$curl_multi_select(curl_multi multi_id, double timeout) noexcept {
-  if (auto *multi_context = get_context<MultiContext>(multi_id)) {
-    int numfds = 0;
-    multi_context->error_num = dl::critical_section_call(curl_multi_wait, multi_context->multi_handle, nullptr, 0,
-                                                         static_cast<int>(timeout * 1000.0), &numfds);
-    if (multi_context->error_num != CURLM_OK) {
-      return -1;
-    }
-    return int64_t{numfds};
+  auto *multi_context = get_context<MultiContext>(multi_id);
+  if (!multi_context) {
+    return false;
   }
-  return false;
+  if (unlikely(multi_context->select_ready_resumable_id)) {
+    php_warning("curl_multi_select is already waiting for this handle");
+    return -1;
+  }
+
+  long curl_timeout_ms = -1;
+  multi_context->error_num = dl::critical_section_call(curl_multi_timeout, multi_context->multi_handle, &curl_timeout_ms);
+  if (multi_context->error_num != CURLM_OK) {
+    return -1;
+  }
+
+  double wait_time = std::max(timeout, 0.0);
+  if (curl_timeout_ms >= 0) {
+    wait_time = std::min(wait_time, curl_timeout_ms * 0.001);
+  }
+  if (wait_time < 0.001) {
+    return 0;
+  }
+
+  // sockets are waited by the net reactor, so other forks keep running during the select
+  for (const auto &socket : multi_context->curl_sockets) {
+    multi_context->watch_socket(static_cast<int>(socket.get_key().to_int()), socket.get_value());
+  }
+  multi_context->set_timer(wait_time);
+  multi_context->select_ready_sockets = 0;
+  multi_context->select_ready_resumable_id = register_forked_resumable(new curl_ready_resumable{});
+  return start_resumable<Optional<int64_t>>(new curl_multi_select_resumable{multi_id, multi_context->select_ready_resumable_id});
 }
 
 int64_t curl_multi_info_read_msgs_in_queue_stub = 0;
@@ -872,12 +1281,9 @@ Optional<array<int64_t>> f$curl_multi_info_read(curl_multi multi_id, int64_t &ms
       result.set_value(string{"msg"}, static_cast<int64_t>(msg->msg));
       result.set_value(string{"result"}, static_cast<int64_t>(msg->data.result));
 
-      void *id_as_ptr = nullptr;
-      dl::critical_section_call([&] { curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &id_as_ptr); });
-      const auto curl_handler_id = static_cast<int64_t>(reinterpret_cast<size_t>(id_as_ptr));
-      const auto *easy_handle = vk::singleton<CurlContexts>::get().easy_contexts.find_value(curl_handler_id - 1);
-      if (easy_handle && (*easy_handle)->easy_handle == msg->easy_handle) {
-        (*easy_handle)->error_num = msg->data.result;
+      int64_t curl_handler_id = 0;
+      if (auto *easy_context = get_easy_context_by_handle(msg->easy_handle, &curl_handler_id)) {
+        easy_context->error_num = msg->data.result;
         result.set_value(string{"handle"}, curl_handler_id);
       }
       return result;
@@ -903,8 +1309,26 @@ Optional<int64_t> f$curl_multi_errno(curl_multi multi_id) noexcept {
 
 void f$curl_multi_close(curl_multi multi_id) noexcept {
   if (auto *multi_context = get_context<MultiContext>(multi_id)) {
+    const int64_t select_ready_resumable_id = multi_context->select_ready_resumable_id;
     vk::singleton<CurlContexts>::get().multi_contexts.set_value(multi_id - 1, nullptr);
     multi_context->release();
+    if (select_ready_resumable_id) {
+      resumable_run_ready(select_ready_resumable_id);
+    }
+  }
+}
+
+void process_curl_socket_ready(int fd, int ready_flags) noexcept {
+  auto &contexts = vk::singleton<CurlContexts>::get();
+  MultiContext *multi_context = contexts.socket_owners.get_value(fd);
+  if (!multi_context) {
+    // the socket has been already closed or the select has been finished
+    return;
+  }
+  if (multi_context == contexts.exec_multi_context) {
+    exec_socket_action(multi_context, fd, ready_flags);
+  } else if (multi_context->select_ready_resumable_id) {
+    multi_context->finish_select(std::max(multi_context->count_ready_sockets(), int64_t{1}));
   }
 }
 
@@ -960,6 +1384,7 @@ void global_init_curl_lib() noexcept {
   }
 
   vk::singleton<CurlMemoryUsage>::get().total_allocated = 0;
+  curl_timeout_wakeup_id = register_wakeup_callback(&process_curl_timeout);
 }
 
 template<class CTX>
@@ -975,7 +1400,12 @@ void clear_contexts(array<CTX *> &contexts) {
 
 void free_curl_lib() noexcept {
   dl::CriticalSectionGuard critical_section;
-  clear_contexts(vk::singleton<CurlContexts>::get().easy_contexts);
-  clear_contexts(vk::singleton<CurlContexts>::get().multi_contexts);
+  auto &contexts = vk::singleton<CurlContexts>::get();
+  if (auto *exec_multi_context = std::exchange(contexts.exec_multi_context, nullptr)) {
+    exec_multi_context->release();
+  }
+  clear_contexts(contexts.easy_contexts);
+  clear_contexts(contexts.multi_contexts);
+  hard_reset_var(contexts.socket_owners);
   vk::singleton<CurlMemoryUsage>::get().total_allocated = 0;
 }
@@ -4,21 +4,25 @@
 
 #include "runtime/instance-cache.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <forward_list>
-#include <map>
 #include <mutex>
-#include <unordered_set>
+#include <vector>
 
 #include "common/kprintf.h"
 #include "common/wrappers/memory-utils.h"
 
 #include "runtime/allocator.h"
 #include "runtime/critical_section.h"
+#include "runtime/inter-process-epoch-readers.h"
 #include "runtime/inter-process-mutex.h"
 #include "runtime/inter-process-resource.h"
-#include "runtime/memory_resource/resource_allocator.h"
 #include "runtime/refcountable_php_classes.h"
+#include "server/php-engine-vars.h"
+#include "server/workers-control.h"
 
 namespace impl_ {
 
@@ -49,20 +53,77 @@ static constexpr size_t DATA_SHARDS_COUNT{997u};
 // The buckets check step during the cache cleanup
 static constexpr size_t SHARDS_PURGE_PERIOD{5u};
 
+// Number of independent memory arenas, the data shards are distributed among them,
+// so stores into the shards from different arenas don't serialize on the allocator lock
+static constexpr size_t MEMORY_ARENAS_COUNT{16u};
+// The part of the memory limit for the arena shared by all shards,
+// the elements which don't fit the arena of their shard are stored there
+static constexpr double LARGE_ELEMENTS_ARENA_RATIO{0.5};
+// The minimal capacity of the shard elements table
+static constexpr size_t MIN_TABLE_CAPACITY{8u};
+
 class ElementHolder;
+struct SharedDataTable;
 
-struct CacheContext : private vk::not_copyable {
+// The removed elements and tables are destroyed only when the readers of the arena, who could see them, have left,
+// this makes possible to fetch an element without taking any locks
+struct CacheMemoryArena : private vk::not_copyable {
   inter_process_mutex allocator_mutex;
   memory_resource::unsynchronized_pool_resource memory_resource;
-  InstanceCacheStats stats;
-  std::atomic<bool> memory_swap_required{false};
+  // by the worker logname_id: a worker killed while reading can't leave,
+  // so it's done by the next worker with the same logname_id, see force_release_all_resources()
+  InterProcessEpochReaders<WorkersControl::max_workers_count> readers;
+  std::atomic<uint64_t> allocator_lock_contentions{0};
+  std::atomic<uint64_t> garbage_clearing_postponed{0};
 
   void move_to_garbage(ElementHolder *element) noexcept;
-  bool has_garbage() const noexcept { return cache_garbage_ != nullptr; }
-  void clear_garbage() noexcept;
+  bool has_garbage() const noexcept {
+    return cache_garbage_ != nullptr || retired_tables_.load(std::memory_order_relaxed) != nullptr || has_detached_garbage();
+  }
+  // should be called under the allocator_mutex
+  void retire_table(SharedDataTable *table) noexcept;
+
+  // the garbage is detached at the epoch, and it's destroyed when there are no readers at this epoch or earlier
+  bool has_detached_garbage() const noexcept { return detached_epoch_.load(std::memory_order_relaxed) != decltype(readers)::NO_EPOCH; }
+  uint64_t get_detached_epoch() const noexcept { return detached_epoch_.load(std::memory_order_relaxed); }
+  // should be called under the allocator_mutex, when there is no detached garbage
+  void detach_garbage(std::atomic<uint64_t> &epoch) noexcept;
+  // should be called under the allocator_mutex, when there are no readers who can see the detached garbage
+  void destroy_detached_garbage() noexcept;
 
 private:
   std::atomic<ElementHolder *> cache_garbage_{nullptr};
+  std::atomic<SharedDataTable *> retired_tables_{nullptr};
+
+  // they are accessed under the allocator_mutex
+  ElementHolder *detached_elements_{nullptr};
+  SharedDataTable *detached_tables_{nullptr};
+  std::atomic<uint64_t> detached_epoch_{decltype(readers)::NO_EPOCH};
+};
+
+struct CacheContext : private vk::not_copyable {
+  // the arenas of the shards and the last one is for the large elements
+  std::array<CacheMemoryArena, MEMORY_ARENAS_COUNT + 1> memory_arenas;
+  InstanceCacheStats stats;
+  std::atomic<bool> memory_swap_required{false};
+  // the epoch of the arena readers, it's shared by all arenas, as the large elements are seen by the readers of any arena
+  std::atomic<uint64_t> readers_epoch{1};
+
+  CacheMemoryArena &get_large_elements_arena() noexcept {
+    return memory_arenas.back();
+  }
+
+  // should be called under the arena allocator_mutex
+  void clear_garbage(CacheMemoryArena &arena) noexcept;
+
+  void force_release_reader(size_t reader_id) noexcept {
+    for (auto &arena : memory_arenas) {
+      arena.readers.leave(reader_id);
+    }
+  }
+
+private:
+  bool has_readers_at(CacheMemoryArena &arena, uint64_t detached_epoch) noexcept;
 };
 
 class ElementHolder : private vk::thread_safe_refcnt<ElementHolder> {
@@ -72,100 +133,295 @@ public:
 
   void release() noexcept {
     if (--refcnt == 0) {
-      cache_context.move_to_garbage(this);
+      memory_arena.move_to_garbage(this);
     }
   }
 
+  // the element can be found by a lock-free reader after the cache has released it, but before it's destroyed
+  bool try_add_ref() noexcept {
+    auto current_refcnt = refcnt.load();
+    do {
+      if (current_refcnt == 0) {
+        return false;
+      }
+    } while (!refcnt.compare_exchange_weak(current_refcnt, current_refcnt + 1));
+    return true;
+  }
+
   void destroy() noexcept {
     php_assert(refcnt == 0);
     cache_context.stats.elements_destroyed.fetch_add(1, std::memory_order_relaxed);
-    auto &mem_resource = cache_context.memory_resource;
+    auto &mem_resource = memory_arena.memory_resource;
+    InstanceDeepDestroyVisitor{ExtraRefCnt::for_instance_cache}.process(key);
     this->~ElementHolder();
     mem_resource.deallocate(this, sizeof(ElementHolder));
   }
 
   ElementHolder(std::chrono::nanoseconds now, int64_t ttl,
+                string &&key_in_shared_memory,
                 std::unique_ptr<InstanceCopyistBase> &&instance,
-                CacheContext &context) noexcept:
+                CacheContext &context, CacheMemoryArena &arena) noexcept:
+    key(std::move(key_in_shared_memory)),
+    key_hash(static_cast<uint64_t>(key.hash())),
     inserted_by_process(getpid()),
     instance_wrapper(std::move(instance)),
-    cache_context(context) {
+    cache_context(context),
+    memory_arena(arena) {
     update_time_points(now, ttl);
     cache_context.stats.elements_created.fetch_add(1, std::memory_order_relaxed);
   }
 
   // returns how long the element is lived in relation to the expected lifetime
   double freshness_ratio(std::chrono::nanoseconds now, double immortal_ratio = 0.5) const noexcept {
+    const auto stored_at_value = stored_at.load(std::memory_order_relaxed);
+    const auto expiring_at_value = expiring_at.load(std::memory_order_relaxed);
     // an immortal element
-    if (expiring_at == std::chrono::nanoseconds::max()) {
+    if (expiring_at_value == std::chrono::nanoseconds::max()) {
       return immortal_ratio;
     }
-    if (expiring_at <= stored_at) {
+    if (expiring_at_value <= stored_at_value) {
       return 1.0;
     }
-    const auto real_age = std::chrono::duration<double>{std::max(now, stored_at) - stored_at};
-    const auto max_age = std::chrono::duration<double>{expiring_at - stored_at};
+    const auto real_age = std::chrono::duration<double>{std::max(now, stored_at_value) - stored_at_value};
+    const auto max_age = std::chrono::duration<double>{expiring_at_value - stored_at_value};
     return real_age.count() / max_age.count();
   }
 
+  // should be called under the storage_mutex
   void update_time_points(std::chrono::nanoseconds now, int64_t ttl) noexcept {
-    stored_at = std::max(now, stored_at);
-    expiring_at = ttl > 0 ? stored_at + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max();
-    early_fetch_performed = false;
+    const auto new_stored_at = std::max(now, stored_at.load(std::memory_order_relaxed));
+    stored_at.store(new_stored_at, std::memory_order_relaxed);
+    expiring_at.store(ttl > 0 ? new_stored_at + std::chrono::seconds{ttl} : std::chrono::nanoseconds::max(), std::memory_order_relaxed);
+    early_fetch_performed.store(false, std::memory_order_relaxed);
   }
 
-  std::chrono::nanoseconds stored_at{std::chrono::nanoseconds::min()};
-  std::chrono::nanoseconds expiring_at{std::chrono::nanoseconds::max()};
-  bool early_fetch_performed{false};
+  const string key;
+  const uint64_t key_hash{0};
+
+  // these fields are read without the storage_mutex
+  std::atomic<std::chrono::nanoseconds> stored_at{std::chrono::nanoseconds::min()};
+  std::atomic<std::chrono::nanoseconds> expiring_at{std::chrono::nanoseconds::max()};
+  std::atomic<bool> early_fetch_performed{false};
   const pid_t inserted_by_process{0};
 
   std::unique_ptr<InstanceCopyistBase> instance_wrapper;
   CacheContext &cache_context;
+  CacheMemoryArena &memory_arena;
 
   // Removed elements list
   std::atomic<ElementHolder *> next_in_garbage_list{nullptr};
 };
 
-using ElementStorage_ = memory_resource::stl::map<string, vk::intrusive_ptr<ElementHolder>, memory_resource::unsynchronized_pool_resource, stl_string_less>;
+// An open addressing table of the shard elements, which holds a reference to each element.
+// It is modified under the storage_mutex and read without any locks,
+// therefore the elements are never moved between slots: the removed ones are replaced with the tombstone,
+// and the table is rebuilt into a new memory when it's getting full.
+struct SharedDataTable : private vk::not_copyable {
+  static ElementHolder *tombstone() noexcept {
+    return reinterpret_cast<ElementHolder *>(uintptr_t{1});
+  }
+
+  static bool is_element(const ElementHolder *slot) noexcept {
+    return slot != nullptr && slot != tombstone();
+  }
+
+  static size_t memory_size(size_t capacity) noexcept {
+    return sizeof(SharedDataTable) + capacity * sizeof(std::atomic<ElementHolder *>);
+  }
+
+  explicit SharedDataTable(size_t table_capacity) noexcept:
+    capacity(table_capacity) {
+    for (size_t i = 0; i != capacity; ++i) {
+      new(&slots()[i]) std::atomic<ElementHolder *>{nullptr};
+    }
+  }
+
+  std::atomic<ElementHolder *> *slots() noexcept {
+    return reinterpret_cast<std::atomic<ElementHolder *> *>(this + 1);
+  }
+
+  std::atomic<ElementHolder *> *find_slot(const string &key, uint64_t key_hash) noexcept {
+    for (size_t i = key_hash & (capacity - 1), probes = 0; probes != capacity; i = (i + 1) & (capacity - 1), ++probes) {
+      ElementHolder *element = slots()[i].load(std::memory_order_acquire);
+      if (!element) {
+        return nullptr;
+      }
+      if (element != tombstone() && element->key_hash == key_hash && element->key == key) {
+        return &slots()[i];
+      }
+    }
+    return nullptr;
+  }
+
+  // the table must have a free slot, the element reference is moved into the table
+  void insert(ElementHolder *element) noexcept {
+    php_assert(used_slots < capacity);
+    for (size_t i = element->key_hash & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+      ElementHolder *slot = slots()[i].load(std::memory_order_relaxed);
+      if (!is_element(slot)) {
+        used_slots += (slot == nullptr);
+        ++elements;
+        slots()[i].store(element, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+  bool has_room_for_one_more() const noexcept {
+    return (used_slots + 1) * 4 <= capacity * 3;
+  }
+
+  const size_t capacity{0};
+  // elements and tombstones
+  size_t used_slots{0};
+  size_t elements{0};
+  SharedDataTable *next_retired{nullptr};
+};
 
 struct SharedDataStorages : private vk::not_copyable {
-  explicit SharedDataStorages(memory_resource::unsynchronized_pool_resource &resource) :
-    storage(ElementStorage_::allocator_type{resource}) {
+  explicit SharedDataStorages(CacheMemoryArena &arena) noexcept:
+    memory_arena(arena) {
+  }
+
+  // lock-free, the caller must be registered as the arena reader
+  ElementHolder *find_element(const string &key, uint64_t key_hash) const noexcept {
+    SharedDataTable *table = elements_table.load(std::memory_order_acquire);
+    if (!table) {
+      return nullptr;
+    }
+    std::atomic<ElementHolder *> *slot = table->find_slot(key, key_hash);
+    return slot ? slot->load(std::memory_order_acquire) : nullptr;
   }
 
   inter_process_mutex storage_mutex;
-  ElementStorage_ storage;
+  std::atomic<SharedDataTable *> elements_table{nullptr};
   std::atomic<bool> is_storage_empty{true};
+  std::atomic<uint64_t> storage_lock_contentions{0};
+  CacheMemoryArena &memory_arena;
 };
 
-void CacheContext::move_to_garbage(ElementHolder *element) noexcept {
+// registers the process as the arena reader, the garbage detached since then isn't destroyed until the reader leaves
+class ArenaReaderGuard : vk::not_copyable {
+public:
+  ArenaReaderGuard(CacheContext &context, CacheMemoryArena &arena) noexcept:
+    arena_(arena) {
+    arena_.readers.enter(get_reader_id(), context.readers_epoch);
+  }
+
+  ~ArenaReaderGuard() noexcept {
+    arena_.readers.leave(get_reader_id());
+  }
+
+private:
+  static size_t get_reader_id() noexcept {
+    php_assert(logname_id >= 0 && logname_id < WorkersControl::max_workers_count);
+    return static_cast<size_t>(logname_id);
+  }
+
+  // the process mustn't be interrupted while it is registered as a reader
+  dl::CriticalSectionGuard critical_section_;
+  CacheMemoryArena &arena_;
+};
+
+template<class Mutex>
+class ContendedLockGuard : vk::not_copyable {
+public:
+  ContendedLockGuard(Mutex &mutex, std::atomic<uint64_t> &contentions) noexcept:
+    mutex_(mutex) {
+    if (!mutex_.try_lock()) {
+      contentions.fetch_add(1, std::memory_order_relaxed);
+      mutex_.lock();
+    }
+  }
+
+  ~ContendedLockGuard() noexcept {
+    mutex_.unlock();
+  }
+
+private:
+  Mutex &mutex_;
+};
+
+void CacheMemoryArena::move_to_garbage(ElementHolder *element) noexcept {
   php_assert(element->next_in_garbage_list == nullptr);
-  // Put all garbage into the cache_context.cache_garbage; the cleanup happens later, under the lock
+  // Put all garbage into the arena garbage list; the cleanup happens later, under the lock
   auto *next = cache_garbage_.load();
   do {
     element->next_in_garbage_list.store(next);
   } while (!cache_garbage_.compare_exchange_strong(next, element));
 }
 
-void CacheContext::clear_garbage() noexcept {
-  auto element = cache_garbage_.exchange(nullptr);
+void CacheMemoryArena::retire_table(SharedDataTable *table) noexcept {
+  table->next_retired = retired_tables_.load(std::memory_order_relaxed);
+  retired_tables_.store(table, std::memory_order_relaxed);
+}
 
+bool CacheContext::has_readers_at(CacheMemoryArena &arena, uint64_t detached_epoch) noexcept {
+  const size_t readers_count = vk::singleton<WorkersControl>::get().get_total_workers_count();
+  // the large elements are referenced from the tables of all shards, so any reader may look at them
+  if (&arena == &get_large_elements_arena()) {
+    return std::any_of(memory_arenas.begin(), memory_arenas.end(), [detached_epoch, readers_count](const CacheMemoryArena &a) {
+      return a.readers.has_readers_at(detached_epoch, readers_count);
+    });
+  }
+  return arena.readers.has_readers_at(detached_epoch, readers_count);
+}
+
+void CacheContext::clear_garbage(CacheMemoryArena &arena) noexcept {
+  // the garbage is detached only after the previous one is destroyed, so the readers at one epoch hold one batch at most
+  if (arena.has_detached_garbage() && !has_readers_at(arena, arena.get_detached_epoch())) {
+    arena.destroy_detached_garbage();
+  }
+  if (!arena.has_detached_garbage() && arena.has_garbage()) {
+    arena.detach_garbage(readers_epoch);
+    if (!has_readers_at(arena, arena.get_detached_epoch())) {
+      arena.destroy_detached_garbage();
+    }
+  }
+  if (arena.has_detached_garbage()) {
+    arena.garbage_clearing_postponed.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void CacheMemoryArena::detach_garbage(std::atomic<uint64_t> &epoch) noexcept {
+  php_assert(!has_detached_garbage());
+  detached_elements_ = cache_garbage_.exchange(nullptr);
+  detached_tables_ = retired_tables_.exchange(nullptr, std::memory_order_relaxed);
+  // the readers entered after that don't see the detached elements and tables, as they had been removed before
+  detached_epoch_.store(epoch.fetch_add(1), std::memory_order_relaxed);
+}
+
+void CacheMemoryArena::destroy_detached_garbage() noexcept {
+  auto *element = std::exchange(detached_elements_, nullptr);
   while (element) {
     auto next = element->next_in_garbage_list.load();
     element->destroy();
     element = next;
   }
+
+  auto *table = std::exchange(detached_tables_, nullptr);
+  while (table) {
+    auto *next = table->next_retired;
+    const size_t table_memory_size = SharedDataTable::memory_size(table->capacity);
+    table->~SharedDataTable();
+    memory_resource.deallocate(table, table_memory_size);
+    table = next;
+  }
+  detached_epoch_.store(decltype(readers)::NO_EPOCH, std::memory_order_relaxed);
 }
 
 class SharedMemoryData : vk::not_copyable {
 public:
-  void init(size_t pool_size) noexcept {
+  void init(size_t pool_size, bool use_huge_pages) noexcept {
     php_assert(!data_shards_);
     php_assert(!cache_context_);
     php_assert(!shared_memory_);
     shared_memory_pool_size_ = pool_size;
     share_memory_full_size_ = get_context_size() + get_data_size() + shared_memory_pool_size_;
     shared_memory_ = mmap_shared(share_memory_full_size_);
+    if (use_huge_pages) {
+      our_madvise(shared_memory_, share_memory_full_size_, MADV_HUGEPAGE);
+    }
     construct_data_inplace();
   }
 
@@ -180,6 +436,12 @@ public:
     cache_context_ = nullptr;
   }
 
+  // the process may be killed while reading
+  void force_release_reader(size_t reader_id) noexcept {
+    php_assert(cache_context_);
+    cache_context_->force_release_reader(reader_id);
+  }
+
   SharedDataStorages &get_data(const string &key) noexcept {
     php_assert(data_shards_);
     return data_shards_[static_cast<uint32_t>(key.hash()) % DATA_SHARDS_COUNT];
@@ -213,10 +475,17 @@ private:
   void construct_data_inplace() noexcept {
     cache_context_ = new(shared_memory_) CacheContext();
     uint8_t *data_storage_mem = static_cast<uint8_t *>(shared_memory_) + get_context_size();
-    cache_context_->memory_resource.init(data_storage_mem + get_data_size(), shared_memory_pool_size_);
+    uint8_t *arenas_mem = data_storage_mem + get_data_size();
+    const auto large_elements_pool_size = static_cast<size_t>(static_cast<double>(shared_memory_pool_size_) * LARGE_ELEMENTS_ARENA_RATIO);
+    const size_t arena_pool_size = (shared_memory_pool_size_ - large_elements_pool_size) / MEMORY_ARENAS_COUNT;
+    for (size_t i = 0; i != MEMORY_ARENAS_COUNT; ++i) {
+      cache_context_->memory_arenas[i].memory_resource.init(arenas_mem, arena_pool_size);
+      arenas_mem += arena_pool_size;
+    }
+    cache_context_->get_large_elements_arena().memory_resource.init(arenas_mem, large_elements_pool_size);
     data_shards_ = reinterpret_cast<SharedDataStorages *>(data_storage_mem);
     for (size_t i = 0; i != DATA_SHARDS_COUNT; ++i) {
-      new(&data_shards_[i]) SharedDataStorages{cache_context_->memory_resource};
+      new(&data_shards_[i]) SharedDataStorages{cache_context_->memory_arenas[i % MEMORY_ARENAS_COUNT]};
     }
   }
 
@@ -237,6 +506,7 @@ private:
 
 struct {
   size_t total_memory_limit{DEFAULT_MEMORY_LIMIT};
+  bool use_huge_pages{false};
 } static instance_cache_settings;
 
 class InstanceCache {
@@ -253,7 +523,7 @@ public:
 
   void global_init() {
     php_assert(!current_ && !context_);
-    data_manager_.init(instance_cache_settings.total_memory_limit);
+    data_manager_.init(instance_cache_settings.total_memory_limit, instance_cache_settings.use_huge_pages);
   }
 
   void refresh() {
@@ -274,14 +544,17 @@ public:
     // request_cache_ and storing_delayed_ use a script memory
     storing_delayed_.clear();
     request_cache_.clear();
+    pinned_elements_.clear();
     // used_elements use a heap memory
     used_elements_.clear();
 
-    if (context_->has_garbage()) {
-      std::unique_lock<inter_process_mutex> allocator_lock{context_->allocator_mutex, std::try_to_lock};
-      if (allocator_lock) {
-        dl::MemoryReplacementGuard shared_memory_guard{context_->memory_resource};
-        context_->clear_garbage();
+    for (auto &arena : context_->memory_arenas) {
+      if (arena.has_garbage()) {
+        std::unique_lock<inter_process_mutex> allocator_lock{arena.allocator_mutex, std::try_to_lock};
+        if (allocator_lock) {
+          dl::MemoryReplacementGuard shared_memory_guard{arena.memory_resource};
+          context_->clear_garbage(arena);
+        }
       }
     }
     data_manager_.release_resource(current_);
@@ -304,14 +577,13 @@ public:
       return false;
     }
 
-    InstanceDeepCopyVisitor detach_processor{context_->memory_resource, ExtraRefCnt::for_instance_cache};
-    const ElementHolder *inserted_element = try_insert_element_into_cache(
-      data, key, ttl, instance_wrapper, detach_processor);
+    ElementHolder *inserted_element = nullptr;
+    const auto insertion_status = try_insert_element_into_cache(data, key, ttl, instance_wrapper, inserted_element);
 
-    if (!inserted_element) {
+    if (insertion_status != InsertionStatus::inserted) {
       // failed to insert the element due to some problems (e.g. memory, depth limit)
-      if (unlikely(!detach_processor.is_ok())) {
-        fire_warning(detach_processor, instance_wrapper.get_class());
+      if (unlikely(insertion_status != InsertionStatus::allocator_locked)) {
+        fire_warning(insertion_status, instance_wrapper.get_class());
         return false;
       }
       // failed to acquire a lock, save the instance into the script memory container, we'll try again later
@@ -326,6 +598,7 @@ public:
     context_->stats.elements_stored.fetch_add(1, std::memory_order_relaxed);
     // request_cache_ uses a script memory
     request_cache_.set_value(key, inserted_element);
+    pinned_elements_.set_value(get_pinned_element_id(inserted_element), true);
     return true;
   }
 
@@ -343,45 +616,37 @@ public:
       return (*cached_element_ptr)->instance_wrapper.get();
     }
 
-    vk::intrusive_ptr<ElementHolder> element;
-    bool element_logically_expired = false;
-    {
-      auto &data = current_->get_data(key);
-      std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-      auto it = data.storage.find(key);
-      if (it == data.storage.end()) {
-        ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
-        context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
-        return nullptr;
-      }
+    vk::intrusive_ptr<ElementHolder> element = acquire_element(*context_, current_->get_data(key), key);
+    if (!element) {
+      ic_debug("can't fetch '%s' because it is absent\n", key.c_str());
+      context_->stats.elements_missed.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
 
-      update_now();
-      // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
-      // return null to the next worker process so it knows that the value needs to be updated in advance
-      if (!it->second->early_fetch_performed &&
-          it->second->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO) {
-        it->second->early_fetch_performed = true;
-        context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("can't fetch '%s' because less than %f of total time is left\n",
-                 key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
-        return nullptr;
-      }
-      element_logically_expired = it->second->expiring_at <= now_;
-      if (element_logically_expired) {
-        if (even_if_expired) {
-          context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("fetch logically expired element '%s'\n", key.c_str());
-        } else {
-          context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
-          ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
-          return nullptr;
-        }
+    update_now();
+    // if more than EARLY_EXPIRATION_ELEMENT_RATIO time is passed out of the expected element lifetime,
+    // return null to the next worker process so it knows that the value needs to be updated in advance
+    if (!element->early_fetch_performed.load(std::memory_order_relaxed) &&
+        element->freshness_ratio(now_) >= EARLY_EXPIRATION_ELEMENT_RATIO &&
+        !element->early_fetch_performed.exchange(true)) {
+      context_->stats.elements_missed_earlier.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("can't fetch '%s' because less than %f of total time is left\n",
+               key.c_str(), EARLY_EXPIRATION_ELEMENT_RATIO);
+      return nullptr;
+    }
+    const bool element_logically_expired = element->expiring_at.load(std::memory_order_relaxed) <= now_;
+    if (element_logically_expired) {
+      if (even_if_expired) {
+        context_->stats.elements_logically_expired_but_fetched.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("fetch logically expired element '%s'\n", key.c_str());
       } else {
-        context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
-        ic_debug("fetch '%s' from inter process cache\n", key.c_str());
+        context_->stats.elements_logically_expired_and_ignored.fetch_add(1, std::memory_order_relaxed);
+        ic_debug("can't fetch '%s' because element was logically expired\n", key.c_str());
+        return nullptr;
       }
-
-      element = it->second;
+    } else {
+      context_->stats.elements_fetched.fetch_add(1, std::memory_order_relaxed);
+      ic_debug("fetch '%s' from inter process cache\n", key.c_str());
     }
 
     // don't cache logically expired elements
@@ -391,8 +656,12 @@ public:
     }
 
     const auto *result = element->instance_wrapper.get();
-    // used_elements uses a heap memory, it'll hold an element until the end of the request
-    used_elements_.emplace(std::move(element));
+    // the element may be already pinned, if it was fetched with even_if_expired or after the deletion
+    if (!pinned_elements_.has_key(get_pinned_element_id(element.get()))) {
+      pinned_elements_.set_value(get_pinned_element_id(element.get()), true);
+      // used_elements uses a heap memory, it'll hold an element until the end of the request
+      used_elements_.emplace_back(std::move(element));
+    }
     return result;
   }
 
@@ -409,13 +678,13 @@ public:
 
     auto &data = current_->get_data(key);
     update_now();
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ContendedLockGuard<inter_process_mutex> shared_data_lock{data.storage_mutex, data.storage_lock_contentions};
+    ElementHolder *element = data.find_element(key, static_cast<uint64_t>(key.hash()));
+    if (!element) {
       return false;
     }
 
-    it->second->update_time_points(now_, ttl);
+    element->update_time_points(now_, ttl);
     return true;
   }
 
@@ -428,23 +697,27 @@ public:
     request_cache_.unset(key);
     auto &data = current_->get_data(key);
     update_now();
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
-    if (it == data.storage.end()) {
+    ContendedLockGuard<inter_process_mutex> shared_data_lock{data.storage_mutex, data.storage_lock_contentions};
+    ElementHolder *element = data.find_element(key, static_cast<uint64_t>(key.hash()));
+    if (!element) {
       return false;
     }
 
     // calculate expiring_at in a way that the next fetch returns false
     constexpr double SCALE = 1.0 / EARLY_EXPIRATION_ELEMENT_RATIO;
-    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - it->second->stored_at) * SCALE);
-    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(it->second->stored_at + new_element_ttl);
+    const auto stored_at = element->stored_at.load(std::memory_order_relaxed);
+    auto new_element_ttl = std::chrono::duration_cast<std::chrono::nanoseconds>((now_ - stored_at) * SCALE);
+    auto new_expiring_at = std::chrono::duration_cast<std::chrono::nanoseconds>(stored_at + new_element_ttl);
     new_expiring_at = std::min(new_expiring_at, now_ + DELETED_ELEMENT_LIFETIME_LIMIT);
-    it->second->expiring_at = std::max(new_expiring_at, it->second->stored_at);
+    element->expiring_at.store(std::max(new_expiring_at, stored_at), std::memory_order_relaxed);
     return true;
   }
 
   void force_release_all_resources() {
     data_manager_.force_release_all_resources();
+    data_manager_.for_each_resource([](SharedMemoryData &data) {
+      data.force_release_reader(static_cast<size_t>(logname_id));
+    });
   }
 
   // this function should be called only from master
@@ -454,10 +727,6 @@ public:
 
     auto &current_data = data_manager_.get_current_resource();
     auto &context = current_data.get_context();
-    // replace the default script allocator
-    // as this call happens from the master process
-    // we need to explicitly activate and deactivate it
-    dl::MemoryReplacementGuard shared_memory_guard{context.memory_resource, true};
 
     auto *data_shards = current_data.get_data_shards();
     const size_t shards_count = current_data.get_data_shards_count();
@@ -468,44 +737,66 @@ public:
       }
       {
         std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-        if (std::none_of(data_shard.storage.begin(), data_shard.storage.end(),
-                         [now_with_delay](const auto &stored_element) {
-                           return stored_element.second->expiring_at <= now_with_delay;
-                         })) {
+        if (!has_expired_elements(data_shard, now_with_delay)) {
           continue;
         }
       }
 
+      auto &arena = data_shard.memory_arena;
+      // replace the default script allocator
+      // as this call happens from the master process
+      // we need to explicitly activate and deactivate it
+      dl::MemoryReplacementGuard shared_memory_guard{arena.memory_resource, true};
       // lock in this very order and do not move allocator_lock anywhere below, otherwise it will result in a deadlock!
-      std::lock_guard<inter_process_mutex> allocator_lock{context.allocator_mutex};
+      std::lock_guard<inter_process_mutex> allocator_lock{arena.allocator_mutex};
       std::lock_guard<inter_process_mutex> shared_data_lock{data_shard.storage_mutex};
-      for (auto it = data_shard.storage.begin(); it != data_shard.storage.end();) {
-        if (it->second->expiring_at <= now_with_delay) {
-          ic_debug("purge '%s'\n", it->first.c_str());
-          string removing_key = it->first;
-          it = data_shard.storage.erase(it);
-          InstanceDeepDestroyVisitor{ExtraRefCnt::for_instance_cache}.process(removing_key);
-          context.stats.elements_expired.fetch_add(1, std::memory_order_relaxed);
-          context.stats.elements_cached.fetch_sub(1, std::memory_order_relaxed);
-        } else {
-          ++it;
-        }
-      }
-      data_shard.is_storage_empty.store(data_shard.storage.empty(), std::memory_order_relaxed);
+      purge_expired_elements(data_shard, now_with_delay, context.stats);
     }
 
     purge_shard_offset_ = (purge_shard_offset_ + 1) % SHARDS_PURGE_PERIOD;
 
-    std::lock_guard<inter_process_mutex> allocator_lock{context.allocator_mutex};
-    context.clear_garbage();
-    last_memory_stats_ = context.memory_resource.get_memory_stats();
+    last_memory_stats_ = memory_resource::MemoryStats{};
+    last_contention_stats_ = InstanceCacheContentionStats{};
+    max_arena_memory_used_ratio_ = 0.0;
+    for (auto &arena : context.memory_arenas) {
+      {
+        dl::MemoryReplacementGuard shared_memory_guard{arena.memory_resource, true};
+        std::lock_guard<inter_process_mutex> allocator_lock{arena.allocator_mutex};
+        context.clear_garbage(arena);
+      }
+      const auto arena_memory_stats = arena.memory_resource.get_memory_stats();
+      last_memory_stats_.real_memory_used += arena_memory_stats.real_memory_used;
+      last_memory_stats_.memory_used += arena_memory_stats.memory_used;
+      last_memory_stats_.max_real_memory_used += arena_memory_stats.max_real_memory_used;
+      last_memory_stats_.max_memory_used += arena_memory_stats.max_memory_used;
+      last_memory_stats_.memory_limit += arena_memory_stats.memory_limit;
+      last_memory_stats_.defragmentation_calls += arena_memory_stats.defragmentation_calls;
+      last_memory_stats_.huge_memory_pieces += arena_memory_stats.huge_memory_pieces;
+      last_memory_stats_.small_memory_pieces += arena_memory_stats.small_memory_pieces;
+      last_memory_stats_.slab_pages += arena_memory_stats.slab_pages;
+      last_memory_stats_.total_allocations += arena_memory_stats.total_allocations;
+      last_memory_stats_.total_memory_allocated += arena_memory_stats.total_memory_allocated;
+      if (arena_memory_stats.memory_limit) {
+        max_arena_memory_used_ratio_ = std::max(max_arena_memory_used_ratio_,
+                                                static_cast<double>(arena_memory_stats.real_memory_used) / static_cast<double>(arena_memory_stats.memory_limit));
+      }
+
+      const uint64_t allocator_lock_contentions = arena.allocator_lock_contentions.load(std::memory_order_relaxed);
+      last_contention_stats_.allocator_lock_contentions_total += allocator_lock_contentions;
+      last_contention_stats_.allocator_lock_contentions_max = std::max(last_contention_stats_.allocator_lock_contentions_max, allocator_lock_contentions);
+      last_contention_stats_.garbage_clearing_postponed += arena.garbage_clearing_postponed.load(std::memory_order_relaxed);
+    }
+    for (size_t shard_id = 0; shard_id != shards_count; ++shard_id) {
+      const uint64_t storage_lock_contentions = data_shards[shard_id].storage_lock_contentions.load(std::memory_order_relaxed);
+      last_contention_stats_.storage_lock_contentions_total += storage_lock_contentions;
+      last_contention_stats_.storage_lock_contentions_max = std::max(last_contention_stats_.storage_lock_contentions_max, storage_lock_contentions);
+    }
   }
 
   // this function should be called only from master
   InstanceCacheSwapStatus try_swap_memory_resource() {
-    const auto &memory_stats = get_last_memory_stats();
-    const auto threshold = REAL_MEMORY_USED_THRESHOLD * static_cast<double>(memory_stats.memory_limit);
-    if (static_cast<double>(memory_stats.real_memory_used) < threshold &&
+    // the arenas are filled unevenly, the buffer is swapped when any of them is almost full
+    if (max_arena_memory_used_ratio_ < REAL_MEMORY_USED_THRESHOLD &&
         !data_manager_.get_current_resource().get_context().memory_swap_required) {
       return InstanceCacheSwapStatus::no_need;
     }
@@ -524,14 +815,93 @@ public:
     return last_memory_stats_;
   }
 
+  // this function should be called only from master
+  const InstanceCacheContentionStats &get_last_contention_stats() const noexcept {
+    return last_contention_stats_;
+  }
+
 private:
+  // lock-free, the found element is held by the returned pointer
+  static vk::intrusive_ptr<ElementHolder> acquire_element(CacheContext &context, SharedDataStorages &data, const string &key) noexcept {
+    ArenaReaderGuard arena_reader{context, data.memory_arena};
+    ElementHolder *element = data.find_element(key, static_cast<uint64_t>(key.hash()));
+    // the element may be already released by the storage
+    if (!element || !element->try_add_ref()) {
+      return {};
+    }
+    return vk::intrusive_ptr<ElementHolder>{element, false};
+  }
+
+  static bool has_expired_elements(SharedDataStorages &data, std::chrono::nanoseconds now_with_delay) noexcept {
+    SharedDataTable *table = data.elements_table.load(std::memory_order_relaxed);
+    for (size_t i = 0; table && i != table->capacity; ++i) {
+      ElementHolder *element = table->slots()[i].load(std::memory_order_relaxed);
+      if (SharedDataTable::is_element(element) && element->expiring_at.load(std::memory_order_relaxed) <= now_with_delay) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // should be called under the allocator_mutex and the storage_mutex
+  static void purge_expired_elements(SharedDataStorages &data, std::chrono::nanoseconds now_with_delay, InstanceCacheStats &stats) noexcept {
+    SharedDataTable *table = data.elements_table.load(std::memory_order_relaxed);
+    for (size_t i = 0; i != table->capacity; ++i) {
+      ElementHolder *element = table->slots()[i].load(std::memory_order_relaxed);
+      if (SharedDataTable::is_element(element) && element->expiring_at.load(std::memory_order_relaxed) <= now_with_delay) {
+        ic_debug("purge '%s'\n", element->key.c_str());
+        table->slots()[i].store(SharedDataTable::tombstone(), std::memory_order_release);
+        --table->elements;
+        element->release();
+        stats.elements_expired.fetch_add(1, std::memory_order_relaxed);
+        stats.elements_cached.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+    data.is_storage_empty.store(table->elements == 0, std::memory_order_relaxed);
+    // get rid of the tombstones, otherwise the probe sequences only grow
+    if (table->used_slots > table->elements * 2 && table->capacity > MIN_TABLE_CAPACITY) {
+      rebuild_table(data, table->elements + 1, nullptr);
+    }
+  }
+
+  // should be called under the allocator_mutex and the storage_mutex,
+  // returns false if there is no memory for the new table
+  static bool rebuild_table(SharedDataStorages &data, size_t elements_count, InstanceDeepCopyVisitor *detach_processor) noexcept {
+    size_t capacity = MIN_TABLE_CAPACITY;
+    while (capacity * 3 < elements_count * 4) {
+      capacity *= 2;
+    }
+    const size_t table_memory_size = SharedDataTable::memory_size(capacity);
+    auto &memory_resource = data.memory_arena.memory_resource;
+    void *mem = detach_processor
+                ? detach_processor->prepare_raw_memory(table_memory_size)
+                : (memory_resource.is_enough_memory_for(table_memory_size) ? memory_resource.allocate(table_memory_size) : nullptr);
+    if (!mem) {
+      return false;
+    }
+
+    auto *new_table = new(mem) SharedDataTable{capacity};
+    SharedDataTable *old_table = data.elements_table.load(std::memory_order_relaxed);
+    if (old_table) {
+      for (size_t i = 0; i != old_table->capacity; ++i) {
+        ElementHolder *element = old_table->slots()[i].load(std::memory_order_relaxed);
+        if (SharedDataTable::is_element(element)) {
+          new_table->insert(element);
+        }
+      }
+      // the lock-free readers may still look at the old table
+      data.memory_arena.retire_table(old_table);
+    }
+    data.elements_table.store(new_table, std::memory_order_release);
+    return true;
+  }
+
   bool is_element_insertion_can_be_skipped(SharedDataStorages &data, const string &key) const {
-    std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-    auto it = data.storage.find(key);
+    vk::intrusive_ptr<ElementHolder> element = acquire_element(*context_, data, key);
     // allow to skip the insertion of the element if it was inserted by another process recently enough
-    if (it != data.storage.end() &&
-        it->second->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
-        it->second->inserted_by_process != getpid()) {
+    if (element &&
+        element->freshness_ratio(now_) < FRESHNESS_ELEMENT_RATIO &&
+        element->inserted_by_process != getpid()) {
       ic_debug("skip '%s' because it was recently updated\n", key.c_str());
       context_->stats.elements_storing_skipped_due_recent_update.fetch_add(1, std::memory_order_relaxed);
       return true;
@@ -545,7 +915,6 @@ private:
       return;
     }
 
-    InstanceDeepCopyVisitor detach_processor{context_->memory_resource, ExtraRefCnt::for_instance_cache};
     for (auto it = storing_delayed_.cbegin(); it != storing_delayed_.cend(); it = storing_delayed_.cbegin()) {
       string key = it.get_key().to_string();
       const auto &delayed_instance = *it.get_value().get();
@@ -555,16 +924,17 @@ private:
         storing_delayed_.unset(key);
         continue;
       }
-      const ElementHolder *inserted_element = try_insert_element_into_cache(
+      ElementHolder *inserted_element = nullptr;
+      const auto insertion_status = try_insert_element_into_cache(
         data, key, delayed_instance.ttl,
-        *delayed_instance.instance_wrapper, detach_processor);
-      if (!inserted_element) {
-        if (likely(detach_processor.is_ok())) {
+        *delayed_instance.instance_wrapper, inserted_element);
+      if (insertion_status != InsertionStatus::inserted) {
+        if (likely(insertion_status == InsertionStatus::allocator_locked)) {
           // failed to acquire an allocator lock; try later
           return;
         }
-        fire_warning(detach_processor, delayed_instance.instance_wrapper->get_class());
-        if (detach_processor.is_memory_limit_exceeded()) {
+        fire_warning(insertion_status, delayed_instance.instance_wrapper->get_class());
+        if (insertion_status == InsertionStatus::memory_limit_exceeded) {
           return;
         }
       } else {
@@ -572,64 +942,108 @@ private:
         context_->stats.elements_stored_with_delay.fetch_add(1, std::memory_order_relaxed);
         // request_cache_ uses script memory
         request_cache_.set_value(key, inserted_element);
+        pinned_elements_.set_value(get_pinned_element_id(inserted_element), true);
       }
       storing_delayed_.unset(key);
     }
   }
 
-  ElementHolder *try_insert_element_into_cache(SharedDataStorages &data,
-                                               const string &key_in_script_memory, int64_t ttl,
-                                               const InstanceCopyistBase &instance_wrapper,
-                                               InstanceDeepCopyVisitor &detach_processor) noexcept {
-    // swap the allocator
-    dl::MemoryReplacementGuard shared_memory_guard{context_->memory_resource};
+  enum class InsertionStatus {
+    inserted,
+    // the insertion can be retried later
+    allocator_locked,
+    memory_limit_exceeded,
+    // e.g. the depth limit
+    copying_failed
+  };
 
-    std::unique_lock<inter_process_mutex> allocator_lock{context_->allocator_mutex, std::try_to_lock};
-    // locking strictly before the storage_mutex to avoid a deadlock
+  InsertionStatus try_insert_element_into_cache(SharedDataStorages &data,
+                                                const string &key_in_script_memory, int64_t ttl,
+                                                const InstanceCopyistBase &instance_wrapper,
+                                                ElementHolder *&inserted_element) noexcept {
+    auto &arena = data.memory_arena;
+    // locking strictly before the large elements arena allocator_mutex and the storage_mutex to avoid a deadlock
+    std::unique_lock<inter_process_mutex> allocator_lock{arena.allocator_mutex, std::try_to_lock};
     if (!allocator_lock) {
-      return nullptr;
+      arena.allocator_lock_contentions.fetch_add(1, std::memory_order_relaxed);
+      return InsertionStatus::allocator_locked;
+    }
+    const auto insertion_status = try_insert_element_into_arena(data, arena, key_in_script_memory, ttl, instance_wrapper, inserted_element);
+    if (insertion_status != InsertionStatus::memory_limit_exceeded) {
+      return insertion_status;
     }
 
+    // the element doesn't fit the arena of its shard, which is a small part of the memory limit
+    auto &large_elements_arena = context_->get_large_elements_arena();
+    std::unique_lock<inter_process_mutex> large_elements_allocator_lock{large_elements_arena.allocator_mutex, std::try_to_lock};
+    if (!large_elements_allocator_lock) {
+      large_elements_arena.allocator_lock_contentions.fetch_add(1, std::memory_order_relaxed);
+      return InsertionStatus::allocator_locked;
+    }
+    return try_insert_element_into_arena(data, large_elements_arena, key_in_script_memory, ttl, instance_wrapper, inserted_element);
+  }
+
+  // should be called under the allocator_mutex of the shard arena and of the element arena
+  InsertionStatus try_insert_element_into_arena(SharedDataStorages &data, CacheMemoryArena &arena,
+                                                const string &key_in_script_memory, int64_t ttl,
+                                                const InstanceCopyistBase &instance_wrapper,
+                                                ElementHolder *&inserted_element) noexcept {
+    // swap the allocator
+    dl::MemoryReplacementGuard shared_memory_guard{arena.memory_resource};
     // acquired an allocator lock, now we can safely collect the garbage
-    auto clear_garbage = vk::finally([this] { context_->clear_garbage(); });
+    auto clear_garbage = vk::finally([this, &arena] { context_->clear_garbage(arena); });
+
+    InstanceDeepCopyVisitor detach_processor{arena.memory_resource, ExtraRefCnt::for_instance_cache};
+    auto failure_status = [&detach_processor] {
+      return detach_processor.is_memory_limit_exceeded() ? InsertionStatus::memory_limit_exceeded : InsertionStatus::copying_failed;
+    };
 
     // moving an instance into a shared memory
-    if (auto cached_instance_wrapper = instance_wrapper.deep_copy_and_set_ref_cnt(detach_processor)) {
-      if (void *mem = detach_processor.prepare_raw_memory(sizeof(ElementHolder))) {
-        vk::intrusive_ptr<ElementHolder> element{new(mem) ElementHolder{now_, ttl, std::move(cached_instance_wrapper), *context_}};
-        std::lock_guard<inter_process_mutex> shared_data_lock{data.storage_mutex};
-        auto it = data.storage.find(key_in_script_memory);
-        if (it == data.storage.end()) {
-          string key_in_shared_memory = key_in_script_memory;
-          if (unlikely(!detach_processor.process(key_in_shared_memory))) {
-            return nullptr;
-          }
-          constexpr auto node_max_size = ElementStorage_::allocator_type::max_value_type_size();
-          if (unlikely(!detach_processor.is_enough_memory_for(node_max_size))) {
-            InstanceDeepDestroyVisitor{ExtraRefCnt::for_instance_cache}.process(key_in_shared_memory);
-            return nullptr;
-          }
-
-          it = data.storage.emplace(std::move(key_in_shared_memory), vk::intrusive_ptr<ElementHolder>{}).first;
-          data.is_storage_empty.store(false, std::memory_order_relaxed);
-          context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
-        }
-        // replace element and save previous element into used_elements_;
-        // it'll make it possible to free it without taking a storage_mutex lock
-        it->second.swap(element);
-        if (element) {
-          // used_elements_ uses heap memory for its internal allocations
-          used_elements_.emplace(std::move(element));
-        }
-        used_elements_.emplace(it->second);
-        return it->second.get();
+    string key_in_shared_memory = key_in_script_memory;
+    if (unlikely(!detach_processor.process(key_in_shared_memory))) {
+      return failure_status();
+    }
+    auto cached_instance_wrapper = instance_wrapper.deep_copy_and_set_ref_cnt(detach_processor);
+    void *mem = cached_instance_wrapper ? detach_processor.prepare_raw_memory(sizeof(ElementHolder)) : nullptr;
+    if (!mem) {
+      InstanceDeepDestroyVisitor{ExtraRefCnt::for_instance_cache}.process(key_in_shared_memory);
+      return failure_status();
+    }
+    // the element is moved to the garbage on a failure below
+    vk::intrusive_ptr<ElementHolder> element{new(mem) ElementHolder{now_, ttl, std::move(key_in_shared_memory),
+                                                                    std::move(cached_instance_wrapper), *context_, arena}};
+
+    ContendedLockGuard<inter_process_mutex> shared_data_lock{data.storage_mutex, data.storage_lock_contentions};
+    SharedDataTable *table = data.elements_table.load(std::memory_order_relaxed);
+    auto *slot = table ? table->find_slot(element->key, element->key_hash) : nullptr;
+    if (!slot && (!table || !table->has_room_for_one_more())) {
+      // the table is always allocated in the arena of the shard
+      if (unlikely(!rebuild_table(data, (table ? table->elements : 0) + 1, &arena == &data.memory_arena ? &detach_processor : nullptr))) {
+        return InsertionStatus::memory_limit_exceeded;
       }
+      table = data.elements_table.load(std::memory_order_relaxed);
     }
-    return nullptr;
+
+    // the table holds its own reference, the other one is kept in used_elements_ until the end of the request
+    element->add_ref();
+    if (slot) {
+      // replace element and save previous element into used_elements_;
+      // it'll make it possible to free it without taking a storage_mutex lock
+      ElementHolder *previous_element = slot->exchange(element.get(), std::memory_order_acq_rel);
+      // used_elements_ uses heap memory for its internal allocations
+      used_elements_.emplace_back(previous_element, false);
+    } else {
+      table->insert(element.get());
+      data.is_storage_empty.store(false, std::memory_order_relaxed);
+      context_->stats.elements_cached.fetch_add(1, std::memory_order_relaxed);
+    }
+    inserted_element = element.get();
+    used_elements_.emplace_back(std::move(element));
+    return InsertionStatus::inserted;
   }
 
-  void fire_warning(const InstanceDeepCopyVisitor &detach_processor, const char *class_name) noexcept {
-    if (detach_processor.is_memory_limit_exceeded()) {
+  void fire_warning(InsertionStatus insertion_status, const char *class_name) noexcept {
+    if (insertion_status == InsertionStatus::memory_limit_exceeded) {
       php_warning("Memory limit exceeded on saving instance of class '%s' into cache", class_name);
       context_->memory_swap_required = true;
     }
@@ -639,18 +1053,23 @@ private:
   CacheContext *context_{nullptr};
   InterProcessResourceManager<SharedMemoryData, 2> data_manager_;
 
-
-  struct IntrusivePtrHash {
-    size_t operator()(const vk::intrusive_ptr<ElementHolder> &el) const {
-      return reinterpret_cast<size_t>(el.get());
-    }
-  };
-
   // A storage of elements that were used inside a script (during the request)
-  // Elements are inserted here to ensure that they don't go away unexpectedly
-  // std::unordered_set uses heap memory
+  // Elements are inserted here to ensure that they don't go away unexpectedly,
+  // the fetched instances are not copied and are used right from the shared memory while they are pinned here.
+  // Each element gets here once per request (see pinned_elements_), so the plain vector is enough;
+  // its capacity is kept between requests and the pinning costs no heap allocations.
+  // std::vector uses heap memory
   // vk::intrusive_ptr<ElementHolder> uses shared memory
-  std::unordered_set<vk::intrusive_ptr<ElementHolder>, IntrusivePtrHash> used_elements_;
+  std::vector<vk::intrusive_ptr<ElementHolder>> used_elements_;
+
+  // The addresses of the elements pinned in used_elements_, the repeated fetches of the same element
+  // are not always served from the request_cache_ (e.g. the expired elements or the ones fetched after the deletion)
+  // Uses a script memory
+  array<bool> pinned_elements_;
+
+  static int64_t get_pinned_element_id(const ElementHolder *element) noexcept {
+    return static_cast<int64_t>(reinterpret_cast<uintptr_t>(element));
+  }
 
   // A local cache that can be used to get elements without taking a storage_mutex lock
   // Uses a script memory
@@ -666,6 +1085,8 @@ private:
 
   std::chrono::nanoseconds now_{std::chrono::nanoseconds::zero()};
   memory_resource::MemoryStats last_memory_stats_;
+  InstanceCacheContentionStats last_contention_stats_;
+  double max_arena_memory_used_ratio_{0.0};
   size_t purge_shard_offset_{0};
 };
 
@@ -696,6 +1117,11 @@ void set_instance_cache_memory_limit(size_t limit) {
   impl_::instance_cache_settings.total_memory_limit = limit;
 }
 
+// should be called only from master
+void set_instance_cache_use_huge_pages() {
+  impl_::instance_cache_settings.use_huge_pages = true;
+}
+
 // should be called only from master
 InstanceCacheSwapStatus instance_cache_try_swap_memory() {
   return impl_::InstanceCache::get().try_swap_memory_resource();
@@ -711,6 +1137,11 @@ const memory_resource::MemoryStats &instance_cache_get_memory_stats() {
   return impl_::InstanceCache::get().get_last_memory_stats();
 }
 
+// should be called only from master
+const InstanceCacheContentionStats &instance_cache_get_contention_stats() {
+  return impl_::InstanceCache::get().get_last_contention_stats();
+}
+
 // should be called only from master
 void instance_cache_purge_expired_elements() {
   impl_::InstanceCache::get().purge_expired();
@@ -12,7 +12,8 @@
 //    therefore the reference counter of cached strings and arrays is ExtraRefCnt::for_instance_cache or ExtraRefCnt::for_global_const;
 //  3) On fetch, all strings and arrays are returned as is;
 //  4) On store, all instances (and sub instances) are deeply cloned into instance cache;
-//  5) On fetch, all instances (and sub instances) are deeply cloned from instance cache;
+//  5) On fetch, nothing is copied: the cached classes are immutable (@kphp-immutable-class),
+//    so the instance is returned as is, and the cache element is pinned until the end of the request;
 //  6) All instances (with all members) are destroyed strictly before or after request,
 //    and shouldn't be destroyed while request.
 
@@ -35,6 +36,7 @@ void free_instance_cache_lib();
 
 // these function should be called from master
 void set_instance_cache_memory_limit(size_t limit);
+void set_instance_cache_use_huge_pages();
 
 struct InstanceCacheStats : private vk::not_copyable {
   std::atomic<uint64_t> elements_stored{0};
@@ -54,6 +56,16 @@ struct InstanceCacheStats : private vk::not_copyable {
   std::atomic<uint64_t> elements_cached{0};
 };
 
+// the lock contention counters, the storage locks are per data shard, the allocator locks are per memory arena
+struct InstanceCacheContentionStats {
+  uint64_t storage_lock_contentions_total{0};
+  uint64_t storage_lock_contentions_max{0};
+  uint64_t allocator_lock_contentions_total{0};
+  uint64_t allocator_lock_contentions_max{0};
+  // the garbage is not destroyed while the lock-free readers, who could see it, are in the arena
+  uint64_t garbage_clearing_postponed{0};
+};
+
 enum class InstanceCacheSwapStatus {
   no_need, // no need to do a swap
   swap_is_finished, // swap succeeded
@@ -66,6 +78,8 @@ const InstanceCacheStats &instance_cache_get_stats();
 // these function should be called from master
 const memory_resource::MemoryStats &instance_cache_get_memory_stats();
 // these function should be called from master
+const InstanceCacheContentionStats &instance_cache_get_contention_stats();
+// these function should be called from master
 void instance_cache_purge_expired_elements();
 
 void instance_cache_release_all_resources_acquired_by_this_proc();
@@ -0,0 +1,60 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "common/mixin/not_copyable.h"
+
+#include "runtime/php_assert.h"
+
+// The lock-free readers of the shared memory, which is reclaimed by epochs.
+// The writer detaches the removed objects as a batch, and then advances the epoch: the batch belongs to the previous epoch.
+// Each reader is registered with the epoch it has started at, so the batch may be destroyed,
+// when there are no readers registered at its epoch or earlier: the later readers can't see the removed objects.
+// Unlike waiting for no readers at all, the memory is reclaimed even if the readers overlap all the time.
+// The readers are identified by the processes (e.g. by logname_id), so a reader killed while reading is released by the next process with its id.
+template<size_t MAX_READERS>
+class InterProcessEpochReaders : vk::not_copyable {
+public:
+  // epochs start from 1
+  static constexpr uint64_t NO_EPOCH = 0;
+
+  // the same epoch may be shared by several reader sets, if the objects are seen by the readers of any of them
+  void enter(size_t reader_id, const std::atomic<uint64_t> &epoch) noexcept {
+    php_assert(reader_id < MAX_READERS);
+    auto &reader_epoch = reader_epochs_[reader_id];
+    php_assert(reader_epoch.load(std::memory_order_relaxed) == NO_EPOCH);
+    uint64_t registered_epoch = NO_EPOCH;
+    uint64_t current_epoch = epoch.load();
+    // the registration is repeated if the epoch has been advanced meanwhile:
+    // either the writer sees this reader at the epoch, or this reader doesn't see the objects removed before the epoch is advanced
+    while (registered_epoch != current_epoch) {
+      registered_epoch = current_epoch;
+      reader_epoch.store(registered_epoch);
+      current_epoch = epoch.load();
+    }
+  }
+
+  void leave(size_t reader_id) noexcept {
+    php_assert(reader_id < MAX_READERS);
+    reader_epochs_[reader_id].store(NO_EPOCH, std::memory_order_release);
+  }
+
+  // should be called after the epoch has been advanced past the detached_epoch
+  bool has_readers_at(uint64_t detached_epoch, size_t readers_count) const noexcept {
+    return std::any_of(reader_epochs_.begin(), reader_epochs_.begin() + std::min(readers_count, MAX_READERS),
+                       [detached_epoch](const std::atomic<uint64_t> &reader_epoch) {
+                         const uint64_t epoch = reader_epoch.load();
+                         return epoch != NO_EPOCH && epoch <= detached_epoch;
+                       });
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, MAX_READERS> reader_epochs_{};
+};
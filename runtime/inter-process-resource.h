@@ -116,6 +116,14 @@ public:
     (*control_block_)->force_release_all_resources();
   }
 
+  // e.g. to release the parts of the resources, which are held by this process directly
+  template<typename F>
+  void for_each_resource(const F &f) noexcept {
+    for (auto &resource: switchable_resource_) {
+      f(resource);
+    }
+  }
+
   // this function should be called only from master
   T &get_current_resource() noexcept {
     php_assert(is_initial_process());
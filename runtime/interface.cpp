@@ -71,6 +71,8 @@ static int ob_cur_buffer;
 static string_buffer oub[OB_MAX_BUFFERS];
 string_buffer *coub;
 static int http_need_gzip;
+static bool http_chunked_allowed;
+static bool http_streaming; // the response head is sent, the output is sent in chunks
 
 static bool is_utf8_enabled = false;
 bool is_json_log_on_timeout_enabled = true;
@@ -233,6 +235,10 @@ static bool check_status_line(const char *str, int str_len) {
 }
 
 static void header(const char *str, int str_len, bool replace = true, int http_response_code = 0) {
+  if (http_streaming) {
+    php_warning("Cannot modify header information - headers already sent by flush()");
+    return;
+  }
   if (dl::query_num != header_last_query_num) {
     new(headers_storage) array<string>();
     header_last_query_num = dl::query_num;
@@ -420,12 +426,16 @@ static inline const char *http_get_error_msg_text(int *code) {
   return "Extension Code";
 }
 
+// the negative content_length means the chunked response
 static const string_buffer *get_headers(int content_length) {//can't use static_SB, returns pointer to static_SB_spare
   string date = f$gmdate(HTTP_DATE);
   static_SB_spare.clean() << "Date: " << date;
   header(static_SB_spare.c_str(), (int)static_SB_spare.size());
 
-  if (!is_head_query) {
+  if (content_length < 0) {
+    headers->unset(string("content-length"));
+    header("Transfer-Encoding: chunked", 26);
+  } else if (!is_head_query) {
     static_SB_spare.clean() << "Content-Length: " << content_length;
     header(static_SB_spare.c_str(), (int)static_SB_spare.size());
   }
@@ -433,7 +443,10 @@ static const string_buffer *get_headers(int content_length) {//can't use static_
   php_assert (dl::query_num == header_last_query_num);
 
   static_SB_spare.clean();
-  if (!http_status_line.empty()) {
+  if (content_length < 0 && !strncmp(http_status_line.c_str(), "HTTP/1.0 ", 9)) {
+    // the chunked encoding is defined since HTTP/1.1
+    static_SB_spare << "HTTP/1.1" << http_status_line.c_str() + 8 << "\r\n";
+  } else if (!http_status_line.empty()) {
     static_SB_spare << http_status_line << "\r\n";
   } else {
     const char *message = http_get_error_msg_text(&http_return_code);
@@ -493,6 +506,19 @@ void f$fastcgi_finish_request(int64_t exit_code) {
       break;
     }
     case QUERY_TYPE_HTTP: {
+      if (http_streaming) {
+        string_buffer &out = oub[first_not_empty_buffer];
+        char chunk_head[16] = {0};
+        int chunk_head_len = 0;
+        if (out.size()) {
+          chunk_head_len = snprintf(chunk_head, sizeof(chunk_head), "%x\r\n", out.size());
+          out.append("\r\n", 2);
+        }
+        out.append("0\r\n\r\n", 5);
+        http_set_result(chunk_head, chunk_head_len, out.buffer(), out.size(), static_cast<int32_t>(exit_code));
+        break;
+      }
+
       const string_buffer *compressed;
       if (is_head_query) {
         oub[first_not_empty_buffer].clean();
@@ -534,6 +560,36 @@ void f$fastcgi_finish_request(int64_t exit_code) {
   coub->clean();
 }
 
+void f$flush() {
+  // the compressed output and the output of the HTTP/1.0 and HTTP/2 queries are sent at once, when the script is finished
+  if (query_type != QUERY_TYPE_HTTP || flushed || is_head_query || !http_chunked_allowed || (http_need_gzip & 4)) {
+    return;
+  }
+
+  string_buffer &out = oub[0];
+  if (http_streaming && out.size() == 0) {
+    return;
+  }
+
+  char chunk_head[16];
+  int chunk_head_len = 0;
+  if (out.size()) {
+    chunk_head_len = snprintf(chunk_head, sizeof(chunk_head), "%x\r\n", out.size());
+    out.append("\r\n", 2);
+  }
+
+  if (!http_streaming) {
+    // get_headers() returns static_SB_spare, the first chunk head follows the response head there
+    get_headers(-1);
+    http_streaming = true;
+    static_SB_spare.append(chunk_head, chunk_head_len);
+    http_send_response_part(static_SB_spare.buffer(), static_SB_spare.size(), out.buffer(), out.size());
+  } else {
+    http_send_response_part(chunk_head, chunk_head_len, out.buffer(), out.size());
+  }
+  out.clean();
+}
+
 void f$register_shutdown_function(const shutdown_function_type &f) {
   if (shutdown_functions_count == MAX_SHUTDOWN_FUNCTIONS) {
     php_warning("Too many shutdown functions registered, ignore next one\n");
@@ -668,6 +724,10 @@ void print(const char *s, size_t s_len) {
     write(kstdout, s, s_len);
   } else {
     coub->append(s, s_len);
+    // the streamed response keeps the script output small
+    if (unlikely(http_streaming) && ob_cur_buffer == 0 && coub->size() >= http_streaming_buffer_size) {
+      f$flush();
+    }
   }
 }
 
@@ -1431,9 +1491,11 @@ static void init_superglobals(const http_query_data &http_data, const rpc_query_
 
       string header_value;
       do {
+        const int value_begin = i;
         while (i < http_data.headers_len && http_data.headers[i] != '\r' && http_data.headers[i] != '\n') {
-          header_value.push_back(http_data.headers[i++]);
+          i++;
         }
+        header_value.append(http_data.headers + value_begin, i - value_begin);
 
         while (i < http_data.headers_len && (http_data.headers[i] == '\r' || http_data.headers[i] == '\n')) {
           i++;
@@ -1575,6 +1637,7 @@ static void init_superglobals(const http_query_data &http_data, const rpc_query_
     v$_SERVER.set_value(string("RPC_REMOTE_PID"), static_cast<int>(rpc_data.pid));
     v$_SERVER.set_value(string("RPC_REMOTE_UTIME"), rpc_data.utime);
   }
+  http_chunked_allowed = http_data.chunked_allowed;
   is_head_query = false;
   if (http_data.request_method_len) {
     v$_SERVER.set_value(string("REQUEST_METHOD"), string(http_data.request_method, http_data.request_method_len));
@@ -2139,6 +2202,7 @@ static void init_interface_lib() {
   shutdown_functions_count = 0;
   finished = false;
   flushed = false;
+  http_streaming = false;
 
   php_warning_level = std::max(2, php_warning_minimum_level);
   php_disable_warnings = 0;
@@ -27,6 +27,8 @@ void f$ob_start(const string &callback = string());
 
 void f$ob_flush();
 
+void f$flush();
+
 bool f$ob_end_flush();
 
 Optional<string> f$ob_get_flush();
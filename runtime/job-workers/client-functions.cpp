@@ -9,6 +9,7 @@
 #include "runtime/instance-copy-processor.h"
 #include "runtime/job-workers/job-interface.h"
 #include "runtime/job-workers/processing-jobs.h"
+#include "runtime/job-workers/shared-memory-pieces.h"
 #include "runtime/resumable.h"
 
 #include "server/job-workers/job-message.h"
@@ -57,6 +58,29 @@ JobMessageT *make_job_request_message(const class_instance<T> &instance) {
   return memory_request;
 }
 
+// the shared memory piece isn't copied into the job message, the job refers to the piece published into the common job
+job_workers::JobSharedMessage *make_job_request_message_with_piece(const class_instance<C$KphpJobWorkerRequest> &request,
+                                                                   const class_instance<C$KphpJobWorkerSharedMemoryPiece> &shared_memory_piece,
+                                                                   job_workers::JobSharedMemoryPiece *common_job_request) {
+  if (common_job_request == nullptr) {
+    return make_job_request_message<job_workers::JobSharedMessage>(request);
+  }
+
+  request.get()->set_shared_memory_piece({});                                           // prepare for copying to shared memory
+  auto *job_request = make_job_request_message<job_workers::JobSharedMessage>(request); // copy to shared memory
+  request.get()->set_shared_memory_piece(shared_memory_piece);                          // roll it back to keep original instance unchanged
+  if (job_request == nullptr) {
+    return nullptr;
+  }
+
+  const auto &job_instance = job_request->instance.cast_to<C$KphpJobWorkerRequest>();
+  const auto &common_job_instance = common_job_request->instance.cast_to<C$KphpJobWorkerSharedMemoryPiece>();
+  php_assert(!job_instance.is_null());
+  php_assert(!common_job_instance.is_null());
+  job_instance.get()->set_shared_memory_piece(common_job_instance);
+  return job_request;
+}
+
 int send_job_request_message(job_workers::JobSharedMessage *job_message, double timeout, job_workers::JobSharedMemoryPiece *common_job = nullptr, bool no_reply = false) {
   auto &client = vk::singleton<job_workers::JobWorkerClient>::get();
 
@@ -129,12 +153,21 @@ Optional<int64_t> kphp_job_worker_start_impl(const class_instance<C$KphpJobWorke
   }
   timeout = normalize_job_timeout(timeout);
 
-  auto *memory_request = make_job_request_message<job_workers::JobSharedMessage>(request);
+  const auto shared_memory_piece = request.get()->get_shared_memory_piece();
+  job_workers::JobSharedMemoryPiece *common_job_request = nullptr;
+  if (!shared_memory_piece.is_null()) {
+    common_job_request = vk::singleton<job_workers::SharedMemoryPieces>::get().publish(shared_memory_piece);
+    if (common_job_request == nullptr) {
+      return false;
+    }
+  }
+
+  auto *memory_request = make_job_request_message_with_piece(request, shared_memory_piece, common_job_request);
   if (memory_request == nullptr) {
     return false;
   }
 
-  int job_resumable_id = send_job_request_message(memory_request, timeout, nullptr, no_reply);
+  int job_resumable_id = send_job_request_message(memory_request, timeout, common_job_request, no_reply);
 
   if (job_resumable_id < 0) {
     return false;
@@ -186,44 +219,32 @@ array<Optional<int64_t>> f$kphp_job_worker_start_multi(const array<class_instanc
 
   job_workers::JobSharedMemoryPiece *common_job_request = nullptr;
   if (!common_shared_memory_piece.is_null()) {
-    common_job_request = make_job_request_message<job_workers::JobSharedMemoryPiece>(common_shared_memory_piece);
     /**
      * common_job_request lifetime:
-     * 1. attaches to client process on creating in `acquire_shared_message()`
+     * 1. attaches to client process on publishing in `SharedMemoryPieces::publish()`
      * 2. attaches to job worker process on job receiving in `job_parse_execute()`
      * 3. detaches from job worker process on terminating in `release_shared_message()` recursively
-     * 4. detaches from client process at the end of this function in `release_shared_message()`
+     * 4. detaches from client process on eviction or at the end of the request in `SharedMemoryPieces::reset()`
      *
      * client: 1 -> 4
      *         ↓
      * server: 2 -> 3
      */
+    common_job_request = vk::singleton<job_workers::SharedMemoryPieces>::get().publish(common_shared_memory_piece);
     if (common_job_request == nullptr) {
       return {};
     }
-    const auto &job_mem_stats = common_job_request->resource.get_memory_stats();
-    vk::singleton<ServerStats>::get().add_job_common_memory_stats(job_mem_stats.max_memory_used, job_mem_stats.max_real_memory_used);
   }
 
   for (const auto &it : requests) {
     const auto &req = it.get_value();
 
-    req.get()->set_shared_memory_piece({});                                           // prepare for copying to shared memory
-    auto *job_request = make_job_request_message<job_workers::JobSharedMessage>(req); // copy to shared memory
-    req.get()->set_shared_memory_piece(common_shared_memory_piece);                   // roll it back to keep original instance unchanged
+    auto *job_request = make_job_request_message_with_piece(req, common_shared_memory_piece, common_job_request);
     if (job_request == nullptr) {
       res.set_value(it.get_key(), false);
       continue;
     }
 
-    if (common_job_request) {
-      const auto &job_instance = job_request->instance.cast_to<C$KphpJobWorkerRequest>();
-      const auto &common_job_instance = common_job_request->instance.cast_to<C$KphpJobWorkerSharedMemoryPiece>();
-      php_assert(!job_instance.is_null());
-      php_assert(!common_job_instance.is_null());
-      job_instance.get()->set_shared_memory_piece(common_job_instance);
-    }
-
     int job_resumable_id = send_job_request_message(job_request, timeout, common_job_request);
     if (job_resumable_id > 0) {
       res.set_value(it.get_key(), job_resumable_id);
@@ -232,15 +253,12 @@ array<Optional<int64_t>> f$kphp_job_worker_start_multi(const array<class_instanc
     }
   }
 
-  if (common_job_request) {
-    vk::singleton<job_workers::SharedMemoryManager>::get().release_shared_message(common_job_request);
-  }
-
   return res;
 }
 
 void free_job_client_interface_lib() noexcept {
   if (f$is_kphp_job_workers_enabled()) {
     vk::singleton<job_workers::ProcessingJobs>::get().reset();
+    vk::singleton<job_workers::SharedMemoryPieces>::get().reset();
   }
 }
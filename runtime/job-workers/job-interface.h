@@ -28,7 +28,8 @@ enum {
   server_php_script_error_offset = -100,
   client_timeout_error = -102, // same as script timeout
   client_oom_error = -1001,
-  server_nothing_replied_error = -2001
+  server_nothing_replied_error = -2001,
+  server_job_expired_error = -3001
 };
 
 struct SendingInstanceBase : virtual abstract_refcountable_php_interface {
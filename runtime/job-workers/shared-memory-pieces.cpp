@@ -0,0 +1,83 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <algorithm>
+
+#include "runtime/allocator.h"
+#include "runtime/instance-copy-processor.h"
+
+#include "server/job-workers/job-message.h"
+#include "server/job-workers/job-stats.h"
+#include "server/job-workers/shared-memory-manager.h"
+#include "server/server-stats.h"
+
+#include "runtime/job-workers/shared-memory-pieces.h"
+
+namespace job_workers {
+
+JobSharedMemoryPiece *SharedMemoryPieces::publish(const class_instance<C$KphpJobWorkerSharedMemoryPiece> &piece) noexcept {
+  forget_pieces_of_previous_requests();
+
+  auto &memory_manager = vk::singleton<SharedMemoryManager>::get();
+  auto &stats = memory_manager.get_stats().shared_memory_pieces;
+  const auto first = pieces_.begin();
+  const auto last = first + pieces_count_;
+  auto found = std::find_if(first, last, [&piece](const PublishedPiece &published) { return published.source.get() == piece.get(); });
+  if (found != last) {
+    std::rotate(first, found, found + 1);
+    ++stats.reused;
+    stats.reused_bytes += first->message->resource.get_memory_stats().memory_used;
+    return first->message;
+  }
+
+  auto *message = memory_manager.acquire_shared_message<JobSharedMemoryPiece>();
+  if (message == nullptr) {
+    php_warning("Can't send job: not enough shared messages");
+    return nullptr;
+  }
+  message->instance = copy_instance_into_other_memory(piece, message->resource,
+                                                      ExtraRefCnt::for_job_worker_communication, request_extra_shared_memory);
+  if (message->instance.is_null()) {
+    memory_manager.release_shared_message(message);
+    php_warning("Can't send job: too big shared memory piece");
+    return nullptr;
+  }
+  const auto &memory_stats = message->resource.get_memory_stats();
+  vk::singleton<ServerStats>::get().add_job_common_memory_stats(memory_stats.max_memory_used, memory_stats.max_real_memory_used);
+  ++stats.published;
+  stats.published_bytes += memory_stats.memory_used;
+
+  if (pieces_count_ == pieces_.size()) {
+    // the jobs keep the evicted piece alive
+    memory_manager.release_shared_message(pieces_.back().message);
+    hard_reset_var(pieces_.back());
+  } else {
+    ++pieces_count_;
+  }
+  std::rotate(first, first + pieces_count_ - 1, first + pieces_count_);
+  first->source = piece;
+  first->message = message;
+  return message;
+}
+
+void SharedMemoryPieces::reset() noexcept {
+  forget_pieces_of_previous_requests();
+  auto &memory_manager = vk::singleton<SharedMemoryManager>::get();
+  for (size_t i = 0; i != pieces_count_; ++i) {
+    memory_manager.release_shared_message(pieces_[i].message);
+  }
+  // the script memory is going to be freed
+  hard_reset_var(pieces_);
+  pieces_count_ = 0;
+}
+
+void SharedMemoryPieces::forget_pieces_of_previous_requests() noexcept {
+  if (query_num_ != dl::query_num) {
+    hard_reset_var(pieces_);
+    pieces_count_ = 0;
+    query_num_ = dl::query_num;
+  }
+}
+
+} // namespace job_workers
@@ -0,0 +1,53 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "common/mixin/not_copyable.h"
+#include "common/smart_ptrs/singleton.h"
+
+#include "runtime/kphp_core.h"
+
+#include "runtime/job-workers/job-interface.h"
+
+namespace job_workers {
+
+struct JobSharedMemoryPiece;
+
+// The shared memory pieces are immutable, therefore a piece is copied into the job shared memory once
+// and the copy is bound to all the jobs started with the same piece during the request.
+// The recently used copies are kept by the client process till the end of the request,
+// the jobs hold their own references, so an evicted copy lives until its last job is finished.
+class SharedMemoryPieces : vk::not_copyable {
+public:
+  static constexpr size_t MAX_PUBLISHED_PIECES = 4;
+
+  // returns nullptr if the piece can't be copied into the job shared memory
+  JobSharedMemoryPiece *publish(const class_instance<C$KphpJobWorkerSharedMemoryPiece> &piece) noexcept;
+
+  void reset() noexcept;
+
+private:
+  friend class vk::singleton<SharedMemoryPieces>;
+
+  SharedMemoryPieces() = default;
+
+  // the pieces were forcibly released, if the previous request was terminated
+  void forget_pieces_of_previous_requests() noexcept;
+
+  struct PublishedPiece {
+    class_instance<C$KphpJobWorkerSharedMemoryPiece> source;
+    JobSharedMemoryPiece *message{nullptr};
+  };
+
+  // the most recently used piece is the first
+  std::array<PublishedPiece, MAX_PUBLISHED_PIECES> pieces_;
+  size_t pieces_count_{0};
+  long long query_num_{0};
+};
+
+} // namespace job_workers
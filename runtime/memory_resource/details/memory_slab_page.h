@@ -0,0 +1,117 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "runtime/memory_resource/memory_resource.h"
+#include "runtime/php_assert.h"
+
+namespace memory_resource {
+namespace details {
+
+// The slab page is an aligned piece of memory, which is split into the blocks of the same size class.
+// The page header with the occupancy bitmap is placed at the beginning of the page,
+// therefore the page of any block is found by the block address alignment.
+class memory_slab_page {
+public:
+  static constexpr size_t PAGE_SIZE{16u * 1024u};
+  static constexpr size_t MAX_BLOCK_SIZE{1024u};
+  // 8 byte classes up to 128 bytes, then 4 classes for each power of 2
+  static constexpr size_t CLASSES_COUNT{16u + 3u * 4u};
+
+  static constexpr size_t get_class_id(size_t aligned_size) noexcept {
+    if (aligned_size <= 128) {
+      return aligned_size ? (aligned_size >> 3) - 1 : 0;
+    }
+    const size_t power = 63 - __builtin_clzll(aligned_size - 1);
+    const size_t step_shift = power - 2;
+    return 16 + (power - 7) * 4 + ((aligned_size - (size_t{1} << power) - 1) >> step_shift);
+  }
+
+  static constexpr size_t get_class_size(size_t class_id) noexcept {
+    if (class_id < 16) {
+      return (class_id + 1) << 3;
+    }
+    const size_t power = 7 + (class_id - 16) / 4;
+    return (size_t{1} << power) + (((class_id - 16) % 4 + 1) << (power - 2));
+  }
+
+  static memory_slab_page *get_page_of(void *block) noexcept {
+    return reinterpret_cast<memory_slab_page *>(reinterpret_cast<uintptr_t>(block) & ~(PAGE_SIZE - 1));
+  }
+
+  // the memory must be aligned to the PAGE_SIZE
+  static memory_slab_page *create(void *page_memory, size_t class_id) noexcept {
+    php_assert((reinterpret_cast<uintptr_t>(page_memory) & (PAGE_SIZE - 1)) == 0);
+    return new(page_memory) memory_slab_page{class_id};
+  }
+
+  // the page must have a free block
+  void *allocate_block() noexcept {
+    for (size_t word = free_word_hint_;; ++word) {
+      php_assert(word < occupied_.size());
+      if (const uint64_t free_bits = ~occupied_[word]) {
+        const size_t bit = __builtin_ctzll(free_bits);
+        occupied_[word] |= uint64_t{1} << bit;
+        free_word_hint_ = static_cast<uint32_t>(word);
+        ++used_blocks_;
+        return blocks_begin() + (word * 64 + bit) * block_size_;
+      }
+    }
+  }
+
+  void deallocate_block(void *block) noexcept {
+    const size_t block_id = static_cast<size_t>(static_cast<char *>(block) - blocks_begin()) / block_size_;
+    const size_t word = block_id / 64;
+    const uint64_t mask = uint64_t{1} << (block_id % 64);
+    php_assert(block_id < blocks_count_ && (occupied_[word] & mask));
+    occupied_[word] ^= mask;
+    free_word_hint_ = std::min(free_word_hint_, static_cast<uint32_t>(word));
+    --used_blocks_;
+  }
+
+  bool is_full() const noexcept { return used_blocks_ == blocks_count_; }
+  bool is_empty() const noexcept { return used_blocks_ == 0; }
+  size_t get_class_id() const noexcept { return class_id_; }
+  size_t get_block_size() const noexcept { return block_size_; }
+
+  // the list of the pages with free blocks of the same size class
+  memory_slab_page *prev{nullptr};
+  memory_slab_page *next{nullptr};
+
+private:
+  explicit memory_slab_page(size_t class_id) noexcept:
+    class_id_(static_cast<uint32_t>(class_id)),
+    block_size_(static_cast<uint32_t>(get_class_size(class_id))),
+    blocks_count_(static_cast<uint32_t>((PAGE_SIZE - sizeof(memory_slab_page)) / block_size_)) {
+    // the bits out of the page are marked as occupied, so they are never found
+    for (size_t block_id = blocks_count_; block_id != occupied_.size() * 64; ++block_id) {
+      occupied_[block_id / 64] |= uint64_t{1} << (block_id % 64);
+    }
+  }
+
+  char *blocks_begin() noexcept {
+    return reinterpret_cast<char *>(this) + sizeof(memory_slab_page);
+  }
+
+  uint32_t class_id_{0};
+  uint32_t block_size_{0};
+  uint32_t blocks_count_{0};
+  uint32_t used_blocks_{0};
+  uint32_t free_word_hint_{0};
+  // the smallest blocks fill the page completely
+  std::array<uint64_t, PAGE_SIZE / 8 / 64> occupied_{};
+};
+
+static_assert(sizeof(memory_slab_page) % 8 == 0, "the blocks must be aligned");
+static_assert(memory_slab_page::get_class_id(memory_slab_page::MAX_BLOCK_SIZE) == memory_slab_page::CLASSES_COUNT - 1, "check classes count");
+static_assert(memory_slab_page::get_class_size(memory_slab_page::CLASSES_COUNT - 1) == memory_slab_page::MAX_BLOCK_SIZE, "check class size");
+
+} // namespace details
+} // namespace memory_resource
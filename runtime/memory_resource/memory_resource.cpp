@@ -15,6 +15,7 @@ void MemoryStats::write_stats_to(stats_t *stats, const char *prefix) const noexc
   add_gauge_stat(stats, defragmentation_calls, prefix, ".memory.defragmentation_calls");
   add_gauge_stat(stats, huge_memory_pieces, prefix, ".memory.huge_memory_pieces");
   add_gauge_stat(stats, small_memory_pieces, prefix, ".memory.small_memory_pieces");
+  add_gauge_stat(stats, slab_pages, prefix, ".memory.slab_pages");
 }
 
 } // namespace memory_resource
@@ -45,6 +45,7 @@ public:
 
   size_t huge_memory_pieces{0}; // the number of huge memory pirces (in rb tree)
   size_t small_memory_pieces{0}; // the number of small memory pieces (in lists)
+  size_t slab_pages{0}; // the number of slab pages (in the slab mode)
 
   size_t total_allocations{0}; // the total number of allocations
   size_t total_memory_allocated{0}; // the total amount of the memory allocated (doesn't take the freed memory into the account)
@@ -29,7 +29,7 @@ protected:
     if (mem) {
       stats_.memory_used += size;
       stats_.max_memory_used = std::max(stats_.max_memory_used, stats_.memory_used);
-      stats_.real_memory_used = static_cast<size_t>(memory_current_ - memory_begin_);
+      stats_.real_memory_used = get_real_memory_used();
       stats_.max_real_memory_used = std::max(stats_.real_memory_used, stats_.max_real_memory_used);
       ++stats_.total_allocations;
       stats_.total_memory_allocated += size;
@@ -38,7 +38,12 @@ protected:
 
   void register_deallocation(size_t size) noexcept {
     stats_.memory_used -= size;
-    stats_.real_memory_used = static_cast<size_t>(memory_current_ - memory_begin_);
+    stats_.real_memory_used = get_real_memory_used();
+  }
+
+  // the end of the buffer can be taken by a derived resource as well
+  size_t get_real_memory_used() const noexcept {
+    return stats_.memory_limit - static_cast<size_t>(memory_end_ - memory_current_);
   }
 
   bool check_memory_piece(void *mem, size_t size) const noexcept {
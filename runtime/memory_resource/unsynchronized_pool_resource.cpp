@@ -4,6 +4,8 @@
 
 #include "runtime/memory_resource/unsynchronized_pool_resource.h"
 
+#include <csignal>
+
 #include "common/wrappers/likely.h"
 
 #include "runtime/memory_resource/details/memory_ordered_chunk_list.h"
@@ -11,6 +13,7 @@
 namespace memory_resource {
 
 constexpr size_t unsynchronized_pool_resource::MAX_CHUNK_BLOCK_SIZE_;
+constexpr size_t unsynchronized_pool_resource::SLAB_PAGE_PIECE_SIZE_;
 
 void unsynchronized_pool_resource::init(void *buffer, size_t buffer_size) noexcept {
   monotonic_buffer_resource::init(buffer, buffer_size);
@@ -18,12 +21,15 @@ void unsynchronized_pool_resource::init(void *buffer, size_t buffer_size) noexce
   huge_pieces_.hard_reset();
   fallback_resource_.init(nullptr, 0);
   free_chunks_.fill(details::memory_chunk_list{});
+  slab_pages_.fill(nullptr);
+  free_slab_pages_ = details::memory_chunk_list{};
 
   extra_memory_head_ = &extra_memory_tail_;
 }
 
 void unsynchronized_pool_resource::hard_reset() noexcept {
-  init(memory_begin_, memory_end_ - memory_begin_);
+  // the end of the pool may be taken by the slab pages
+  init(memory_begin_, stats_.memory_limit);
 }
 
 void unsynchronized_pool_resource::perform_defragmentation() noexcept {
@@ -89,6 +95,80 @@ void *unsynchronized_pool_resource::perform_defragmentation_and_allocate_huge_pi
   return allocate_huge_piece(aligned_size, false);
 }
 
+details::memory_slab_page *unsynchronized_pool_resource::allocate_slab_page(size_t class_id) noexcept {
+  void *page_mem = get_slab_page_memory();
+  if (!page_mem) {
+    perform_defragmentation();
+    page_mem = get_slab_page_memory();
+  }
+  if (unlikely(!page_mem)) {
+    php_out_of_memory_warning("Can't allocate %zu bytes", details::memory_slab_page::get_class_size(class_id));
+    raise(SIGUSR2);
+    return nullptr;
+  }
+  auto *page = details::memory_slab_page::create(page_mem, class_id);
+  link_slab_page(page);
+  memory_debug("allocate slab page %p for blocks of size %zu\n", page_mem, page->get_block_size());
+  return page;
+}
+
+void unsynchronized_pool_resource::release_slab_page(details::memory_slab_page *page) noexcept {
+  memory_debug("release slab page %p for blocks of size %zu\n", page, page->get_block_size());
+  unlink_slab_page(page);
+  page->~memory_slab_page();
+  // the page is kept for the other size classes, it can't be mixed with the other free pieces
+  free_slab_pages_.put_mem(page);
+}
+
+void *unsynchronized_pool_resource::get_slab_page_memory() noexcept {
+  if (void *page = free_slab_pages_.get_mem()) {
+    return page;
+  }
+
+  constexpr size_t page_size = details::memory_slab_page::PAGE_SIZE;
+  // the pages are taken from the end of the pool, so they are packed without the alignment gaps
+  auto *page = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(memory_end_) & ~(page_size - 1)) - page_size);
+  // only the first page leaves the unaligned tail of the pool behind, it is not used anymore
+  if (memory_current_ <= page && page < memory_end_) {
+    memory_end_ = page;
+    ++stats_.slab_pages;
+    register_deallocation(0);
+    return page;
+  }
+
+  // the pool is over, a piece of this size always contains an aligned page
+  details::memory_chunk_tree::tree_node *huge_piece = huge_pieces_.extract(SLAB_PAGE_PIECE_SIZE_);
+  if (!huge_piece) {
+    return nullptr;
+  }
+  --stats_.huge_memory_pieces;
+  auto *piece = reinterpret_cast<char *>(huge_piece);
+  const size_t piece_size = details::memory_chunk_tree::get_chunk_size(huge_piece);
+  page = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(piece) + page_size - 1) & ~(page_size - 1));
+  if (const size_t tail_size = static_cast<size_t>(piece + piece_size - page - page_size)) {
+    put_memory_back(page + page_size, tail_size);
+  }
+  if (const size_t head_size = static_cast<size_t>(page - piece)) {
+    put_memory_back(piece, head_size);
+  }
+  ++stats_.slab_pages;
+  return page;
+}
+
+void *unsynchronized_pool_resource::reallocate_slab_block(void *mem, size_t aligned_new_size, size_t aligned_old_size) noexcept {
+  constexpr size_t max_block_size = details::memory_slab_page::MAX_BLOCK_SIZE;
+  if (aligned_old_size <= max_block_size && aligned_new_size <= max_block_size &&
+      details::memory_slab_page::get_class_id(aligned_old_size) == details::memory_slab_page::get_class_id(aligned_new_size)) {
+    return mem;
+  }
+  void *new_mem = allocate(aligned_new_size);
+  if (new_mem != nullptr) {
+    memcpy(new_mem, mem, std::min(aligned_old_size, aligned_new_size));
+    deallocate(mem, aligned_old_size);
+  }
+  return new_mem;
+}
+
 bool unsynchronized_pool_resource::is_memory_from_extra_pool(void *mem, size_t size) const noexcept {
   auto *extra_pool = extra_memory_head_;
   do {
@@ -8,6 +8,7 @@
 
 #include "runtime/memory_resource/details/memory_chunk_list.h"
 #include "runtime/memory_resource/details/memory_chunk_tree.h"
+#include "runtime/memory_resource/details/memory_slab_page.h"
 #include "runtime/memory_resource/details/universal_reallocate.h"
 #include "runtime/memory_resource/extra-memory-pool.h"
 #include "runtime/memory_resource/monotonic_buffer_resource.h"
@@ -25,9 +26,25 @@ public:
   void init(void *buffer, size_t buffer_size) noexcept;
   void hard_reset() noexcept;
 
+  // In the slab mode the small pieces are allocated from the slab pages of the size classes,
+  // allocate and deallocate are O(1) for them, and they never need the defragmentation.
+  // The pages are taken from the end of the pool and are kept for the slabs until the reset.
+  // It should be set while there are no allocations, init() and hard_reset() keep the mode.
+  void set_slab_mode(bool enabled) noexcept {
+    php_assert(!stats_.memory_used);
+    slab_mode_ = enabled;
+  }
+
+  bool is_slab_mode() const noexcept {
+    return slab_mode_;
+  }
+
   void *allocate(size_t size) noexcept {
     void *mem = nullptr;
     const auto aligned_size = details::align_for_chunk(size);
+    if (slab_mode_ && aligned_size <= details::memory_slab_page::MAX_BLOCK_SIZE) {
+      return allocate_slab_block(aligned_size);
+    }
     if (aligned_size < MAX_CHUNK_BLOCK_SIZE_) {
       mem = try_allocate_small_piece(aligned_size);
       if (!mem) {
@@ -55,12 +72,20 @@ public:
   void *reallocate(void *mem, size_t new_size, size_t old_size) noexcept {
     const auto aligned_old_size = details::align_for_chunk(old_size);
     const auto aligned_new_size = details::align_for_chunk(new_size);
+    // the slab blocks can't be expanded in place
+    if (slab_mode_ && std::min(aligned_old_size, aligned_new_size) <= details::memory_slab_page::MAX_BLOCK_SIZE) {
+      return reallocate_slab_block(mem, aligned_new_size, aligned_old_size);
+    }
     return details::universal_reallocate(*this, mem, aligned_new_size, aligned_old_size);
   }
 
   void deallocate(void *mem, size_t size) noexcept {
     memory_debug("deallocate %zu at %p\n", size, mem);
     const auto aligned_size = details::align_for_chunk(size);
+    if (slab_mode_ && aligned_size <= details::memory_slab_page::MAX_BLOCK_SIZE) {
+      deallocate_slab_block(mem);
+      return;
+    }
     put_memory_back(mem, aligned_size);
     register_deallocation(aligned_size);
   }
@@ -68,7 +93,13 @@ public:
   void perform_defragmentation() noexcept;
 
   bool is_enough_memory_for(size_t size) const noexcept {
-    const auto aligned_size = details::align_for_chunk(size);
+    auto aligned_size = details::align_for_chunk(size);
+    if (slab_mode_ && aligned_size <= details::memory_slab_page::MAX_BLOCK_SIZE) {
+      if (slab_pages_[details::memory_slab_page::get_class_id(aligned_size)] || !free_slab_pages_.empty()) {
+        return true;
+      }
+      aligned_size = SLAB_PAGE_PIECE_SIZE_;
+    }
     // not using free_chunks_ here as the real size can be smaller
     return static_cast<size_t>(memory_end_ - memory_current_) >= aligned_size || huge_pieces_.has_memory_for(aligned_size);
   }
@@ -114,6 +145,64 @@ private:
     return mem;
   }
 
+  void *allocate_slab_block(size_t aligned_size) noexcept {
+    auto *page = slab_pages_[details::memory_slab_page::get_class_id(aligned_size)];
+    if (unlikely(!page)) {
+      page = allocate_slab_page(details::memory_slab_page::get_class_id(aligned_size));
+      if (!page) {
+        return nullptr;
+      }
+    }
+    void *mem = page->allocate_block();
+    if (page->is_full()) {
+      unlink_slab_page(page);
+    }
+    memory_debug("allocate %zu, slab block of size %zu, allocated address %p\n", aligned_size, page->get_block_size(), mem);
+    register_allocation(mem, page->get_block_size());
+    return mem;
+  }
+
+  void deallocate_slab_block(void *mem) noexcept {
+    auto *page = details::memory_slab_page::get_page_of(mem);
+    const bool was_full = page->is_full();
+    page->deallocate_block(mem);
+    register_deallocation(page->get_block_size());
+    if (was_full) {
+      link_slab_page(page);
+    } else if (page->is_empty() && (page->prev || page->next)) {
+      // keep the last page of the class, so the allocate/deallocate ping-pong doesn't recreate it
+      release_slab_page(page);
+    }
+  }
+
+  void link_slab_page(details::memory_slab_page *page) noexcept {
+    auto &head = slab_pages_[page->get_class_id()];
+    page->prev = nullptr;
+    page->next = head;
+    if (head) {
+      head->prev = page;
+    }
+    head = page;
+  }
+
+  void unlink_slab_page(details::memory_slab_page *page) noexcept {
+    if (page->prev) {
+      page->prev->next = page->next;
+    } else {
+      slab_pages_[page->get_class_id()] = page->next;
+    }
+    if (page->next) {
+      page->next->prev = page->prev;
+    }
+    page->prev = nullptr;
+    page->next = nullptr;
+  }
+
+  details::memory_slab_page *allocate_slab_page(size_t class_id) noexcept;
+  void release_slab_page(details::memory_slab_page *page) noexcept;
+  void *get_slab_page_memory() noexcept;
+  void *reallocate_slab_block(void *mem, size_t aligned_new_size, size_t aligned_old_size) noexcept;
+
   void *allocate_small_piece_from_fallback_resource(size_t aligned_size) noexcept;
   void *perform_defragmentation_and_allocate_huge_piece(size_t aligned_size) noexcept;
   bool is_memory_from_extra_pool(void *mem, size_t size) const noexcept;
@@ -140,6 +229,14 @@ private:
 
   static constexpr size_t MAX_CHUNK_BLOCK_SIZE_{16u * 1024u};
   std::array<details::memory_chunk_list, details::get_chunk_id(MAX_CHUNK_BLOCK_SIZE_)> free_chunks_;
+
+  // a piece of this size always contains an aligned slab page
+  static constexpr size_t SLAB_PAGE_PIECE_SIZE_{2 * details::memory_slab_page::PAGE_SIZE - 8};
+  bool slab_mode_{false};
+  // the pages with free blocks for each size class
+  std::array<details::memory_slab_page *, details::memory_slab_page::CLASSES_COUNT> slab_pages_{};
+  // the released pages, which can be taken by any size class
+  details::memory_chunk_list free_slab_pages_;
 };
 
 } // namespace memory_resource
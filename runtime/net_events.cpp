@@ -7,6 +7,7 @@
 #include "common/precise-time.h"
 
 #include "runtime/allocator.h"
+#include "runtime/curl.h"
 #include "runtime/job-workers/job-interface.h"
 #include "runtime/rpc.h"
 #include "server/php-queries.h"
@@ -49,6 +50,9 @@ static bool process_net_event(net_event_t *e) {
     case net_event_type_t::job_worker_answer:
       process_job_answer(e->slot_id, e->job_result);
       break;
+    case net_event_type_t::curl_socket_ready:
+      process_curl_socket_ready(e->slot_id, e->curl_ready_flags);
+      break;
     default:
       php_critical_error ("unsupported net event %d", static_cast<int>(e->type));
   }
@@ -168,6 +172,7 @@ int wait_net(int timeout_ms) {
   double begin_time = get_precise_now();
   double expire_event_time = 0.0;
 //  fprintf (stderr, "wait_net_begin\n");
+  rpc_flush_deferred_before_wait();
   int finished_events = process_net_events();
   if (finished_events) {
     timeout_ms = 0;
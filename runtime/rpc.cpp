@@ -733,10 +733,9 @@ int64_t rpc_send(const class_instance<C$RpcConnection> &conn, double timeout, bo
   }
 }
 
-void f$rpc_flush() {
-  update_precise_now();
-  wait_net(0);
-  update_precise_now();
+static bool rpc_flush_is_deferred;
+
+static void start_rpc_request_timers() {
   for (array<double>::iterator iter = rpc_request_need_timer.begin(); iter != rpc_request_need_timer.end(); ++iter) {
     int32_t id = static_cast<int32_t>(iter.get_key().to_int());
     rpc_request *cur = get_rpc_request(id);
@@ -748,6 +747,27 @@ void f$rpc_flush() {
   rpc_request_need_timer.clear();
 }
 
+void f$rpc_flush() {
+  rpc_flush_is_deferred = false;
+  update_precise_now();
+  wait_net(0);
+  update_precise_now();
+  start_rpc_request_timers();
+}
+
+void rpc_defer_flush() {
+  rpc_flush_is_deferred = true;
+}
+
+void rpc_flush_deferred_before_wait() {
+  if (rpc_flush_is_deferred) {
+    // the queries themselves are sent by this wait, all together
+    rpc_flush_is_deferred = false;
+    update_precise_now();
+    start_rpc_request_timers();
+  }
+}
+
 int64_t f$rpc_send(const class_instance<C$RpcConnection> &conn, double timeout) {
   int64_t request_id = rpc_send(conn, timeout);
   if (request_id <= 0) {
@@ -1118,7 +1138,7 @@ int64_t rpc_tl_query_impl(const class_instance<C$RpcConnection> &c, const mixed
     return 0;
   }
   if (flush) {
-    f$rpc_flush();
+    rpc_defer_flush();
   }
   if (ignore_answer) {
     return -1;
@@ -1188,7 +1208,7 @@ array<int64_t> f$rpc_tl_query(const class_instance<C$RpcConnection> &c, const ar
     result.set_value(it.get_key(), query_id);
   }
   if (bytes_sent > 0) {
-    f$rpc_flush();
+    rpc_defer_flush();
   }
 
   return result;
@@ -1374,6 +1394,7 @@ static void reset_rpc_global_vars() {
   hard_reset_var(rpc_data_copy_backup);
   hard_reset_var(rpc_request_need_timer);
   fail_rpc_on_int32_overflow = false;
+  rpc_flush_is_deferred = false;
 }
 
 void init_rpc_lib() {
@@ -160,6 +160,10 @@ int64_t f$rpc_send_noflush(const class_instance<C$RpcConnection> &conn, double t
 
 void f$rpc_flush();
 
+// the queries are sent not immediately, but on the next wait for the net events, together with the queries of the other forks
+void rpc_defer_flush();
+void rpc_flush_deferred_before_wait();
+
 Optional<string> f$rpc_get(int64_t request_id, double timeout = -1.0);
 
 Optional<string> f$rpc_get_synchronously(int64_t request_id);
@@ -11,7 +11,8 @@ prepend(KPHP_RUNTIME_JOB_WORKERS_SOURCES job-workers/
         client-functions.cpp
         job-interface.cpp
         processing-jobs.cpp
-        server-functions.cpp)
+        server-functions.cpp
+        shared-memory-pieces.cpp)
 
 prepend(KPHP_RUNTIME_SOURCES ${BASE_DIR}/runtime/
         ${KPHP_RUNTIME_MEMORY_RESOURCE_SOURCES}
@@ -21,7 +22,9 @@ prepend(KPHP_RUNTIME_SOURCES ${BASE_DIR}/runtime/
         bcmath.cpp
         confdata-functions.cpp
         confdata-global-manager.cpp
+        confdata-hash-index.cpp
         confdata-keys.cpp
+        confdata-persistent-storage.cpp
         critical_section.cpp
         curl.cpp
         datetime.cpp
@@ -968,6 +968,10 @@ string::size_type string::find_first_of(const string &s, size_type pos) const {
 }
 
 int64_t string::compare(const string &str) const {
+  // the copies share the buffer, there is no need to touch it
+  if (p == str.p) {
+    return 0;
+  }
   const size_type my_size = size();
   const size_type str_size = str.size();
   const int res = memcmp(p, str.p, std::min(my_size, str_size));
@@ -1068,11 +1072,12 @@ inline void string::destroy() {
 
 
 bool operator==(const string &lhs, const string &rhs) {
-  return lhs.size() == rhs.size() && lhs.compare(rhs) == 0;
+  const string::size_type size = lhs.size();
+  return lhs.c_str() == rhs.c_str() || (size == rhs.size() && !memcmp(lhs.c_str(), rhs.c_str(), size));
 }
 
 bool operator!=(const string &lhs, const string &rhs) {
-  return lhs.size() != rhs.size() || lhs.compare(rhs) != 0;
+  return !(lhs == rhs);
 }
 
 bool is_ok_float(double v) {
@@ -162,7 +162,7 @@ int64_t typed_rpc_tl_query_impl(const class_instance<C$RpcConnection> &connectio
     return 0;
   }
   if (flush) {
-    f$rpc_flush();
+    rpc_defer_flush();
   }
   if (ignore_answer) {
     return -1;
@@ -15,6 +15,7 @@
 #include "common/server/engine-settings.h"
 #include "common/server/init-binlog.h"
 #include "common/server/init-snapshot.h"
+#include "common/wrappers/memory-utils.h"
 #include "common/wrappers/string_view.h"
 #include "common/kfs/kfs.h"
 
@@ -146,19 +147,23 @@ public:
     log_server_warning("Confdata binlog reading error: got unsupported operation '%s' with key '%.*s'", operation_name, std::max(key_len, 0), key);
   }
 
-  void init(memory_resource::unsynchronized_pool_resource &memory_pool) noexcept {
+  void init(memory_resource::unsynchronized_pool_resource &memory_pool, bool track_hash_index_changes) noexcept {
     assert(!updating_confdata_storage_);
-    updating_confdata_storage_ = new(&confdata_mem_)confdata_sample_storage{confdata_sample_storage::allocator_type{memory_pool}};
+    updating_confdata_storage_ = new(&confdata_mem_)confdata_sample_storage{memory_pool};
+    track_hash_index_changes_ = track_hash_index_changes;
   }
 
   struct ConfdataUpdateResult {
     confdata_sample_storage new_confdata;
     std::forward_list<ConfdataGarbageNode> previous_confdata_garbage;
     size_t previous_confdata_garbage_size;
+    size_t updated_nodes_memory;
+    ConfdataHashIndex::Changes hash_index_changes;
   };
 
   ConfdataUpdateResult finish_confdata_update() noexcept {
-    for (auto &confdata_section: *updating_confdata_storage_) {
+    // only the sections updated since the previous sample are visited, the others are already marked and shared
+    const size_t updated_nodes_memory = updating_confdata_storage_->commit_updates([this](confdata_sample_storage::value_type &confdata_section) {
       // save into the separate variable to avoid the const_cast
       string key = confdata_section.first;
       mark_string_as_confdata_const(key);
@@ -167,16 +172,23 @@ public:
       } else if (confdata_section.second.is_string()) {
         mark_string_as_confdata_const(confdata_section.second.as_string());
       }
-    }
+      if (track_hash_index_changes_) {
+        hash_index_changes_.updated_elements.emplace_back(&confdata_section);
+      }
+    });
 
     ConfdataUpdateResult result{
       std::move(*updating_confdata_storage_),
       std::move(*garbage_from_previous_confdata_sample_),
-      garbage_size_
+      garbage_size_,
+      updated_nodes_memory,
+      std::move(hash_index_changes_)
     };
     // do an explicit clear() as a container is left in "a valid but unspecified state" after the move
     updating_confdata_storage_->clear();
     garbage_from_previous_confdata_sample_->clear();
+    hash_index_changes_.updated_elements.clear();
+    hash_index_changes_.erased_keys.clear();
     garbage_size_ = 0;
     confdata_has_any_updates_ = false;
     return result;
@@ -186,6 +198,7 @@ public:
     if (!confdata_has_any_updates_) {
       assert(garbage_from_previous_confdata_sample_->empty());
       if (updating_confdata_storage_->empty()) {
+        // the nodes are shared, they will be copied on the first update
         *updating_confdata_storage_ = previous_confdata_storage;
       } else {
         // strictly speaking, they should be identical, but it's too hard to verify
@@ -222,6 +235,10 @@ public:
     return event_counters_;
   }
 
+  const ConfdataElementsStats &get_elements_stats() const noexcept {
+    return elements_stats_;
+  }
+
 private:
   ConfdataBinlogReplayer() noexcept:
     garbage_from_previous_confdata_sample_(new(&garbage_mem_) GarbageList{}),
@@ -287,12 +304,25 @@ private:
     assert(processing_value_.is_null());
     static_assert(std::is_same<short, int16_t>{}, "short is expected to be int16_t");
 
+    // the processed section contribution is replaced, so the stats are kept up to date without the storage walk
+    auto operation_with_stats = [this, &operation] {
+      const auto &first_key = processing_key_.get_first_key();
+      if (const auto *section = updating_confdata_storage_->find(first_key)) {
+        elements_stats_.remove_section(*section, predefined_wildcards_);
+      }
+      const auto operation_status = operation();
+      if (const auto *section = updating_confdata_storage_->find(first_key)) {
+        elements_stats_.add_section(*section, predefined_wildcards_);
+      }
+      return operation_status;
+    };
+
     OperationStatus last_operation_status{OperationStatus::no_update};
     const auto predefined_wildcard_lengths = predefined_wildcards_.make_predefined_wildcard_len_range_by_key(key_view);
     for (size_t wildcard_len : predefined_wildcard_lengths) {
       assert(wildcard_len <= std::numeric_limits<int16_t>::max());
       processing_key_.update_with_predefined_wildcard(key, key_len, static_cast<int16_t>(wildcard_len));
-      const auto operation_status = operation();
+      const auto operation_status = operation_with_stats();
       assert(last_operation_status != OperationStatus::full_update ||
              operation_status == OperationStatus::full_update);
       last_operation_status = operation_status;
@@ -306,13 +336,13 @@ private:
       const auto first_key_type = processing_key_.update(key, key_len);
       if (predefined_wildcard_lengths.empty() ||
           first_key_type != ConfdataFirstKeyType::simple_key) {
-        const auto operation_status = operation();
+        const auto operation_status = operation_with_stats();
         assert(last_operation_status != OperationStatus::full_update ||
                operation_status == OperationStatus::full_update);
         if (operation_status == OperationStatus::full_update &&
             first_key_type == ConfdataFirstKeyType::two_dots_wildcard) {
           processing_key_.forcibly_change_first_key_wildcard_dots_from_two_to_one();
-          const auto should_be_full = operation();
+          const auto should_be_full = operation_with_stats();
           assert(should_be_full == OperationStatus::full_update);
         }
         last_operation_status = operation_status;
@@ -351,26 +381,29 @@ private:
   }
 
   OperationStatus delete_processing_element() noexcept {
-    auto first_key_it = updating_confdata_storage_->find(processing_key_.get_first_key());
-    if (first_key_it == updating_confdata_storage_->end()) {
+    const auto &first_key = processing_key_.get_first_key();
+    const auto *first_key_element = updating_confdata_storage_->find(first_key);
+    if (!first_key_element) {
       return OperationStatus::no_update;
     }
 
     // for keys without '.'
     if (processing_key_.get_first_key_type() == ConfdataFirstKeyType::simple_key) {
       // move deleted element key and value to garbage
-      put_confdata_element_value_into_garbage(first_key_it->second);
-      put_confdata_var_into_garbage(first_key_it->first, ConfdataGarbageDestroyWay::shallow_first);
-      updating_confdata_storage_->erase(first_key_it);
+      put_confdata_element_value_into_garbage(first_key_element->second);
+      put_confdata_var_into_garbage(first_key_element->first, ConfdataGarbageDestroyWay::shallow_first);
+      erase_section(first_key);
       return OperationStatus::full_update;
     }
 
-    assert(first_key_it->second.is_array());
-    auto &array_for_second_key = first_key_it->second.as_array();
-    if (!array_for_second_key.has_key(processing_key_.get_second_key())) {
+    assert(first_key_element->second.is_array());
+    if (!first_key_element->second.as_array().has_key(processing_key_.get_second_key())) {
       return OperationStatus::no_update;
     }
 
+    auto &first_key_element_for_update = updating_confdata_storage_->find_for_update(first_key);
+    auto &array_for_second_key = first_key_element_for_update.second.as_array();
+
     // move deleted element data to garbage; it will be a copy with RC detachment
     put_confdata_var_into_garbage(array_for_second_key, ConfdataGarbageDestroyWay::shallow_first);
 
@@ -388,15 +421,22 @@ private:
     array_for_second_key.unset(processing_key_.get_second_key());
     if (array_for_second_key.empty()) {
       // name is moved to garbage, the section itself will be removed due to RC detachment (see above)
-      put_confdata_var_into_garbage(first_key_it->first, ConfdataGarbageDestroyWay::shallow_first);
-      updating_confdata_storage_->erase(first_key_it);
+      put_confdata_var_into_garbage(first_key_element_for_update.first, ConfdataGarbageDestroyWay::shallow_first);
+      erase_section(first_key);
     }
     return OperationStatus::full_update;
   }
 
+  void erase_section(const string &first_key) noexcept {
+    if (track_hash_index_changes_) {
+      hash_index_changes_.erased_keys.emplace_back(first_key.c_str(), first_key.size());
+    }
+    updating_confdata_storage_->erase(first_key);
+  }
+
   OperationStatus touch_processing_element() noexcept {
-    auto first_key_it = updating_confdata_storage_->find(processing_key_.get_first_key());
-    if (first_key_it == updating_confdata_storage_->end()) {
+    const auto *first_key_element = updating_confdata_storage_->find(processing_key_.get_first_key());
+    if (!first_key_element) {
       return OperationStatus::no_update;
     }
 
@@ -405,8 +445,8 @@ private:
       return OperationStatus::ttl_update_only;
     }
 
-    assert(first_key_it->second.is_array());
-    auto &array_for_second_key = first_key_it->second.as_array();
+    assert(first_key_element->second.is_array());
+    const auto &array_for_second_key = first_key_element->second.as_array();
     return array_for_second_key.has_key(processing_key_.get_second_key())
            ? OperationStatus::ttl_update_only
            : OperationStatus::no_update;
@@ -414,12 +454,11 @@ private:
 
   template<class BASE, int OPERATION>
   OperationStatus store_processing_element(const lev_confdata_store_wrapper<BASE, OPERATION> &E) noexcept {
-    auto first_key_it = updating_confdata_storage_->find(processing_key_.get_first_key());
-    bool element_exists = true;
-    if (first_key_it == updating_confdata_storage_->end()) {
-      element_exists = false;
-      // during the snapshot loading all keys are already sorted, so it makes sense to push it back
-      first_key_it = updating_confdata_storage_->emplace_hint(first_key_it, processing_key_.make_first_key_copy(), mixed{});
+    const auto &first_key = processing_key_.get_first_key();
+    const auto *first_key_element = updating_confdata_storage_->find(first_key);
+    const bool element_exists = first_key_element != nullptr;
+    if (!element_exists) {
+      first_key_element = &updating_confdata_storage_->insert(processing_key_.make_first_key_copy());
     }
 
     // for keys without '.'
@@ -428,27 +467,31 @@ private:
         return OperationStatus::no_update;
       }
 
-      if (is_new_value(E, first_key_it->second)) {
+      if (is_new_value(E, first_key_element->second)) {
+        auto &value = updating_confdata_storage_->find_for_update(first_key).second;
         // put the previous value to garbage and overwrite it with a new value
-        put_confdata_element_value_into_garbage(first_key_it->second);
-        first_key_it->second = get_processing_value(E);
+        put_confdata_element_value_into_garbage(value);
+        value = get_processing_value(E);
         return OperationStatus::full_update;
       }
       return OperationStatus::ttl_update_only;
     }
 
     // null is inserted by the default
-    if (first_key_it->second.is_null()) {
-      first_key_it->second = prepare_array_for(vk::string_view{first_key_it->first.c_str(), first_key_it->first.size()});
-    }
-    assert(first_key_it->second.is_array());
-    auto &array_for_second_key = first_key_it->second.as_array();
-    const auto *prev_value = element_exists ? array_for_second_key.find_value(processing_key_.get_second_key()) : nullptr;
+    if (first_key_element->second.is_null()) {
+      // the element has been just inserted, so it isn't shared and won't be copied
+      auto &new_element = updating_confdata_storage_->find_for_update(first_key);
+      new_element.second = prepare_array_for(vk::string_view{new_element.first.c_str(), new_element.first.size()});
+      first_key_element = &new_element;
+    }
+    assert(first_key_element->second.is_array());
+    const auto *prev_value = element_exists ? first_key_element->second.as_array().find_value(processing_key_.get_second_key()) : nullptr;
     if (!can_element_be_saved(E, prev_value != nullptr)) {
       return OperationStatus::no_update;
     }
 
     if (!prev_value) {
+      auto &array_for_second_key = updating_confdata_storage_->find_for_update(first_key).second.as_array();
       // move old element data to garbage; it will be a copy with RC detachment
       put_confdata_var_into_garbage(array_for_second_key, ConfdataGarbageDestroyWay::shallow_first);
       array_for_second_key.set_value(processing_key_.make_second_key_copy(), get_processing_value(E));
@@ -457,6 +500,7 @@ private:
       return OperationStatus::full_update;
     }
     if (is_new_value(E, *prev_value)) {
+      auto &array_for_second_key = updating_confdata_storage_->find_for_update(first_key).second.as_array();
       // move old element data to garbage; it will be a copy with RC detachment
       put_confdata_var_into_garbage(array_for_second_key, ConfdataGarbageDestroyWay::shallow_first);
       array_for_second_key.mutate_if_shared();
@@ -642,6 +686,9 @@ private:
   bool confdata_has_any_updates_{false};
   std::unordered_map<vk::string_view, array_size> size_hints_;
   ConfdataStats::EventCounters event_counters_;
+  ConfdataElementsStats elements_stats_;
+  bool track_hash_index_changes_{false};
+  ConfdataHashIndex::Changes hash_index_changes_;
 
   ConfdataKeyMaker processing_key_;
   mixed processing_value_;
@@ -659,6 +706,9 @@ struct {
   size_t memory_limit{2u * 1024u * 1024u * 1024u};
   std::unique_ptr<re2::RE2> key_blacklist_pattern;
   std::unordered_set<vk::string_view> predefined_wildcards;
+  bool use_hash_index{false};
+  bool use_slab_allocator{false};
+  bool use_huge_pages{false};
 
   bool is_enabled() const noexcept {
     return binlog_mask;
@@ -679,6 +729,18 @@ void set_confdata_blacklist_pattern(std::unique_ptr<re2::RE2> &&key_blacklist_pa
   confdata_settings.key_blacklist_pattern = std::move(key_blacklist_pattern);
 }
 
+void set_confdata_use_hash_index() noexcept {
+  confdata_settings.use_hash_index = true;
+}
+
+void set_confdata_use_slab_allocator() noexcept {
+  confdata_settings.use_slab_allocator = true;
+}
+
+void set_confdata_use_huge_pages() noexcept {
+  confdata_settings.use_huge_pages = true;
+}
+
 void add_confdata_predefined_wildcard(const char *wildcard) noexcept {
   assert(wildcard && *wildcard);
   vk::string_view wildcard_value{wildcard};
@@ -715,9 +777,14 @@ void init_confdata_binlog_reader() noexcept {
   confdata_stats.initial_loading_time = -std::chrono::steady_clock::now().time_since_epoch();
 
   auto &confdata_manager = ConfdataGlobalManager::get();
+  confdata_manager.get_resource().set_slab_mode(confdata_settings.use_slab_allocator);
   confdata_manager.init(confdata_settings.memory_limit,
                         std::move(confdata_settings.predefined_wildcards),
-                        std::move(confdata_settings.key_blacklist_pattern));
+                        std::move(confdata_settings.key_blacklist_pattern),
+                        confdata_settings.use_hash_index);
+  if (confdata_settings.use_huge_pages) {
+    our_madvise(confdata_manager.get_resource().memory_begin(), confdata_settings.memory_limit, MADV_HUGEPAGE);
+  }
 
   dl::set_current_script_allocator(confdata_manager.get_resource(), true);
   // engine_default_load_index and engine_default_read_binlog call exit(1) on errors,
@@ -729,7 +796,7 @@ void init_confdata_binlog_reader() noexcept {
   });
 
   auto &confdata_binlog_replayer = ConfdataBinlogReplayer::get();
-  confdata_binlog_replayer.init(confdata_manager.get_resource());
+  confdata_binlog_replayer.init(confdata_manager.get_resource(), confdata_settings.use_hash_index);
   engine_default_load_index(confdata_settings.binlog_mask);
   engine_default_read_binlog();
   confdata_binlog_replayer.delete_expired_elements();
@@ -737,9 +804,9 @@ void init_confdata_binlog_reader() noexcept {
   auto loaded_confdata = confdata_binlog_replayer.finish_confdata_update();
   assert(loaded_confdata.previous_confdata_garbage.empty());
 
-  confdata_stats.on_update(loaded_confdata.new_confdata,
+  confdata_stats.on_update(confdata_binlog_replayer.get_elements_stats(),
                            loaded_confdata.previous_confdata_garbage_size,
-                           confdata_manager.get_predefined_wildcards());
+                           loaded_confdata.updated_nodes_memory);
   confdata_stats.initial_loading_time += confdata_stats.last_update_time_point.time_since_epoch();
 
   confdata_manager.get_current().reset(std::move(loaded_confdata.new_confdata));
@@ -770,11 +837,12 @@ void confdata_binlog_update_cron() noexcept {
   if (confdata_binlog_replayer.has_new_confdata()){
     if (confdata_manager.can_next_be_updated()) {
       auto updated_confdata = confdata_binlog_replayer.finish_confdata_update();
-      confdata_stats.on_update(updated_confdata.new_confdata,
+      confdata_stats.on_update(confdata_binlog_replayer.get_elements_stats(),
                                updated_confdata.previous_confdata_garbage_size,
-                               confdata_manager.get_predefined_wildcards());
+                               updated_confdata.updated_nodes_memory);
       previous_confdata_sample.save_garbage(std::move(updated_confdata.previous_confdata_garbage));
-      const bool switched = confdata_manager.try_switch_to_next_sample(std::move(updated_confdata.new_confdata));
+      const bool switched = confdata_manager.try_switch_to_next_sample(std::move(updated_confdata.new_confdata),
+                                                                    updated_confdata.hash_index_changes);
       assert(switched);
     } else {
       ++confdata_stats.ignored_updates;
@@ -793,6 +861,7 @@ void write_confdata_stats_to(stats_t *stats) noexcept {
     auto &binlog_replayer = ConfdataBinlogReplayer::get();
     confdata_stats.elements_with_delay = binlog_replayer.get_elements_with_delay_count();
     confdata_stats.event_counters = binlog_replayer.get_event_counters();
+    confdata_stats.hash_index_memory_used = ConfdataGlobalManager::get().get_current().get_hash_index_memory_used();
     confdata_stats.write_stats_to(stats, ConfdataGlobalManager::get().get_resource().get_memory_stats());
   }
 }
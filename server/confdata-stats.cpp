@@ -19,56 +19,68 @@ void write_event_stats(stats_t *stats, const char *name, const ConfdataStats::Ev
   add_gauge_stat(stats, event.ttl_updated, name, ".ttl_updated");
 }
 
-} // namespace
-
-void ConfdataStats::on_update(const confdata_sample_storage &new_confdata,
-                              size_t previous_garbage_size,
-                              const ConfdataPredefinedWildcards &confdata_predefined_wildcards) noexcept {
-  last_garbage_size = previous_garbage_size;
-  garbage_statistic_[(total_updates++) % garbage_statistic_.size()] = last_garbage_size;
-
-  total_elements = 0;
-  simple_key_elements = 0;
-  one_dot_wildcards = 0;
-  one_dot_wildcard_elements = 0;
-  two_dots_wildcards = 0;
-  two_dots_wildcard_elements = 0;
-  predefined_wildcards = 0;
-  predefined_wildcard_elements = 0;
-  for (const auto &section: new_confdata) {
-    const vk::string_view first_key{section.first.c_str(), section.first.size()};
-    switch (confdata_predefined_wildcards.detect_first_key_type(first_key)) {
-      case ConfdataFirstKeyType::simple_key:
-        ++simple_key_elements;
-        ++total_elements;
-        break;
-      case ConfdataFirstKeyType::one_dot_wildcard: {
-        assert(section.second.is_array());
-        ++one_dot_wildcards;
-        one_dot_wildcard_elements += section.second.as_array().count();
-        if (!confdata_predefined_wildcards.has_wildcard_for_key(first_key)) {
-          total_elements += section.second.as_array().count();
-        }
-        break;
+template<class F>
+void for_each_section_counter(ConfdataElementsStats &stats,
+                              const confdata_sample_storage::value_type &section,
+                              const ConfdataPredefinedWildcards &confdata_predefined_wildcards,
+                              const F &apply) noexcept {
+  const vk::string_view first_key{section.first.c_str(), section.first.size()};
+  switch (confdata_predefined_wildcards.detect_first_key_type(first_key)) {
+    case ConfdataFirstKeyType::simple_key:
+      apply(stats.simple_key_elements, 1);
+      apply(stats.total_elements, 1);
+      break;
+    case ConfdataFirstKeyType::one_dot_wildcard: {
+      assert(section.second.is_array());
+      apply(stats.one_dot_wildcards, 1);
+      apply(stats.one_dot_wildcard_elements, section.second.as_array().count());
+      if (!confdata_predefined_wildcards.has_wildcard_for_key(first_key)) {
+        apply(stats.total_elements, section.second.as_array().count());
       }
-      case ConfdataFirstKeyType::two_dots_wildcard:
-        assert(section.second.is_array());
-        ++two_dots_wildcards;
-        two_dots_wildcard_elements += section.second.as_array().count();
-        break;
-      case ConfdataFirstKeyType::predefined_wildcard: {
-        assert(section.second.is_array());
-        ++predefined_wildcards;
-        if (confdata_predefined_wildcards.is_most_common_predefined_wildcard(first_key)) {
-          predefined_wildcard_elements += section.second.as_array().count();
-          if (!vk::contains(first_key, ".")) {
-            total_elements += section.second.as_array().count();  
-          }
+      break;
+    }
+    case ConfdataFirstKeyType::two_dots_wildcard:
+      assert(section.second.is_array());
+      apply(stats.two_dots_wildcards, 1);
+      apply(stats.two_dots_wildcard_elements, section.second.as_array().count());
+      break;
+    case ConfdataFirstKeyType::predefined_wildcard: {
+      assert(section.second.is_array());
+      apply(stats.predefined_wildcards, 1);
+      if (confdata_predefined_wildcards.is_most_common_predefined_wildcard(first_key)) {
+        apply(stats.predefined_wildcard_elements, section.second.as_array().count());
+        if (!vk::contains(first_key, ".")) {
+          apply(stats.total_elements, section.second.as_array().count());
         }
-        break;
       }
+      break;
     }
   }
+}
+
+} // namespace
+
+void ConfdataElementsStats::add_section(const confdata_sample_storage::value_type &section,
+                                        const ConfdataPredefinedWildcards &predefined_wildcards) noexcept {
+  for_each_section_counter(*this, section, predefined_wildcards, [](size_t &counter, size_t value) { counter += value; });
+}
+
+void ConfdataElementsStats::remove_section(const confdata_sample_storage::value_type &section,
+                                           const ConfdataPredefinedWildcards &predefined_wildcards) noexcept {
+  for_each_section_counter(*this, section, predefined_wildcards, [](size_t &counter, size_t value) {
+    assert(counter >= value);
+    counter -= value;
+  });
+}
+
+void ConfdataStats::on_update(const ConfdataElementsStats &new_confdata_elements,
+                              size_t previous_garbage_size,
+                              size_t copied_bytes) noexcept {
+  last_garbage_size = previous_garbage_size;
+  garbage_statistic_[(total_updates++) % garbage_statistic_.size()] = last_garbage_size;
+  last_update_copied_bytes = copied_bytes;
+  total_copied_bytes += copied_bytes;
+  elements = new_confdata_elements;
 
   last_update_time_point = std::chrono::steady_clock::now();
 }
@@ -83,17 +95,21 @@ void ConfdataStats::write_stats_to(stats_t *stats, const memory_resource::Memory
 
   add_gauge_stat_long(stats, "confdata.updates.ignored", ignored_updates);
   add_gauge_stat_long(stats, "confdata.updates.total", total_updates);
-
-  add_gauge_stat_long(stats, "confdata.elements.total", total_elements);
-  add_gauge_stat_long(stats, "confdata.elements.simple_key", simple_key_elements);
-  add_gauge_stat_long(stats, "confdata.elements.one_dot_wildcard", one_dot_wildcard_elements);
-  add_gauge_stat_long(stats, "confdata.elements.two_dots_wildcard", two_dots_wildcard_elements);
-  add_gauge_stat_long(stats, "confdata.elements.predefined_wildcard", predefined_wildcard_elements);
+  add_gauge_stat_long(stats, "confdata.updates.copied_bytes_last", last_update_copied_bytes);
+  add_gauge_stat_long(stats, "confdata.updates.copied_bytes_total", total_copied_bytes);
+
+  add_gauge_stat_long(stats, "confdata.elements.total", elements.total_elements);
+  add_gauge_stat_long(stats, "confdata.elements.simple_key", elements.simple_key_elements);
+  add_gauge_stat_long(stats, "confdata.elements.one_dot_wildcard", elements.one_dot_wildcard_elements);
+  add_gauge_stat_long(stats, "confdata.elements.two_dots_wildcard", elements.two_dots_wildcard_elements);
+  add_gauge_stat_long(stats, "confdata.elements.predefined_wildcard", elements.predefined_wildcard_elements);
   add_gauge_stat_long(stats, "confdata.elements.with_delay", elements_with_delay);
 
-  add_gauge_stat_long(stats, "confdata.wildcards.one_dot", one_dot_wildcards);
-  add_gauge_stat_long(stats, "confdata.wildcards.two_dots", two_dots_wildcards);
-  add_gauge_stat_long(stats, "confdata.wildcards.predefined", predefined_wildcards);
+  add_gauge_stat_long(stats, "confdata.wildcards.one_dot", elements.one_dot_wildcards);
+  add_gauge_stat_long(stats, "confdata.wildcards.two_dots", elements.two_dots_wildcards);
+  add_gauge_stat_long(stats, "confdata.wildcards.predefined", elements.predefined_wildcards);
+
+  add_gauge_stat_long(stats, "confdata.hash_index.memory_used", hash_index_memory_used);
 
   size_t last_100_garbage_max = 0;
   double last_100_garbage_avg = 0;
@@ -9,6 +9,21 @@
 #include "common/stats/provider.h"
 #include "runtime/confdata-global-manager.h"
 
+// the counters are updated by the binlog replayer on every section change, so the update doesn't walk the storage
+struct ConfdataElementsStats {
+  size_t total_elements{0};
+  size_t simple_key_elements{0};
+  size_t one_dot_wildcards{0};
+  size_t one_dot_wildcard_elements{0};
+  size_t two_dots_wildcards{0};
+  size_t two_dots_wildcard_elements{0};
+  size_t predefined_wildcards{0};
+  size_t predefined_wildcard_elements{0};
+
+  void add_section(const confdata_sample_storage::value_type &section, const ConfdataPredefinedWildcards &predefined_wildcards) noexcept;
+  void remove_section(const confdata_sample_storage::value_type &section, const ConfdataPredefinedWildcards &predefined_wildcards) noexcept;
+};
+
 struct ConfdataStats : private vk::not_copyable {
   static ConfdataStats &get() noexcept {
     static ConfdataStats confdata_stats;
@@ -25,16 +40,15 @@ struct ConfdataStats : private vk::not_copyable {
   size_t last_garbage_size{0};
   std::array<size_t, 100> garbage_statistic_{{0}};
 
-  size_t total_elements{0};
-  size_t simple_key_elements{0};
-  size_t one_dot_wildcards{0};
-  size_t one_dot_wildcard_elements{0};
-  size_t two_dots_wildcards{0};
-  size_t two_dots_wildcard_elements{0};
-  size_t predefined_wildcards{0};
-  size_t predefined_wildcard_elements{0};
+  // the memory of the storage nodes, which were copied or created by the update
+  size_t last_update_copied_bytes{0};
+  size_t total_copied_bytes{0};
+
+  ConfdataElementsStats elements;
   size_t elements_with_delay{0};
 
+  size_t hash_index_memory_used{0};
+
   struct EventCounters {
     struct Event {
       size_t total{0};
@@ -64,9 +78,9 @@ struct ConfdataStats : private vk::not_copyable {
     size_t unsupported_total_events{0};
   } event_counters;
 
-  void on_update(const confdata_sample_storage &new_confdata,
+  void on_update(const ConfdataElementsStats &new_confdata_elements,
                  size_t previous_garbage_size,
-                 const ConfdataPredefinedWildcards &predefined_wildcards) noexcept;
+                 size_t copied_bytes) noexcept;
   void write_stats_to(stats_t *stats, const memory_resource::MemoryStats &memory_stats) noexcept;
 
 private:
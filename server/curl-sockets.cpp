@@ -0,0 +1,46 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "server/curl-sockets.h"
+
+#include "net/net-events.h"
+
+#include "server/php-engine.h"
+#include "server/php-queries.h"
+#include "server/php-worker.h"
+
+namespace {
+
+int curl_socket_ready(int fd, void *data __attribute__((unused)), event_t *ev) {
+  epoll_remove(fd);
+  if (active_worker == nullptr) {
+    // the script which has watched the socket is already finished
+    return 0;
+  }
+
+  int ready_flags = 0;
+  if (ev->ready & EVT_READ) {
+    ready_flags |= curl_socket_readable;
+  }
+  if (ev->ready & EVT_WRITE) {
+    ready_flags |= curl_socket_writable;
+  }
+  if (ev->ready & EVT_SPEC) {
+    ready_flags |= curl_socket_failed;
+  }
+  on_net_event(create_curl_socket_ready_event(fd, ready_flags));
+  return 0;
+}
+
+} // namespace
+
+void curl_socket_watch(int fd, bool want_read, bool want_write) noexcept {
+  const int flags = (want_read ? EVT_READ : 0) | (want_write ? EVT_WRITE : 0) | EVT_SPEC | EVT_LEVEL;
+  epoll_sethandler(fd, 0, curl_socket_ready, nullptr);
+  epoll_insert(fd, flags);
+}
+
+void curl_socket_unwatch(int fd) noexcept {
+  epoll_close(fd);
+}
@@ -0,0 +1,19 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+// Sockets of curl transfers are polled by the worker net reactor instead of curl_easy_perform / curl_multi_wait.
+// A watched socket is one-shot: when it becomes ready, it's removed from the reactor
+// and the readiness is delivered to the script as a curl_socket_ready net event.
+// The script rearms the socket after curl_multi_socket_action()
+
+enum curl_socket_ready_flags {
+  curl_socket_readable = 1,
+  curl_socket_writable = 2,
+  curl_socket_failed = 4
+};
+
+void curl_socket_watch(int fd, bool want_read, bool want_write) noexcept;
+void curl_socket_unwatch(int fd) noexcept;
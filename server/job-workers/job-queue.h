@@ -0,0 +1,347 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#include "common/mixin/not_copyable.h"
+
+#include "server/workers-control.h"
+
+namespace job_workers {
+
+struct JobSharedMessage;
+
+// The jobs are prioritized by their timeouts: the short jobs are usually latency critical,
+// so they shouldn't wait behind a burst of the slow batch jobs
+enum class JobPriority : uint8_t {
+  high,
+  normal,
+  low
+};
+
+constexpr size_t JOB_PRIORITIES_COUNT = 3;
+constexpr double JOB_HIGH_PRIORITY_MAX_TIMEOUT = 1.0;
+constexpr double JOB_NORMAL_PRIORITY_MAX_TIMEOUT = 10.0;
+
+inline JobPriority get_job_priority(double job_timeout) noexcept {
+  if (job_timeout <= JOB_HIGH_PRIORITY_MAX_TIMEOUT) {
+    return JobPriority::high;
+  }
+  return job_timeout <= JOB_NORMAL_PRIORITY_MAX_TIMEOUT ? JobPriority::normal : JobPriority::low;
+}
+
+// The bounded lock-free MPMC queue of the jobs (D. Vyukov's algorithm), which is placed into the job workers shared memory.
+// Unlike the original algorithm, a cell is claimed by the CAS of its sequence, which keeps the id of the claiming process,
+// and the queue position is advanced after that by the claimer or by anyone who finds the claimed cell.
+// So if a process dies in the middle of the push or the pop, the master can find its cells and complete them (see release_claims).
+class JobQueue : vk::not_copyable {
+public:
+  static size_t get_memory_size(uint32_t min_capacity) noexcept {
+    return sizeof(JobQueue) + round_up_capacity(min_capacity) * sizeof(Cell);
+  }
+
+  // the memory must be get_memory_size(min_capacity) bytes
+  static JobQueue *create(void *memory, uint32_t min_capacity) noexcept {
+    return new(memory) JobQueue{round_up_capacity(min_capacity)};
+  }
+
+  // returns false if the queue is full
+  bool push(JobSharedMessage *job, int64_t enqueue_time_ns, double deadline, uint16_t process_id) noexcept {
+    uint64_t pos = 0;
+    Cell *cell = claim_cell_for_push(process_id, pos);
+    if (!cell) {
+      return false;
+    }
+    cell->job = job;
+    cell->enqueue_time_ns = enqueue_time_ns;
+    cell->deadline.store(deadline, std::memory_order_relaxed);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // returns nullptr if the queue is empty
+  JobSharedMessage *pop(int64_t &enqueue_time_ns, uint16_t process_id) noexcept {
+    uint64_t pos = 0;
+    while (Cell *cell = claim_cell_for_pop(process_id, pos)) {
+      JobSharedMessage *job = cell->job;
+      enqueue_time_ns = cell->enqueue_time_ns;
+      cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+      // the cell may be left by a producer that has died, it's skipped
+      if (job) {
+        return job;
+      }
+    }
+    return nullptr;
+  }
+
+  // the deadline of the first job or infinity if the queue is empty;
+  // the job may be taken concurrently, so this is only a hint
+  double peek_deadline() const noexcept {
+    const uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const Cell &cell = cells()[pos & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return cell.deadline.load(std::memory_order_relaxed);
+  }
+
+  // Completes the pushes and the pops of the dead process, must be called when the process can't run anymore.
+  // The pushed cells are left empty and are skipped by the consumers, their number is returned;
+  // the popped jobs are lost for the queue and are passed to on_lost_job.
+  template<class F>
+  uint32_t release_claims(uint16_t process_id, const F &on_lost_job) noexcept {
+    uint32_t abandoned_pushes = 0;
+    for (uint64_t i = 0; i <= mask_; ++i) {
+      Cell &cell = cells()[i];
+      const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+      if (!is_claim(sequence) || get_claim_process_id(sequence) != process_id) {
+        continue;
+      }
+      const uint64_t pos = sequence & POSITION_MASK;
+      if (sequence & POP_CLAIM_BIT) {
+        advance(dequeue_pos_, pos);
+        if (cell.job) {
+          on_lost_job(cell.job);
+        }
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+      } else {
+        advance(enqueue_pos_, pos);
+        cell.job = nullptr;
+        cell.enqueue_time_ns = 0;
+        cell.deadline.store(0, std::memory_order_relaxed);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        ++abandoned_pushes;
+      }
+    }
+    return abandoned_pushes;
+  }
+
+  uint32_t capacity() const noexcept {
+    return static_cast<uint32_t>(mask_ + 1);
+  }
+
+private:
+  friend struct JobQueueTestAccess;
+
+  struct Cell {
+    std::atomic<uint64_t> sequence{0};
+    JobSharedMessage *job{nullptr};
+    int64_t enqueue_time_ns{0};
+    std::atomic<double> deadline{0};
+  };
+
+  // the claimed cell sequence: [63] claim, [62] pop, [52..61] the process id, [0..51] the position;
+  // the positions are the operations counters, so they never reach 2^52
+  static constexpr uint64_t CLAIM_BIT = uint64_t{1} << 63;
+  static constexpr uint64_t POP_CLAIM_BIT = uint64_t{1} << 62;
+  static constexpr int PROCESS_ID_SHIFT = 52;
+  static constexpr uint64_t POSITION_MASK = (uint64_t{1} << PROCESS_ID_SHIFT) - 1;
+  static constexpr uint64_t PROCESS_ID_MASK = (POP_CLAIM_BIT - 1) & ~POSITION_MASK;
+  static_assert(WorkersControl::max_workers_count <= (PROCESS_ID_MASK >> PROCESS_ID_SHIFT) + 1, "the process id doesn't fit the claim");
+
+  static bool is_claim(uint64_t sequence) noexcept {
+    return sequence & CLAIM_BIT;
+  }
+
+  static uint16_t get_claim_process_id(uint64_t sequence) noexcept {
+    return static_cast<uint16_t>((sequence & PROCESS_ID_MASK) >> PROCESS_ID_SHIFT);
+  }
+
+  // the cell is claimed at the position by any process
+  static bool is_claim_of(uint64_t sequence, uint64_t pos, uint64_t pop_bit) noexcept {
+    return (sequence & ~PROCESS_ID_MASK) == (CLAIM_BIT | pop_bit | pos);
+  }
+
+  static uint64_t make_claim(uint64_t pos, uint16_t process_id, uint64_t pop_bit) noexcept {
+    return CLAIM_BIT | pop_bit | (uint64_t{process_id} << PROCESS_ID_SHIFT) | pos;
+  }
+
+  // the sequence the claimed cell had before the claim
+  static uint64_t get_unclaimed(uint64_t sequence) noexcept {
+    if (!is_claim(sequence)) {
+      return sequence;
+    }
+    return (sequence & POSITION_MASK) + ((sequence & POP_CLAIM_BIT) ? 1 : 0);
+  }
+
+  static void advance(std::atomic<uint64_t> &queue_pos, uint64_t claimed_pos) noexcept {
+    queue_pos.compare_exchange_strong(claimed_pos, claimed_pos + 1, std::memory_order_relaxed);
+  }
+
+  // returns nullptr if the queue is full
+  Cell *claim_cell_for_push(uint16_t process_id, uint64_t &pos) noexcept {
+    pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells()[pos & mask_];
+      uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+      if (sequence == pos) {
+        if (cell.sequence.compare_exchange_weak(sequence, make_claim(pos, process_id, 0), std::memory_order_relaxed)) {
+          advance(enqueue_pos_, pos);
+          return &cell;
+        }
+      } else if (is_claim_of(sequence, pos, 0)) {
+        // the cell is claimed by another producer, which may be not yet advanced the position
+        advance(enqueue_pos_, pos);
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      } else if (get_unclaimed(sequence) < pos) {
+        return nullptr;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // returns nullptr if the queue is empty
+  Cell *claim_cell_for_pop(uint16_t process_id, uint64_t &pos) noexcept {
+    pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells()[pos & mask_];
+      uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+      if (sequence == pos + 1) {
+        if (cell.sequence.compare_exchange_weak(sequence, make_claim(pos, process_id, POP_CLAIM_BIT), std::memory_order_acquire)) {
+          advance(dequeue_pos_, pos);
+          return &cell;
+        }
+      } else if (is_claim_of(sequence, pos, POP_CLAIM_BIT)) {
+        // the cell is claimed by another consumer, which may be not yet advanced the position
+        advance(dequeue_pos_, pos);
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      } else if (get_unclaimed(sequence) < pos + 1) {
+        return nullptr;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static uint32_t round_up_capacity(uint32_t min_capacity) noexcept {
+    uint32_t capacity = 2;
+    while (capacity < min_capacity) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  explicit JobQueue(uint32_t capacity) noexcept:
+    mask_(capacity - 1) {
+    for (uint32_t i = 0; i != capacity; ++i) {
+      new(&cells()[i]) Cell{};
+      cells()[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  Cell *cells() noexcept {
+    return reinterpret_cast<Cell *>(this + 1);
+  }
+
+  const Cell *cells() const noexcept {
+    return reinterpret_cast<const Cell *>(this + 1);
+  }
+
+  // the producers and the consumers work with the different cache lines
+  alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(64) std::atomic<uint64_t> dequeue_pos_{0};
+  alignas(64) const uint64_t mask_{0};
+};
+
+// The queues of all the priorities.
+// The clients push the jobs without syscalls; the job workers take the next job right after the previous one is finished,
+// and they are woken up via the job pipe only when they are idle (see idle_workers).
+class JobScheduler : vk::not_copyable {
+public:
+  static size_t get_memory_size(uint32_t queue_capacity) noexcept {
+    return sizeof(JobScheduler) + JOB_PRIORITIES_COUNT * JobQueue::get_memory_size(queue_capacity);
+  }
+
+  // the memory must be get_memory_size(queue_capacity) bytes
+  static JobScheduler *create(void *memory, uint32_t queue_capacity) noexcept {
+    return new(memory) JobScheduler{queue_capacity};
+  }
+
+  bool push(JobSharedMessage *job, JobPriority priority, int64_t enqueue_time_ns, double deadline, uint16_t process_id) noexcept {
+    return queues_[static_cast<size_t>(priority)]->push(job, enqueue_time_ns, deadline, process_id);
+  }
+
+  // takes the job with the earliest deadline among the first jobs of the queues,
+  // the queues are FIFO, but the jobs of the same priority have the similar timeouts
+  JobSharedMessage *pop(JobPriority &priority, int64_t &enqueue_time_ns, uint16_t process_id) noexcept {
+    for (;;) {
+      size_t earliest = JOB_PRIORITIES_COUNT;
+      double earliest_deadline = std::numeric_limits<double>::infinity();
+      for (size_t i = 0; i != JOB_PRIORITIES_COUNT; ++i) {
+        const double deadline = queues_[i]->peek_deadline();
+        if (deadline < earliest_deadline) {
+          earliest = i;
+          earliest_deadline = deadline;
+        }
+      }
+      if (earliest == JOB_PRIORITIES_COUNT) {
+        return nullptr;
+      }
+      if (JobSharedMessage *job = queues_[earliest]->pop(enqueue_time_ns, process_id)) {
+        priority = static_cast<JobPriority>(earliest);
+        return job;
+      }
+      // the job has been taken by another worker, look again
+    }
+  }
+
+  template<class F>
+  uint32_t release_claims(uint16_t process_id, const F &on_lost_job) noexcept {
+    uint32_t abandoned_pushes = 0;
+    for (auto *queue : queues_) {
+      abandoned_pushes += queue->release_claims(process_id, on_lost_job);
+    }
+    return abandoned_pushes;
+  }
+
+  // the worker is counted in idle_workers before it rechecks the queues;
+  // the process is marked after the increment, so its death in between may only cause the extra wakeups, not the lost ones
+  void mark_idle(uint16_t process_id) noexcept {
+    idle_workers.fetch_add(1, std::memory_order_seq_cst);
+    idle_processes_[process_id].store(true, std::memory_order_relaxed);
+  }
+
+  void unmark_idle(uint16_t process_id) noexcept {
+    idle_processes_[process_id].store(false, std::memory_order_relaxed);
+    idle_workers.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // called by the master for the dead process, which may have exited or crashed while idle;
+  // returns true, if the process was counted in idle_workers
+  bool release_idle(uint16_t process_id) noexcept {
+    if (idle_processes_[process_id].exchange(false, std::memory_order_relaxed)) {
+      idle_workers.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  // The job workers, which have found the queues empty and wait for the wakeup.
+  // A client pushes the job and then checks this counter, while a worker increments it and then checks the queues,
+  // both with the full fence in between, so at least one of them sees the other.
+  alignas(64) std::atomic<int32_t> idle_workers{0};
+
+private:
+  explicit JobScheduler(uint32_t queue_capacity) noexcept {
+    auto *queue_memory = reinterpret_cast<uint8_t *>(this + 1);
+    for (auto &queue : queues_) {
+      queue = JobQueue::create(queue_memory, queue_capacity);
+      queue_memory += JobQueue::get_memory_size(queue_capacity);
+    }
+  }
+
+  std::array<JobQueue *, JOB_PRIORITIES_COUNT> queues_{};
+  // the processes counted in idle_workers, so that the count is fixed when a process dies
+  std::array<std::atomic<bool>, WorkersControl::max_workers_count> idle_processes_{};
+};
+
+} // namespace job_workers
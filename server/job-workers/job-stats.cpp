@@ -2,7 +2,9 @@
 // Copyright (c) 2020 LLC «V Kontakte»
 // Distributed under the GPL v3 License, see LICENSE.notice.txt
 
+#include <algorithm>
 #include <new>
+#include <string>
 #include <sys/mman.h>
 
 #include "runtime/memory_resource/extra-memory-pool.h"
@@ -27,12 +29,44 @@ size_t JobStats::MemoryBufferStats::write_stats_to(stats_t *stats, const char *p
   return memory_used;
 }
 
+void JobStats::PriorityStats::add_wait_time(int64_t wait_time_ns) noexcept {
+  const auto wait_time_us = static_cast<uint64_t>(std::max(wait_time_ns, int64_t{0}) / 1000);
+  const size_t bucket = wait_time_us ? std::min<size_t>(64 - __builtin_clzll(wait_time_us), wait_time_histogram.size() - 1) : 0;
+  wait_time_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t JobStats::PriorityStats::get_wait_time_percentile_us(double percentile) const noexcept {
+  uint64_t total = 0;
+  for (const auto &bucket : wait_time_histogram) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  const auto rank = static_cast<uint64_t>(percentile * total);
+  uint64_t counted = 0;
+  for (size_t i = 0; i != wait_time_histogram.size(); ++i) {
+    counted += wait_time_histogram[i].load(std::memory_order_relaxed);
+    if (counted > rank) {
+      // the upper bound of the bucket
+      return i ? uint64_t{1} << i : 0;
+    }
+  }
+  return 0;
+}
+
+void JobStats::PriorityStats::write_stats_to(stats_t *stats, const char *prefix) const noexcept {
+  add_gauge_stat(stats, started, prefix, "started");
+  add_gauge_stat(stats, expired, prefix, "expired");
+  add_gauge_stat(stats, get_wait_time_percentile_us(0.5), prefix, "wait_time_us.p50");
+  add_gauge_stat(stats, get_wait_time_percentile_us(0.95), prefix, "wait_time_us.p95");
+  add_gauge_stat(stats, get_wait_time_percentile_us(0.99), prefix, "wait_time_us.p99");
+}
+
 void JobStats::write_stats_to(stats_t *stats) const noexcept {
   const char *prefix = "workers.job.";
   add_gauge_stat(stats, errors_pipe_server_write, prefix, "pipe_errors.server_write");
   add_gauge_stat(stats, errors_pipe_server_read, prefix, "pipe_errors.server_read");
   add_gauge_stat(stats, errors_pipe_client_write, prefix, "pipe_errors.client_write");
   add_gauge_stat(stats, errors_pipe_client_read, prefix, "pipe_errors.client_read");
+  add_gauge_stat(stats, errors_queue_full, prefix, "queue_errors.full");
 
   add_gauge_stat(stats, job_worker_skip_job_due_another_is_running, prefix, "jobs.skip.another_is_running");
   add_gauge_stat(stats, job_worker_skip_job_due_steal, prefix, "jobs.skip.steal");
@@ -40,6 +74,31 @@ void JobStats::write_stats_to(stats_t *stats) const noexcept {
   add_gauge_stat(stats, job_queue_size, prefix, "jobs.queue_size");
   add_gauge_stat(stats, jobs_sent, prefix, "jobs.sent");
   add_gauge_stat(stats, jobs_replied, prefix, "jobs.replied");
+  add_gauge_stat(stats, jobs_started, prefix, "jobs.started");
+  add_gauge_stat(stats, job_queue_wakeups, prefix, "jobs.queue_wakeups");
+  add_gauge_stat(stats, job_queue_wait_time_ns.load(std::memory_order_relaxed) / 1000, prefix, "jobs.queue_wait_time_us");
+
+  constexpr std::array<const char *, JOB_PRIORITIES_COUNT> priority_prefixes{
+    "workers.job.jobs.priority.high.",
+    "workers.job.jobs.priority.normal.",
+    "workers.job.jobs.priority.low.",
+  };
+  for (size_t i = 0; i != JOB_PRIORITIES_COUNT; ++i) {
+    priorities[i].write_stats_to(stats, priority_prefixes[i]);
+  }
+
+  add_gauge_stat(stats, shared_memory_pieces.published, prefix, "memory.shared_memory_pieces.published");
+  add_gauge_stat(stats, shared_memory_pieces.reused, prefix, "memory.shared_memory_pieces.reused");
+  add_gauge_stat(stats, shared_memory_pieces.published_bytes, prefix, "memory.shared_memory_pieces.published_bytes");
+  // the memory, which isn't copied due to the reuse
+  add_gauge_stat(stats, shared_memory_pieces.reused_bytes, prefix, "memory.shared_memory_pieces.reused_bytes");
+
+  const auto &job_worker_pools = vk::singleton<JobWorkerPools>::get();
+  for (size_t pool_id = 0; pool_id != job_worker_pools.get_pools_count(); ++pool_id) {
+    const std::string pool_prefix = "workers.job.pools." + job_worker_pools.get_pool(pool_id).name + ".";
+    add_gauge_stat(stats, pools[pool_id].jobs_sent, pool_prefix.c_str(), "jobs.sent");
+    add_gauge_stat(stats, pools[pool_id].jobs_started, pool_prefix.c_str(), "jobs.started");
+  }
 
   size_t currently_used = messages.write_stats_to(stats, "workers.job.memory.messages.shared_messages.", JOB_SHARED_MESSAGE_BYTES);
   constexpr std::array<const char *, JOB_EXTRA_MEMORY_BUFFER_BUCKETS> extra_memory_prefixes{
@@ -11,6 +11,8 @@
 #include "common/stats/provider.h"
 
 #include "server/job-workers/job-message.h"
+#include "server/job-workers/job-queue.h"
+#include "server/job-workers/job-worker-pools.h"
 
 namespace job_workers {
 
@@ -20,6 +22,7 @@ public:
   std::atomic<uint32_t> errors_pipe_server_read{0};
   std::atomic<uint32_t> errors_pipe_client_write{0};
   std::atomic<uint32_t> errors_pipe_client_read{0};
+  std::atomic<uint32_t> errors_queue_full{0};
 
   std::atomic<uint32_t> job_worker_skip_job_due_another_is_running{0};
   std::atomic<size_t> job_worker_skip_job_due_steal{0};
@@ -27,6 +30,9 @@ public:
   std::atomic<size_t> jobs_sent{0};
   std::atomic<size_t> jobs_replied{0};
   std::atomic<int32_t> job_queue_size{0};
+  std::atomic<size_t> job_queue_wakeups{0};
+  std::atomic<size_t> jobs_started{0};
+  std::atomic<uint64_t> job_queue_wait_time_ns{0};
 
   uint32_t unused_memory{0};
   size_t memory_limit{0};
@@ -40,6 +46,36 @@ public:
     size_t write_stats_to(stats_t *stats, const char *prefix, size_t buffer_size) const noexcept;
   };
 
+  struct PriorityStats : private vk::not_copyable {
+    std::atomic<size_t> started{0};
+    std::atomic<size_t> expired{0};
+    // the bucket i counts the queue wait times in [2^(i-1), 2^i) microseconds
+    std::array<std::atomic<uint64_t>, 32> wait_time_histogram{};
+
+    void add_wait_time(int64_t wait_time_ns) noexcept;
+    uint64_t get_wait_time_percentile_us(double percentile) const noexcept;
+    void write_stats_to(stats_t *stats, const char *prefix) const noexcept;
+  };
+
+  std::array<PriorityStats, JOB_PRIORITIES_COUNT> priorities{};
+
+  struct PoolStats : private vk::not_copyable {
+    std::atomic<size_t> jobs_sent{0};
+    std::atomic<size_t> jobs_started{0};
+  };
+
+  std::array<PoolStats, JobWorkerPools::MAX_POOLS_COUNT> pools{};
+
+  // the immutable shared memory pieces, which are copied into the job shared memory once and bound to many jobs
+  struct SharedMemoryPiecesStats : private vk::not_copyable {
+    std::atomic<size_t> published{0};
+    std::atomic<size_t> reused{0};
+    std::atomic<uint64_t> published_bytes{0};
+    std::atomic<uint64_t> reused_bytes{0};
+  };
+
+  SharedMemoryPiecesStats shared_memory_pieces;
+
   MemoryBufferStats messages;
   std::array<MemoryBufferStats, JOB_EXTRA_MEMORY_BUFFER_BUCKETS> extra_memory{};
 
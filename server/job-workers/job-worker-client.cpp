@@ -2,7 +2,9 @@
 // Copyright (c) 2020 LLC «V Kontakte»
 // Distributed under the GPL v3 License, see LICENSE.notice.txt
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <unistd.h>
 
 #include "common/kprintf.h"
@@ -12,9 +14,11 @@
 
 #include "server/job-workers/job-message.h"
 #include "server/job-workers/job-worker-client.h"
+#include "server/job-workers/job-worker-pools.h"
 #include "server/job-workers/job-workers-context.h"
 #include "server/job-workers/job-stats.h"
 #include "server/job-workers/shared-memory-manager.h"
+#include "server/php-engine-vars.h"
 #include "server/php-engine.h"
 #include "server/php-queries.h"
 #include "server/server-log.h"
@@ -62,7 +66,10 @@ void JobWorkerClient::init(int job_result_slot) {
 
   assert(job_workers_ctx.pipes_inited);
 
-  write_job_fd = job_workers_ctx.job_pipe[1];
+  write_job_fds.clear();
+  for (const auto &job_pipe : job_workers_ctx.job_pipes) {
+    write_job_fds.emplace_back(job_pipe[1]);
+  }
 
   for (int i = 0; i < job_workers_ctx.result_pipes.size(); ++i) {
     auto &result_pipe = job_workers_ctx.result_pipes[i];
@@ -84,20 +91,39 @@ void JobWorkerClient::init(int job_result_slot) {
 
 int JobWorkerClient::send_job(JobSharedMessage *job_request) {
   slot_id_t job_id = parallel_job_ids_factory.create_slot();
+  const size_t pool_id = vk::singleton<JobWorkerPools>::get().get_pool_id_by_request_class(job_request->instance.get()->get_class());
 
-  tvkprintf(job_workers, 2, "sending job: <job_result_fd_idx, job_id> = <%d, %d> , job_memory_ptr = %p, write_job_fd = %d\n",
-            job_result_fd_idx, job_id, job_request, write_job_fd);
+  tvkprintf(job_workers, 2, "sending job: <job_result_fd_idx, job_id> = <%d, %d> , job_memory_ptr = %p, pool_id = %zu\n",
+            job_result_fd_idx, job_id, job_request, pool_id);
 
   job_request->job_id = job_id;
   job_request->job_result_fd_idx = job_result_fd_idx;
-  bool success = job_writer.write_job(job_request, write_job_fd);
-  if (!success) {
-    ++vk::singleton<SharedMemoryManager>::get().get_stats().errors_pipe_client_write;
+
+  auto &memory_manager = vk::singleton<SharedMemoryManager>::get();
+  auto &stats = memory_manager.get_stats();
+  auto &job_scheduler = memory_manager.get_job_scheduler(pool_id);
+  const auto enqueue_time = std::chrono::steady_clock::now().time_since_epoch();
+  ++stats.job_queue_size;
+  if (!job_scheduler.push(job_request, get_job_priority(job_request->job_timeout),
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(enqueue_time).count(), job_request->job_deadline_time(),
+                          logname_id)) {
+    --stats.job_queue_size;
+    ++stats.errors_queue_full;
     return -1;
   }
-
-  ++vk::singleton<SharedMemoryManager>::get().get_stats().job_queue_size;
-  ++vk::singleton<SharedMemoryManager>::get().get_stats().jobs_sent;
+  ++stats.jobs_sent;
+  ++stats.pools[pool_id].jobs_sent;
+
+  // the busy workers take the job from the queue themselves, the pipe is written only if someone waits on it
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (job_scheduler.idle_workers.load(std::memory_order_relaxed) > 0) {
+    if (job_writer.write_job_wakeup(write_job_fds[pool_id])) {
+      ++stats.job_queue_wakeups;
+    } else {
+      // the job is already in the queue, so it will be taken by the next finished worker
+      ++stats.errors_pipe_client_write;
+    }
+  }
   return job_id;
 }
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 #include "common/algorithms/find.h"
 #include "common/mixin/not_copyable.h"
@@ -26,14 +27,15 @@ public:
 
   int job_result_fd_idx{-1};
   int read_job_result_fd{-1};
-  int write_job_fd{-1};
+  // the wakeup pipes of the job worker pools
+  std::vector<int> write_job_fds;
   PipeJobWriter job_writer;
   PipeJobReader job_reader;
 
   void init(int job_result_slot);
 
   bool is_inited() const {
-    return vk::none_of_equal(-1, job_result_fd_idx, read_job_result_fd, write_job_fd);
+    return vk::none_of_equal(-1, job_result_fd_idx, read_job_result_fd) && !write_job_fds.empty();
   }
 
   int send_job(JobSharedMessage *job_request);
@@ -0,0 +1,138 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include "server/job-workers/job-worker-pools.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <yaml-cpp/yaml.h>
+
+#include "common/kprintf.h"
+#include "common/options.h"
+
+namespace job_workers {
+
+namespace {
+
+std::string normalize_class_name(std::string class_name) {
+  // get_class() returns the names without the leading slash
+  if (!class_name.empty() && class_name.front() == '\\') {
+    class_name.erase(0, 1);
+  }
+  return class_name;
+}
+
+JobWorkerPool parse_pool(const YAML::Node &node) {
+  JobWorkerPool pool;
+  if (!node["name"] || !node["workers"] || !node["classes"]) {
+    throw std::runtime_error("each pool must have 'name', 'workers' and 'classes'");
+  }
+  pool.name = node["name"].as<std::string>();
+  if (pool.name.empty() || pool.name == "default") {
+    throw std::runtime_error("pool name must be non empty and differ from 'default'");
+  }
+  const int workers_count = node["workers"].as<int>();
+  if (workers_count <= 0) {
+    throw std::runtime_error("pool '" + pool.name + "' must have positive 'workers'");
+  }
+  pool.workers_count = static_cast<uint16_t>(workers_count);
+  if (const auto &memory_limit = node["memory_limit"]) {
+    pool.memory_limit = parse_memory_limit(memory_limit.as<std::string>().c_str());
+    if (pool.memory_limit < (1 << 20) || pool.memory_limit > (2047LL << 20)) {
+      throw std::runtime_error("pool '" + pool.name + "' has incorrect 'memory_limit'");
+    }
+  }
+  for (const auto &class_node : node["classes"]) {
+    pool.request_classes.emplace_back(normalize_class_name(class_node.as<std::string>()));
+  }
+  if (pool.request_classes.empty()) {
+    throw std::runtime_error("pool '" + pool.name + "' has empty 'classes'");
+  }
+  return pool;
+}
+
+} // namespace
+
+JobWorkerPools::JobWorkerPools() noexcept {
+  JobWorkerPool default_pool;
+  default_pool.name = "default";
+  pools_.emplace_back(std::move(default_pool));
+}
+
+int JobWorkerPools::parse_config(const char *config_file) noexcept {
+  try {
+    const YAML::Node node = YAML::LoadFile(config_file);
+    auto pools = pools_;
+    auto class_to_pool = class_to_pool_;
+    for (const auto &pool_node : node["pools"]) {
+      if (pools.size() == MAX_POOLS_COUNT) {
+        throw std::runtime_error("too many pools, the limit is " + std::to_string(MAX_POOLS_COUNT - 1));
+      }
+      JobWorkerPool pool = parse_pool(pool_node);
+      for (const auto &other : pools) {
+        if (other.name == pool.name) {
+          throw std::runtime_error("pool '" + pool.name + "' is declared twice");
+        }
+      }
+      for (const auto &request_class : pool.request_classes) {
+        if (!class_to_pool.emplace(request_class, pools.size()).second) {
+          throw std::runtime_error("class '" + request_class + "' is bound to several pools");
+        }
+      }
+      pools.emplace_back(std::move(pool));
+    }
+    pools_ = std::move(pools);
+    class_to_pool_ = std::move(class_to_pool);
+  } catch (const std::exception &e) {
+    kprintf("--job-workers-pools-config option, incorrect config '%s'\n%s\n", config_file, e.what());
+    return -1;
+  }
+  return 0;
+}
+
+bool JobWorkerPools::init(uint16_t job_workers_count) noexcept {
+  uint16_t dedicated_workers = 0;
+  for (size_t pool_id = DEFAULT_POOL_ID + 1; pool_id != pools_.size(); ++pool_id) {
+    dedicated_workers += pools_[pool_id].workers_count;
+  }
+  if (pools_.size() > 1 && dedicated_workers >= job_workers_count) {
+    return false;
+  }
+  pools_[DEFAULT_POOL_ID].workers_count = job_workers_count - dedicated_workers;
+  return true;
+}
+
+uint16_t JobWorkerPools::get_first_worker_index(size_t pool_id) const noexcept {
+  assert(pool_id < pools_.size());
+  uint16_t first = 0;
+  for (size_t i = 0; i != pool_id; ++i) {
+    first += pools_[i].workers_count;
+  }
+  return first;
+}
+
+size_t JobWorkerPools::get_pool_id_by_worker(uint16_t job_worker_index) const noexcept {
+  for (size_t pool_id = 0; pool_id != pools_.size(); ++pool_id) {
+    if (job_worker_index < pools_[pool_id].workers_count) {
+      return pool_id;
+    }
+    job_worker_index -= pools_[pool_id].workers_count;
+  }
+  assert(false);
+  return DEFAULT_POOL_ID;
+}
+
+size_t JobWorkerPools::get_pool_id_by_request_class(const char *class_name) noexcept {
+  if (class_to_pool_.empty()) {
+    return DEFAULT_POOL_ID;
+  }
+  auto it = class_name_ptr_to_pool_.find(class_name);
+  if (it == class_name_ptr_to_pool_.end()) {
+    auto pool_it = class_to_pool_.find(class_name);
+    it = class_name_ptr_to_pool_.emplace(class_name, pool_it == class_to_pool_.end() ? DEFAULT_POOL_ID : pool_it->second).first;
+  }
+  return it->second;
+}
+
+} // namespace job_workers
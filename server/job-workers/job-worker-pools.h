@@ -0,0 +1,81 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/mixin/not_copyable.h"
+#include "common/smart_ptrs/singleton.h"
+
+namespace job_workers {
+
+/* Config example:
+------------- job-workers-pools.yaml -------------
+pools:
+- name: ml
+  workers: 4
+  memory_limit: 2g
+  classes:
+  - VK\Ml\PredictRequest
+- name: fanout
+  workers: 16
+  classes:
+  - VK\Feed\FetchRequest
+  - VK\Feed\RankRequest
+*/
+
+struct JobWorkerPool {
+  std::string name;
+  uint16_t workers_count{0};
+  // the script memory limit of the pool workers, 0 means the default one
+  int64_t memory_limit{0};
+  std::vector<std::string> request_classes;
+};
+
+// The job workers are split into the pools, which are bound to the job request classes.
+// The jobs of the other classes are run by the default pool, which gets the rest of the job workers.
+// The workers of a pool have the consecutive unique ids, so the pool of a worker is known by its id.
+class JobWorkerPools : vk::not_copyable {
+public:
+  static constexpr size_t MAX_POOLS_COUNT = 8;
+  static constexpr size_t DEFAULT_POOL_ID = 0;
+
+  int parse_config(const char *config_file) noexcept;
+
+  // distributes the job workers between the pools, fails if the default pool is left without workers
+  bool init(uint16_t job_workers_count) noexcept;
+
+  size_t get_pools_count() const noexcept {
+    return pools_.size();
+  }
+
+  const JobWorkerPool &get_pool(size_t pool_id) const noexcept {
+    return pools_[pool_id];
+  }
+
+  // job_worker_index is the index of the worker among the job workers
+  size_t get_pool_id_by_worker(uint16_t job_worker_index) const noexcept;
+
+  // the first job worker index of the pool
+  uint16_t get_first_worker_index(size_t pool_id) const noexcept;
+
+  // the class name is expected to be the string literal returned by get_class(), so the lookup is cached by the pointer
+  size_t get_pool_id_by_request_class(const char *class_name) noexcept;
+
+private:
+  JobWorkerPools() noexcept;
+
+  friend class vk::singleton<JobWorkerPools>;
+
+  std::vector<JobWorkerPool> pools_;
+  std::unordered_map<std::string, size_t> class_to_pool_;
+  std::unordered_map<const char *, size_t> class_name_ptr_to_pool_;
+};
+
+} // namespace job_workers
@@ -2,10 +2,11 @@
 // Copyright (c) 2020 LLC «V Kontakte»
 // Distributed under the GPL v3 License, see LICENSE.notice.txt
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 
-#include "common/containers/final_action.h"
 #include "common/kprintf.h"
 #include "common/pipe-utils.h"
 
@@ -13,9 +14,11 @@
 #include "net/net-events.h"
 
 #include "server/job-workers/job-message.h"
+#include "server/job-workers/job-worker-pools.h"
 #include "server/job-workers/job-worker-server.h"
 #include "server/job-workers/job-workers-context.h"
 #include "server/job-workers/shared-memory-manager.h"
+#include "server/php-engine-vars.h"
 #include "server/php-worker.h"
 #include "server/server-log.h"
 #include "server/server-stats.h"
@@ -26,6 +29,14 @@ namespace {
 
 constexpr int EPOLL_FLAGS = EVT_READ | EVT_LEVEL | EVT_SPEC | EPOLLONESHOT;
 
+// the expired job error must reach the client before its own timeout fires, otherwise it's useless for the client,
+// so the job is dropped a bit earlier than its deadline
+constexpr double JOB_EXPIRATION_MARGIN = 0.01;
+
+bool is_job_expired(const JobSharedMessage *job, double now_time) noexcept {
+  return now_time >= job->job_deadline_time() - std::min(JOB_EXPIRATION_MARGIN, job->job_timeout * 0.1);
+}
+
 struct JobCustomData {
   php_worker *worker;
 };
@@ -126,29 +137,15 @@ int JobWorkerServer::job_parse_execute(connection *c) noexcept {
     return 0;
   }
 
-  JobSharedMessage *job = nullptr;
-  PipeJobReader::ReadStatus status = job_reader.read_job(job);
-
-  auto job_fd_rearmer = vk::finally([this]() {
-    rearm_read_job_fd(); // because > 1 workers can wake up on single job
-  });
-
-  if (status == PipeJobReader::READ_BLOCK) {
-    assert(errno == EWOULDBLOCK);
-    // another job worker has already taken the job (all job workers are readers for this fd)
-    // or there are no more jobs in pipe
-    tvkprintf(job_workers, 3, "No jobs in pipe after wakeup\n");
-    ++vk::singleton<SharedMemoryManager>::get().get_stats().job_worker_skip_job_due_steal;
+  JobSharedMessage *job = take_next_job();
+  if (!job) {
+    // another job worker has already taken the job or there are no more jobs in the queue
+    tvkprintf(job_workers, 3, "No jobs in queue after wakeup\n");
+    rearm_read_job_fd();
     return 0;
-  } else if (status == PipeJobReader::READ_FAIL) {
-    ++vk::singleton<SharedMemoryManager>::get().get_stats().errors_pipe_server_read;
-    return -1;
   }
 
-  job_fd_rearmer.disable();
-
   auto &memory_manager = vk::singleton<job_workers::SharedMemoryManager>::get();
-  --memory_manager.get_stats().job_queue_size;
   memory_manager.attach_shared_message_to_this_proc(job);
   if (job->common_job) {
     memory_manager.attach_shared_message_to_this_proc(job->common_job);
@@ -183,12 +180,98 @@ int JobWorkerServer::job_parse_execute(connection *c) noexcept {
   return 0;
 }
 
+JobSharedMessage *JobWorkerServer::take_next_job() noexcept {
+  auto &memory_manager = vk::singleton<job_workers::SharedMemoryManager>::get();
+  auto &stats = memory_manager.get_stats();
+  auto &job_scheduler = memory_manager.get_job_scheduler(pool_id);
+
+  for (;;) {
+    JobPriority priority{};
+    int64_t enqueue_time_ns = 0;
+    JobSharedMessage *job = job_scheduler.pop(priority, enqueue_time_ns, logname_id);
+    if (!job && !is_idle) {
+      // the clients check the idle workers after the push, so the queues must be rechecked after the increment
+      is_idle = true;
+      job_scheduler.mark_idle(logname_id);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      job = job_scheduler.pop(priority, enqueue_time_ns, logname_id);
+    }
+
+    if (is_idle) {
+      // the wakeup may be written for this worker, take it so that the pipe doesn't stay readable
+      const PipeJobReader::ReadStatus status = job_reader.read_job_wakeup();
+      if (status == PipeJobReader::READ_FAIL) {
+        ++stats.errors_pipe_server_read;
+      } else if (status == PipeJobReader::READ_OK && !job) {
+        ++stats.job_worker_skip_job_due_steal;
+      }
+      if (job) {
+        is_idle = false;
+        job_scheduler.unmark_idle(logname_id);
+      }
+    }
+
+    if (!job) {
+      return nullptr;
+    }
+
+    --stats.job_queue_size;
+    auto &priority_stats = stats.priorities[static_cast<size_t>(priority)];
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const int64_t wait_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - enqueue_time_ns;
+    stats.job_queue_wait_time_ns += wait_time_ns;
+    priority_stats.add_wait_time(wait_time_ns);
+
+    const double now_time = std::chrono::duration<double>{std::chrono::system_clock::now().time_since_epoch()}.count();
+    if (is_job_expired(job, now_time)) {
+      ++priority_stats.expired;
+      drop_expired_job(job);
+      continue;
+    }
+
+    ++stats.jobs_started;
+    ++stats.pools[pool_id].jobs_started;
+    ++priority_stats.started;
+    return job;
+  }
+}
+
+void JobWorkerServer::drop_expired_job(JobSharedMessage *job) noexcept {
+  tvkprintf(job_workers, 2, "drop expired job: <job_result_fd_idx, job_id> = <%d, %d>, job_memory_ptr = %p\n",
+            job->job_result_fd_idx, job->job_id, job);
+
+  auto &memory_manager = vk::singleton<job_workers::SharedMemoryManager>::get();
+  memory_manager.attach_shared_message_to_this_proc(job);
+  if (job->common_job) {
+    memory_manager.attach_shared_message_to_this_proc(job->common_job);
+  }
+
+  running_job = job;
+  reply_was_sent = false;
+  if (reply_is_expected()) {
+    store_job_response_error("Job expired before it was started", server_job_expired_error);
+  }
+  running_job = nullptr;
+  // the common job is released together with the job
+  memory_manager.release_shared_message(job);
+}
+
 void JobWorkerServer::init() noexcept {
   const auto &job_workers_ctx = vk::singleton<JobWorkersContext>::get();
 
   assert(job_workers_ctx.pipes_inited);
 
-  read_job_fd = job_workers_ctx.job_pipe[0];
+  const auto &job_worker_pools = vk::singleton<JobWorkerPools>::get();
+  const uint16_t job_worker_index = logname_id - vk::singleton<WorkersControl>::get().get_count(WorkerType::general_worker);
+  pool_id = job_worker_pools.get_pool_id_by_worker(job_worker_index);
+  const auto &pool = job_worker_pools.get_pool(pool_id);
+  if (pool.memory_limit) {
+    // the script isn't created yet, it is done on the first job
+    max_memory = pool.memory_limit;
+  }
+  tvkprintf(job_workers, 1, "job worker %d is in the pool '%s'\n", logname_id, pool.name.c_str());
+
+  read_job_fd = job_workers_ctx.job_pipes[pool_id][0];
 
   read_job_connection = epoll_insert_pipe(pipe_for_read, read_job_fd, &php_jobs_server, nullptr, EPOLL_FLAGS);
   assert(read_job_connection);
@@ -50,13 +50,19 @@ public:
 
 private:
   const char *send_job_reply(JobSharedMessage *response) noexcept;
+  JobSharedMessage *take_next_job() noexcept;
+  void drop_expired_job(JobSharedMessage *job) noexcept;
 
   JobSharedMessage *running_job{nullptr};
   PipeJobWriter job_writer;
   PipeJobReader job_reader;
   int read_job_fd{-1};
+  // the pool, which this job worker belongs to
+  size_t pool_id{0};
   connection *read_job_connection{nullptr};
   bool reply_was_sent{false};
+  // the worker is counted in JobScheduler::idle_workers
+  bool is_idle{false};
 
   JobWorkerServer() = default;
 };
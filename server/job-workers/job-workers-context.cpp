@@ -16,22 +16,25 @@ DEFINE_VERBOSITY(job_workers);
 
 namespace job_workers {
 
-void JobWorkersContext::master_init_pipes(int job_result_slots_num) {
+void JobWorkersContext::master_init_pipes(int job_pools_num, int job_result_slots_num) {
   if (pipes_inited) {
     return;
   }
 
-  int err = pipe2(job_pipe.data(), O_NONBLOCK);
-  if (err) {
-    log_server_critical("Unable to create job pipe: %s", strerror(errno));
-    assert(false);
-    return;
+  job_pipes.resize(job_pools_num);
+  for (auto &job_pipe : job_pipes) {
+    int err = pipe2(job_pipe.data(), O_NONBLOCK);
+    if (err) {
+      log_server_critical("Unable to create job pipe: %s", strerror(errno));
+      assert(false);
+      return;
+    }
   }
 
   result_pipes.resize(job_result_slots_num);
   for (int i = 0; i < result_pipes.size(); ++i) {
     auto &result_pipe = result_pipes.at(i);
-    err = pipe2(result_pipe.data(), O_NONBLOCK);
+    int err = pipe2(result_pipe.data(), O_NONBLOCK);
     if (err) {
       log_server_critical("Unable to create job result pipe: %s", strerror(errno));
       assert(false);
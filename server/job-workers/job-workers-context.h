@@ -26,19 +26,15 @@ public:
   friend class vk::singleton<JobWorkersContext>;
   using Pipe = std::array<int, 2>;
 
-  Pipe job_pipe{};
+  // wake up the idle job workers of each pool, the jobs themselves are passed through the JobScheduler in the shared memory
+  std::vector<Pipe> job_pipes;
   std::vector<Pipe> result_pipes;
   bool pipes_inited{false};
 
-  void master_init_pipes(int job_result_slots_num);
+  void master_init_pipes(int job_pools_num, int job_result_slots_num);
 
 private:
-  JobWorkersContext() {
-    job_pipe.fill(-1);
-    for (auto &result_pipe : result_pipes) {
-      result_pipe.fill(-1);
-    }
-  }
+  JobWorkersContext() = default;
 };
 
 } // namespace job_workers
@@ -34,10 +34,10 @@ bool PipeJobWriter::write_to_pipe(int write_fd, const char *description) {
   return true;
 }
 
-bool PipeJobWriter::write_job(JobSharedMessage *job, int write_fd) {
+bool PipeJobWriter::write_job_wakeup(int write_fd) {
   reset();
-  copy_to_buffer(job);
-  return write_to_pipe(write_fd, "writing job");
+  copy_to_buffer(uint8_t{1});
+  return write_to_pipe(write_fd, "writing job wakeup");
 }
 
 bool PipeJobWriter::write_job_result(JobSharedMessage *job_result, int write_fd) {
@@ -46,13 +46,10 @@ bool PipeJobWriter::write_job_result(JobSharedMessage *job_result, int write_fd)
   return write_to_pipe(write_fd, "writing result of job");
 }
 
-PipeJobReader::ReadStatus PipeJobReader::read_job(JobSharedMessage *&job) {
+PipeJobReader::ReadStatus PipeJobReader::read_job_wakeup() {
+  // only one wakeup is read, so the others wake up the other idle workers
   reset();
-  ReadStatus status = read_from_pipe(sizeof(JobSharedMessage *), "read job");
-  if (status == READ_OK) {
-    extract_from_buffer(job);
-  }
-  return status;
+  return read_from_pipe(sizeof(uint8_t), "read job wakeup");
 }
 
 PipeJobReader::ReadStatus PipeJobReader::read_job_result(JobSharedMessage *&job_result) {
@@ -38,7 +38,7 @@ protected:
 
 class PipeJobWriter : public PipeIO {
 public:
-  bool write_job(JobSharedMessage *job, int write_fd);
+  bool write_job_wakeup(int write_fd);
   bool write_job_result(JobSharedMessage *job_result, int write_fd);
 
 private:
@@ -58,7 +58,7 @@ public:
     READ_BLOCK
   };
 
-  ReadStatus read_job(JobSharedMessage *&job);
+  ReadStatus read_job_wakeup();
   ReadStatus read_job_result(JobSharedMessage *&job_result);
 private:
   int read_fd{-1};
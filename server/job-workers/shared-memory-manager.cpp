@@ -26,9 +26,21 @@ void SharedMemoryManager::init() noexcept {
     memory_limit_ = processes * JOB_DEFAULT_MEMORY_LIMIT_PROCESS_MULTIPLIER + sizeof(ControlBlock);
   }
   auto *raw_mem = static_cast<uint8_t *>(mmap_shared(memory_limit_));
-  const size_t left_memory = memory_limit_ - sizeof(ControlBlock);
+  size_t left_memory = memory_limit_ - sizeof(ControlBlock);
+  // every job in the queues holds a message, so the queues can't be overflowed
+  const uint32_t job_queue_capacity = std::min(shared_messages_count_, left_memory / sizeof(JobSharedMessage));
+  const size_t pools_count = vk::singleton<JobWorkerPools>::get().get_pools_count();
+  const size_t job_scheduler_memory = JobScheduler::get_memory_size(job_queue_capacity);
+  left_memory -= job_scheduler_memory * pools_count;
   const uint32_t messages_count = std::min(shared_messages_count_, left_memory / sizeof(JobSharedMessage));
+  // the queues are placed first, as they are aligned to the cache line
+  std::array<JobScheduler *, JobWorkerPools::MAX_POOLS_COUNT> job_schedulers{};
+  for (size_t pool_id = 0; pool_id != pools_count; ++pool_id) {
+    job_schedulers[pool_id] = JobScheduler::create(raw_mem, job_queue_capacity);
+    raw_mem += job_scheduler_memory;
+  }
   control_block_ = new(raw_mem) ControlBlock{};
+  control_block_->job_schedulers = job_schedulers;
   raw_mem += sizeof(ControlBlock);
   for (uint32_t i = 0; i != messages_count; ++i) {
     freelist_put(&control_block_->free_messages, raw_mem);
@@ -113,6 +125,26 @@ void SharedMemoryManager::forcibly_release_all_attached_messages() noexcept {
   }
 }
 
+void SharedMemoryManager::forcibly_release_job_queues_claims(uint16_t worker_unique_id) noexcept {
+  if (!control_block_) {
+    return;
+  }
+  for (JobScheduler *job_scheduler : control_block_->job_schedulers) {
+    if (!job_scheduler) {
+      continue;
+    }
+    const uint32_t abandoned_pushes = job_scheduler->release_claims(worker_unique_id, [this, worker_unique_id](JobSharedMessage *job) {
+      // the job has been taken by the dead worker, it's released by the next process with the same id
+      dl::CriticalSectionGuard critical_section;
+      control_block_->workers_table[worker_unique_id].attach(job);
+      --control_block_->stats.job_queue_size;
+    });
+    control_block_->stats.job_queue_size -= abandoned_pushes;
+    // the worker, which has exited or crashed while waiting for the wakeup, mustn't be woken up anymore
+    job_scheduler->release_idle(worker_unique_id);
+  }
+}
+
 bool SharedMemoryManager::request_extra_memory_for_resource(memory_resource::unsynchronized_pool_resource &resource, size_t required_size) noexcept {
   assert(control_block_);
   for (size_t i = 0; i != control_block_->free_extra_memory.size(); ++i) {
@@ -10,7 +10,9 @@
 
 #include "runtime/critical_section.h"
 #include "runtime/memory_resource/extra-memory-pool.h"
+#include "server/job-workers/job-queue.h"
 #include "server/job-workers/job-stats.h"
+#include "server/job-workers/job-worker-pools.h"
 #include "server/job-workers/job-workers-context.h"
 #include "server/php-engine-vars.h"
 #include "server/workers-control.h"
@@ -32,8 +34,9 @@ struct WorkerProcessMeta {
   //    ok response
   //    error response (only for job workers)
   // + 2 messages: mutable request & immutable request, if job is invoked from running job
-  // so let's use 8 just in case
-  std::array<JobMetadata *, 8> attached_messages{};
+  // + SharedMemoryPieces::MAX_PUBLISHED_PIECES immutable requests kept by the client till the end of the request
+  // so let's use 16 just in case
+  std::array<JobMetadata *, 16> attached_messages{};
 
   void attach(JobMetadata *message) noexcept {
     replace(nullptr, message);
@@ -65,6 +68,7 @@ public:
     dl::CriticalSectionGuard critical_section;
     if (void *free_mem = freelist_get(&control_block_->free_messages)) {
       auto *message = new(free_mem) JobMessageT{};
+      message->resource.set_slab_mode(use_slab_allocator_);
       control_block_->workers_table[logname_id].attach(message);
       ++control_block_->stats.messages.acquired;
       return message;
@@ -79,14 +83,24 @@ public:
   void detach_shared_message_from_this_proc(JobMetadata *message) noexcept;
 
   void forcibly_release_all_attached_messages() noexcept;
+  // completes the job queues operations interrupted by the death of the process and drops its idle mark, is called by the master
+  void forcibly_release_job_queues_claims(uint16_t worker_unique_id) noexcept;
 
   bool set_memory_limit(size_t memory_limit) noexcept;
   bool set_shared_messages_count(size_t shared_messages_count) noexcept;
+  void set_use_slab_allocator() noexcept {
+    use_slab_allocator_ = true;
+  }
 
   bool request_extra_memory_for_resource(memory_resource::unsynchronized_pool_resource &resource, size_t required_size) noexcept;
 
   JobStats &get_stats() noexcept;
 
+  JobScheduler &get_job_scheduler(size_t pool_id) noexcept {
+    assert(control_block_ && control_block_->job_schedulers[pool_id]);
+    return *control_block_->job_schedulers[pool_id];
+  }
+
   bool is_initialized() const noexcept {
     return control_block_;
   }
@@ -98,6 +112,7 @@ private:
 
   size_t memory_limit_{0};
   size_t shared_messages_count_{0};
+  bool use_slab_allocator_{false};
 
   struct alignas(8) ControlBlock {
     ControlBlock() noexcept {
@@ -108,6 +123,8 @@ private:
     }
 
     JobStats stats;
+    // the schedulers of the job worker pools are placed right before the control block
+    std::array<JobScheduler *, JobWorkerPools::MAX_POOLS_COUNT> job_schedulers{};
     std::array<WorkerProcessMeta, WorkersControl::max_workers_count> workers_table{};
     freelist_t free_messages{};
 
@@ -60,6 +60,9 @@ int force_clear_sql_connection = 0;
 long long static_buffer_length_limit = -1;
 int use_madvise_dontneed = 0;
 long long memory_used_to_recreate_script = LLONG_MAX;
+int use_script_memory_huge_pages = 0;
+int use_script_memory_adaptive_trim = 0;
+long long http_streaming_buffer_size = 64 * 1024;
 
 /***
   save of stdout/stderr fd
@@ -69,6 +69,9 @@ extern int force_clear_sql_connection;
 extern long long static_buffer_length_limit;
 extern int use_madvise_dontneed;
 extern long long memory_used_to_recreate_script;
+extern int use_script_memory_huge_pages;
+extern int use_script_memory_adaptive_trim;
+extern long long http_streaming_buffer_size;
 
 #define SIGTERM_MAX_TIMEOUT 10
 #define SIGTERM_WAIT_TIMEOUT 0.1
@@ -43,6 +43,7 @@
 #include "net/net-crypto-aes.h"
 #include "net/net-dc.h"
 #include "net/net-http-server.h"
+#include "net/net-http2-server.h"
 #include "net/net-ifnet.h"
 #include "net/net-memcache-client.h"
 #include "net/net-memcache-server.h"
@@ -60,6 +61,7 @@
 #include "server/cluster-name.h"
 #include "server/confdata-binlog-replay.h"
 #include "server/job-workers/job-worker-client.h"
+#include "server/job-workers/job-worker-pools.h"
 #include "server/job-workers/job-worker-server.h"
 #include "server/job-workers/job-workers-context.h"
 #include "server/job-workers/shared-memory-manager.h"
@@ -94,6 +96,7 @@ double rpc_ping_interval = RPC_DEFAULT_PING_INTERVAL;
 #define RPC_CONNECT_TIMEOUT 3
 
 #define MAX_POST_SIZE (2 * 1024 * 1024) // 2 MB
+static_assert(HTTP2_MAX_BODY_SIZE == MAX_POST_SIZE, "HTTP/2 body must be limited as POST one");
 
 /***
   RPC-client
@@ -325,7 +328,7 @@ void prepare_rpc_query_raw(int packet_id, int *q, int qsize, unsigned (*crc32_pa
   q[qlen - 1] = (int)~crc32_partial_custom(q, q[0] - 4, 0xffffffff);
 }
 
-void send_rpc_query(connection *c, int op, long long id, int *q, int qsize) {
+void write_rpc_query(connection *c, int op, long long id, int *q, int qsize) {
   q[2] = op;
   if (id != -1) {
     *(long long *)(q + 3) = id;
@@ -333,7 +336,10 @@ void send_rpc_query(connection *c, int op, long long id, int *q, int qsize) {
 
   vkprintf (4, "send_rpc_query: [len = %d] [op = %08x] [rpc_id = <%lld>]\n", q[0], op, id);
   tcp_rpc_conn_send_data(c, static_cast<int>(qsize - 3 * sizeof(int)), q + 2);
+}
 
+void send_rpc_query(connection *c, int op, long long id, int *q, int qsize) {
+  write_rpc_query(c, op, id, q, qsize);
   TCP_RPCS_FUNC(c)->flush_packet(c);
 }
 
@@ -438,6 +444,7 @@ int hts_php_wakeup(connection *c) {
 
 int hts_func_wakeup(connection *c);
 int hts_func_execute(connection *c, int op);
+int hts_func_execute_http2(connection *c, int op, char *head, char *body);
 int hts_func_close(connection *c, int who);
 
 http_server_functions http_methods = [] {
@@ -446,6 +453,7 @@ http_server_functions http_methods = [] {
   res.ht_wakeup = hts_func_wakeup;
   res.ht_alarm = hts_func_wakeup;
   res.ht_close = hts_func_close;
+  res.execute_http2 = hts_func_execute_http2;
 
   return res;
 }();
@@ -467,6 +475,13 @@ void http_return(connection *c, const char *str, int len) {
   if (len < 0) {
     len = (int)strlen(str);
   }
+  if (HTS_DATA(c)->http2) {
+    static char head[256];
+    int head_len = snprintf(head, sizeof(head), "HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain; charset=UTF-8\r\n%sContent-Length: %d\r\n\r\n",
+                            no_cache_headers, len);
+    http2_write_response(c, head, head_len, str, len);
+    return;
+  }
   write_basic_http_header(c, 500, 0, len, no_cache_headers, "text/plain; charset=UTF-8");
   write_out(&c->Out, str, len);
 }
@@ -520,6 +535,8 @@ int do_hts_func_wakeup(connection *c, int flag) {
   return 0;
 }
 
+static int hts_func_execute_query(connection *c, char *ReqHdr, char *post, bool chunked_allowed);
+
 int hts_func_execute(connection *c, int op) {
   hts_data *D = HTS_DATA(c);
   static char ReqHdr[MAX_HTTP_HEADER_SIZE];
@@ -548,6 +565,37 @@ int hts_func_execute(connection *c, int op) {
   assert (D->header_size <= MAX_HTTP_HEADER_SIZE);
   assert (read_in(&c->In, &ReqHdr, D->header_size) == D->header_size);
 
+  char *post = nullptr;
+  if (0 < D->data_size && D->data_size < MAX_POST_SIZE) {
+    assert (read_in(&c->In, Post, D->data_size) == D->data_size);
+    Post[D->data_size] = 0;
+    post = Post;
+  }
+  return hts_func_execute_query(c, ReqHdr, post, D->http_ver >= HTTP_V11);
+}
+
+/* the chunked encoding is replaced with the own framing of HTTP/2, so the response is sent at once */
+int hts_func_execute_http2(connection *c, int op, char *head, char *body) {
+  hts_data *D = HTS_DATA(c);
+
+  if (sigterm_on && sigterm_time < precise_now) {
+    return -501;
+  }
+
+  vkprintf (1, "in hts_execute_http2: connection #%d, op=%d, header_size=%d, data_size=%d\n", c->fd, op, D->header_size, D->data_size);
+
+  if (!vk::any_of_equal(op, htqt_get, htqt_post, htqt_head)) {
+    return -501;
+  }
+  if (D->data_size >= MAX_POST_SIZE) {
+    return -413;
+  }
+  return hts_func_execute_query(c, head, D->data_size > 0 ? body : nullptr, false);
+}
+
+static int hts_func_execute_query(connection *c, char *ReqHdr, char *post, bool chunked_allowed) {
+  hts_data *D = HTS_DATA(c);
+
   qHeaders = ReqHdr + D->first_line_size;
   qHeadersLen = D->header_size - D->first_line_size;
   assert (D->first_line_size > 0 && D->first_line_size <= D->header_size);
@@ -560,11 +608,9 @@ int hts_func_execute(connection *c, int op) {
 
 //  D->query_flags &= ~QF_KEEPALIVE;
 
-  if (0 < D->data_size && D->data_size < MAX_POST_SIZE) {
-    assert (read_in(&c->In, Post, D->data_size) == D->data_size);
-    Post[D->data_size] = 0;
-    vkprintf (1, "have %d POST bytes: `%.80s`\n", D->data_size, Post);
-    qPost = Post;
+  if (post) {
+    vkprintf (1, "have %d POST bytes: `%.80s`\n", D->data_size, post);
+    qPost = post;
     qPostLen = D->data_size;
   } else {
     qPost = nullptr;
@@ -605,7 +651,7 @@ int hts_func_execute(connection *c, int op) {
 
   /** save query here **/
   http_query_data *http_data = http_query_data_create(qUri, qUriLen, qGet, qGetLen, qHeaders, qHeadersLen, qPost,
-                                                      qPostLen, query_type_str, D->query_flags & QF_KEEPALIVE,
+                                                      qPostLen, query_type_str, D->query_flags & QF_KEEPALIVE, chunked_allowed,
                                                       inet_sockaddr_address(&c->remote_endpoint),
                                                       inet_sockaddr_port(&c->remote_endpoint));
 
@@ -1619,6 +1665,7 @@ void start_server() {
 }
 
 void set_instance_cache_memory_limit(size_t limit);
+void set_instance_cache_use_huge_pages();
 void init_php_scripts() noexcept;
 void global_init_php_scripts() noexcept;
 const char *get_php_scripts_version() noexcept;
@@ -2029,6 +2076,46 @@ int main_args_handler(int i, const char *long_option) {
     case 2025: {
       return 0;
     }
+    case 2026: {
+      set_confdata_use_hash_index();
+      return 0;
+    }
+    case 2027: {
+      dl::set_script_allocator_slab_mode(true);
+      return 0;
+    }
+    case 2028: {
+      set_confdata_use_slab_allocator();
+      return 0;
+    }
+    case 2029: {
+      vk::singleton<job_workers::SharedMemoryManager>::get().set_use_slab_allocator();
+      return 0;
+    }
+    case 2030: {
+      use_script_memory_huge_pages = 1;
+      return 0;
+    }
+    case 2031: {
+      use_script_memory_adaptive_trim = 1;
+      return 0;
+    }
+    case 2032: {
+      set_confdata_use_huge_pages();
+      set_instance_cache_use_huge_pages();
+      return 0;
+    }
+    case 2033: {
+      return vk::singleton<job_workers::JobWorkerPools>::get().parse_config(optarg);
+    }
+    case 2034: {
+      http_streaming_buffer_size = parse_memory_limit_default(optarg, 'k');
+      if (http_streaming_buffer_size <= 0 || http_streaming_buffer_size > (1 << 30)) {
+        kprintf("--http-streaming-buffer-size option: invalid size %s\n", optarg);
+        return -1;
+      }
+      return 0;
+    }
     default:
       return -1;
   }
@@ -2106,6 +2193,17 @@ void parse_main_args(int argc, char *argv[]) {
   parse_option("disable-mysql-same-datacenter-check", no_argument, 2023, "Disable MySQL same datacenter check");
   parse_option("use-utf8", no_argument, 2024, "Use UTF8");
   parse_option("xgboost-model-path-experimental", required_argument, 2025, "intended for tests, don't use it for now!");
+  parse_option("confdata-hash-index", no_argument, 2026, "build the hash index over confdata for faster key lookups, costs extra confdata memory");
+  parse_option("script-memory-slabs", no_argument, 2027, "allocate small pieces of the script memory from the size class slabs, avoids the defragmentation");
+  parse_option("confdata-memory-slabs", no_argument, 2028, "allocate small pieces of the confdata memory from the size class slabs, avoids the defragmentation");
+  parse_option("job-workers-shared-memory-slabs", no_argument, 2029, "allocate small pieces of the job workers shared messages from the size class slabs");
+  parse_option("script-memory-huge-pages", no_argument, 2030, "back the script memory with the transparent huge pages (MADV_HUGEPAGE)");
+  parse_option("script-memory-adaptive-trim", no_argument, 2031, "keep the script memory used by the recent requests resident and trim the rest after each request, "
+                                                                "replaces --use-madvise-dontneed");
+  parse_option("shared-memory-huge-pages", no_argument, 2032, "back the confdata and instance cache shared memory with the transparent huge pages (MADV_HUGEPAGE)");
+  parse_option("job-workers-pools-config", required_argument, 2033, "yaml config of the dedicated job workers pools, which run the jobs of the specified request classes");
+  parse_option("http-streaming-buffer-size", required_argument, 2034, "after flush() the http response is sent in chunks: "
+                                                                      "the script output above this size is sent to the client, the script waits for the slow clients (default: 64k)");
   parse_engine_options_long(argc, argv, main_args_handler);
   parse_main_args_till_option(argc, argv);
 }
@@ -2116,6 +2214,10 @@ void init_default() {
     kprintf ("fatal: not enough workers for general purposes\n");
     exit(1);
   }
+  if (!vk::singleton<job_workers::JobWorkerPools>::get().init(vk::singleton<WorkersControl>::get().get_count(WorkerType::job_worker))) {
+    kprintf ("fatal: not enough job workers for the default job workers pool\n");
+    exit(1);
+  }
 
   dl_set_default_handlers();
   now = (int)time(nullptr);
@@ -62,6 +62,7 @@
 #include "server/php-master-warmup.h"
 
 #include "server/job-workers/job-worker-client.h"
+#include "server/job-workers/job-worker-pools.h"
 #include "server/job-workers/job-workers-context.h"
 #include "server/job-workers/job-stats.h"
 #include "server/job-workers/shared-memory-manager.h"
@@ -649,6 +650,9 @@ void remove_worker(pid_t pid) {
   for (int i = 0; i < workers_control.get_all_alive(); i++) {
     if (workers[i]->pid == pid) {
       vk::singleton<WorkersControl>::get().on_worker_removing(workers[i]->type, workers[i]->is_dying, workers[i]->unique_id);
+      // the dead worker may be interrupted in the middle of the job queue operation, which would stall the queue,
+      // or it may exit while waiting for the wakeup, either on SIGTERM or on crash
+      vk::singleton<job_workers::SharedMemoryManager>::get().forcibly_release_job_queues_claims(workers[i]->unique_id);
       if (workers[i]->type == WorkerType::general_worker && !workers[i]->is_dying) {
         failed++;
       }
@@ -1080,6 +1084,13 @@ STATS_PROVIDER_TAGGED(kphp_stats, 100, STATS_TAG_KPHP_SERVER) {
   add_gauge_stat(stats, instance_cache_element_stats.elements_logically_expired_and_ignored, "instance_cache.elements.logically_expired_and_ignored");
   add_gauge_stat(stats, instance_cache_element_stats.elements_logically_expired_but_fetched, "instance_cache.elements.logically_expired_but_fetched");
 
+  const auto &instance_cache_contention_stats = instance_cache_get_contention_stats();
+  add_gauge_stat_long(stats, "instance_cache.contention.storage_lock_total", instance_cache_contention_stats.storage_lock_contentions_total);
+  add_gauge_stat_long(stats, "instance_cache.contention.storage_lock_max_per_shard", instance_cache_contention_stats.storage_lock_contentions_max);
+  add_gauge_stat_long(stats, "instance_cache.contention.allocator_lock_total", instance_cache_contention_stats.allocator_lock_contentions_total);
+  add_gauge_stat_long(stats, "instance_cache.contention.allocator_lock_max_per_arena", instance_cache_contention_stats.allocator_lock_contentions_max);
+  add_gauge_stat_long(stats, "instance_cache.contention.garbage_clearing_postponed", instance_cache_contention_stats.garbage_clearing_postponed);
+
   write_confdata_stats_to(stats);
   vk::singleton<ServerStats>::get().write_stats_to(stats);
 
@@ -1198,7 +1209,8 @@ void run_master_on() {
   }
 
   if (vk::singleton<WorkersControl>::get().get_count(WorkerType::job_worker) > 0) {
-    vk::singleton<JobWorkersContext>::get().master_init_pipes(vk::singleton<WorkersControl>::get().get_total_workers_count());
+    vk::singleton<JobWorkersContext>::get().master_init_pipes(static_cast<int>(vk::singleton<job_workers::JobWorkerPools>::get().get_pools_count()),
+                                                              vk::singleton<WorkersControl>::get().get_total_workers_count());
   }
 
   bool need_http_fd = http_fd != nullptr && *http_fd == -1;
@@ -43,6 +43,55 @@ void php_query_rpc_answer::run(php_worker *worker) noexcept {
   php_script_query_answered(php_script);
 }
 
+/* the written part is pushed to the client right away, the script waits while the client is too slow to take it */
+static int php_worker_http_send_response_part_impl(php_worker *worker, const char *headers, int headers_len, const char *body, int body_len) {
+  connection *c = worker->conn;
+
+  if (worker->mode != http_worker || c == nullptr || c->error) {
+    return -1;
+  }
+
+  assert (!c->crypto);
+  worker->http_response_started = true;
+  write_out(&c->Out, headers, headers_len);
+  write_out(&c->Out, body, body_len);
+
+  pollfd poll_fds;
+  poll_fds.fd = c->fd;
+  poll_fds.events = POLLOUT;
+
+  while (true) {
+    c->flags &= ~C_NOWR;
+    flush_connection_output(c);
+    if (c->error || (c->flags & C_FAILED)) {
+      return -1;
+    }
+    if (c->Out.total_bytes <= http_streaming_buffer_size) {
+      return 0;
+    }
+
+    double left_time = worker->finish_time - get_utime_monotonic();
+    if (left_time < 0.01) {
+      return -1;
+    }
+    if (poll(&poll_fds, 1, (int)(left_time * 1000 + 1)) < 0 && errno != EINTR) {
+      return -1;
+    }
+  }
+}
+
+void php_query_http_send_response_part_t::run(php_worker *worker) noexcept {
+  query_stats.desc = "HTTP_SEND_RESPONSE_PART";
+
+  php_script_query_readed(php_script);
+  int res = php_worker_http_send_response_part_impl(worker, headers, headers_len, body, body_len);
+  php_script_query_answered(php_script);
+
+  if (res < 0) {
+    php_worker_terminate(worker, 1, script_error_t::http_connection_close, "error during sending http response part");
+  }
+}
+
 void php_query_connect_t::run([[maybe_unused]] php_worker *worker) noexcept {
   query_stats.desc = "CONNECT";
 
@@ -33,6 +33,15 @@ struct php_query_rpc_answer : php_query_base_t {
   void run(php_worker *worker) noexcept final;
 };
 
+struct php_query_http_send_response_part_t : php_query_base_t {
+  const char *headers{nullptr};
+  int headers_len{0};
+  const char *body{nullptr};
+  int body_len{0};
+
+  void run(php_worker *worker) noexcept final;
+};
+
 struct php_query_connect_t : php_query_base_t {
   const char *host{nullptr};
   int port{0};
@@ -882,6 +882,16 @@ int create_job_worker_answer_event(job_workers::JobSharedMessage *job_result) {
   return 1;
 }
 
+int create_curl_socket_ready_event(int fd, int ready_flags) {
+  net_event_t *event = nullptr;
+  const int status = alloc_net_event(fd, net_event_type_t::curl_socket_ready, &event);
+  if (status <= 0) {
+    return status;
+  }
+  event->curl_ready_flags = ready_flags;
+  return 1;
+}
+
 int net_events_empty() {
   return net_events.empty();
 }
@@ -1016,6 +1026,18 @@ void http_set_result(const char *headers, int headers_len, const char *body, int
   PHPScriptBase::current_script->set_script_result(&res);
 }
 
+void http_send_response_part(const char *headers, int headers_len, const char *body, int body_len) {
+  assert (PHPScriptBase::is_running);
+
+  php_query_http_send_response_part_t q;
+  q.headers = headers;
+  q.headers_len = headers_len;
+  q.body = body;
+  q.body_len = body_len;
+
+  PHPScriptBase::current_script->ask_query(&q);
+}
+
 void rpc_set_result(const char *body, int body_len, int exit_code) {
   script_result res;
   res.exit_code = exit_code;
@@ -1106,6 +1128,10 @@ const char *net_event_t::get_description() const noexcept {
       }
       break;
     }
+    case net_event_type_t::curl_socket_ready: {
+      sprintf(BUF, "CURL SOCKET READY: fd = %d, flags = %d", slot_id, curl_ready_flags);
+      break;
+    }
   }
   return BUF;
 }
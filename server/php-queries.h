@@ -22,6 +22,7 @@ enum class net_event_type_t {
   rpc_answer,
   rpc_error,
   job_worker_answer,
+  curl_socket_ready,
 };
 
 struct net_event_t {
@@ -43,6 +44,9 @@ struct net_event_t {
     struct { // job_worker_answer
       job_workers::FinishedJob *job_result;
     };
+    struct { // curl_socket_ready, slot_id is a socket fd
+      int curl_ready_flags;
+    };
   };
 
   const char *get_description() const noexcept;
@@ -284,6 +288,7 @@ int create_rpc_error_event(slot_id_t slot_id, int error_code, const char *error_
 int create_rpc_answer_event(slot_id_t slot_id, int len, net_event_t **res);
 
 int create_job_worker_answer_event(job_workers::JobSharedMessage *job_result);
+int create_curl_socket_ready_event(int fd, int ready_flags);
 
 int net_events_empty();
 
@@ -305,6 +310,7 @@ int get_engine_uptime();
 const char *get_engine_version();
 int http_load_long_query(char *buf, int min_len, int max_len);
 void http_set_result(const char *headers, int headers_len, const char *body, int body_len, int exit_code);
+void http_send_response_part(const char *headers, int headers_len, const char *body, int body_len);
 void rpc_answer(const char *res, int res_len);
 void rpc_set_result(const char *body, int body_len, int exit_code);
 void job_set_result(int exit_code);
@@ -28,7 +28,7 @@ http_query_data *http_query_data_create(
             const char *qGet, int qGetLen,
             const char *qHeaders, int qHeadersLen,
             const char *qPost, int qPostLen,
-            const char *request_method, int keep_alive, unsigned int ip, unsigned int port) {
+            const char *request_method, int keep_alive, int chunked_allowed, unsigned int ip, unsigned int port) {
   http_query_data *d = (http_query_data *)malloc(sizeof(http_query_data));
 
   //TODO remove memdup completely. We can just copy pointers
@@ -49,6 +49,7 @@ http_query_data *http_query_data_create(
   d->request_method_len = (int)strlen(request_method);
 
   d->keep_alive = keep_alive;
+  d->chunked_allowed = chunked_allowed;
 
   d->ip = ip;
   d->port = port;
@@ -11,12 +11,14 @@ struct http_query_data {
   char *uri, *get, *headers, *post, *request_method;
   int uri_len, get_len, headers_len, post_len, request_method_len;
   int keep_alive;
+  int chunked_allowed; // the client speaks HTTP/1.1, so the response can be streamed
   unsigned int ip;
   unsigned int port;
 };
 
 http_query_data *http_query_data_create(const char *qUri, int qUriLen, const char *qGet, int qGetLen, const char *qHeaders,
-                                        int qHeadersLen, const char *qPost, int qPostLen, const char *request_method, int keep_alive, unsigned int ip, unsigned int port);
+                                        int qHeadersLen, const char *qPost, int qPostLen, const char *request_method, int keep_alive, int chunked_allowed,
+                                        unsigned int ip, unsigned int port);
 void http_query_data_free(http_query_data *d);
 
 /** rpc_query_data **/
@@ -4,6 +4,8 @@
 
 #include "server/php-runner.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cerrno>
 #include <cstdlib>
@@ -11,6 +13,7 @@
 #include <exception>
 #include <execinfo.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -37,6 +40,53 @@
 query_stats_t query_stats;
 long long query_stats_id = 1;
 
+namespace {
+
+// The script memory, which is used by the recent requests of this worker, is kept resident between the requests:
+// the next requests don't pay the page faults on the first touches and keep the huge pages (if any) intact.
+class ScriptMemoryResidency {
+public:
+  // returns the new watermark, the memory above it should be trimmed if it's still resident
+  size_t add_request(size_t max_real_memory_used, size_t mem_size) noexcept {
+    recent_usage_[next_request_++ % recent_usage_.size()] = max_real_memory_used;
+    resident_bound_ = std::max(resident_bound_, max_real_memory_used);
+    const size_t max_recent_usage = *std::max_element(recent_usage_.begin(), recent_usage_.end());
+    // the watermark is aligned to the huge page size, so the trimming doesn't split the huge pages
+    keep_resident_bytes_ = std::min((max_recent_usage + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE, mem_size);
+    return keep_resident_bytes_;
+  }
+
+  bool is_trim_required() const noexcept {
+    return resident_bound_ > keep_resident_bytes_;
+  }
+
+  void on_trimmed() noexcept {
+    resident_bound_ = keep_resident_bytes_;
+  }
+
+  size_t get_keep_resident_bytes() const noexcept {
+    return keep_resident_bytes_;
+  }
+
+  size_t huge_pages_bytes{0};
+
+private:
+  std::array<size_t, 16> recent_usage_{};
+  size_t next_request_{0};
+  size_t resident_bound_{0};
+  size_t keep_resident_bytes_{0};
+};
+
+ScriptMemoryResidency script_memory_residency;
+
+long get_minor_page_faults() noexcept {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+} // namespace
+
 void PHPScriptBase::error(const char *error_message, script_error_t error_type) {
   assert (is_running == true);
   is_running = false;
@@ -102,7 +152,20 @@ PHPScriptBase::PHPScriptBase(size_t mem_size, size_t stack_size) :
   protected_end = run_stack + getpagesize();
   run_stack_end = run_stack + stack_size;
 
-  run_mem = static_cast<char *>(mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
+  void *mem = MAP_FAILED;
+  if (use_script_memory_huge_pages) {
+    mem = mmap_huge_pages(mem_size, MAP_ANONYMOUS | MAP_PRIVATE);
+    script_memory_residency.huge_pages_bytes = mem != MAP_FAILED ? mem_size : 0;
+  }
+  if (mem == MAP_FAILED) {
+    mem = mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  }
+  run_mem = static_cast<char *>(mem);
+  if (use_script_memory_adaptive_trim) {
+    // the recreated script gets the memory used by the recent requests in advance
+    prefault_memory(run_mem, script_memory_residency.get_keep_resident_bytes());
+  }
+  last_minor_page_faults = get_minor_page_faults();
   //fprintf (stderr, "[%p -> %p] [%p -> %p]\n", run_stack, run_stack_end, run_mem, run_mem + mem_size);
 }
 
@@ -257,8 +320,12 @@ void PHPScriptBase::finish() {
   const auto &script_mem_stats = dl::get_script_memory_stats();
   state = run_state_t::uncleared;
   update_net_time();
+  // the page faults between the requests (e.g. of the script memory cleanup) are attributed to the next one
+  const long minor_page_faults = get_minor_page_faults();
   vk::singleton<ServerStats>::get().add_request_stats(script_time, net_time, queries_cnt, long_queries_cnt, script_mem_stats.max_memory_used,
-                                                      script_mem_stats.max_real_memory_used, vk::singleton<CurlMemoryUsage>::get().total_allocated, error_type);
+                                                      script_mem_stats.max_real_memory_used, vk::singleton<CurlMemoryUsage>::get().total_allocated,
+                                                      minor_page_faults - last_minor_page_faults, error_type);
+  last_minor_page_faults = minor_page_faults;
   if (save_state == run_state_t::error) {
     assert (error_message != nullptr);
     kprintf("Critical error during script execution: %s\n", error_message);
@@ -302,7 +369,14 @@ void PHPScriptBase::clear() {
   run_main->clear();
   free_runtime_environment();
   state = run_state_t::empty;
-  if (use_madvise_dontneed) {
+  if (use_script_memory_adaptive_trim) {
+    const size_t keep_resident_bytes = script_memory_residency.add_request(dl::get_script_memory_stats().max_real_memory_used, mem_size);
+    if (script_memory_residency.is_trim_required()) {
+      const int advice = madvise_madv_free_supported() ? MADV_FREE : MADV_DONTNEED;
+      our_madvise(&run_mem[keep_resident_bytes], mem_size - keep_resident_bytes, advice);
+      script_memory_residency.on_trimmed();
+    }
+  } else if (use_madvise_dontneed) {
     if (dl::get_script_memory_stats().real_memory_used > memory_used_to_recreate_script) {
       const int advice = madvise_madv_free_supported() ? MADV_FREE : MADV_DONTNEED;
       our_madvise(&run_mem[memory_used_to_recreate_script], mem_size - memory_used_to_recreate_script, advice);
@@ -663,6 +737,14 @@ long long php_script_memory_get_total_usage(void *ptr) {
   return ((PHPScriptBase *)ptr)->memory_get_total_usage();
 }
 
+size_t php_script_memory_get_huge_pages_bytes() {
+  return script_memory_residency.huge_pages_bytes;
+}
+
+size_t php_script_memory_get_keep_resident_bytes() {
+  return script_memory_residency.get_keep_resident_bytes();
+}
+
 void php_script_set_timeout(double t) {
   static itimerval timer;
   timer.it_interval.tv_sec = 0;
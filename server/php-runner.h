@@ -73,12 +73,16 @@ const char *php_script_get_error(void *ptr);
 script_error_t php_script_get_error_type(void *ptr);
 
 long long php_script_memory_get_total_usage(void *ptr);
+size_t php_script_memory_get_huge_pages_bytes();
+size_t php_script_memory_get_keep_resident_bytes();
 
 /** script **/
 class PHPScriptBase {
   double cur_timestamp, net_time, script_time;
   int queries_cnt;
   int long_queries_cnt{0};
+  // the snapshot taken at the end of the previous request, so getrusage is called once per request
+  long last_minor_page_faults{0};
 
 private:
 #if ASAN7_ENABLED
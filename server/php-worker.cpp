@@ -8,6 +8,9 @@
 #include "common/precise-time.h"
 #include "common/rpc-error-codes.h"
 #include "net/net-connections.h"
+#include "net/net-http-server.h"
+#include "net/net-http2-server.h"
+#include "net/net-tcp-rpc-client.h"
 #include "runtime/rpc.h"
 #include "runtime/job-workers/job-interface.h"
 #include "server/job-workers/job-stats.h"
@@ -45,6 +48,7 @@ php_worker *php_worker_create(php_worker_mode_t mode, connection *c, http_query_
   worker->wakeup_time = 0;
 
   worker->req_id = req_id;
+  worker->http_response_started = false;
 
   if (worker->conn->target) {
     worker->target_fd = static_cast<int>(worker->conn->target - Targets);
@@ -200,6 +204,44 @@ void php_worker_init_script(php_worker *worker) {
   worker->state = phpq_run;
 }
 
+/*
+ * The queries of the script are written to the connections one by one,
+ * and each connection with the new queries is flushed once, after the whole net queue is processed.
+ * So the queries, issued by the script (from the different forks) before it waits for the net events, are sent together.
+ */
+#define MAX_RPC_BATCHES 64
+
+struct rpc_batch {
+  connection *conn;
+  int queries;
+};
+
+static rpc_batch rpc_batches[MAX_RPC_BATCHES];
+static int rpc_batches_count;
+
+static void php_worker_flush_rpc_batches() {
+  for (int i = 0; i < rpc_batches_count; i++) {
+    connection *c = rpc_batches[i].conn;
+    vkprintf (3, "flush %d rpc queries to connection %d\n", rpc_batches[i].queries, c->fd);
+    TCP_RPCC_FUNC(c)->flush_packet(c);
+    vk::singleton<ServerStats>::get().add_rpc_flush_stats(rpc_batches[i].queries);
+  }
+  rpc_batches_count = 0;
+}
+
+static void php_worker_add_rpc_batch_query(connection *c) {
+  for (int i = rpc_batches_count - 1; i >= 0; i--) {
+    if (rpc_batches[i].conn == c) {
+      rpc_batches[i].queries++;
+      return;
+    }
+  }
+  if (rpc_batches_count == MAX_RPC_BATCHES) {
+    php_worker_flush_rpc_batches();
+  }
+  rpc_batches[rpc_batches_count++] = {c, 1};
+}
+
 void php_worker_run_rpc_send_query(net_query_t *query) {
   int connection_id = query->host_num;
   slot_id_t slot_id = query->slot_id;
@@ -211,7 +253,8 @@ void php_worker_run_rpc_send_query(net_query_t *query) {
   connection *conn = get_target_connection(target, 0);
 
   if (conn != nullptr) {
-    send_rpc_query(conn, TL_RPC_INVOKE_REQ, slot_id, (int *)query->request, query->request_size);
+    write_rpc_query(conn, TL_RPC_INVOKE_REQ, slot_id, (int *)query->request, query->request_size);
+    php_worker_add_rpc_batch_query(conn);
     conn->last_query_sent_time = precise_now;
   } else {
     int new_conn_cnt = create_new_connections(target);
@@ -233,6 +276,7 @@ void php_worker_run_net_queue(php_worker *worker __attribute__((unused))) {
     php_worker_run_rpc_send_query(query);
     free_net_query(query);
   }
+  php_worker_flush_rpc_batches();
 }
 
 void php_worker_run(php_worker *worker) {
@@ -289,7 +333,12 @@ void php_worker_run(php_worker *worker) {
         if (worker->conn != nullptr) {
           switch (worker->mode) {
             case http_worker:
-              http_return(worker->conn, "ERROR", 5);
+              if (worker->http_response_started) {
+                // the response is left incomplete, the client must not wait for the rest of it
+                HTS_DATA(worker->conn)->query_flags &= ~QF_KEEPALIVE;
+              } else {
+                http_return(worker->conn, "ERROR", 5);
+              }
               break;
             case rpc_worker:
               if (!rpc_stored) {
@@ -315,6 +364,8 @@ void php_worker_run(php_worker *worker) {
       }
       case run_state_t::finished: {
         vkprintf (2, "php script [req_id = %016llx]: OK (still can return RPC_ERROR)\n", worker->req_id);
+        // the queries, issued by the script right before the end, are still in the net queue
+        php_worker_run_net_queue(worker);
         script_result *res = php_script_get_res(php_script);
         php_worker_set_result(worker, res);
         php_script_finish(php_script);
@@ -386,6 +437,8 @@ void php_worker_set_result(php_worker *worker, script_result *res) {
     if (worker->mode == http_worker) {
       if (res == nullptr) {
         http_return(worker->conn, "OK", 2);
+      } else if (HTS_DATA(worker->conn)->http2) {
+        http2_write_response(worker->conn, res->headers, res->headers_len, res->body, res->body_len);
       } else {
         write_out(&worker->conn->Out, res->headers, res->headers_len);
         write_out(&worker->conn->Out, res->body, res->body_len);
@@ -440,7 +493,7 @@ void php_worker_free_script(php_worker *worker) {
 
   static int finished_queries = 0;
   if ((++finished_queries) % queries_to_recreate_script == 0
-      || (!use_madvise_dontneed && php_script_memory_get_total_usage(php_script) > memory_used_to_recreate_script)) {
+      || (!use_madvise_dontneed && !use_script_memory_adaptive_trim && php_script_memory_get_total_usage(php_script) > memory_used_to_recreate_script)) {
     php_script_free(php_script);
     php_script = nullptr;
     finished_queries = 0;
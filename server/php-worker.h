@@ -48,6 +48,9 @@ struct php_worker {
 
   long long req_id;
   int target_fd;
+
+  // a part of the http response is already sent, so it can't be replaced with an error
+  bool http_response_started;
 };
 
 extern php_worker *active_worker;
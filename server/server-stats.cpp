@@ -7,6 +7,7 @@
 #include <atomic>
 #include <iomanip>
 #include <new>
+#include <string>
 
 #include "common/functional/identity.h"
 #include "common/smart_iterators/transform_iterator.h"
@@ -15,6 +16,7 @@
 
 #include "runtime/curl.h"
 
+#include "server/job-workers/job-worker-pools.h"
 #include "server/workers-control.h"
 
 #include "server/server-stats.h"
@@ -36,6 +38,7 @@ struct ScriptSamples : WithStatType<uint64_t> {
     working_time,
     net_time,
     script_time,
+    minor_page_faults,
     types_count
   };
 };
@@ -83,6 +86,8 @@ struct HeapStat : WithStatType<uint64_t> {
   enum class Key {
     script_heap_memory_usage = 0,
     curl_memory_currently_usage,
+    script_memory_huge_pages_bytes,
+    script_memory_keep_resident_bytes,
     types_count
   };
 };
@@ -193,6 +198,8 @@ EnumTable<HeapStat> get_heap_stat() noexcept {
   EnumTable<HeapStat> result;
   result[HeapStat::Key::curl_memory_currently_usage] = vk::singleton<CurlMemoryUsage>::get().currently_allocated;
   result[HeapStat::Key::script_heap_memory_usage] = dl::get_heap_memory_used();
+  result[HeapStat::Key::script_memory_huge_pages_bytes] = php_script_memory_get_huge_pages_bytes();
+  result[HeapStat::Key::script_memory_keep_resident_bytes] = php_script_memory_get_keep_resident_bytes();
   return result;
 }
 
@@ -271,7 +278,7 @@ struct WorkerSharedStats : private vk::not_copyable {
   }
 
   void add_request_stats(const EnumTable<QueriesStat> &queries, script_error_t error,
-                         uint64_t memory_used, uint64_t real_memory_used, uint64_t curl_total_allocated) noexcept {
+                         uint64_t memory_used, uint64_t real_memory_used, uint64_t curl_total_allocated, uint64_t minor_page_faults) noexcept {
     errors[static_cast<size_t>(error)].fetch_add(1, std::memory_order_relaxed);
 
     for (size_t i = 0; i != queries.size(); ++i) {
@@ -287,11 +294,24 @@ struct WorkerSharedStats : private vk::not_copyable {
     sample[ScriptSamples::Key::working_time] = queries[QueriesStat::Key::net_time] + queries[QueriesStat::Key::script_time];
     sample[ScriptSamples::Key::net_time] = queries[QueriesStat::Key::net_time];
     sample[ScriptSamples::Key::script_time] = queries[QueriesStat::Key::script_time];
+    sample[ScriptSamples::Key::minor_page_faults] = minor_page_faults;
     script_samples.add_sample(sample);
   }
 
+  void add_rpc_flush_stats(uint64_t queries) noexcept {
+    rpc_flushes.fetch_add(1, std::memory_order_relaxed);
+    rpc_flushed_queries.fetch_add(queries, std::memory_order_relaxed);
+    if (queries > 1) {
+      rpc_batched_flushes.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
   std::array<std::atomic<uint32_t>, static_cast<size_t>(script_error_t::errors_count)> errors{};
 
+  std::atomic<uint64_t> rpc_flushes{0};
+  std::atomic<uint64_t> rpc_flushed_queries{0};
+  std::atomic<uint64_t> rpc_batched_flushes{0};
+
   EnumTable<QueriesStat, std::atomic<QueriesStat::StatType>> total_queries_stat;
   SharedSamplesBundle<ScriptSamples> script_samples;
 };
@@ -560,16 +580,22 @@ void ServerStats::after_fork(pid_t worker_pid, uint64_t active_connections, uint
 }
 
 void ServerStats::add_request_stats(double script_time_sec, double net_time_sec, int64_t script_queries, int64_t long_script_queries, int64_t memory_used,
-                                    int64_t real_memory_used, int64_t curl_total_allocated, script_error_t error) noexcept {
+                                    int64_t real_memory_used, int64_t curl_total_allocated, int64_t minor_page_faults,
+                                    script_error_t error) noexcept {
   auto &stats = worker_type_ == WorkerType::job_worker ? shared_stats_->job_workers : shared_stats_->general_workers;
   const auto script_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(script_time_sec));
   const auto net_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(net_time_sec));
   const auto queries_stat = make_queries_stat(script_queries, long_script_queries, script_time.count(), net_time.count());
 
-  stats.add_request_stats(queries_stat, error, memory_used, real_memory_used, curl_total_allocated);
+  stats.add_request_stats(queries_stat, error, memory_used, real_memory_used, curl_total_allocated, minor_page_faults);
   shared_stats_->workers.add_worker_stats(queries_stat, worker_process_id_);
 }
 
+void ServerStats::add_rpc_flush_stats(int64_t queries) noexcept {
+  auto &stats = worker_type_ == WorkerType::job_worker ? shared_stats_->job_workers : shared_stats_->general_workers;
+  stats.add_rpc_flush_stats(queries);
+}
+
 void ServerStats::add_job_stats(double job_wait_time_sec, int64_t request_memory_used, int64_t request_real_memory_used, int64_t response_memory_used,
                                 int64_t response_real_memory_used) noexcept {
   const auto job_wait_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(job_wait_time_sec));
@@ -664,6 +690,9 @@ void write_to(stats_t *stats, const char *prefix, const WorkerAggregatedStats &a
   add_gauge_stat(stats, shared.total_queries_stat[QueriesStat::Key::incoming_queries], prefix, ".requests.total_incoming_queries");
   add_gauge_stat(stats, shared.total_queries_stat[QueriesStat::Key::outgoing_queries], prefix, ".requests.total_outgoing_queries");
   add_gauge_stat(stats, shared.total_queries_stat[QueriesStat::Key::outgoing_long_queries], prefix, ".requests.total_outgoing_long_queries");
+  add_gauge_stat(stats, shared.rpc_flushes, prefix, ".rpc.total_flushes");
+  add_gauge_stat(stats, shared.rpc_flushed_queries, prefix, ".rpc.total_flushed_queries");
+  add_gauge_stat(stats, shared.rpc_batched_flushes, prefix, ".rpc.total_batched_flushes");
 
   write_to(stats, prefix, ".requests.outgoing_queries", agg.script_samples[ScriptSamples::Key::outgoing_queries].percentiles);
   write_to(stats, prefix, ".requests.outgoing_long_queries", agg.script_samples[ScriptSamples::Key::outgoing_long_queries].percentiles);
@@ -673,9 +702,12 @@ void write_to(stats_t *stats, const char *prefix, const WorkerAggregatedStats &a
   write_to(stats, prefix, ".memory.script_usage", agg.script_samples[ScriptSamples::Key::memory_used].percentiles);
   write_to(stats, prefix, ".memory.script_real_usage", agg.script_samples[ScriptSamples::Key::real_memory_used].percentiles);
   write_to(stats, prefix, ".memory.script_total_allocated_by_curl", agg.script_samples[ScriptSamples::Key::total_allocated_by_curl].percentiles);
+  write_to(stats, prefix, ".memory.script_minor_page_faults", agg.script_samples[ScriptSamples::Key::minor_page_faults].percentiles);
 
   write_to(stats, prefix, ".memory.currently_script_heap_usage_bytes", agg.heap_percentiles[HeapStat::Key::script_heap_memory_usage]);
   write_to(stats, prefix, ".memory.currently_allocated_by_curl_bytes", agg.heap_percentiles[HeapStat::Key::curl_memory_currently_usage]);
+  write_to(stats, prefix, ".memory.script_huge_pages_bytes", agg.heap_percentiles[HeapStat::Key::script_memory_huge_pages_bytes]);
+  write_to(stats, prefix, ".memory.script_keep_resident_bytes", agg.heap_percentiles[HeapStat::Key::script_memory_keep_resident_bytes]);
 
   write_to(stats, prefix, ".memory.malloc_non_mapped_allocated_bytes", agg.malloc_percentiles[MallocStat::Key::non_mmaped_allocated_bytes]);
   write_to(stats, prefix, ".memory.malloc_non_mapped_free_bytes", agg.malloc_percentiles[MallocStat::Key::non_mmaped_free_bytes]);
@@ -738,6 +770,15 @@ void ServerStats::write_stats_to(stats_t *stats) const noexcept {
   write_to(stats, "workers.job", aggregated_stats_->job_workers, shared_stats_->job_workers);
   write_to(stats, "workers.job", aggregated_stats_->job_workers);
 
+  const auto &job_worker_pools = vk::singleton<job_workers::JobWorkerPools>::get();
+  for (size_t pool_id = 0; pool_id != job_worker_pools.get_pools_count(); ++pool_id) {
+    const std::string prefix = "workers.job.pools." + job_worker_pools.get_pool(pool_id).name;
+    const auto pool_workers_stat = collect_job_pool_workers_stat(pool_id);
+    add_gauge_stat(stats, pool_workers_stat.total_workers, prefix.c_str(), ".processes.total");
+    add_gauge_stat(stats, pool_workers_stat.running_workers, prefix.c_str(), ".processes.working");
+    add_gauge_stat(stats, pool_workers_stat.waiting_workers, prefix.c_str(), ".processes.working_but_waiting");
+  }
+
   write_to(stats, "master", aggregated_stats_->master_process);
 
   write_server_vm_to(stats, "server", aggregated_stats_->master_process.vm_stats,
@@ -811,6 +852,16 @@ ServerStats::WorkersStat ServerStats::collect_workers_stat(WorkerType worker_typ
 
   const uint16_t first = worker_type == WorkerType::general_worker ? 0 : general_workers;
   const uint16_t last = worker_type == WorkerType::general_worker ? general_workers : job_workers + general_workers;
+  return collect_workers_stat(first, last);
+}
+
+ServerStats::WorkersStat ServerStats::collect_job_pool_workers_stat(size_t pool_id) const noexcept {
+  const auto &job_worker_pools = vk::singleton<job_workers::JobWorkerPools>::get();
+  const uint16_t first = vk::singleton<WorkersControl>::get().get_count(WorkerType::general_worker) + job_worker_pools.get_first_worker_index(pool_id);
+  return collect_workers_stat(first, first + job_worker_pools.get_pool(pool_id).workers_count);
+}
+
+ServerStats::WorkersStat ServerStats::collect_workers_stat(uint16_t first, uint16_t last) const noexcept {
   WorkersStat result;
   const auto &workers_misc = shared_stats_->workers.misc_stats;
   for (uint16_t w = first; w != last; ++w) {
@@ -20,7 +20,9 @@ public:
   void init() noexcept;
 
   void add_request_stats(double script_time_sec, double net_time_sec, int64_t script_queries, int64_t long_script_queries, int64_t memory_used,
-                         int64_t real_memory_used, int64_t curl_total_allocated, script_error_t error) noexcept;
+                         int64_t real_memory_used, int64_t curl_total_allocated, int64_t minor_page_faults, script_error_t error) noexcept;
+  // the queries written to the same rpc connection before the one flush of it
+  void add_rpc_flush_stats(int64_t queries) noexcept;
   void add_job_stats(double job_wait_time_sec, int64_t request_memory_used, int64_t request_real_memory_used, int64_t response_memory_used,
                      int64_t response_real_memory_used) noexcept;
   void add_job_common_memory_stats(int64_t common_request_memory_used, int64_t common_request_real_memory_used) noexcept;
@@ -48,12 +50,15 @@ public:
     uint16_t total_workers{0};
   };
   WorkersStat collect_workers_stat(WorkerType worker_type) const noexcept;
+  WorkersStat collect_job_pool_workers_stat(size_t pool_id) const noexcept;
 
 private:
   friend class vk::singleton<ServerStats>;
 
   ServerStats() = default;
 
+  WorkersStat collect_workers_stat(uint16_t first_worker_id, uint16_t last_worker_id) const noexcept;
+
   WorkerType worker_type_{WorkerType::general_worker};
   uint16_t worker_process_id_{0};
   std::chrono::steady_clock::time_point last_update_;
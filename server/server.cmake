@@ -2,6 +2,7 @@ prepend(KPHP_SERVER_SOURCES ${BASE_DIR}/server/
         cluster-name.cpp
         confdata-binlog-replay.cpp
         confdata-stats.cpp
+        curl-sockets.cpp
         json-logger.cpp
         lease-config-parser.cpp
         lease-rpc-client.cpp
@@ -29,6 +30,7 @@ prepend(KPHP_JOB_WORKERS_SOURCES ${BASE_DIR}/server/job-workers/
         job-stats.cpp
         job-worker-server.cpp
         job-worker-client.cpp
+        job-worker-pools.cpp
         job-workers-context.cpp
         pipe-io.cpp
         shared-memory-manager.cpp)
@@ -3,7 +3,10 @@ prepend(COMPILER_TESTS_SOURCES ${BASE_DIR}/tests/cpp/compiler/
         data/performance-inspections-test.cpp
         phpdoc-test.cpp
         typedata-test.cpp
+        hash-table-test.cpp
+        jumbo-cpp-test.cpp
         lexer-test.cpp
+        objs-cache-test.cpp
         ffi-parser-test.cpp)
 
 vk_add_unittest(compiler "${COMPILER_LIBS}" ${COMPILER_TESTS_SOURCES})
@@ -0,0 +1,76 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "compiler/threading/hash-table.h"
+
+TEST(hash_table_test, test_at_and_find) {
+  TSHashTable<int> ht;
+  ASSERT_EQ(ht.find(42), nullptr);
+
+  auto *node = ht.at(42);
+  ASSERT_EQ(node->hash, 42);
+  node->data = 1;
+  for (unsigned long long hash = 1; hash <= 10000; ++hash) {
+    ht.at(hash * 1000003)->data = static_cast<int>(hash);
+  }
+
+  ASSERT_EQ(ht.at(42), node);
+  ASSERT_EQ(*ht.find(42), 1);
+  ASSERT_EQ(*ht.find(5000ULL * 1000003), 5000);
+  ASSERT_EQ(ht.find(43), nullptr);
+  ASSERT_EQ(ht.size(), 10001);
+  ASSERT_EQ(ht.get_all().size(), 10001);
+  ASSERT_EQ(ht.get_all_if([](int x) { return x % 2 == 0; }).size(), 5000);
+}
+
+TEST(hash_table_test, test_concurrent_at) {
+  constexpr int threads_count = 8;
+  constexpr unsigned long long keys_count = 100000;
+  TSHashTable<unsigned long long> ht;
+  std::vector<std::vector<TSHashTable<unsigned long long>::HTNode *>> nodes(threads_count);
+
+  std::vector<std::thread> threads;
+  for (int thread_id = 0; thread_id < threads_count; ++thread_id) {
+    threads.emplace_back([&ht, &nodes, thread_id] {
+      nodes[thread_id].resize(keys_count);
+      // the threads go through the same keys from the different positions, so they race for every key
+      for (unsigned long long i = 0; i < keys_count; ++i) {
+        const unsigned long long key = (i + thread_id * keys_count / threads_count) % keys_count;
+        auto *node = ht.at(key * 7919 + 1);
+        AutoLocker<Lockable *> locker{node};
+        if (node->data == 0) {
+          node->data = key + 1;
+        }
+        nodes[thread_id][key] = node;
+      }
+      for (unsigned long long key = 0; key < keys_count; ++key) {
+        const unsigned long long *data = ht.find(key * 7919 + 1);
+        ASSERT_NE(data, nullptr);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(ht.size(), keys_count);
+  for (unsigned long long key = 0; key < keys_count; ++key) {
+    auto *node = ht.at(key * 7919 + 1);
+    ASSERT_EQ(node->data, key + 1);
+    for (int thread_id = 0; thread_id < threads_count; ++thread_id) {
+      ASSERT_EQ(nodes[thread_id][key], node);
+    }
+  }
+
+  auto all = ht.get_all();
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.size(), keys_count);
+  ASSERT_EQ(std::unique(all.begin(), all.end()), all.end());
+  ASSERT_EQ(all.front(), 1);
+  ASSERT_EQ(all.back(), keys_count);
+}
@@ -0,0 +1,75 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <numeric>
+
+#include "compiler/code-gen/files/jumbo-cpp.h"
+
+namespace {
+
+using items_t = std::vector<std::pair<std::string, size_t>>;
+
+items_t make_items(size_t count) {
+  items_t items;
+  for (size_t i = 0; i < count; ++i) {
+    items.emplace_back("f$function_" + std::to_string(i * 2) + ".cpp", 10 + i % 7 * 20);
+  }
+  std::sort(items.begin(), items.end());
+  return items;
+}
+
+std::vector<items_t> split(const items_t &items, size_t jumbo_size) {
+  std::vector<items_t> groups;
+  auto group_begin = items.begin();
+  for (size_t group_len : split_into_jumbo_groups(items, jumbo_size)) {
+    groups.emplace_back(group_begin, group_begin + group_len);
+    group_begin += group_len;
+  }
+  EXPECT_EQ(group_begin, items.end());
+  return groups;
+}
+
+size_t group_size(const items_t &group) {
+  return std::accumulate(group.begin(), group.end(), size_t{0}, [](size_t size, const auto &item) { return size + item.second; });
+}
+
+} // namespace
+
+TEST(jumbo_cpp_test, test_group_sizes) {
+  ASSERT_TRUE(split_into_jumbo_groups({}, 1000).empty());
+
+  const auto groups = split(make_items(1000), 1000);
+  ASSERT_GT(groups.size(), 1);
+  for (size_t i = 0; i < groups.size(); ++i) {
+    // the last item may overflow the group, the last group may be small
+    ASSERT_LT(group_size(groups[i]) - groups[i].back().second, 1000);
+    if (i + 1 != groups.size()) {
+      ASSERT_GE(group_size(groups[i]), 1000 / 4);
+    }
+  }
+
+  // the large item closes its group
+  const auto large_groups = split({{"a.cpp", 10}, {"b.cpp", 5000}, {"c.cpp", 10}}, 1000);
+  ASSERT_EQ(large_groups.size(), 2);
+  ASSERT_EQ(large_groups[0].size(), 2);
+}
+
+TEST(jumbo_cpp_test, test_stable_groups) {
+  const auto items = make_items(1000);
+  const auto groups = split(items, 1000);
+
+  // adding an item changes only a few groups, the others stay the same
+  auto new_items = items;
+  new_items.emplace_back("f$function_501.cpp", 30);
+  std::sort(new_items.begin(), new_items.end());
+  const auto new_groups = split(new_items, 1000);
+
+  size_t changed_groups = 0;
+  for (const auto &group : new_groups) {
+    changed_groups += std::find(groups.begin(), groups.end(), group) == groups.end();
+  }
+  ASSERT_GE(changed_groups, 1);
+  ASSERT_LE(changed_groups, 3);
+}
@@ -0,0 +1,141 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "compiler/compiler-core.h"
+#include "compiler/index.h"
+#include "compiler/make/objs-cache.h"
+
+namespace {
+
+class objs_cache_test : public ::testing::Test {
+protected:
+  void SetUp() override {
+    char tmp_dir_template[] = "/tmp/kphp_objs_cache_test_XXXXXX";
+    ASSERT_NE(mkdtemp(tmp_dir_template), nullptr);
+    tmp_dir = tmp_dir_template;
+    std::filesystem::create_directories(tmp_dir + "/objs");
+    std::filesystem::create_directories(tmp_dir + "/cpp1");
+    std::filesystem::create_directories(tmp_dir + "/cpp2");
+  }
+
+  void TearDown() override {
+    std::filesystem::remove_all(tmp_dir);
+  }
+
+  void write_file(const std::string &path, const std::string &content) {
+    std::ofstream{path} << content;
+  }
+
+  std::string read_file(const std::string &path) {
+    std::stringstream ss;
+    ss << std::ifstream{path}.rdbuf();
+    return ss.str();
+  }
+
+  File *add_file(Index &index, const std::string &name, unsigned long long crc64, std::forward_list<std::string> includes = {}) {
+    File *file = index.insert_file(name);
+    file->crc64 = crc64;
+    file->crc64_with_comments = 0;
+    file->includes = std::move(includes);
+    return file;
+  }
+
+  // a.cpp -> a.h <-> b.h -> c.h, d.cpp -> c.h, the hashes of the files are added to base_crc
+  std::unordered_map<std::string, std::string> calc_keys(const std::string &dir, unsigned long long base_crc, const std::string &changed_file = {},
+                                                         const std::string &cxx_identity = "cxx") {
+    Index index;
+    index.set_dir(tmp_dir + "/" + dir + "/");
+    auto crc = [&](const std::string &name) { return base_crc + std::hash<std::string>{}(name) + (name == changed_file); };
+    add_file(index, "_lib_version.h", crc("_lib_version.h"));
+    add_file(index, "a.cpp", crc("a.cpp"), {"a.h"});
+    add_file(index, "a.h", crc("a.h"), {"b.h"});
+    add_file(index, "b.h", crc("b.h"), {"a.h", "c.h"});
+    add_file(index, "c.h", crc("c.h"));
+    add_file(index, "d.cpp", crc("d.cpp"), {"c.h"});
+    add_file(index, "lib.cpp", crc("lib.cpp"))->lib_includes.emplace_front("lib.h");
+
+    std::unordered_map<std::string, std::string> keys;
+    for (const auto &file_and_key : calc_objs_cache_keys(index, G->settings(), cxx_identity)) {
+      keys.emplace(static_cast<std::string>(file_and_key.first->name), file_and_key.second);
+    }
+    return keys;
+  }
+
+  std::string tmp_dir;
+};
+
+} // namespace
+
+TEST_F(objs_cache_test, test_keys) {
+  const auto keys = calc_keys("cpp1", 0);
+  ASSERT_EQ(keys.size(), 2);
+  ASSERT_EQ(keys.count("lib.cpp"), 0);
+  ASSERT_NE(keys.at("a.cpp"), keys.at("d.cpp"));
+  // the keys don't depend on the directory
+  ASSERT_EQ(calc_keys("cpp2", 0), keys);
+
+  // the change of any file included transitively changes the key
+  for (const char *changed_file : {"a.cpp", "a.h", "b.h", "c.h", "_lib_version.h"}) {
+    const auto changed_keys = calc_keys("cpp1", 0, changed_file);
+    ASSERT_NE(changed_keys.at("a.cpp"), keys.at("a.cpp")) << changed_file;
+  }
+  ASSERT_EQ(calc_keys("cpp1", 0, "a.h").at("d.cpp"), keys.at("d.cpp"));
+  ASSERT_NE(calc_keys("cpp1", 0, "c.h").at("d.cpp"), keys.at("d.cpp"));
+  // the objects of the other compiler aren't reused
+  ASSERT_NE(calc_keys("cpp1", 0, {}, "other cxx").at("a.cpp"), keys.at("a.cpp"));
+}
+
+TEST_F(objs_cache_test, test_cxx_identity) {
+  const std::string sh_identity = calc_cxx_identity("sh -c 'echo version 1' --");
+  ASSERT_FALSE(sh_identity.empty());
+  ASSERT_EQ(calc_cxx_identity("sh -c 'echo version 1' --"), sh_identity);
+  ASSERT_NE(calc_cxx_identity("sh -c 'echo version 2' --"), sh_identity);
+  ASSERT_TRUE(calc_cxx_identity("/nonexistent/cxx").empty());
+}
+
+TEST_F(objs_cache_test, test_store_and_restore) {
+  const std::string obj_path = tmp_dir + "/objs/a.o";
+  const std::string key1(64, 'a');
+  const std::string key2(64, 'b');
+
+  ObjsCache cache{tmp_dir + "/cache/", 1 << 20, true, "cxx"};
+  ASSERT_FALSE(cache.restore(key1, obj_path));
+  write_file(obj_path, "object 1");
+  cache.store(key1, obj_path);
+
+  std::filesystem::remove(obj_path);
+  ASSERT_TRUE(cache.restore(key1, obj_path));
+  ASSERT_EQ(read_file(obj_path), "object 1");
+  ASSERT_FALSE(cache.restore(key2, obj_path));
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 2);
+
+  ObjsCache write_only_cache{tmp_dir + "/cache/", 1 << 20, false, "cxx"};
+  ASSERT_FALSE(write_only_cache.restore(key1, obj_path));
+}
+
+TEST_F(objs_cache_test, test_trim) {
+  const std::string obj_path = tmp_dir + "/objs/a.o";
+  ObjsCache cache{tmp_dir + "/cache/", 2500, true, "cxx"};
+
+  write_file(obj_path, std::string(1000, 'x'));
+  for (char c : {'a', 'b', 'c'}) {
+    cache.store(std::string(64, c), obj_path);
+  }
+  // make 'a' the most recently used one
+  const auto now = std::filesystem::file_time_type::clock::now();
+  std::filesystem::last_write_time(tmp_dir + "/cache/aa/" + std::string(64, 'a') + ".o", now);
+  std::filesystem::last_write_time(tmp_dir + "/cache/bb/" + std::string(64, 'b') + ".o", now - std::chrono::hours{2});
+  std::filesystem::last_write_time(tmp_dir + "/cache/cc/" + std::string(64, 'c') + ".o", now - std::chrono::hours{1});
+
+  cache.trim();
+  ASSERT_TRUE(cache.restore(std::string(64, 'a'), obj_path));
+  ASSERT_FALSE(cache.restore(std::string(64, 'b'), obj_path));
+  ASSERT_TRUE(cache.restore(std::string(64, 'c'), obj_path));
+}
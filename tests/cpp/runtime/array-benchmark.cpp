@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "runtime/kphp_core.h"
+
+namespace {
+
+constexpr int64_t elements_count = 1000000;
+constexpr int64_t rounds = 5;
+
+template<class F>
+void run_benchmark(const char *name, const F &f) {
+  const auto start = std::chrono::steady_clock::now();
+  int64_t checksum = 0;
+  for (int64_t round = 0; round != rounds; ++round) {
+    checksum += f();
+  }
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  fprintf(stderr, "%-24s %8.1f ns/element (checksum %" PRId64 ")\n", name, duration.count() * 1e9 / (rounds * elements_count), checksum);
+}
+
+// sparse user ids
+int64_t make_int_key(int64_t i) {
+  return i * 7919 + 100000000;
+}
+
+string make_string_key(int64_t i) {
+  string result{"user_"};
+  result.append(i);
+  return result;
+}
+
+template<class F>
+void run_map_benchmarks(const char *prefix, const F &make_key) {
+  fprintf(stderr, "%s:\n", prefix);
+  run_benchmark("insert", [&make_key] {
+    array<int64_t> map;
+    for (int64_t i = 0; i != elements_count; ++i) {
+      map.set_value(make_key(i), i);
+    }
+    return map.count();
+  });
+
+  array<int64_t> map;
+  for (int64_t i = 0; i != elements_count; ++i) {
+    map.set_value(make_key(i), i);
+  }
+  std::vector<decltype(make_key(0))> keys;
+  std::vector<decltype(make_key(0))> missing_keys;
+  keys.reserve(elements_count);
+  missing_keys.reserve(elements_count);
+  for (int64_t i = 0; i != elements_count; ++i) {
+    keys.emplace_back(make_key(i));
+    missing_keys.emplace_back(make_key(elements_count + i));
+  }
+
+  run_benchmark("lookup hit", [&map, &keys] {
+    int64_t sum = 0;
+    for (const auto &key : keys) {
+      sum += *map.find_value(key);
+    }
+    return sum;
+  });
+
+  run_benchmark("lookup miss", [&map, &missing_keys] {
+    int64_t found = 0;
+    for (const auto &key : missing_keys) {
+      found += map.find_value(key) != nullptr;
+    }
+    return found;
+  });
+
+  run_benchmark("iterate", [&map] {
+    int64_t sum = 0;
+    for (const auto &it : map) {
+      sum += it.get_value();
+    }
+    return sum;
+  });
+}
+
+} // namespace
+
+TEST(array_benchmark, DISABLED_map_operations) {
+  run_map_benchmarks("int keys", make_int_key);
+  run_map_benchmarks("string keys", make_string_key);
+}
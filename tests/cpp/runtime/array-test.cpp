@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <random>
+#include <vector>
 
 #include "runtime/kphp_core.h"
 
@@ -132,3 +135,47 @@ TEST(array_test, test_mutate_shared_map) {
   ASSERT_EQ(arr_copy.get_reference_counter(), 1);
   ASSERT_FALSE(arr_copy.is_equal_inner_pointer(arr));
 }
+
+TEST(array_test, test_map_set_unset_random) {
+  // the probing and the backward shift deletion of the map buckets are checked against the straightforward model
+  std::vector<std::pair<mixed, int64_t>> model;
+  array<int64_t> arr;
+  std::mt19937 gen{42};
+  auto make_key = [&gen](int64_t i) {
+    // the int keys collide modulo the small buckets count, the string keys have the different hashes
+    return gen() % 2 ? mixed{i * 7} : mixed{string{"key_"}.append(i)};
+  };
+
+  for (int64_t step = 0; step != 20000; ++step) {
+    const mixed key = make_key(gen() % 500);
+    auto model_it = std::find_if(model.begin(), model.end(), [&key](const auto &element) { return equals(element.first, key); });
+    if (gen() % 3) {
+      arr.set_value(key, step);
+      if (model_it == model.end()) {
+        model.emplace_back(key, step);
+      } else {
+        model_it->second = step;
+      }
+    } else {
+      arr.unset(key);
+      if (model_it != model.end()) {
+        model.erase(model_it);
+      }
+    }
+
+    if (step % 100 == 0) {
+      ASSERT_EQ(arr.count(), model.size());
+      auto model_element = model.begin();
+      for (const auto &it : arr) {
+        ASSERT_TRUE(equals(it.get_key(), model_element->first));
+        ASSERT_EQ(it.get_value(), model_element->second);
+        ++model_element;
+      }
+      for (const auto &element : model) {
+        ASSERT_TRUE(arr.isset(element.first));
+      }
+      ASSERT_FALSE(arr.isset(string{"key_500"}));
+      ASSERT_FALSE(arr.isset(500 * 7));
+    }
+  }
+}
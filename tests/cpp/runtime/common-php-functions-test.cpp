@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <set>
 
 #include "common/php-functions.h"
 
@@ -147,3 +148,25 @@ TEST(test_php_try_to_integer, long_strings) {
   ASSERT_FALSE(php_try_to_int_wrapper("-784894841981984984891498", x));
   ASSERT_FALSE(php_try_to_int_wrapper("-9223372036854775809", x));
 }
+
+TEST(test_string_hash, all_lengths_and_bytes) {
+  std::string s;
+  for (size_t i = 0; i != 256; ++i) {
+    s.push_back(static_cast<char>('a' + i % 26));
+  }
+
+  std::set<int64_t> prefix_hashes;
+  for (size_t len = 0; len <= s.size(); ++len) {
+    // the hash must not read out of the string
+    const std::string prefix = s.substr(0, len);
+    const int64_t hash = string_hash(prefix.c_str(), prefix.size());
+    ASSERT_EQ(hash, string_hash(prefix.c_str(), prefix.size()));
+    ASSERT_TRUE(prefix_hashes.insert(hash).second);
+
+    for (size_t i = 0; i != len; ++i) {
+      std::string changed = prefix;
+      changed[i] ^= 1;
+      ASSERT_NE(hash, string_hash(changed.c_str(), changed.size()));
+    }
+  }
+}
@@ -14,7 +14,7 @@ void init_global_confdata_confdata() {
 
   pid = 0;
   auto &global_manager = ConfdataGlobalManager::get();
-  global_manager.init(1024 * 1024 * 16, std::unordered_set<vk::string_view>{}, nullptr);
+  global_manager.init(1024 * 1024 * 16, std::unordered_set<vk::string_view>{}, nullptr, false);
   auto confdata_sample_storage = global_manager.get_current().get_confdata();
 
   confdata_sample_storage[string{"_key_1"}] = string{"value_1"};
@@ -0,0 +1,222 @@
+#include <array>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "runtime/confdata-hash-index.h"
+
+TEST(confdata_hash_index_test, empty_storage) {
+  std::array<char, 64 * 1024> buffer;
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  confdata_sample_storage storage{resource};
+  ConfdataHashIndex index;
+  ASSERT_TRUE(index.build(storage, resource));
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(index.get_memory_used(), 0);
+}
+
+TEST(confdata_hash_index_test, find) {
+  std::array<char, 1024 * 1024> buffer;
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  {
+    confdata_sample_storage storage{resource};
+    for (int64_t i = 0; i < 1000; ++i) {
+      storage[string{"key_"}.append(i)] = i;
+    }
+    storage[string{"section."}] = array<mixed>{std::make_pair(mixed{string{"x"}}, mixed{string{"y"}})};
+
+    ConfdataHashIndex index;
+    ASSERT_TRUE(index.build(storage, resource));
+    ASSERT_FALSE(index.empty());
+    ASSERT_GE(index.get_memory_used(), storage.size() * 2 * sizeof(void *));
+
+    for (int64_t i = 0; i < 1000; ++i) {
+      const auto *element = index.find(string{"key_"}.append(i));
+      ASSERT_TRUE(element);
+      ASSERT_EQ(element->second.as_int(), i);
+      ASSERT_EQ(element, storage.find(string{"key_"}.append(i)));
+    }
+    const auto *section = index.find(string{"section."});
+    ASSERT_TRUE(section);
+    ASSERT_TRUE(section->second.is_array());
+
+    for (const char *unknown_key : {"", "key_", "key_1000", "key_-1", "section", "section.x"}) {
+      ASSERT_FALSE(index.find(string{unknown_key}));
+    }
+
+    const auto memory_used = resource.get_memory_stats().memory_used;
+    index.clear(resource);
+    ASSERT_TRUE(index.empty());
+    ASSERT_LT(resource.get_memory_stats().memory_used, memory_used);
+  }
+}
+
+TEST(confdata_hash_index_test, no_memory) {
+  std::array<char, 256 * 1024> storage_buffer;
+  memory_resource::unsynchronized_pool_resource storage_resource;
+  storage_resource.init(storage_buffer.data(), storage_buffer.size());
+
+  std::array<char, 4 * 1024> index_buffer;
+  memory_resource::unsynchronized_pool_resource index_resource;
+  index_resource.init(index_buffer.data(), index_buffer.size());
+
+  confdata_sample_storage storage{storage_resource};
+  for (int64_t i = 0; i < 500; ++i) {
+    storage[string{i}] = i;
+  }
+  ConfdataHashIndex index;
+  ASSERT_FALSE(index.build(storage, index_resource));
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(index_resource.get_memory_stats().memory_used, 0);
+}
+
+namespace {
+
+ConfdataHashIndex::Changes commit_storage(confdata_sample_storage &storage, std::vector<std::string> &&erased_keys) {
+  ConfdataHashIndex::Changes changes;
+  storage.commit_updates([&changes](const confdata_sample_storage::value_type &element) {
+    changes.updated_elements.emplace_back(&element);
+  });
+  changes.erased_keys = std::move(erased_keys);
+  return changes;
+}
+
+void expect_index_of(const ConfdataHashIndex &index, const confdata_sample_storage &storage, int64_t max_key) {
+  if (index.empty()) {
+    ASSERT_TRUE(storage.empty());
+    return;
+  }
+  for (int64_t i = 0; i < max_key; ++i) {
+    const string key{i};
+    ASSERT_EQ(index.find(key), storage.find(key));
+  }
+}
+
+} // namespace
+
+TEST(confdata_hash_index_test, update) {
+  std::vector<char> buffer(64 * 1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  {
+    confdata_sample_storage previous_storage{resource};
+    for (int64_t i = 0; i < 100000; ++i) {
+      previous_storage[string{i}] = i;
+    }
+    commit_storage(previous_storage, {});
+    ConfdataHashIndex previous_index;
+    ASSERT_TRUE(previous_index.build(previous_storage, resource));
+
+    confdata_sample_storage storage{previous_storage};
+    storage[string{"500"}] = -500;
+    storage[string{"100000"}] = 100000;
+    storage.erase(string{"10"});
+    const auto changes = commit_storage(storage, {"10"});
+
+    const auto memory_used = resource.get_memory_stats().memory_used;
+    ConfdataHashIndex index;
+    ASSERT_TRUE(index.update(previous_index, storage, changes, resource));
+    // only the pages with the changed slots are copied
+    ASSERT_LT(resource.get_memory_stats().memory_used - memory_used, index.get_memory_used() / 10);
+    ASSERT_EQ(index.get_memory_used(), previous_index.get_memory_used());
+
+    expect_index_of(index, storage, 100001);
+    ASSERT_EQ(index.find(string{"500"})->second.as_int(), -500);
+    ASSERT_FALSE(index.find(string{"10"}));
+    // the previous index isn't changed
+    expect_index_of(previous_index, previous_storage, 100001);
+    ASSERT_EQ(previous_index.find(string{"500"})->second.as_int(), 500);
+
+    previous_index.clear(resource);
+    previous_storage.clear();
+    expect_index_of(index, storage, 100001);
+    index.clear(resource);
+  }
+  ASSERT_EQ(resource.get_memory_stats().memory_used, 0);
+}
+
+TEST(confdata_hash_index_test, random_updates) {
+  std::vector<char> buffer(32 * 1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  constexpr int64_t max_key = 3000;
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int64_t> key_distribution{0, max_key - 1};
+  {
+    std::vector<confdata_sample_storage> storages;
+    std::vector<ConfdataHashIndex> indexes(50);
+    storages.reserve(indexes.size());
+    storages.emplace_back(resource);
+    ASSERT_TRUE(indexes[0].build(storages[0], resource));
+    for (size_t sample = 1; sample < indexes.size(); ++sample) {
+      storages.emplace_back(storages.back());
+      auto &storage = storages.back();
+      std::vector<std::string> erased_keys;
+      // the storage grows and shrinks, so the index is rebuilt sometimes
+      const int64_t updates = sample < 20 ? 300 : 50;
+      for (int64_t i = 0; i < updates; ++i) {
+        const string key{key_distribution(gen)};
+        if (sample < 30 ? i % 4 == 0 : i % 4 != 0) {
+          if (storage.find(key)) {
+            storage.erase(key);
+            erased_keys.emplace_back(key.c_str(), key.size());
+          }
+        } else {
+          storage[key] = static_cast<int64_t>(sample);
+        }
+      }
+      const auto changes = commit_storage(storage, std::move(erased_keys));
+      ASSERT_TRUE(indexes[sample].update(indexes[sample - 1], storage, changes, resource));
+      expect_index_of(indexes[sample], storage, max_key);
+    }
+    for (size_t sample = 0; sample < indexes.size(); ++sample) {
+      expect_index_of(indexes[sample], storages[sample], max_key);
+      indexes[sample].clear(resource);
+      storages[sample].clear();
+    }
+  }
+  ASSERT_EQ(resource.get_memory_stats().memory_used, 0);
+}
+
+// run it with --gtest_also_run_disabled_tests --gtest_filter=*benchmark*
+TEST(confdata_hash_index_test, DISABLED_benchmark) {
+  static constexpr int64_t elements = 100000;
+  static constexpr int64_t lookups = 10000000;
+  std::vector<char> buffer(32 * 1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  confdata_sample_storage storage{resource};
+  std::vector<string> keys;
+  keys.reserve(elements);
+  for (int64_t i = 0; i < elements; ++i) {
+    keys.emplace_back(string{"confdata_benchmark_key_"}.append(i * 7919));
+    storage[keys.back()] = i;
+  }
+  const size_t storage_memory = resource.get_memory_stats().memory_used;
+
+  ConfdataHashIndex index;
+  ASSERT_TRUE(index.build(storage, resource));
+
+  auto measure = [&keys](const char *name, size_t memory, const auto &find) {
+    int64_t found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < lookups; ++i) {
+      found += find(keys[(i * 31) % elements]);
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(found, lookups);
+    fprintf(stderr, "%-10s %12.0f lookups/sec, %10zu bytes of shared memory\n", name, lookups / duration.count(), memory);
+  };
+  measure("tree", storage_memory, [&storage](const string &key) { return storage.find(key) != nullptr; });
+  measure("hash index", storage_memory + index.get_memory_used(), [&index](const string &key) { return index.find(key) != nullptr; });
+
+  index.clear(resource);
+}
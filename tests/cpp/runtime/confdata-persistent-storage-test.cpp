@@ -0,0 +1,146 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "runtime/confdata-persistent-storage.h"
+
+namespace {
+
+// the storage keys are ordered as strings
+using expected_storage = std::map<std::string, int64_t>;
+
+void expect_equal(const confdata_sample_storage &storage, const expected_storage &expected) {
+  ASSERT_EQ(storage.size(), expected.size());
+  auto expected_it = expected.begin();
+  for (const auto &element : storage) {
+    ASSERT_NE(expected_it, expected.end());
+    ASSERT_STREQ(element.first.c_str(), expected_it->first.c_str());
+    ASSERT_EQ(element.second.as_int(), expected_it->second);
+    ++expected_it;
+  }
+  ASSERT_EQ(expected_it, expected.end());
+}
+
+} // namespace
+
+TEST(confdata_persistent_storage_test, insert_find_erase) {
+  std::array<char, 256 * 1024> buffer;
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  {
+    confdata_sample_storage storage{resource};
+    ASSERT_TRUE(storage.empty());
+    ASSERT_EQ(storage.begin(), storage.end());
+
+    for (int64_t i = 0; i < 100; ++i) {
+      storage[string{"key_"}.append(i)] = i;
+    }
+    ASSERT_EQ(storage.size(), 100);
+    for (int64_t i = 0; i < 100; ++i) {
+      const auto *element = storage.find(string{"key_"}.append(i));
+      ASSERT_TRUE(element);
+      ASSERT_EQ(element->second.as_int(), i);
+    }
+    ASSERT_FALSE(storage.find(string{"key_100"}));
+
+    auto it = storage.lower_bound(string{"key_5"});
+    ASSERT_EQ(it->first, string{"key_5"});
+    ++it;
+    ASSERT_EQ(it->first, string{"key_50"});
+    it = storage.lower_bound(string{"key_99_"});
+    ASSERT_EQ(it, storage.end());
+    it = storage.lower_bound(string{"a"});
+    ASSERT_EQ(it, storage.begin());
+
+    for (int64_t i = 0; i < 100; i += 2) {
+      storage.erase(string{"key_"}.append(i));
+    }
+    storage.erase(string{"unknown"});
+    ASSERT_EQ(storage.size(), 50);
+    for (int64_t i = 0; i < 100; ++i) {
+      ASSERT_EQ(storage.find(string{"key_"}.append(i)) != nullptr, i % 2 == 1);
+    }
+  }
+  ASSERT_EQ(resource.get_memory_stats().memory_used, 0);
+}
+
+TEST(confdata_persistent_storage_test, copies_share_nodes) {
+  std::array<char, 1024 * 1024> buffer;
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  {
+    confdata_sample_storage storage{resource};
+    expected_storage expected;
+    for (int64_t i = 0; i < 1000; ++i) {
+      storage[string{i}] = i;
+      expected[std::to_string(i)] = i;
+    }
+    storage.commit_updates([](confdata_sample_storage::value_type &) {});
+    const size_t memory_used = resource.get_memory_stats().memory_used;
+
+    confdata_sample_storage updated{storage};
+    ASSERT_EQ(resource.get_memory_stats().memory_used, memory_used);
+
+    updated.find_for_update(string{int64_t{500}}).second = -500;
+    updated.erase(string{int64_t{10}});
+    updated[string{int64_t{1000}}] = 1000;
+
+    size_t visited = 0;
+    const size_t copied_bytes = updated.commit_updates([&visited](confdata_sample_storage::value_type &) { ++visited; });
+    // only the paths to the updated elements are copied
+    ASSERT_GT(visited, 0);
+    ASSERT_LT(visited, 100);
+    ASSERT_GT(copied_bytes, 0);
+    ASSERT_LE(resource.get_memory_stats().memory_used - memory_used, copied_bytes);
+
+    expect_equal(storage, expected);
+    auto updated_expected = expected;
+    updated_expected["500"] = -500;
+    updated_expected.erase("10");
+    updated_expected["1000"] = 1000;
+    expect_equal(updated, updated_expected);
+
+    storage.clear();
+    expect_equal(updated, updated_expected);
+  }
+  ASSERT_EQ(resource.get_memory_stats().memory_used, 0);
+}
+
+TEST(confdata_persistent_storage_test, random_updates) {
+  std::vector<char> buffer(16 * 1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.init(buffer.data(), buffer.size());
+
+  {
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int64_t> key_distribution{0, 5000};
+    std::vector<confdata_sample_storage> samples;
+    std::vector<expected_storage> expected_samples;
+    confdata_sample_storage storage{resource};
+    expected_storage expected;
+    for (int sample = 0; sample < 20; ++sample) {
+      for (int i = 0; i < 1000; ++i) {
+        const int64_t key = key_distribution(gen);
+        if (gen() % 3 == 0) {
+          storage.erase(string{key});
+          expected.erase(std::to_string(key));
+        } else {
+          storage[string{key}] = sample;
+          expected[std::to_string(key)] = sample;
+        }
+      }
+      storage.commit_updates([](confdata_sample_storage::value_type &) {});
+      samples.emplace_back(storage);
+      expected_samples.emplace_back(expected);
+    }
+    for (size_t i = 0; i < samples.size(); ++i) {
+      expect_equal(samples[i], expected_samples[i]);
+    }
+  }
+  ASSERT_EQ(resource.get_memory_stats().memory_used, 0);
+}
@@ -0,0 +1,160 @@
+#include <array>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "runtime/inter-process-epoch-readers.h"
+
+namespace {
+
+constexpr size_t MAX_READERS = 8;
+
+// the objects removed by the writer, they are detached and destroyed like the garbage of the instance cache arena
+struct GarbageStub {
+  std::vector<int> removed;
+  std::vector<int> detached;
+  uint64_t detached_epoch{0};
+  size_t destroyed{0};
+
+  void clear(InterProcessEpochReaders<MAX_READERS> &readers, std::atomic<uint64_t> &epoch) {
+    if (!detached.empty() && !readers.has_readers_at(detached_epoch, MAX_READERS)) {
+      destroyed += detached.size();
+      detached.clear();
+    }
+    if (detached.empty() && !removed.empty()) {
+      detached.swap(removed);
+      detached_epoch = epoch.fetch_add(1);
+      if (!readers.has_readers_at(detached_epoch, MAX_READERS)) {
+        destroyed += detached.size();
+        detached.clear();
+      }
+    }
+  }
+};
+
+} // namespace
+
+TEST(inter_process_epoch_readers_test, test_readers_at_epoch) {
+  InterProcessEpochReaders<MAX_READERS> readers;
+  std::atomic<uint64_t> epoch{1};
+
+  readers.enter(1, epoch);
+  const uint64_t detached_epoch = epoch.fetch_add(1);
+  ASSERT_TRUE(readers.has_readers_at(detached_epoch, MAX_READERS));
+
+  // the reader entered after the epoch is advanced doesn't see the detached objects
+  readers.enter(2, epoch);
+  ASSERT_TRUE(readers.has_readers_at(detached_epoch, MAX_READERS));
+  readers.leave(1);
+  ASSERT_FALSE(readers.has_readers_at(detached_epoch, MAX_READERS));
+  ASSERT_TRUE(readers.has_readers_at(epoch.fetch_add(1), MAX_READERS));
+
+  readers.leave(2);
+  ASSERT_FALSE(readers.has_readers_at(epoch.load(), MAX_READERS));
+}
+
+TEST(inter_process_epoch_readers_test, test_readers_count) {
+  InterProcessEpochReaders<MAX_READERS> readers;
+  std::atomic<uint64_t> epoch{1};
+
+  readers.enter(5, epoch);
+  const uint64_t detached_epoch = epoch.fetch_add(1);
+  ASSERT_FALSE(readers.has_readers_at(detached_epoch, 5));
+  ASSERT_TRUE(readers.has_readers_at(detached_epoch, 6));
+  readers.leave(5);
+}
+
+TEST(inter_process_epoch_readers_test, test_overlapping_readers) {
+  InterProcessEpochReaders<MAX_READERS> readers;
+  std::atomic<uint64_t> epoch{1};
+  GarbageStub garbage;
+
+  constexpr int steps = 1000;
+  readers.enter(0, epoch);
+  for (int i = 0; i != steps; ++i) {
+    // there is always a reader, the next one enters before the previous one leaves
+    readers.enter((i + 1) % 2, epoch);
+    readers.leave(i % 2);
+    garbage.removed.push_back(i);
+    garbage.clear(readers, epoch);
+  }
+  readers.leave(steps % 2);
+  // the last batches are waiting for the readers, which were there when they were detached
+  ASSERT_GE(garbage.destroyed, steps - 2);
+
+  garbage.clear(readers, epoch);
+  garbage.clear(readers, epoch);
+  ASSERT_EQ(garbage.destroyed, steps);
+}
+
+TEST(inter_process_epoch_readers_test, test_concurrent_readers) {
+  constexpr int alive = 1;
+  constexpr int destroyed = 2;
+  constexpr size_t objects_count = 64;
+  constexpr size_t readers_count = 3;
+  constexpr size_t reads = 20000;
+
+  InterProcessEpochReaders<MAX_READERS> readers;
+  std::atomic<uint64_t> epoch{1};
+  std::array<std::atomic<int>, objects_count> objects{};
+  std::atomic<size_t> current{0};
+  std::atomic<bool> done{false};
+  std::atomic<size_t> seen_destroyed{0};
+  std::atomic<size_t> reads_done{0};
+
+  objects[0] = alive;
+  std::vector<std::thread> reader_threads;
+  for (size_t reader_id = 0; reader_id != readers_count; ++reader_id) {
+    reader_threads.emplace_back([&, reader_id] {
+      while (!done.load()) {
+        readers.enter(reader_id, epoch);
+        const size_t object = current.load();
+        // let the writer replace and destroy the objects while the reader is looking at one
+        for (int i = 0; i != 4; ++i) {
+          std::this_thread::yield();
+        }
+        if (objects[object].load() != alive) {
+          seen_destroyed.fetch_add(1);
+        }
+        readers.leave(reader_id);
+        reads_done.fetch_add(1);
+      }
+    });
+  }
+
+  std::vector<size_t> removed;
+  std::vector<size_t> detached;
+  uint64_t detached_epoch = 0;
+  size_t destroyed_count = 0;
+  auto destroy_detached = [&] {
+    for (size_t object : detached) {
+      objects[object] = destroyed;
+    }
+    destroyed_count += detached.size();
+    detached.clear();
+  };
+  while (reads_done.load() < reads) {
+    std::this_thread::yield();
+    // the next object is reused only after it has been destroyed
+    const size_t next = (current.load() + 1) % objects_count;
+    if (objects[next].load() != alive) {
+      objects[next] = alive;
+      removed.push_back(current.exchange(next));
+    }
+    if (!detached.empty() && !readers.has_readers_at(detached_epoch, readers_count)) {
+      destroy_detached();
+    }
+    if (detached.empty() && !removed.empty()) {
+      detached.swap(removed);
+      detached_epoch = epoch.fetch_add(1);
+    }
+  }
+  done = true;
+  for (auto &thread : reader_threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(seen_destroyed.load(), 0);
+  ASSERT_GT(destroyed_count, 0);
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "runtime/memory_resource/unsynchronized_pool_resource.h"
+
+namespace {
+
+// A long running script like workload: the live set slowly drifts, the sizes are mixed
+void run_mixed_sizes_benchmark(const char *name, bool slab_mode) {
+  static constexpr size_t operations = 20000000;
+  static constexpr size_t live_pieces = 100000;
+  std::vector<char> buffer(48 * 1024 * 1024);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.set_slab_mode(slab_mode);
+  resource.init(buffer.data(), buffer.size());
+
+  std::mt19937 gen{42};
+  std::vector<size_t> sizes(operations / 16);
+  for (auto &size : sizes) {
+    // mostly small objects with a tail of bigger ones
+    size = gen() % 8 ? 8 + gen() % 120 : 128 + gen() % 4000;
+  }
+  std::vector<std::pair<void *, size_t>> pieces(live_pieces, {nullptr, 0});
+
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i != operations; ++i) {
+    auto &piece = pieces[(i * 7919) % live_pieces];
+    if (piece.first) {
+      resource.deallocate(piece.first, piece.second);
+    }
+    piece.second = sizes[i % sizes.size()];
+    piece.first = resource.allocate(piece.second);
+    ASSERT_TRUE(piece.first);
+  }
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+  const auto stats = resource.get_memory_stats();
+  fprintf(stderr, "%-12s %8.1f ns/op, %3zu defragmentations, %10zu used bytes, %10zu real used bytes, %6zu slab pages\n",
+          name, duration.count() * 1e9 / operations, stats.defragmentation_calls,
+          stats.memory_used, stats.real_memory_used, stats.slab_pages);
+
+  for (const auto &piece : pieces) {
+    resource.deallocate(piece.first, piece.second);
+  }
+}
+
+} // namespace
+
+TEST(unsynchronized_pool_resource_benchmark, DISABLED_mixed_sizes) {
+  run_mixed_sizes_benchmark("free lists", false);
+  run_mixed_sizes_benchmark("slabs", true);
+}
@@ -1,5 +1,8 @@
 #include <array>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <random>
+#include <vector>
 
 #include "runtime/memory_resource/unsynchronized_pool_resource.h"
 
@@ -292,4 +295,133 @@ TEST(unsynchronized_pool_resource_test, test_auto_defragmentation_small_piece) {
   ASSERT_EQ(mem_stats.small_memory_pieces, 0);
 
   resource.deallocate(mem64, 64);
-}
\ No newline at end of file
+}
+TEST(unsynchronized_pool_resource_test, slab_size_classes) {
+  using memory_resource::details::memory_slab_page;
+  size_t prev_class_size = 0;
+  for (size_t class_id = 0; class_id != memory_slab_page::CLASSES_COUNT; ++class_id) {
+    const size_t class_size = memory_slab_page::get_class_size(class_id);
+    ASSERT_GT(class_size, prev_class_size);
+    ASSERT_EQ(class_size % 8, 0);
+    for (size_t size = prev_class_size + 8; size <= class_size; size += 8) {
+      ASSERT_EQ(memory_slab_page::get_class_id(size), class_id);
+    }
+    prev_class_size = class_size;
+  }
+  ASSERT_EQ(prev_class_size, memory_slab_page::MAX_BLOCK_SIZE);
+}
+
+TEST(unsynchronized_pool_resource_test, slab_mode_allocation) {
+  using memory_resource::details::memory_slab_page;
+  std::vector<char> some_memory(memory_slab_page::PAGE_SIZE * 8);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.set_slab_mode(true);
+  resource.init(some_memory.data(), some_memory.size());
+  ASSERT_TRUE(resource.is_slab_mode());
+
+  void *mem24 = resource.allocate(20);
+  void *mem24_2 = resource.allocate(24);
+  ASSERT_EQ(memory_slab_page::get_page_of(mem24), memory_slab_page::get_page_of(mem24_2));
+  void *mem160 = resource.allocate(150);
+  ASSERT_NE(memory_slab_page::get_page_of(mem24), memory_slab_page::get_page_of(mem160));
+  void *mem_huge = resource.allocate(2000);
+
+  auto mem_stats = resource.get_memory_stats();
+  ASSERT_EQ(mem_stats.memory_used, 24 + 24 + 160 + 2000);
+  ASSERT_EQ(mem_stats.slab_pages, 2);
+
+  // the same class, the block isn't moved
+  ASSERT_EQ(resource.reallocate(mem24, 17, 20), mem24);
+  void *mem1024 = resource.reallocate(mem24, 1000, 17);
+  ASSERT_EQ(memory_slab_page::get_page_of(mem1024)->get_block_size(), 1024);
+  mem_stats = resource.get_memory_stats();
+  ASSERT_EQ(mem_stats.memory_used, 24 + 160 + 1024 + 2000);
+  ASSERT_EQ(mem_stats.slab_pages, 3);
+
+  resource.deallocate(mem24_2, 24);
+  resource.deallocate(mem160, 150);
+  resource.deallocate(mem1024, 1000);
+  resource.deallocate(mem_huge, 2000);
+  mem_stats = resource.get_memory_stats();
+  ASSERT_EQ(mem_stats.memory_used, 0);
+  // the last page of each class is kept
+  ASSERT_EQ(mem_stats.slab_pages, 3);
+  ASSERT_EQ(mem_stats.defragmentation_calls, 0);
+
+  resource.hard_reset();
+  ASSERT_TRUE(resource.is_slab_mode());
+  ASSERT_EQ(resource.get_memory_stats().slab_pages, 0);
+}
+
+TEST(unsynchronized_pool_resource_test, slab_mode_pages_reuse) {
+  using memory_resource::details::memory_slab_page;
+  std::vector<char> some_memory(memory_slab_page::PAGE_SIZE * 16);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.set_slab_mode(true);
+  resource.init(some_memory.data(), some_memory.size());
+
+  std::mt19937 gen{7};
+  std::vector<std::pair<void *, size_t>> allocated;
+  for (size_t iteration = 0; iteration != 100000; ++iteration) {
+    if (allocated.empty() || gen() % 3 != 0) {
+      const size_t size = 1 + gen() % (gen() % 4 ? 128 : memory_slab_page::MAX_BLOCK_SIZE);
+      if (!resource.is_enough_memory_for(size)) {
+        continue;
+      }
+      void *mem = resource.allocate(size);
+      ASSERT_TRUE(mem);
+      std::memset(mem, static_cast<int>(size), size);
+      allocated.emplace_back(mem, size);
+    } else {
+      std::swap(allocated[gen() % allocated.size()], allocated.back());
+      const auto piece = allocated.back();
+      allocated.pop_back();
+      ASSERT_EQ(static_cast<char *>(piece.first)[piece.second - 1], static_cast<char>(piece.second));
+      resource.deallocate(piece.first, piece.second);
+    }
+  }
+
+  for (const auto &piece : allocated) {
+    resource.deallocate(piece.first, piece.second);
+  }
+  const auto mem_stats = resource.get_memory_stats();
+  ASSERT_EQ(mem_stats.memory_used, 0);
+  ASSERT_LE(mem_stats.slab_pages, memory_slab_page::CLASSES_COUNT);
+}
+
+TEST(unsynchronized_pool_resource_test, slab_mode_free_pages_are_enough) {
+  using memory_resource::details::memory_slab_page;
+  std::vector<char> some_memory(memory_slab_page::PAGE_SIZE * 4);
+  memory_resource::unsynchronized_pool_resource resource;
+  resource.set_slab_mode(true);
+  resource.init(some_memory.data(), some_memory.size());
+
+  std::vector<void *> allocated;
+  while (resource.is_enough_memory_for(24)) {
+    allocated.emplace_back(resource.allocate(24));
+    ASSERT_TRUE(allocated.back());
+  }
+  ASSERT_FALSE(resource.is_enough_memory_for(160));
+
+  // the first page gets empty and is released for the other classes, as the last page of the class has free blocks
+  const auto *first_page = memory_slab_page::get_page_of(allocated.front());
+  ASSERT_NE(memory_slab_page::get_page_of(allocated.back()), first_page);
+  resource.deallocate(allocated.back(), 24);
+  allocated.pop_back();
+  for (void *&mem : allocated) {
+    if (memory_slab_page::get_page_of(mem) == first_page) {
+      resource.deallocate(mem, 24);
+      mem = nullptr;
+    }
+  }
+  ASSERT_TRUE(resource.is_enough_memory_for(160));
+  void *mem160 = resource.allocate(160);
+  ASSERT_TRUE(mem160);
+  resource.deallocate(mem160, 160);
+
+  for (void *mem : allocated) {
+    if (mem) {
+      resource.deallocate(mem, 24);
+    }
+  }
+}
@@ -1,12 +1,16 @@
 prepend(RUNTIME_TESTS_SOURCES ${BASE_DIR}/tests/cpp/runtime/
         _runtime-tests-env.cpp
         allocator-malloc-replacement-test.cpp
+        array-benchmark.cpp
         array-test.cpp
         common-php-functions-test.cpp
         confdata-functions-test.cpp
+        confdata-hash-index-test.cpp
         confdata-key-maker-test.cpp
+        confdata-persistent-storage-test.cpp
         confdata-predefined-wildcards-test.cpp
         flex-test.cpp
+        inter-process-epoch-readers-test.cpp
         inter-process-mutex-test.cpp
         inter-process-resource-test.cpp
         number-string-comparison.cpp
@@ -15,7 +19,9 @@ prepend(RUNTIME_TESTS_SOURCES ${BASE_DIR}/tests/cpp/runtime/
         memory_resource/details/memory_chunk_tree-test.cpp
         memory_resource/details/memory_ordered_chunk_list-test.cpp
         memory_resource/extra-memory-pool-test.cpp
+        memory_resource/unsynchronized_pool_resource-benchmark.cpp
         memory_resource/unsynchronized_pool_resource-test.cpp
+        string-benchmark.cpp
         string-list-test.cpp
         string-test.cpp
         zstd-test.cpp)
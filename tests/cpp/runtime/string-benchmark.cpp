@@ -0,0 +1,86 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+
+#include "runtime/kphp_core.h"
+
+namespace {
+
+constexpr int64_t strings_count = 100000;
+constexpr int64_t rounds = 20;
+
+template<class F>
+void run_benchmark(const char *name, const F &f) {
+  const auto start = std::chrono::steady_clock::now();
+  int64_t checksum = 0;
+  for (int64_t round = 0; round != rounds; ++round) {
+    checksum += f();
+  }
+  const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+  fprintf(stderr, "%-24s %8.1f ns/string (checksum %" PRId64 ")\n", name, duration.count() * 1e9 / (rounds * strings_count), checksum);
+}
+
+// short keys and ids, which are typical for the php code
+string make_short_string(int64_t i) {
+  string result{"id_"};
+  result.append(i);
+  return result;
+}
+
+} // namespace
+
+TEST(string_benchmark, DISABLED_array_of_short_strings) {
+  run_benchmark("build", [] {
+    array<string> strings;
+    for (int64_t i = 0; i != strings_count; ++i) {
+      strings.push_back(make_short_string(i));
+    }
+    return strings.count();
+  });
+
+  array<string> strings;
+  for (int64_t i = 0; i != strings_count; ++i) {
+    strings.push_back(make_short_string(i));
+  }
+  const array<string> copy = strings;
+
+  run_benchmark("iterate", [&strings] {
+    int64_t total_size = 0;
+    for (const auto &it : strings) {
+      total_size += it.get_value().size();
+    }
+    return total_size;
+  });
+
+  run_benchmark("compare copies", [&strings, &copy] {
+    int64_t equal = 0;
+    for (int64_t i = 0; i != strings_count; ++i) {
+      equal += strings.get_value(i) == copy.get_value(i);
+    }
+    return equal;
+  });
+
+  run_benchmark("compare neighbours", [&strings] {
+    int64_t less = 0;
+    for (int64_t i = 1; i != strings_count; ++i) {
+      less += strings.get_value(i - 1).compare(strings.get_value(i)) < 0;
+    }
+    return less;
+  });
+
+  run_benchmark("string keys lookup", [&strings] {
+    array<int64_t> index;
+    for (const auto &it : strings) {
+      index.set_value(it.get_value(), it.get_key().to_int());
+    }
+    int64_t found = 0;
+    for (const auto &it : strings) {
+      found += index.isset(it.get_value());
+    }
+    return found;
+  });
+}
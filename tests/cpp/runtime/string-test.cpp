@@ -65,6 +65,25 @@ TEST(string_test, test_copy_and_make_not_shared) {
   ASSERT_EQ(str3.get_reference_counter(), 1);
 }
 
+TEST(string_test, test_equality) {
+  const string str1{"hello world"};
+  const string str2 = str1;
+  const string str3 = str1.copy_and_make_not_shared();
+  const string str4{"hello world!"};
+
+  ASSERT_TRUE(str1 == str2);
+  ASSERT_TRUE(str1 == str3);
+  ASSERT_FALSE(str1 != str3);
+  ASSERT_EQ(str1.compare(str2), 0);
+  ASSERT_EQ(str1.compare(str3), 0);
+
+  ASSERT_FALSE(str1 == str4);
+  ASSERT_TRUE(str1 != str4);
+  ASSERT_LT(str1.compare(str4), 0);
+  ASSERT_GT(str4.compare(str1), 0);
+  ASSERT_FALSE(string{"hello"} == string{"hellO"});
+}
+
 TEST(string_test, test_hex_to_int) {
   for (size_t c = 0; c != 256; ++c) {
     if (vk::none_of_equal(c,
@@ -0,0 +1,219 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "server/job-workers/job-queue.h"
+
+using namespace job_workers;
+
+namespace {
+
+template<class T>
+struct AlignedHolder {
+  explicit AlignedHolder(uint32_t capacity) :
+    memory(new uint64_t[T::get_memory_size(capacity) / sizeof(uint64_t) + 8]) {
+    // the queue is aligned to the cache line
+    auto address = reinterpret_cast<uintptr_t>(memory.get());
+    queue = T::create(reinterpret_cast<void *>((address + 63) & ~uintptr_t{63}), capacity);
+  }
+
+  std::unique_ptr<uint64_t[]> memory;
+  T *queue{nullptr};
+};
+
+using JobQueueHolder = AlignedHolder<JobQueue>;
+using JobSchedulerHolder = AlignedHolder<JobScheduler>;
+
+JobSharedMessage *make_job(uintptr_t i) {
+  return reinterpret_cast<JobSharedMessage *>(i);
+}
+
+} // namespace
+
+namespace job_workers {
+
+// the process dies right after the claim
+struct JobQueueTestAccess {
+  static bool abandon_push(JobQueue &queue, uint16_t process_id) {
+    uint64_t pos = 0;
+    return queue.claim_cell_for_push(process_id, pos);
+  }
+
+  static bool abandon_pop(JobQueue &queue, uint16_t process_id) {
+    uint64_t pos = 0;
+    return queue.claim_cell_for_pop(process_id, pos);
+  }
+};
+
+} // namespace job_workers
+
+TEST(job_queue_test, test_push_pop) {
+  JobQueueHolder holder{5};
+  JobQueue &queue = *holder.queue;
+  ASSERT_EQ(queue.capacity(), 8);
+
+  int64_t enqueue_time_ns = 0;
+  ASSERT_EQ(queue.pop(enqueue_time_ns, 0), nullptr);
+
+  for (uintptr_t i = 1; i <= 8; ++i) {
+    ASSERT_TRUE(queue.push(make_job(i), i * 10, 0, 0));
+  }
+  ASSERT_FALSE(queue.push(make_job(9), 90, 0, 0));
+
+  for (uintptr_t i = 1; i <= 8; ++i) {
+    ASSERT_EQ(queue.pop(enqueue_time_ns, 0), make_job(i));
+    ASSERT_EQ(enqueue_time_ns, i * 10);
+    ASSERT_TRUE(queue.push(make_job(i + 8), 0, 0, 0));
+  }
+  for (uintptr_t i = 9; i <= 16; ++i) {
+    ASSERT_EQ(queue.pop(enqueue_time_ns, 0), make_job(i));
+  }
+  ASSERT_EQ(queue.pop(enqueue_time_ns, 0), nullptr);
+}
+
+TEST(job_queue_test, test_concurrent_push_pop) {
+  constexpr uintptr_t producers = 4;
+  constexpr uintptr_t consumers = 4;
+  constexpr uintptr_t jobs_per_producer = 20000;
+
+  JobQueueHolder holder{64};
+  JobQueue &queue = *holder.queue;
+
+  std::vector<std::thread> threads;
+  for (uintptr_t producer = 0; producer != producers; ++producer) {
+    threads.emplace_back([&queue, producer] {
+      for (uintptr_t i = 0; i != jobs_per_producer; ++i) {
+        while (!queue.push(make_job(producer * jobs_per_producer + i + 1), 0, 0, producer)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<std::vector<uintptr_t>> popped(consumers);
+  std::atomic<uintptr_t> popped_count{0};
+  for (uintptr_t consumer = 0; consumer != consumers; ++consumer) {
+    threads.emplace_back([&queue, &popped_count, &jobs = popped[consumer], consumer] {
+      int64_t enqueue_time_ns = 0;
+      while (popped_count.load() != producers * jobs_per_producer) {
+        if (JobSharedMessage *job = queue.pop(enqueue_time_ns, producers + consumer)) {
+          jobs.push_back(reinterpret_cast<uintptr_t>(job));
+          ++popped_count;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // every job is popped exactly once, and the jobs of each producer are popped in the push order
+  std::vector<bool> seen(producers * jobs_per_producer + 1);
+  for (const auto &jobs : popped) {
+    std::vector<uintptr_t> last_popped(producers);
+    for (uintptr_t job : jobs) {
+      ASSERT_FALSE(seen[job]);
+      seen[job] = true;
+      const uintptr_t producer = (job - 1) / jobs_per_producer;
+      ASSERT_GT(job, last_popped[producer]);
+      last_popped[producer] = job;
+    }
+  }
+  ASSERT_EQ(popped_count.load(), producers * jobs_per_producer);
+}
+
+TEST(job_queue_test, test_job_priority) {
+  ASSERT_EQ(get_job_priority(0.5), JobPriority::high);
+  ASSERT_EQ(get_job_priority(JOB_HIGH_PRIORITY_MAX_TIMEOUT), JobPriority::high);
+  ASSERT_EQ(get_job_priority(5), JobPriority::normal);
+  ASSERT_EQ(get_job_priority(60), JobPriority::low);
+}
+
+TEST(job_queue_test, test_scheduler_earliest_deadline_first) {
+  JobSchedulerHolder holder{8};
+  JobScheduler &scheduler = *holder.queue;
+
+  JobPriority priority{};
+  int64_t enqueue_time_ns = 0;
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), nullptr);
+
+  ASSERT_TRUE(scheduler.push(make_job(1), JobPriority::low, 1, 100.0, 0));
+  ASSERT_TRUE(scheduler.push(make_job(2), JobPriority::normal, 2, 30.0, 0));
+  ASSERT_TRUE(scheduler.push(make_job(3), JobPriority::high, 3, 50.0, 0));
+  ASSERT_TRUE(scheduler.push(make_job(4), JobPriority::high, 4, 10.0, 0));
+  ASSERT_TRUE(scheduler.push(make_job(5), JobPriority::low, 5, 20.0, 0));
+
+  // the normal priority job with the earliest deadline is taken before the high priority ones
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), make_job(2));
+  ASSERT_EQ(priority, JobPriority::normal);
+  ASSERT_EQ(enqueue_time_ns, 2);
+  // the queues are FIFO, only their heads are compared
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), make_job(3));
+  ASSERT_EQ(priority, JobPriority::high);
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), make_job(4));
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), make_job(1));
+  ASSERT_EQ(priority, JobPriority::low);
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), make_job(5));
+  ASSERT_EQ(scheduler.pop(priority, enqueue_time_ns, 0), nullptr);
+}
+
+TEST(job_queue_test, test_release_abandoned_claims) {
+  JobQueueHolder holder{4};
+  JobQueue &queue = *holder.queue;
+  int64_t enqueue_time_ns = 0;
+
+  ASSERT_TRUE(queue.push(make_job(1), 0, 0, 1));
+  ASSERT_TRUE(JobQueueTestAccess::abandon_push(queue, 2));
+  ASSERT_TRUE(queue.push(make_job(2), 0, 0, 1));
+  ASSERT_TRUE(JobQueueTestAccess::abandon_pop(queue, 3));
+  // the abandoned cells stall the queue until they are released
+  ASSERT_EQ(queue.pop(enqueue_time_ns, 4), nullptr);
+  ASSERT_TRUE(queue.push(make_job(3), 0, 0, 1));
+  ASSERT_FALSE(queue.push(make_job(4), 0, 0, 1));
+
+  std::vector<JobSharedMessage *> lost_jobs;
+  const auto on_lost_job = [&lost_jobs](JobSharedMessage *job) { lost_jobs.push_back(job); };
+  ASSERT_EQ(queue.release_claims(1, on_lost_job), 0);
+  ASSERT_EQ(queue.release_claims(2, on_lost_job), 1);
+  ASSERT_TRUE(lost_jobs.empty());
+  ASSERT_EQ(queue.release_claims(3, on_lost_job), 0);
+  ASSERT_EQ(lost_jobs, std::vector<JobSharedMessage *>{make_job(1)});
+
+  // the abandoned push is skipped
+  ASSERT_EQ(queue.pop(enqueue_time_ns, 4), make_job(2));
+  ASSERT_TRUE(queue.push(make_job(4), 0, 0, 1));
+  ASSERT_TRUE(queue.push(make_job(5), 0, 0, 1));
+  ASSERT_TRUE(queue.push(make_job(6), 0, 0, 1));
+  ASSERT_FALSE(queue.push(make_job(7), 0, 0, 1));
+  for (uintptr_t i = 3; i <= 6; ++i) {
+    ASSERT_EQ(queue.pop(enqueue_time_ns, 4), make_job(i));
+  }
+  ASSERT_EQ(queue.pop(enqueue_time_ns, 4), nullptr);
+}
+
+TEST(job_queue_test, test_release_idle_of_dead_worker) {
+  JobSchedulerHolder holder{8};
+  JobScheduler &scheduler = *holder.queue;
+
+  scheduler.mark_idle(1);
+  scheduler.mark_idle(2);
+  ASSERT_EQ(scheduler.idle_workers.load(), 2);
+  scheduler.unmark_idle(1);
+  // the worker has been woken up, so its death doesn't change the count
+  ASSERT_FALSE(scheduler.release_idle(1));
+  ASSERT_EQ(scheduler.idle_workers.load(), 1);
+
+  // the worker has died while waiting for the wakeup, the restarted one isn't counted until it waits itself
+  ASSERT_TRUE(scheduler.release_idle(2));
+  ASSERT_FALSE(scheduler.release_idle(2));
+  ASSERT_EQ(scheduler.idle_workers.load(), 0);
+  scheduler.mark_idle(2);
+  ASSERT_EQ(scheduler.idle_workers.load(), 1);
+}
@@ -0,0 +1,69 @@
+// Compiler for PHP (aka KPHP)
+// Copyright (c) 2021 LLC «V Kontakte»
+// Distributed under the GPL v3 License, see LICENSE.notice.txt
+
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "server/job-workers/job-worker-pools.h"
+
+using namespace job_workers;
+
+namespace {
+
+std::string write_config(const char *content) {
+  char path[] = "/tmp/job-worker-pools-test-XXXXXX";
+  const int fd = mkstemp(path);
+  EXPECT_NE(fd, -1);
+  FILE *file = fdopen(fd, "w");
+  fputs(content, file);
+  fclose(file);
+  return path;
+}
+
+} // namespace
+
+TEST(job_worker_pools_test, test_pools) {
+  auto &pools = vk::singleton<JobWorkerPools>::get();
+  ASSERT_EQ(pools.get_pools_count(), 1);
+  ASSERT_EQ(pools.get_pool(JobWorkerPools::DEFAULT_POOL_ID).name, "default");
+
+  const std::string bad_config = write_config(
+    "pools:\n"
+    "- { name: ml, workers: 2, classes: [A] }\n"
+    "- { name: fanout, workers: 3, classes: [A] }\n");
+  ASSERT_EQ(pools.parse_config(bad_config.c_str()), -1);
+  std::remove(bad_config.c_str());
+
+  const std::string config = write_config(
+    "pools:\n"
+    "- name: ml\n"
+    "  workers: 2\n"
+    "  memory_limit: 256m\n"
+    "  classes: ['\\VK\\Ml\\Predict']\n"
+    "- { name: fanout, workers: 3, classes: [Fetch, Rank] }\n");
+  // the pools of the failed config are not added
+  ASSERT_EQ(pools.get_pools_count(), 1);
+  ASSERT_EQ(pools.parse_config(config.c_str()), 0);
+  std::remove(config.c_str());
+  ASSERT_EQ(pools.get_pools_count(), 3);
+  ASSERT_EQ(pools.get_pool(1).memory_limit, 256 << 20);
+  ASSERT_EQ(pools.get_pool(2).memory_limit, 0);
+
+  ASSERT_FALSE(pools.init(5));
+  ASSERT_TRUE(pools.init(10));
+  ASSERT_EQ(pools.get_pool(JobWorkerPools::DEFAULT_POOL_ID).workers_count, 5);
+
+  const uint16_t expected_pools[] = {0, 0, 0, 0, 0, 1, 1, 2, 2, 2};
+  for (uint16_t worker = 0; worker != 10; ++worker) {
+    ASSERT_EQ(pools.get_pool_id_by_worker(worker), expected_pools[worker]);
+  }
+  ASSERT_EQ(pools.get_first_worker_index(0), 0);
+  ASSERT_EQ(pools.get_first_worker_index(1), 5);
+  ASSERT_EQ(pools.get_first_worker_index(2), 7);
+
+  ASSERT_EQ(pools.get_pool_id_by_request_class("VK\\Ml\\Predict"), 1);
+  ASSERT_EQ(pools.get_pool_id_by_request_class("Rank"), 2);
+  ASSERT_EQ(pools.get_pool_id_by_request_class("Unknown"), JobWorkerPools::DEFAULT_POOL_ID);
+}
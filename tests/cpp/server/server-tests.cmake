@@ -1,4 +1,6 @@
 prepend(SERVER_TESTS_SOURCES ${BASE_DIR}/tests/cpp/server/
+        job-workers/job-queue-test.cpp
+        job-workers/job-worker-pools-test.cpp
         job-workers/shared-memory-manager-test.cpp
         cluster-name-test.cpp
         confdata-binlog-events-test.cpp
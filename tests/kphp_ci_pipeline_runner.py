@@ -328,6 +328,19 @@ if __name__ == "__main__":
         skip=args.steps and "kphp-tests" not in args.steps
     )
 
+    runner.add_test_group(
+        name="kphp-tests-jumbo",
+        description="run kphp tests with jumbo cpp files in {} mode".format("gcc"),
+        cmd="KPHP_TESTS_POLYFILLS_REPO={kphp_polyfills_repo} "
+            "KPHP_JUMBO_SIZE=5000 "
+            "{kphp_runner} -j{{jobs}} {distcc_options}".format(
+            kphp_polyfills_repo=kphp_polyfills_repo,
+            kphp_runner=kphp_test_runner,
+            distcc_options=distcc_options
+        ),
+        skip=args.steps and "kphp-tests-jumbo" not in args.steps
+    )
+
     if args.zend_repo:
         runner.add_test_group(
             name="zend-tests",
@@ -0,0 +1,68 @@
+@ok
+KPHP_JUMBO_SIZE=200
+<?php
+
+// the functions below are compiled as a part of the jumbo .cpp files,
+// so their static vars, lambdas and const arrays should not clash with each other
+
+class A {
+  public $values = [];
+
+  public function add(int $x) {
+    static $calls = 0;
+    $calls++;
+    $this->values[] = $x * $calls;
+    return $this;
+  }
+
+  public function sum(): int {
+    return array_reduce($this->values, function ($carry, $x) { return $carry + $x; }, 0);
+  }
+}
+
+class B {
+  public $values = [];
+
+  public function add(string $x) {
+    static $calls = 0;
+    $calls += 2;
+    $this->values[] = $x . $calls;
+    return $this;
+  }
+
+  public function sum(): string {
+    return array_reduce($this->values, function ($carry, $x) { return $carry . $x; }, '');
+  }
+}
+
+function counter_a() {
+  static $calls = 0;
+  return ++$calls;
+}
+
+function counter_b() {
+  static $calls = 100;
+  return ++$calls;
+}
+
+function names_a() {
+  $names = ['a' => 1, 'b' => 2, 'c' => 3];
+  return array_map(function ($x) { return $x * 10; }, $names);
+}
+
+function names_b() {
+  $names = ['a' => 'x', 'b' => 'y'];
+  return array_map(function ($x) { return $x . $x; }, $names);
+}
+
+function test_jumbo_functions() {
+  for ($i = 0; $i < 3; ++$i) {
+    echo counter_a(), " ", counter_b(), "\n";
+  }
+  var_dump(names_a());
+  var_dump(names_b());
+  echo (new A)->add(1)->add(2)->add(3)->sum(), "\n";
+  echo (new B)->add('x')->add('y')->sum(), "\n";
+}
+
+test_jumbo_functions();
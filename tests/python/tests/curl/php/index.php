@@ -17,6 +17,12 @@ function main() {
     case "/test_curl":
       test_curl();
       return;
+    case "/test_curl_in_forks":
+      test_curl_in_forks();
+      return;
+    case "/test_curl_multi_with_many_fds":
+      test_curl_multi_with_many_fds();
+      return;
   }
 
   critical_error("unknown test");
@@ -50,4 +56,64 @@ function test_curl() {
   echo json_encode($resp);
 }
 
+function curl_get(string $url) {
+  $ch = curl_init($url);
+  curl_setopt($ch, CURLOPT_RETURNTRANSFER, 1);
+  $output = curl_exec($ch);
+  curl_close($ch);
+  return is_string($output) ? json_decode($output) : $output;
+}
+
+function test_curl_in_forks() {
+  $params = json_decode(file_get_contents('php://input'));
+
+  $futures = [];
+  foreach ($params["urls"] as $url) {
+    $futures[] = fork(curl_get((string)$url));
+  }
+
+  $resp = [];
+  foreach ($futures as $future) {
+    $resp[] = wait($future);
+  }
+  echo json_encode($resp);
+}
+
+function test_curl_multi_with_many_fds() {
+  $params = json_decode(file_get_contents('php://input'));
+
+  // the curl sockets get the descriptors above FD_SETSIZE
+  $files = [];
+  for ($i = 0; $i < (int)$params["files"]; ++$i) {
+    $files[] = fopen("/dev/null", "r");
+  }
+
+  $mh = curl_multi_init();
+  $ch = curl_init((string)$params["url"]);
+  curl_setopt($ch, CURLOPT_RETURNTRANSFER, 1);
+  curl_multi_add_handle($mh, $ch);
+
+  $ready_selects = 0;
+  $still_running = 0;
+  do {
+    curl_multi_exec($mh, $still_running);
+    if ($still_running && curl_multi_select($mh, 5.0) > 0) {
+      ++$ready_selects;
+    }
+  } while ($still_running);
+
+  $output = curl_multi_getcontent($ch);
+  curl_multi_remove_handle($mh, $ch);
+  curl_close($ch);
+  curl_multi_close($mh);
+  foreach ($files as $file) {
+    fclose($file);
+  }
+
+  echo json_encode([
+    "exec_result" => is_string($output) ? json_decode($output) : $output,
+    "sockets_were_ready" => $ready_selects > 0
+  ]);
+}
+
 main();
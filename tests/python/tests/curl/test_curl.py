@@ -4,6 +4,13 @@ from python.lib.testcase import KphpServerAutoTestCase
 class TestCurl(KphpServerAutoTestCase):
     maxDiff = 16 * 1024
 
+    @classmethod
+    def extra_class_setup(cls):
+        # allows the worker to open more than FD_SETSIZE descriptors
+        cls.kphp_server.update_options({
+            "--connections": 2000
+        })
+
     def _curl_request(self, uri, return_transfer=1, post=None, headers=None):
         resp = self.kphp_server.http_post(
             uri="/test_curl",
@@ -57,3 +64,24 @@ class TestCurl(KphpServerAutoTestCase):
                     "HTTP_HELLO": "world",
                     "HTTP_FOO": "bar"
                 })})
+
+    def test_curl_in_forks(self):
+        uris = ["/echo/test_fork_{}".format(i) for i in range(5)]
+        resp = self.kphp_server.http_post(
+            uri="/test_curl_in_forks",
+            json={"urls": ["localhost:{}{}".format(self.kphp_server.http_port, uri) for uri in uris]})
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.json(), [self._prepare_result(uri, "GET") for uri in uris])
+
+    def test_curl_multi_with_many_fds(self):
+        resp = self.kphp_server.http_post(
+            uri="/test_curl_multi_with_many_fds",
+            json={
+                "url": "localhost:{}/echo/test_many_fds".format(self.kphp_server.http_port),
+                "files": 1100
+            })
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.json(), {
+            "exec_result": self._prepare_result("/echo/test_many_fds", "GET"),
+            "sockets_were_ready": True
+        })
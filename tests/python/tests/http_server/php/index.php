@@ -46,6 +46,16 @@ if ($_SERVER["PHP_SELF"] === "/ini_get") {
         $res = 0;
     }
     echo json_encode(['len' => $res]);
+} else if ($_SERVER["PHP_SELF"] === "/test_streaming") {
+  header("X-Streaming: yes");
+  echo "first line\n";
+  flush();
+  header("X-Too-Late: yes");
+  for ($i = 0; $i < (int)$_GET["lines"]; ++$i) {
+    echo str_repeat("x", 99), "\n";
+  }
+  flush();
+  echo "last line";
 } else {
   echo "Hello world!";
 }
@@ -0,0 +1,85 @@
+import socket
+import struct
+
+from hpack import Decoder, Encoder
+
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestHttp2(KphpServerAutoTestCase):
+    @staticmethod
+    def _frame(frame_type, flags, stream_id, payload=b""):
+        return struct.pack(">I", len(payload))[1:] + struct.pack(">BBI", frame_type, flags, stream_id) + payload
+
+    def _send_requests(self, requests):
+        """
+        Sends the requests as the concurrent streams of one h2c connection.
+        Returns the dict of stream id to the response headers and body.
+        """
+        encoder = Encoder()
+        data = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" + self._frame(4, 0, 0)
+        for i, (headers, body) in enumerate(requests):
+            data += self._frame(1, 0x4 if body else 0x5, 2 * i + 1, encoder.encode(headers))
+        # the bodies follow all the heads, so the streams are interleaved
+        for i, (headers, body) in enumerate(requests):
+            if body:
+                data += self._frame(0, 0x1, 2 * i + 1, body)
+
+        s = socket.create_connection(('127.0.0.1', self.kphp_server.http_port), timeout=30)
+        s.sendall(data)
+        decoder = Decoder()
+        responses = {}
+        finished = set()
+        buffer = b""
+        while len(finished) < len(requests):
+            chunk = s.recv(65536)
+            if not chunk:
+                break
+            buffer += chunk
+            while len(buffer) >= 9:
+                length = struct.unpack(">I", b"\0" + buffer[:3])[0]
+                if len(buffer) < 9 + length:
+                    break
+                frame_type, flags, stream_id = struct.unpack(">BBI", buffer[3:9])
+                payload = buffer[9:9 + length]
+                buffer = buffer[9 + length:]
+                if frame_type == 1:
+                    responses[stream_id] = (dict(decoder.decode(payload)), b"")
+                elif frame_type == 0:
+                    headers, body = responses[stream_id]
+                    responses[stream_id] = (headers, body + payload)
+                if frame_type in (0, 1) and flags & 0x1:
+                    finished.add(stream_id)
+        s.close()
+        return responses
+
+    def test_concurrent_streams(self):
+        common = [(":scheme", "http"), (":authority", "localhost")]
+        responses = self._send_requests([
+            ([(":method", "GET"), (":path", "/status")] + common, b""),
+            ([(":method", "POST"), (":path", "/test_big_post_data")] + common +
+             [("content-type", "application/x-www-form-urlencoded")], b"abc=1"),
+            ([(":method", "GET"), (":path", "/test_streaming?lines=10")] + common, b""),
+        ])
+        self.assertEqual(sorted(responses.keys()), [1, 3, 5])
+
+        headers, body = responses[1]
+        self.assertEqual(headers[":status"], "200")
+        self.assertEqual(body, b"Hello world!")
+
+        headers, body = responses[3]
+        self.assertEqual(headers[":status"], "200")
+        self.assertEqual(body, b'{"len":3}')
+
+        headers, body = responses[5]
+        self.assertEqual(headers[":status"], "200")
+        self.assertEqual(headers["x-streaming"], "yes")
+        self.assertNotIn("transfer-encoding", headers)
+        self.assertNotIn("connection", headers)
+        self.assertEqual(body, ("first line\n" + ("x" * 99 + "\n") * 10 + "last line").encode())
+
+    def test_head_request(self):
+        responses = self._send_requests([([(":method", "HEAD"), (":scheme", "http"), (":path", "/status")], b"")])
+        headers, body = responses[1]
+        self.assertEqual(headers[":status"], "200")
+        self.assertEqual(body, b"")
@@ -1,3 +1,4 @@
+import socket
 import urllib
 
 from python.lib.testcase import KphpServerAutoTestCase
@@ -53,3 +54,17 @@ class TestRequest(KphpServerAutoTestCase):
         ])
         self.assertEqual(response.status_code, 200)
         self.assertEqual(response.content, b"Hello world!")
+
+    def test_pipelined_keep_alive_requests(self):
+        s = socket.create_connection(('127.0.0.1', self.kphp_server.http_port), timeout=30)
+        s.sendall(b"GET /status HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+                  b"GET /status?second HTTP/1.1\r\n\r\n")
+        response = b""
+        while True:
+            buffer = s.recv(4096)
+            if not buffer:
+                break
+            response += buffer
+        s.close()
+        self.assertEqual(response.count(b" 200 OK\r\n"), 2)
+        self.assertEqual(response.count(b"Hello world!"), 2)
@@ -0,0 +1,33 @@
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestStreaming(KphpServerAutoTestCase):
+    @classmethod
+    def extra_class_setup(cls):
+        cls.kphp_server.update_options({
+            "--http-streaming-buffer-size": "4k"
+        })
+
+    def _expected_body(self, lines):
+        return "first line\n" + ("x" * 99 + "\n") * lines + "last line"
+
+    def test_streaming_response(self):
+        for lines in (0, 10, 1000):
+            response = self.kphp_server.http_get("/test_streaming?lines={}".format(lines))
+            self.assertEqual(response.status_code, 200)
+            self.assertEqual(response.headers["Transfer-Encoding"], "chunked")
+            self.assertEqual(response.headers["X-Streaming"], "yes")
+            self.assertNotIn("Content-Length", response.headers)
+            self.assertNotIn("X-Too-Late", response.headers)
+            self.assertEqual(response.text, self._expected_body(lines))
+
+    def test_http10_response_is_not_streamed(self):
+        response = self.kphp_server.http_request_raw([b"GET /test_streaming?lines=10 HTTP/1.0"])
+        self.assertEqual(response.status_code, 200)
+        self.assertEqual(response.headers["Content-Length"], str(len(self._expected_body(10))))
+        self.assertEqual(response.content, self._expected_body(10).encode())
+
+    def test_head_response_is_not_streamed(self):
+        response = self.kphp_server.http_request(uri="/test_streaming?lines=10", method='HEAD')
+        self.assertEqual(response.status_code, 200)
+        self.assertNotIn("Transfer-Encoding", response.headers)
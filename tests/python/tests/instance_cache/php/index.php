@@ -14,6 +14,14 @@ function main() {
       test_delete();
       return;
     }
+    case "/store_large": {
+      test_store_large();
+      return;
+    }
+    case "/fetch_large": {
+      test_fetch_large();
+      return;
+    }
   }
 
   critical_error("unknown test " . $_SERVER["PHP_SELF"]);
@@ -145,4 +153,28 @@ function test_delete() {
   instance_cache_delete($data["key"]);
 }
 
+/** @kphp-immutable-class */
+class TestLargeClass {
+  function __construct(int $size) {
+    for ($i = 0; $i != $size; ++$i) {
+      $this->arr[] = str_repeat("x", 100) . $i;
+    }
+  }
+
+  /** @var string[] */
+  public $arr = [];
+}
+
+function test_store_large() {
+  $data = json_decode(file_get_contents('php://input'));
+  echo json_encode(["result" => instance_cache_store($data["key"], new TestLargeClass((int)$data["size"]))]);
+}
+
+function test_fetch_large() {
+  $data = json_decode(file_get_contents('php://input'));
+  /** @var TestLargeClass $instance */
+  $instance = instance_cache_fetch(TestLargeClass::class, $data["key"]);
+  echo json_encode(["size" => $instance ? count($instance->arr) : -1]);
+}
+
 main();
@@ -0,0 +1,34 @@
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestLargeElement(KphpServerAutoTestCase):
+    @classmethod
+    def extra_class_setup(cls):
+        cls.kphp_server.update_options({
+            "--instance-cache-memory-limit": "16m"
+        })
+
+    def test_store_element_larger_than_arena(self):
+        # about 3.5MB, while an arena of a shard is less than limit / 16
+        size = 20000
+        stats_before = self.kphp_server.get_stats(prefix="kphp_server.instance_cache_")
+        resp = self.kphp_server.http_post(
+            uri="/store_large",
+            json={"key": "large_key", "size": size})
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.json(), {"result": True})
+
+        resp = self.kphp_server.http_post(
+            uri="/fetch_large",
+            json={"key": "large_key"})
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.json(), {"size": size})
+
+        self.kphp_server.assert_stats(
+            initial_stats=stats_before,
+            prefix="kphp_server.instance_cache_",
+            expected_added_stats={
+                "elements_stored": 1,
+                "memory_buffer_swaps_ok": 0,
+                "memory_buffer_swaps_fail": 0
+            })
@@ -27,7 +27,7 @@ function parse_input() {
   return tuple($arr, $batch_count, $limit, $error_indices);
 }
 
-function test_job_worker_start_multi_impl(bool $use_shared_data) {
+function test_job_worker_start_multi_impl(bool $use_shared_data, bool $start_one_by_one = false) {
   [$arr, $batch_count, $limit, $error_indices] = parse_input();
 
   $shared_data = null;
@@ -52,7 +52,14 @@ function test_job_worker_start_multi_impl(bool $use_shared_data) {
     $offset += $limit;
   }
 
-  $job_ids = kphp_job_worker_start_multi($requests, -1);
+  if ($start_one_by_one) {
+    $job_ids = [];
+    foreach ($requests as $req) {
+      $job_ids[] = kphp_job_worker_start($req, -1);
+    }
+  } else {
+    $job_ids = kphp_job_worker_start_multi($requests, -1);
+  }
   foreach ($requests as $req) {
     if ($req instanceof SumJobRequestWithSharedData) {
       if ($req->shared_data !== $shared_data) {
@@ -86,6 +93,10 @@ function test_job_worker_start_multi_with_shared_data() {
   test_job_worker_start_multi_impl(true);
 }
 
+function test_job_worker_start_with_shared_data() {
+  test_job_worker_start_multi_impl(true, true);
+}
+
 function test_job_worker_start_multi_without_shared_data() {
   test_job_worker_start_multi_impl(false);
 }
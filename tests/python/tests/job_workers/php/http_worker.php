@@ -54,6 +54,10 @@ function do_http_worker() {
       test_job_worker_start_multi_with_shared_data();
       return;
     }
+    case "/test_job_worker_start_with_shared_data": {
+      test_job_worker_start_with_shared_data();
+      return;
+    }
     case "/test_job_worker_start_multi_without_shared_data": {
       test_job_worker_start_multi_without_shared_data();
       return;
@@ -70,6 +70,8 @@ class TestComplexScenarioJob(KphpServerAutoTestCase):
                 "jobs_queue_size": 0,
                 "jobs_sent": requests_count * 5,
                 "jobs_replied": requests_count * 5,
+                "jobs_started": requests_count * 5,
+                "queue_errors_full": 0,
                 "pipe_errors_server_write": 0,
                 "pipe_errors_server_read": 0,
                 "pipe_errors_client_write": 0,
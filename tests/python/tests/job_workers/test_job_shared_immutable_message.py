@@ -30,6 +30,11 @@ class TestJobSharedImmutableMessage(KphpServerAutoTestCase):
         self._test_job_worker_start_multi(uri='/test_job_worker_start_multi_with_shared_data',
                                           jobs_cnt=10, with_shared_data=True)
 
+    def test_job_worker_start_with_shared_data(self):
+        # the shared data is copied once and reused by the jobs started one by one
+        self._test_job_worker_start_multi(uri='/test_job_worker_start_with_shared_data',
+                                          jobs_cnt=10, with_shared_data=True, shared_data_reuses=9)
+
     def test_job_worker_start_multi_without_shared_data(self):
         self._test_job_worker_start_multi(uri='/test_job_worker_start_multi_without_shared_data',
                                           jobs_cnt=2, with_shared_data=False)
@@ -38,7 +43,7 @@ class TestJobSharedImmutableMessage(KphpServerAutoTestCase):
         self._test_job_worker_start_multi(uri='/test_job_worker_start_multi_with_errors',
                                           jobs_cnt=10, errors_cnt=5, with_shared_data=True)
 
-    def _test_job_worker_start_multi(self, *, uri, with_shared_data, jobs_cnt, errors_cnt=0):
+    def _test_job_worker_start_multi(self, *, uri, with_shared_data, jobs_cnt, errors_cnt=0, shared_data_reuses=0):
         stats_before = self.kphp_server.get_stats()
 
         start, end, step = 0, 2000000, 1
@@ -91,6 +96,8 @@ class TestJobSharedImmutableMessage(KphpServerAutoTestCase):
                 "kphp_server.workers_job_memory_messages_extra_buffers_32mb_buffer_acquire_fails": 0,
                 "kphp_server.workers_job_memory_messages_extra_buffers_64mb_buffers_acquired": 0,
                 "kphp_server.workers_job_memory_messages_extra_buffers_64mb_buffer_acquire_fails": 0,
+                "kphp_server.workers_job_memory_shared_memory_pieces_published": int(with_shared_data),
+                "kphp_server.workers_job_memory_shared_memory_pieces_reused": shared_data_reuses,
             })
 
     def _test_shared_memory_piece_copying_impl(self, label):
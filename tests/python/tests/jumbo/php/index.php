@@ -0,0 +1,85 @@
+<?php
+
+class Counter {
+  public $values = [];
+
+  public function add(int $x) {
+    static $calls = 0;
+    $calls++;
+    $this->values[] = $x * $calls;
+    return $this;
+  }
+
+  public function sum(): int {
+    return array_reduce($this->values, function ($carry, $x) { return $carry + $x; }, 0);
+  }
+}
+
+class Joiner {
+  public $values = [];
+
+  public function add(string $x) {
+    static $calls = 0;
+    $calls += 2;
+    $this->values[] = $x . $calls;
+    return $this;
+  }
+
+  public function sum(): string {
+    return array_reduce($this->values, function ($carry, $x) { return $carry . $x; }, '');
+  }
+}
+
+function counter_a() {
+  static $calls = 0;
+  return ++$calls;
+}
+
+function counter_b() {
+  static $calls = 100;
+  return ++$calls;
+}
+
+function names_a() {
+  $names = ['a' => 1, 'b' => 2, 'c' => 3];
+  return array_map(function ($x) { return $x * 10; }, $names);
+}
+
+function names_b() {
+  $names = ['a' => 'x', 'b' => 'y'];
+  return array_map(function ($x) { return $x . $x; }, $names);
+}
+
+function split_words(string $s) {
+  $words = [];
+  foreach (explode(' ', $s) as $word) {
+    if ($word !== '') {
+      $words[] = strtoupper($word);
+    }
+  }
+  return $words;
+}
+
+function count_chars_in(array $words) {
+  $total = 0;
+  foreach ($words as $word) {
+    $total += strlen($word);
+  }
+  return $total;
+}
+
+function jumbo_marker() {
+  return 1000;
+}
+
+for ($i = 0; $i < 3; ++$i) {
+  echo counter_a(), " ", counter_b(), "\n";
+}
+var_dump(names_a());
+var_dump(names_b());
+echo (new Counter)->add(1)->add(2)->add(3)->sum(), "\n";
+echo (new Joiner)->add('x')->add('y')->sum(), "\n";
+$words = split_words("jumbo  cpp files are compiled  together");
+var_dump($words);
+echo count_chars_in($words), "\n";
+echo jumbo_marker(), "\n";
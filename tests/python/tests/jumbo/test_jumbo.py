@@ -0,0 +1,63 @@
+import glob
+import os
+import shutil
+import time
+
+from python.lib.testcase import KphpCompilerAutoTestCase
+
+
+class TestJumbo(KphpCompilerAutoTestCase):
+    KPHP_ENV = {"KPHP_JUMBO_SIZE": "200"}
+
+    @staticmethod
+    def _build_dir(once_runner):
+        return os.path.dirname(once_runner.kphp_runtime_bin)
+
+    def _jumbo_objs_mtimes(self, once_runner):
+        objs = glob.glob(os.path.join(self._build_dir(once_runner), "objs/**/_jumbo_*.o"), recursive=True)
+        return {obj: os.stat(obj).st_mtime_ns for obj in objs}
+
+    def _compare_with_php(self, once_runner):
+        self.assertTrue(once_runner.run_with_php(), "Got PHP error")
+        self.assertTrue(once_runner.compile_with_kphp(self.KPHP_ENV), "Got KPHP build error")
+        self.assertTrue(once_runner.run_with_kphp(), "Got KPHP runtime error")
+        self.assertTrue(once_runner.compare_php_and_kphp_stdout(), "Got PHP and KPHP diff")
+
+    def test_jumbo_build(self):
+        once_runner = self.build_and_compare_with_php("php/index.php", self.KPHP_ENV)
+        build_dir = self._build_dir(once_runner)
+        jumbo_cpps = glob.glob(os.path.join(build_dir, "kphp/**/_jumbo_*.cpp"), recursive=True)
+        self.assertTrue(jumbo_cpps, "No jumbo cpp files are generated")
+        self.assertTrue(self._jumbo_objs_mtimes(once_runner), "No jumbo objects are compiled")
+
+        # the functions of the jumbo cpp files are compiled only as their part
+        for jumbo_cpp in jumbo_cpps:
+            with open(jumbo_cpp) as f:
+                included_cpps = [line.split('"')[1] for line in f if line.startswith("#include") and line.rstrip().endswith('.cpp"')]
+            self.assertGreater(len(included_cpps), 1)
+            for included_cpp in included_cpps:
+                obj = os.path.join(build_dir, "objs", included_cpp[:-len(".cpp")] + ".o")
+                self.assertFalse(os.path.exists(obj), "{} is compiled separately".format(included_cpp))
+
+    def test_jumbo_incremental_build(self):
+        src_dir = os.path.join(self.kphp_build_working_dir, "jumbo_src")
+        os.makedirs(src_dir, exist_ok=True)
+        src_file = os.path.join(src_dir, "index.php")
+        shutil.copy(os.path.join(self.test_dir, "php/index.php"), src_file)
+
+        once_runner = self.make_kphp_once_runner(src_file)
+        self._compare_with_php(once_runner)
+        objs_before = self._jumbo_objs_mtimes(once_runner)
+
+        time.sleep(1)
+        with open(src_file) as f:
+            source = f.read()
+        with open(src_file, "w") as f:
+            f.write(source.replace("return 1000;", "return 2000;"))
+        self._compare_with_php(once_runner)
+        objs_after = self._jumbo_objs_mtimes(once_runner)
+
+        # only the group of the changed function is recompiled
+        self.assertEqual(objs_before.keys(), objs_after.keys())
+        recompiled = [obj for obj, mtime in objs_after.items() if mtime != objs_before[obj]]
+        self.assertLessEqual(len(recompiled), 1, "Recompiled jumbo objects: {}".format(recompiled))
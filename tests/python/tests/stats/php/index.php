@@ -39,6 +39,32 @@ function get_stats_by_rpc() {
   echo json_encode($result["result"]);
 }
 
+function get_stats_by_rpc_in_fork(int $port) {
+  $connection = new_rpc_connection("localhost", $port);
+  $req = rpc_tl_query_one($connection, ['_' => "engine.stat"]);
+  $result = rpc_tl_query_result_one($req);
+  return isset($result["result"]);
+}
+
+function get_stats_by_rpc_from_forks() {
+  $port = (int)$_GET["master-port"];
+  // establish the connection
+  if (!get_stats_by_rpc_in_fork($port)) {
+    critical_error("rpc query failed!");
+  }
+
+  $ids = [];
+  for ($i = 0; $i < (int)$_GET["forks"]; ++$i) {
+    $ids[] = fork(get_stats_by_rpc_in_fork($port));
+  }
+  foreach ($ids as $id) {
+    if (!wait($id)) {
+      critical_error("rpc query failed!");
+    }
+  }
+  echo "OK";
+}
+
 function do_http_worker() {
   switch($_SERVER["PHP_SELF"]) {
     case "/get_stats_by_mc": {
@@ -49,6 +75,10 @@ function do_http_worker() {
       get_stats_by_rpc();
       return;
     }
+    case "/get_stats_by_rpc_from_forks": {
+      get_stats_by_rpc_from_forks();
+      return;
+    }
   }
 
   run_default();
@@ -0,0 +1,18 @@
+from python.lib.testcase import KphpServerAutoTestCase
+
+
+class TestRpcBatching(KphpServerAutoTestCase):
+    def test_rpc_queries_from_forks_flushed_together(self):
+        initial_stats = self.kphp_server.get_stats(prefix="kphp_server.")
+        resp = self.kphp_server.http_get("/get_stats_by_rpc_from_forks?master-port={}&forks=5".format(self.kphp_server.master_port))
+        self.assertEqual(resp.status_code, 200)
+        self.assertEqual(resp.text, "OK")
+
+        self.kphp_server.assert_stats(
+            initial_stats=initial_stats,
+            prefix="kphp_server.",
+            expected_added_stats={
+                "workers_general_rpc_total_flushed_queries": self.cmpGe(5),
+                "workers_general_rpc_total_batched_flushes": self.cmpGe(1)
+            }
+        )